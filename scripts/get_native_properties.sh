@@ -39,7 +39,11 @@ set_arch_loongarch64() {
 
 # Set the file CPU x86_64 architecture
 set_arch_x86_64() {
-  if check_flags 'avx512vnni' 'avx512dq' 'avx512f' 'avx512bw' 'avx512vl'; then
+  if check_flags 'amxtile' 'amxint8' 'avx512vbmi2' 'avx512vnni' 'avx512dq' 'avx512f' 'avx512bw' 'avx512vl'; then
+    true_arch='x86-64-amx'
+  elif check_flags 'avx512vbmi2' 'avx512vnni' 'avx512dq' 'avx512f' 'avx512bw' 'avx512vl'; then
+    true_arch='x86-64-avx512icl'
+  elif check_flags 'avx512vnni' 'avx512dq' 'avx512f' 'avx512bw' 'avx512vl'; then
     true_arch='x86-64-vnni256'
   elif check_flags 'avx512f' 'avx512bw'; then
     true_arch='x86-64-avx512'
@@ -81,7 +85,7 @@ case $uname_s in
       'x86_64')
         flags=$(sysctl -n machdep.cpu.features machdep.cpu.leaf7_features | tr '\n' ' ' | tr '[:upper:]' '[:lower:]' | tr -d '_.')
         set_arch_x86_64
-        if [ "$true_arch" = 'x86-64-vnni256' ] || [ "$true_arch" = 'x86-64-avx512' ]; then
+        if [ "$true_arch" = 'x86-64-amx' ] || [ "$true_arch" = 'x86-64-avx512icl' ] || [ "$true_arch" = 'x86-64-vnni256' ] || [ "$true_arch" = 'x86-64-avx512' ]; then
            file_arch='x86-64-bmi2'
         fi
         ;;
@@ -108,7 +112,13 @@ case $uname_s in
       'aarch64')
         file_os='android'
         true_arch='armv8'
-        if check_flags 'asimddp'; then
+        if check_flags 'asimddp' 'i8mm' 'sve2'; then
+          true_arch='armv9-sve2'
+          file_arch='armv8-dotprod'
+        elif check_flags 'asimddp' 'i8mm'; then
+          true_arch="$true_arch-i8mm"
+          file_arch='armv8-dotprod'
+        elif check_flags 'asimddp'; then
           true_arch="$true_arch-dotprod"
         fi
         ;;
@@ -18,7 +18,9 @@
 
 #include "benchmark.h"
 #include "numa.h"
+#include "trainingdata.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -372,30 +374,12 @@ const std::vector<std::vector<std::string>> BenchmarkPositions = {
 
 namespace Stockfish::Benchmark {
 
-// Builds a list of UCI commands to be run by bench. There
-// are five parameters: TT size in MB, number of search threads that
-// should be used, the limit value spent for each position, a file name
-// where to look for positions in FEN format, and the type of the limit:
-// depth, perft, nodes and movetime (in milliseconds). Examples:
-//
-// bench                            : search default positions up to depth 13
-// bench 64 1 15                    : search default positions up to depth 15 (TT = 64MB)
-// bench 64 1 100000 default nodes  : search default positions for 100K nodes each
-// bench 64 4 5000 current movetime : search current position with 4 threads for 5 sec
-// bench 16 1 5 blah perft          : run a perft 5 on positions in file "blah"
-std::vector<std::string> setup_bench(const std::string& currentFen, std::istream& is) {
-
-    std::vector<std::string> fens, list;
-    std::string              go, token;
-
-    // Assign default values to missing arguments
-    std::string ttSize    = (is >> token) ? token : "16";
-    std::string threads   = (is >> token) ? token : "1";
-    std::string limit     = (is >> token) ? token : "13";
-    std::string fenFile   = (is >> token) ? token : "default";
-    std::string limitType = (is >> token) ? token : "depth";
+// Returns the list of positions of the given source: "default" for the
+// built-in bench positions, "current" for the current position, otherwise
+// the name of a file with one FEN string (optionally followed by moves) per line.
+std::vector<std::string> read_positions(const std::string& currentFen, const std::string& fenFile) {
 
-    go = limitType == "eval" ? "eval" : "go " + limitType + " " + limit;
+    std::vector<std::string> fens;
 
     if (fenFile == "default")
         fens = Defaults;
@@ -403,6 +387,16 @@ std::vector<std::string> setup_bench(const std::string& currentFen, std::istream
     else if (fenFile == "current")
         fens.push_back(currentFen);
 
+    else if (TrainingData::is_packed(fenFile))
+    {
+        if (!TrainingData::read(fenFile,
+                                [&](const TrainingPosition& p) { fens.push_back(p.fen); }))
+        {
+            std::cerr << "Unable to read training data " << fenFile << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
     else
     {
         std::string   fen;
@@ -421,6 +415,36 @@ std::vector<std::string> setup_bench(const std::string& currentFen, std::istream
         file.close();
     }
 
+    return fens;
+}
+
+// Builds a list of UCI commands to be run by bench. There
+// are five parameters: TT size in MB, number of search threads that
+// should be used, the limit value spent for each position, a file name
+// where to look for positions in FEN format, and the type of the limit:
+// depth, perft, nodes and movetime (in milliseconds). Examples:
+//
+// bench                            : search default positions up to depth 13
+// bench 64 1 15                    : search default positions up to depth 15 (TT = 64MB)
+// bench 64 1 100000 default nodes  : search default positions for 100K nodes each
+// bench 64 4 5000 current movetime : search current position with 4 threads for 5 sec
+// bench 16 1 5 blah perft          : run a perft 5 on positions in file "blah"
+std::vector<std::string> setup_bench(const std::string& currentFen, std::istream& is) {
+
+    std::vector<std::string> fens, list;
+    std::string              go, token;
+
+    // Assign default values to missing arguments
+    std::string ttSize    = (is >> token) ? token : "16";
+    std::string threads   = (is >> token) ? token : "1";
+    std::string limit     = (is >> token) ? token : "13";
+    std::string fenFile   = (is >> token) ? token : "default";
+    std::string limitType = (is >> token) ? token : "depth";
+
+    go = limitType == "eval" ? "eval" : "go " + limitType + " " + limit;
+
+    fens = read_positions(currentFen, fenFile);
+
     list.emplace_back("setoption name Threads value " + threads);
     list.emplace_back("setoption name Hash value " + ttSize);
     list.emplace_back("ucinewgame");
@@ -509,4 +533,205 @@ BenchmarkSetup setup_benchmark(std::istream& is) {
     return setup;
 }
 
+// Parses the arguments of the analyse command, which searches a list of
+// positions concurrently. The optional parameters "file" and "threads-per-job"
+// select the positions (see read_positions) and the size of each thread group,
+// the remaining arguments are the search limits as in the go command. Examples:
+//
+// analyse                                   : search current position up to depth 13
+// analyse file default depth 16             : search default positions up to depth 16
+// analyse file blah threads-per-job 2 nodes 100000
+//                                           : search positions in file "blah" for 100K
+//                                             nodes each, with 2 threads per position
+//
+// With "game" followed by moves, the positions are those of the game played from
+// the current position, searched one after the other with all the threads, from
+// the last one back to the first, so that each search finds in the transposition
+// table what the searches of the positions after it learned.
+//
+// analyse game e2e4 e7e5 g1f3 depth 18      : search the 4 positions of the game up
+//                                             to depth 18, the last one first
+AnalysisSetup setup_analysis(const std::string& currentFen, std::istream& is) {
+
+    AnalysisSetup setup{};
+    std::string   fenFile = "current", token;
+
+    setup.threadsPerJob = 1;
+
+    auto is_move = [](const std::string& s) {
+        return (s.size() == 4 || s.size() == 5) && s[0] >= 'a' && s[0] <= 'h' && s[1] >= '1'
+            && s[1] <= '8' && s[2] >= 'a' && s[2] <= 'h' && s[3] >= '1' && s[3] <= '8';
+    };
+
+    while (is >> token)
+    {
+        if (token == "game")
+        {
+            while (is >> token && is_move(token))
+                setup.gameMoves.push_back(token);
+
+            setup.threadsPerJob = 0;
+            fenFile.clear();
+
+            if (!is_move(token) && !is.fail())
+                setup.limits += token + " ";
+        }
+        else if (token == "file")
+            is >> fenFile;
+        else if (token == "threads-per-job")
+        {
+            int k = 1;
+            is >> k;
+            setup.threadsPerJob = size_t(std::max(k, 1));
+        }
+        else
+            setup.limits += token + " ";
+    }
+
+    if (setup.limits.empty())
+        setup.limits = "depth 13";
+
+    if (!setup.threadsPerJob)
+    {
+        for (size_t i = setup.gameMoves.size() + 1; i-- > 0;)
+        {
+            std::string entry = currentFen + (i ? " moves" : "");
+            for (size_t j = 0; j < i; ++j)
+                entry += " " + setup.gameMoves[j];
+            setup.fens.push_back(entry);
+        }
+
+        return setup;
+    }
+
+    for (const auto& fen : read_positions(currentFen, fenFile))
+        if (fen.find("setoption") != 0)
+            setup.fens.push_back(fen);
+
+    return setup;
+}
+
+// Parses the arguments of the generate_training_data command, which plays self-play
+// games concurrently and writes their positions. The optional parameters are the
+// number of games, the file of the openings (see read_positions), played in turn,
+// the threads per game, the random moves played after the opening, the length
+// beyond which a game is drawn, the score beyond which it is won and the output
+// file. The remaining arguments are the search limits of each move. Examples:
+//
+// generate_training_data                     : 100 games from the current position
+//                                              with 5000 nodes per move
+// generate_training_data games 100000 file book.epd output data.plain nodes 10000
+//                                            : 100K games from the openings in file
+//                                              "book.epd", with 10K nodes per move
+TrainingDataSetup setup_training_data(const std::string& currentFen, std::istream& is) {
+
+    TrainingDataSetup setup{};
+    std::string       fenFile = "current", token;
+
+    setup.games          = 100;
+    setup.threadsPerGame = 1;
+    setup.randomMoves    = 8;
+    setup.maxPly         = 400;
+    setup.evalLimit      = 3000;
+    setup.output         = "training_data.plain";
+
+    while (is >> token)
+    {
+        if (token == "file")
+            is >> fenFile;
+        else if (token == "output")
+            is >> setup.output;
+        else if (token == "games")
+            is >> setup.games;
+        else if (token == "threads-per-game")
+        {
+            int k = 1;
+            is >> k;
+            setup.threadsPerGame = size_t(std::max(k, 1));
+        }
+        else if (token == "random-moves")
+            is >> setup.randomMoves;
+        else if (token == "max-ply")
+            is >> setup.maxPly;
+        else if (token == "eval-limit")
+            is >> setup.evalLimit;
+        else
+            setup.limits += token + " ";
+    }
+
+    if (setup.limits.empty())
+        setup.limits = "nodes 5000";
+
+    for (const auto& fen : read_positions(currentFen, fenFile))
+        if (fen.find("setoption") != 0)
+            setup.openings.push_back(fen);
+
+    return setup;
+}
+
+// Parses the arguments of the spsa command, which tunes the parameters of TUNE()
+// by playing game pairs concurrently, see Spsa. The optional parameters are the
+// number of game pairs, the game pairs between two writes of the results, the
+// file of the openings (see read_positions), played in turn, the threads per
+// game, the random moves played after the opening, the length beyond which a
+// game is drawn, the score beyond which it is won and the output file of the
+// results. The remaining arguments are the search limits of each move. Examples:
+//
+// spsa                                       : 10K game pairs from the current
+//                                              position with 1000 nodes per move
+// spsa pairs 100000 file book.epd output tuned.txt nodes 2000
+//                                            : 100K game pairs from the openings
+//                                              in file "book.epd", with 2000
+//                                              nodes per move
+SpsaSetup setup_spsa(const std::string& currentFen, std::istream& is) {
+
+    SpsaSetup   setup{};
+    std::string fenFile = "current", token;
+
+    setup.gamePairs      = 10000;
+    setup.checkpoint     = 1000;
+    setup.threadsPerGame = 1;
+    setup.randomMoves    = 8;
+    setup.maxPly         = 400;
+    setup.evalLimit      = 3000;
+    setup.output         = "spsa_results.txt";
+
+    while (is >> token)
+    {
+        if (token == "file")
+            is >> fenFile;
+        else if (token == "output")
+            is >> setup.output;
+        else if (token == "pairs")
+            is >> setup.gamePairs;
+        else if (token == "checkpoint")
+            is >> setup.checkpoint;
+        else if (token == "threads-per-game")
+        {
+            int k = 1;
+            is >> k;
+            setup.threadsPerGame = size_t(std::max(k, 1));
+        }
+        else if (token == "random-moves")
+            is >> setup.randomMoves;
+        else if (token == "max-ply")
+            is >> setup.maxPly;
+        else if (token == "eval-limit")
+            is >> setup.evalLimit;
+        else
+            setup.limits += token + " ";
+    }
+
+    if (setup.limits.empty())
+        setup.limits = "nodes 1000";
+
+    setup.checkpoint = std::max<size_t>(setup.checkpoint, 1);
+
+    for (const auto& fen : read_positions(currentFen, fenFile))
+        if (fen.find("setoption") != 0)
+            setup.openings.push_back(fen);
+
+    return setup;
+}
+
 }  // namespace Stockfish
\ No newline at end of file
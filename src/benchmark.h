@@ -19,12 +19,17 @@
 #ifndef BENCHMARK_H_INCLUDED
 #define BENCHMARK_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <vector>
 
+#include "misc.h"
+
 namespace Stockfish::Benchmark {
 
+std::vector<std::string> read_positions(const std::string&, const std::string&);
 std::vector<std::string> setup_bench(const std::string&, std::istream&);
 
 struct BenchmarkSetup {
@@ -37,6 +42,51 @@ struct BenchmarkSetup {
 
 BenchmarkSetup setup_benchmark(std::istream&);
 
+struct AnalysisSetup {
+    size_t                   threadsPerJob;  // 0 for all the threads
+    std::vector<std::string> fens;
+    std::string              limits;
+    std::vector<std::string> gameMoves;  // Of a game, whose positions are the fens, last first
+};
+
+AnalysisSetup setup_analysis(const std::string&, std::istream&);
+
+struct TrainingDataSetup {
+    size_t                   games;
+    size_t                   threadsPerGame;
+    int                      randomMoves;  // Played after the opening, not recorded
+    int                      maxPly;       // Games longer than this are drawn
+    int                      evalLimit;    // Games are adjudicated beyond this score
+    std::vector<std::string> openings;
+    std::string              limits;
+    std::string              output;
+};
+
+TrainingDataSetup setup_training_data(const std::string&, std::istream&);
+
+struct SpsaSetup {
+    size_t                   gamePairs;
+    size_t                   checkpoint;  // Game pairs between two writes of the results
+    size_t                   threadsPerGame;
+    int                      randomMoves;  // Played after the opening, the same in a pair
+    int                      maxPly;       // Games longer than this are drawn
+    int                      evalLimit;    // Games are adjudicated beyond this score
+    std::vector<std::string> openings;
+    std::string              limits;
+    std::string              output;
+};
+
+SpsaSetup setup_spsa(const std::string&, std::istream&);
+
+// Time spent by one engine component, measured in isolation by "bench components",
+// and its hardware events when they are counted
+struct ComponentTiming {
+    std::string          name;
+    uint64_t             ops;
+    uint64_t             nanoseconds;
+    PerfCounters::Values events;
+};
+
 }  // namespace Stockfish
 
 #endif  // #ifndef BENCHMARK_H_INCLUDED
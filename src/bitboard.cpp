@@ -19,36 +19,184 @@
 #include "bitboard.h"
 
 #include <algorithm>
-#include <bitset>
+#include <array>
 #include <initializer_list>
+#include <unordered_map>
+#include <vector>
 
 #include "misc.h"
 
 namespace Stockfish {
 
-uint8_t PopCnt16[1 << 16];
-uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
+constexpr std::array<uint8_t, 1 << 16> PopCnt16 = []() {
+    std::array<uint8_t, 1 << 16> t{};
 
-Bitboard LineBB[SQUARE_NB][SQUARE_NB];
-Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
-Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
-Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+    for (unsigned i = 1; i < (1 << 16); ++i)
+        t[i] = uint8_t(t[i / 2] + (i & 1));
+
+    return t;
+}();
+
+constexpr std::array<std::array<uint8_t, SQUARE_NB>, SQUARE_NB> SquareDistance = []() {
+    std::array<std::array<uint8_t, SQUARE_NB>, SQUARE_NB> t{};
+
+    for (int s1 = SQ_A1; s1 <= SQ_H8; ++s1)
+        for (int s2 = SQ_A1; s2 <= SQ_H8; ++s2)
+        {
+            const int df = file_of(Square(s1)) - file_of(Square(s2));
+            const int dr = rank_of(Square(s1)) - rank_of(Square(s2));
+            t[s1][s2]    = uint8_t(std::max(df < 0 ? -df : df, dr < 0 ? -dr : dr));
+        }
+
+    return t;
+}();
+
+constexpr std::array<std::array<Bitboard, SQUARE_NB>, PIECE_TYPE_NB> PseudoAttacks = []() {
+    std::array<std::array<Bitboard, SQUARE_NB>, PIECE_TYPE_NB> t{};
+
+    for (int s = SQ_A1; s <= SQ_H8; ++s)
+        for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN, KING})
+            t[pt][s] = slow_attacks_bb(pt, Square(s));
+
+    return t;
+}();
+
+constexpr std::array<std::array<Bitboard, SQUARE_NB>, COLOR_NB> PawnAttacks = []() {
+    std::array<std::array<Bitboard, SQUARE_NB>, COLOR_NB> t{};
+
+    for (int s = SQ_A1; s <= SQ_H8; ++s)
+    {
+        t[WHITE][s] = pawn_attacks_bb<WHITE>(square_bb(Square(s)));
+        t[BLACK][s] = pawn_attacks_bb<BLACK>(square_bb(Square(s)));
+    }
+
+    return t;
+}();
+
+constexpr std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB> LineBB = []() {
+    std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB> t{};
+
+    for (int s1 = SQ_A1; s1 <= SQ_H8; ++s1)
+        for (PieceType pt : {BISHOP, ROOK})
+            for (int s2 = SQ_A1; s2 <= SQ_H8; ++s2)
+                if (PseudoAttacks[pt][s1] & square_bb(Square(s2)))
+                    t[s1][s2] = (PseudoAttacks[pt][s1] & PseudoAttacks[pt][s2])
+                              | square_bb(Square(s1)) | square_bb(Square(s2));
+    return t;
+}();
+
+// The squares of a line between two squares are those whose index is between
+// theirs, which avoids generating the sliding attacks of both squares.
+constexpr std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB> BetweenBB = []() {
+    std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB> t{};
+
+    for (int s1 = SQ_A1; s1 <= SQ_H8; ++s1)
+        for (int s2 = SQ_A1; s2 <= SQ_H8; ++s2)
+        {
+            const Bitboard range = (~0ULL << std::min(s1, s2)) & (~0ULL >> (63 - std::max(s1, s2)));
+            t[s1][s2] = (LineBB[s1][s2] & range & ~square_bb(Square(s1))) | square_bb(Square(s2));
+        }
+
+    return t;
+}();
 
 alignas(64) Magic Magics[SQUARE_NB][2];
 
 namespace {
 
+#ifdef USE_COMPACT_SLIDERS
+// With compact sliders, the magic index selects a byte, which in turn selects
+// the attack among the distinct attacks of the square. A rook in the center has
+// the most of them, 144. This shrinks the tables from about 840 KB to 155 KB.
+uint8_t  RookIndices[0x19000];
+uint8_t  BishopIndices[0x1480];
+Bitboard RookTable[0x1324];   // To store the distinct rook attacks
+Bitboard BishopTable[0x594];  // To store the distinct bishop attacks
+
+void compact_magics(PieceType pt, uint8_t indices[], Bitboard table[], Magic magics[][2]);
+#else
 Bitboard RookTable[0x19000];   // To store rook attacks
 Bitboard BishopTable[0x1480];  // To store bishop attacks
+#endif
 
-void init_magics(PieceType pt, Bitboard table[], Magic magics[][2]);
+#ifndef USE_PEXT
+// The magic numbers of the squares, indexed by [Is64Bit][pt - BISHOP][square].
+// They were found once by a random search, with seeds picked for a fast search,
+// and are now constants so that the search no longer delays the startup.
+constexpr Bitboard MagicNumbers[2][2][SQUARE_NB] = {
+  // 32-bit
+  {// Bishop
+   {0x31010A0044021521ULL, 0x80200710301002ULL, 0x4221080080049122ULL, 0x1000124640080581ULL,
+    0x84084410001450C0ULL, 0x900808020A060104ULL, 0x848401C04C0D808ULL, 0x1100A40C3808528ULL,
+    0x4801304440803027ULL, 0x24081202006901BULL, 0x8606120002000401ULL, 0x880102091A82404ULL,
+    0x1040002A20030A32ULL, 0x44201A0160021091ULL, 0x1008080104402244ULL, 0x182203100450909ULL,
+    0x12100C4302280010ULL, 0x9A58410212580017ULL, 0x142058800102009ULL, 0x620A00400008104ULL,
+    0x301148200010002ULL, 0x8900900800204026ULL, 0x105200108024202ULL, 0x420A0410804092ULL,
+    0x4802086023601201ULL, 0x1811040840B00600ULL, 0x900C20004031000ULL, 0x2010201840004400ULL,
+    0x80805008101440ULL, 0x80A00C11006100ULL, 0x424010600114904ULL, 0x424010600114904ULL,
+    0x1220200802021804ULL, 0x814040000015102ULL, 0x6C10180040C04ULL, 0x401880A000000208ULL,
+    0x812480883820042ULL, 0x80808025149011ULL, 0x6C10180040C04ULL, 0x101C2007000812AULL,
+    0x2402120200880202ULL, 0x863244230004108ULL, 0x120820000114108ULL, 0x2090110022400099ULL,
+    0x1410020240000202ULL, 0xB040822001411001ULL, 0x20031000204012AULL, 0x81420500109001C1ULL,
+    0x828000078040105ULL, 0x402063624084424ULL, 0x40B0000124240049ULL, 0x504400000C040252ULL,
+    0x20A050102880092ULL, 0x100220000130A004ULL, 0x8108540051302BULL, 0x708028A2008D1044ULL,
+    0x10940401000A0101ULL, 0x118244024002821ULL, 0x8406062000441221ULL, 0x20A020000030108ULL,
+    0x10020225200102A0ULL, 0x2C6220020400120ULL, 0x80E910800104144ULL, 0x50C200800A982129ULL},
+   // Rook
+   {0x1100400000808020ULL, 0x1100400000808020ULL, 0x200A10E0800890ULL, 0x10A00C000800410ULL,
+    0x9080084080810404ULL, 0x4081A0481000201ULL, 0x48600480102008A1ULL, 0x8201228080801249ULL,
+    0x100500000440204ULL, 0x1020031000200804ULL, 0x2010802000082008ULL, 0x2010802000082008ULL,
+    0x20500806801A0022ULL, 0x20500806801A0022ULL, 0x38421000A008022ULL, 0x108442002200811ULL,
+    0x8002C02009010202ULL, 0x2041200441100040ULL, 0x2400300100004420ULL, 0x400090210004042ULL,
+    0x580100800080102ULL, 0x3100C0020020202ULL, 0x5020048820101ULL, 0x2491040100000201ULL,
+    0x1080010200424021ULL, 0x3042050080908022ULL, 0x4820802C020212ULL, 0x1010006420000921ULL,
+    0x58CC050008229801ULL, 0x14400200408901ULL, 0xC008104230680104ULL, 0xD00048201380041ULL,
+    0x40105040900823ULL, 0x40105040900823ULL, 0x80220600008610ULL, 0x80502010008289ULL,
+    0x1640040011120008ULL, 0x80048000A41102ULL, 0x40010000028C4AULL, 0x81004000009601ULL,
+    0x20800000049050ULL, 0x2020200802409009ULL, 0x184202200080441ULL, 0x821000800210010ULL,
+    0x302040201006208ULL, 0x400402220054302ULL, 0x4020808200E001ULL, 0x400404030110081ULL,
+    0x40302000900080ULL, 0x60108080C0086941ULL, 0x41010200C002106ULL, 0x801180800810400AULL,
+    0x41010200C002106ULL, 0x890C80401002004ULL, 0x11B0201000104082ULL, 0x180028090800871ULL,
+    0x280006104304013ULL, 0xA1405140040221ULL, 0x2011482520086005ULL, 0x404405290881822ULL,
+    0x12508C220A640482ULL, 0x818211260000402ULL, 0x12008104000A85ULL, 0x20009023018000C1ULL}},
+  // 64-bit
+  {// Bishop
+   {0x40106000A1160020ULL, 0x20010250810120ULL, 0x2010010220280081ULL, 0x2806004050C040ULL,
+    0x2021018000000ULL, 0x2001112010000400ULL, 0x881010120218080ULL, 0x1030820110010500ULL,
+    0x120222042400ULL, 0x2000020404040044ULL, 0x8000480094208000ULL, 0x3422A02000001ULL,
+    0xA220210100040ULL, 0x8004820202226000ULL, 0x18234854100800ULL, 0x100004042101040ULL,
+    0x4001004082820ULL, 0x10000810010048ULL, 0x1014004208081300ULL, 0x2080818802044202ULL,
+    0x40880C00A00100ULL, 0x80400200522010ULL, 0x1000188180B04ULL, 0x80249202020204ULL,
+    0x1004400004100410ULL, 0x13100A0022206ULL, 0x2148500001040080ULL, 0x4241080011004300ULL,
+    0x4020848004002000ULL, 0x10101380D1004100ULL, 0x8004422020284ULL, 0x1010A1041008080ULL,
+    0x808080400082121ULL, 0x808080400082121ULL, 0x91128200100C00ULL, 0x202200802010104ULL,
+    0x8C0A020200440085ULL, 0x1A0008080B10040ULL, 0x889520080122800ULL, 0x100902022202010AULL,
+    0x4081A0816002000ULL, 0x681208005000ULL, 0x8170840041008802ULL, 0xA00004200810805ULL,
+    0x830404408210100ULL, 0x2602208106006102ULL, 0x1048300680802628ULL, 0x2602208106006102ULL,
+    0x602010120110040ULL, 0x941010801043000ULL, 0x40440A210428ULL, 0x8240020880021ULL,
+    0x400002012048200ULL, 0xAC102001210220ULL, 0x220021002009900ULL, 0x84440C080A013080ULL,
+    0x1008044200440ULL, 0x4C04410841000ULL, 0x2000500104011130ULL, 0x1A0C010011C20229ULL,
+    0x44800112202200ULL, 0x434804908100424ULL, 0x300404822C08200ULL, 0x48081010008A2A80ULL},
+   // Rook
+   {0xA80004000801220ULL, 0x8040004010002008ULL, 0x2080200010008008ULL, 0x1100100008210004ULL,
+    0xC200209084020008ULL, 0x2100010004000208ULL, 0x400081000822421ULL, 0x200010422048844ULL,
+    0x800800080400024ULL, 0x1402000401000ULL, 0x3000801000802001ULL, 0x4400800800100083ULL,
+    0x904802402480080ULL, 0x4040800400020080ULL, 0x18808042000100ULL, 0x4040800080004100ULL,
+    0x40048001458024ULL, 0xA0004000205000ULL, 0x3100808010002000ULL, 0x4825010010000820ULL,
+    0x5004808008000401ULL, 0x2024818004000A00ULL, 0x5808002000100ULL, 0x2100060004806104ULL,
+    0x80400880008421ULL, 0x4062220600410280ULL, 0x10A004A00108022ULL, 0x100080080080ULL,
+    0x21000500080010ULL, 0x44000202001008ULL, 0x100400080102ULL, 0xC020128200040545ULL,
+    0x80002000400040ULL, 0x804000802004ULL, 0x120022004080ULL, 0x10A386103001001ULL,
+    0x9010080080800400ULL, 0x8440020080800400ULL, 0x4228824001001ULL, 0x490A000084ULL,
+    0x80002000504000ULL, 0x200020005000C000ULL, 0x12088020420010ULL, 0x10010080080800ULL,
+    0x85001008010004ULL, 0x2000204008080ULL, 0x40413002040008ULL, 0x304081020004ULL,
+    0x80204000800080ULL, 0x3008804000290100ULL, 0x1010100080200080ULL, 0x2008100208028080ULL,
+    0x5000850800910100ULL, 0x8402019004680200ULL, 0x120911028020400ULL, 0x8044010200ULL,
+    0x20850200244012ULL, 0x20850200244012ULL, 0x102001040841ULL, 0x140900040A100021ULL,
+    0x200282410A102ULL, 0x200282410A102ULL, 0x200282410A102ULL, 0x4048240043802106ULL}}};
+#endif
 
-// Returns the bitboard of target square for the given step
-// from the given square. If the step is off the board, returns empty bitboard.
-Bitboard safe_destination(Square s, int step) {
-    Square to = Square(s + step);
-    return is_ok(to) && distance(s, to) <= 2 ? square_bb(to) : Bitboard(0);
-}
+void init_magics(PieceType pt, Bitboard table[], Magic magics[][2]);
 }
 
 // Returns an ASCII representation of a bitboard suitable
@@ -70,89 +218,34 @@ std::string Bitboards::pretty(Bitboard b) {
 }
 
 
-// Initializes various bitboard tables. It is called at
-// startup and relies on global objects to be already zero-initialized.
+// Initializes the slider attack tables, the only bitboard tables not computed at
+// compile time. It is called at startup and relies on global objects to be
+// already zero-initialized.
 void Bitboards::init() {
 
-    for (unsigned i = 0; i < (1 << 16); ++i)
-        PopCnt16[i] = uint8_t(std::bitset<16>(i).count());
-
-    for (Square s1 = SQ_A1; s1 <= SQ_H8; ++s1)
-        for (Square s2 = SQ_A1; s2 <= SQ_H8; ++s2)
-            SquareDistance[s1][s2] = std::max(distance<File>(s1, s2), distance<Rank>(s1, s2));
+#ifdef USE_COMPACT_SLIDERS
+    std::vector<Bitboard> rookAttacks(std::size(RookIndices));
+    std::vector<Bitboard> bishopAttacks(std::size(BishopIndices));
 
+    init_magics(ROOK, rookAttacks.data(), Magics);
+    init_magics(BISHOP, bishopAttacks.data(), Magics);
+    compact_magics(ROOK, RookIndices, RookTable, Magics);
+    compact_magics(BISHOP, BishopIndices, BishopTable, Magics);
+#else
     init_magics(ROOK, RookTable, Magics);
     init_magics(BISHOP, BishopTable, Magics);
-
-    for (Square s1 = SQ_A1; s1 <= SQ_H8; ++s1)
-    {
-        PawnAttacks[WHITE][s1] = pawn_attacks_bb<WHITE>(square_bb(s1));
-        PawnAttacks[BLACK][s1] = pawn_attacks_bb<BLACK>(square_bb(s1));
-
-        for (int step : {-9, -8, -7, -1, 1, 7, 8, 9})
-            PseudoAttacks[KING][s1] |= safe_destination(s1, step);
-
-        for (int step : {-17, -15, -10, -6, 6, 10, 15, 17})
-            PseudoAttacks[KNIGHT][s1] |= safe_destination(s1, step);
-
-        PseudoAttacks[QUEEN][s1] = PseudoAttacks[BISHOP][s1] = attacks_bb<BISHOP>(s1, 0);
-        PseudoAttacks[QUEEN][s1] |= PseudoAttacks[ROOK][s1]  = attacks_bb<ROOK>(s1, 0);
-
-        for (PieceType pt : {BISHOP, ROOK})
-            for (Square s2 = SQ_A1; s2 <= SQ_H8; ++s2)
-            {
-                if (PseudoAttacks[pt][s1] & s2)
-                {
-                    LineBB[s1][s2] = (attacks_bb(pt, s1, 0) & attacks_bb(pt, s2, 0)) | s1 | s2;
-                    BetweenBB[s1][s2] =
-                      (attacks_bb(pt, s1, square_bb(s2)) & attacks_bb(pt, s2, square_bb(s1)));
-                }
-                BetweenBB[s1][s2] |= s2;
-            }
-    }
+#endif
 }
 
 namespace {
 
-Bitboard sliding_attack(PieceType pt, Square sq, Bitboard occupied) {
-
-    Bitboard  attacks             = 0;
-    Direction RookDirections[4]   = {NORTH, SOUTH, EAST, WEST};
-    Direction BishopDirections[4] = {NORTH_EAST, SOUTH_EAST, SOUTH_WEST, NORTH_WEST};
-
-    for (Direction d : (pt == ROOK ? RookDirections : BishopDirections))
-    {
-        Square s = sq;
-        while (safe_destination(s, d))
-        {
-            attacks |= (s += d);
-            if (occupied & s)
-            {
-                break;
-            }
-        }
-    }
-
-    return attacks;
-}
-
-
 // Computes all rook and bishop attacks at startup. Magic
 // bitboards are used to look up attacks of sliding pieces. As a reference see
 // https://www.chessprogramming.org/Magic_Bitboards. In particular, here we use
 // the so called "fancy" approach.
 void init_magics(PieceType pt, Bitboard table[], Magic magics[][2]) {
 
-#ifndef USE_PEXT
-    // Optimal PRNG seeds to pick the correct magics in the shortest time
-    int seeds[][RANK_NB] = {{8977, 44560, 54343, 38998, 5731, 95205, 104912, 17020},
-                            {728, 10316, 55013, 32803, 12281, 15100, 16645, 255}};
-
-    Bitboard occupancy[4096];
-    int      epoch[4096] = {}, cnt = 0;
-#endif
-    Bitboard reference[4096];
-    int      size = 0;
+    int size = 0;
 
     for (Square s = SQ_A1; s <= SQ_H8; ++s)
     {
@@ -165,9 +258,10 @@ void init_magics(PieceType pt, Bitboard table[], Magic magics[][2]) {
         // the number of 1s of the mask. Hence we deduce the size of the shift to
         // apply to the 64 or 32 bits word to get the index.
         Magic& m = magics[s][pt - BISHOP];
-        m.mask   = sliding_attack(pt, s, 0) & ~edges;
+        m.mask   = PseudoAttacks[pt][s] & ~edges;
 #ifndef USE_PEXT
         m.shift = (Is64Bit ? 64 : 32) - popcount(m.mask);
+        m.magic = MagicNumbers[Is64Bit][pt - BISHOP][s];
 #endif
         // Set the offset for the attacks table of the square. We have individual
         // table sizes for each square with "Fancy Magic Bitboards".
@@ -175,54 +269,65 @@ void init_magics(PieceType pt, Bitboard table[], Magic magics[][2]) {
         size      = 0;
 
         // Use Carry-Rippler trick to enumerate all subsets of masks[s] and
-        // store the corresponding sliding attack bitboard in reference[].
+        // store the corresponding sliding attack bitboard. Occupancies that
+        // share an index have the same attacks, which is what makes the magic
+        // good. An attack is never empty, so an empty entry was not stored yet.
         Bitboard b = 0;
         do
         {
-#ifndef USE_PEXT
-            occupancy[size] = b;
-#endif
-            reference[size] = sliding_attack(pt, s, b);
+            const Bitboard attacks = slow_attacks_bb(pt, s, b);
+            const unsigned idx     = m.index(b);
 
-            if (HasPext)
-                m.attacks[pext(b, m.mask)] = reference[size];
+            assert(!m.attacks[idx] || m.attacks[idx] == attacks);
 
+            m.attacks[idx] = attacks;
             size++;
             b = (b - m.mask) & m.mask;
         } while (b);
+    }
+}
 
-#ifndef USE_PEXT
-        PRNG rng(seeds[Is64Bit][rank_of(s)]);
+#ifdef USE_COMPACT_SLIDERS
+// Replaces the attacks of each square, which init_magics() stored in a table
+// indexed directly by the magic index, with a byte index into the distinct
+// attacks of the square, which are stored in table[].
+void compact_magics(PieceType pt, uint8_t indices[], Bitboard table[], Magic magics[][2]) {
+
+    std::unordered_map<Bitboard, uint8_t> distinct;
+    uint8_t*                              idx = indices;
+    Bitboard*                             att = table;
+
+    for (Square s = SQ_A1; s <= SQ_H8; ++s)
+    {
+        Magic&          m    = magics[s][pt - BISHOP];
+        const Bitboard* full = m.attacks;
 
-        // Find a magic for square 's' picking up an (almost) random number
-        // until we find the one that passes the verification test.
-        for (int i = 0; i < size;)
+        m.indices = idx;
+        m.attacks = att;
+        distinct.clear();
+
+        // Enumerate all the subsets of the mask, as in init_magics()
+        Bitboard b = 0;
+        do
         {
-            for (m.magic = 0; popcount((m.magic * m.mask) >> 56) < 6;)
-                m.magic = rng.sparse_rand<Bitboard>();
-
-            // A good magic must map every possible occupancy to an index that
-            // looks up the correct sliding attack in the attacks[s] database.
-            // Note that we build up the database for square 's' as a side
-            // effect of verifying the magic. Keep track of the attempt count
-            // and save it in epoch[], little speed-up trick to avoid resetting
-            // m.attacks[] after every failed attempt.
-            for (++cnt, i = 0; i < size; ++i)
-            {
-                unsigned idx = m.index(occupancy[i]);
-
-                if (epoch[idx] < cnt)
-                {
-                    epoch[idx]     = cnt;
-                    m.attacks[idx] = reference[i];
-                }
-                else if (m.attacks[idx] != reference[i])
-                    break;
-            }
-        }
-#endif
+            unsigned i       = m.index(b);
+            auto [it, isNew] = distinct.try_emplace(full[i], uint8_t(distinct.size()));
+
+            if (isNew)
+                *att++ = full[i];
+
+            m.indices[i] = it->second;
+            b            = (b - m.mask) & m.mask;
+        } while (b);
+
+        assert(distinct.size() <= 256);
+
+        idx += size_t(1) << popcount(m.mask);
     }
+
+    assert(att - table == (pt == ROOK ? 0x1324 : 0x594));
 }
+#endif
 }
 
 }  // namespace Stockfish
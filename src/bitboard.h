@@ -20,6 +20,7 @@
 #define BITBOARD_H_INCLUDED
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -56,25 +57,32 @@ constexpr Bitboard Rank6BB = Rank1BB << (8 * 5);
 constexpr Bitboard Rank7BB = Rank1BB << (8 * 6);
 constexpr Bitboard Rank8BB = Rank1BB << (8 * 7);
 
-extern uint8_t PopCnt16[1 << 16];
-extern uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
+// These tables are computed at compile time, so they are in read-only data and
+// shared by all the processes running the binary.
+extern const std::array<uint8_t, 1 << 16>                          PopCnt16;
+extern const std::array<std::array<uint8_t, SQUARE_NB>, SQUARE_NB> SquareDistance;
 
-extern Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
-extern Bitboard LineBB[SQUARE_NB][SQUARE_NB];
-extern Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
-extern Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+extern const std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB>     BetweenBB;
+extern const std::array<std::array<Bitboard, SQUARE_NB>, SQUARE_NB>     LineBB;
+extern const std::array<std::array<Bitboard, SQUARE_NB>, PIECE_TYPE_NB> PseudoAttacks;
+extern const std::array<std::array<Bitboard, SQUARE_NB>, COLOR_NB>      PawnAttacks;
 
 
 // Magic holds all magic bitboards relevant data for a single square
 struct Magic {
     Bitboard  mask;
     Bitboard* attacks;
+#ifdef USE_COMPACT_SLIDERS
+    uint8_t* indices;
+#endif
 #ifndef USE_PEXT
     Bitboard magic;
     unsigned shift;
 #endif
 
-    // Compute the attack's index using the 'magic bitboards' approach
+    // Compute the attack's index using the 'magic bitboards' approach. The
+    // choice is made at compile time, on CPUs with a slow pext the 'compiler'
+    // command tells to use a build without it.
     unsigned index(Bitboard occupied) const {
 
 #ifdef USE_PEXT
@@ -89,7 +97,13 @@ struct Magic {
 #endif
     }
 
-    Bitboard attacks_bb(Bitboard occupied) const { return attacks[index(occupied)]; }
+    Bitboard attacks_bb(Bitboard occupied) const {
+#ifdef USE_COMPACT_SLIDERS
+        return attacks[indices[index(occupied)]];
+#else
+        return attacks[index(occupied)];
+#endif
+    }
 };
 
 extern Magic Magics[SQUARE_NB][2];
@@ -155,6 +169,36 @@ constexpr Bitboard pawn_attacks_bb(Bitboard b) {
                       : shift<SOUTH_WEST>(b) | shift<SOUTH_EAST>(b);
 }
 
+// Returns the attacks of a piece of the given type, not a pawn, on the given
+// square. Sliders stop at the first occupied square in each direction. It is
+// slow, but constexpr, so it builds the attack tables at compile time.
+constexpr Bitboard slow_attacks_bb(PieceType pt, Square s, Bitboard occupied = 0) {
+
+    // Steps as (file, rank): knight, then diagonal, then orthogonal
+    constexpr int Steps[][2] = {{1, 2},   {2, 1},   {2, -1}, {1, -2}, {-1, -2}, {-2, -1},
+                                {-2, 1},  {-1, 2},  {1, 1},  {1, -1}, {-1, -1}, {-1, 1},
+                                {1, 0},   {0, -1},  {-1, 0}, {0, 1}};
+
+    const int  first   = pt == KNIGHT ? 0 : pt == ROOK ? 12 : 8;
+    const int  last    = pt == KNIGHT ? 8 : pt == BISHOP ? 12 : 16;
+    const bool slider  = pt != KNIGHT && pt != KING;
+    Bitboard   attacks = 0;
+
+    for (int i = first; i < last; ++i)
+        for (int f = file_of(s) + Steps[i][0], r = rank_of(s) + Steps[i][1];
+             f >= FILE_A && f <= FILE_H && r >= RANK_1 && r <= RANK_8;
+             f += Steps[i][0], r += Steps[i][1])
+        {
+            const Bitboard b = square_bb(make_square(File(f), Rank(r)));
+
+            attacks |= b;
+            if (!slider || (occupied & b))
+                break;
+        }
+
+    return attacks;
+}
+
 inline Bitboard pawn_attacks_bb(Color c, Square s) {
 
     assert(is_ok(s));
@@ -0,0 +1,771 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cluster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#include "engine.h"
+#include "misc.h"
+#include "search.h"
+#include "thread.h"
+#include "tt.h"
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+    #include <cerrno>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+namespace Stockfish {
+
+namespace {
+
+// Messages between the nodes are frames of a header followed by size bytes
+enum FrameType : uint32_t {
+    POSITION,  // Main node: "<chess960> <fen> moves <moves>"
+    GO,        // Main node: the search id, followed by the searchmoves
+    STOP,      // Main node: stop the search, its result is expected
+    NEW_GAME,  // Main node: clear the histories for a new game
+    ENTRIES,   // Any node: an array of RemoteEntry
+    NODES,     // Other nodes: NodesFrame, sent periodically while searching
+    RESULT     // Other nodes: ResultFrame followed by the PV moves
+};
+
+struct FrameHeader {
+    uint32_t type;
+    uint32_t size;
+};
+
+struct NodesFrame {
+    uint64_t nodes;
+    uint32_t id;
+    uint32_t padding;
+};
+
+struct ResultFrame {
+    uint64_t nodes;
+    uint32_t id;
+    int32_t  depth;
+    int32_t  score;
+    uint32_t pvSize;
+};
+
+constexpr uint32_t MaxFrameSize = 1 << 24;
+constexpr size_t   MaxQueued    = 1 << 16;  // Entries beyond are dropped on a slow network
+
+constexpr auto StopTimeout  = std::chrono::milliseconds(1000);
+constexpr int  NodesPeriodMs = 100;
+
+static_assert(MaxQueued * sizeof(RemoteEntry) < MaxFrameSize);
+
+}  // namespace
+
+
+// A connection to another node
+struct SearchCluster::Node {
+    explicit Node(int socket) :
+        fd(socket) {}
+    ~Node();
+
+    bool send(FrameType type, const void* data, size_t size);
+
+    int         fd;
+    std::mutex  sendMutex;
+    std::thread receiver;
+
+    // Guarded by SearchCluster::mutex
+    bool          alive     = true;
+    bool          searching = false;
+    uint64_t      nodes     = 0;
+    RemoteResult result;
+};
+
+
+#ifndef _WIN32
+
+namespace {
+
+bool write_all(int fd, const char* data, size_t size) {
+
+    while (size)
+    {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return false;
+
+        data += n;
+        size -= size_t(n);
+    }
+
+    return true;
+}
+
+bool read_all(int fd, char* data, size_t size) {
+
+    while (size)
+    {
+        ssize_t n = ::recv(fd, data, size, 0);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return false;
+
+        data += n;
+        size -= size_t(n);
+    }
+
+    return true;
+}
+
+bool read_frame(int fd, uint32_t& type, std::string& payload) {
+
+    FrameHeader header;
+
+    if (!read_all(fd, reinterpret_cast<char*>(&header), sizeof(header))
+        || header.size > MaxFrameSize)
+        return false;
+
+    type = header.type;
+    payload.resize(header.size);
+
+    return read_all(fd, payload.data(), header.size);
+}
+
+}  // namespace
+
+
+SearchCluster::Node::~Node() { ::close(fd); }
+
+bool SearchCluster::Node::send(FrameType type, const void* data, size_t size) {
+
+    FrameHeader header{type, uint32_t(size)};
+    std::string frame(reinterpret_cast<const char*>(&header), sizeof(header));
+    frame.append(static_cast<const char*>(data), size);
+
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return write_all(fd, frame.data(), frame.size());
+}
+
+
+SearchCluster::SearchCluster(TranspositionTable& transpositionTable, ThreadPool& threadPool) :
+    tt(transpositionTable),
+    threads(threadPool) {}
+
+SearchCluster::~SearchCluster() {
+
+    close_all();
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        exit = true;
+    }
+
+    queueCv.notify_one();
+
+    if (sender.joinable())
+        sender.join();
+}
+
+
+// Stops listening and disconnects all the nodes
+void SearchCluster::close_all() {
+
+    if (listenFd != -1)
+    {
+        ::shutdown(listenFd, SHUT_RDWR);  // Wakes up the acceptor
+        acceptor.join();
+        ::close(listenFd);
+        listenFd = -1;
+    }
+
+    std::vector<std::shared_ptr<Node>> nodes;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nodes.swap(nodes_);
+    }
+
+    for (auto& node : nodes)
+        ::shutdown(node->fd, SHUT_RDWR);  // Wakes up the receivers
+
+    for (auto& node : nodes)
+        if (node->receiver.joinable())
+            node->receiver.join();
+
+    connected = 0;
+}
+
+
+std::shared_ptr<SearchCluster::Node> SearchCluster::add_node(int fd, bool receiver) {
+
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    auto node = std::make_shared<Node>(fd);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nodes_.push_back(node);
+        ++connected;
+
+        if (receiver)
+            node->receiver = std::thread(&SearchCluster::receive, this, std::ref(*node));
+    }
+
+    if (!sender.joinable())
+        sender = std::thread(&SearchCluster::send_entries, this);
+
+    return node;
+}
+
+
+bool SearchCluster::listen(int port, const std::string& address) {
+
+    close_all();
+
+    if (!port)
+        return true;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(uint16_t(port));
+
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+        return false;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd == -1)
+        return false;
+
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) || ::listen(fd, 64))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    listenFd = fd;
+    acceptor = std::thread([this]() {
+        while (true)
+        {
+            int node = ::accept(listenFd, nullptr, nullptr);
+
+            if (node != -1)
+                add_node(node, true);
+
+            else if (errno != EINTR && errno != ECONNABORTED)
+                break;
+        }
+    });
+
+    return true;
+}
+
+
+// Handles the frames of another node on the main node
+void SearchCluster::receive(Node& node) {
+
+    uint32_t    type;
+    std::string payload;
+
+    while (read_frame(node.fd, type, payload))
+    {
+        if (type == ENTRIES)
+        {
+            store(payload);
+
+            // Forward the entries to the other nodes
+            std::vector<std::shared_ptr<Node>> others;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& n : nodes_)
+                    if (n.get() != &node && n->alive)
+                        others.push_back(n);
+            }
+
+            for (auto& n : others)
+                n->send(ENTRIES, payload.data(), payload.size());
+        }
+
+        else if (type == NODES && payload.size() == sizeof(NodesFrame))
+        {
+            NodesFrame frame;
+            std::memcpy(&frame, payload.data(), sizeof(frame));
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (frame.id == searchId && frame.nodes > node.nodes)
+            {
+                remoteNodes += frame.nodes - node.nodes;
+                node.nodes = frame.nodes;
+            }
+        }
+
+        else if (type == RESULT && payload.size() >= sizeof(ResultFrame))
+        {
+            ResultFrame frame;
+            std::memcpy(&frame, payload.data(), sizeof(frame));
+
+            if (payload.size() != sizeof(frame) + frame.pvSize * sizeof(uint16_t))
+                break;
+
+            RemoteResult result;
+            result.nodes = frame.nodes;
+            result.depth = Depth(frame.depth);
+            result.score = Value(frame.score);
+
+            for (uint32_t i = 0; i < frame.pvSize; ++i)
+            {
+                uint16_t move;
+                std::memcpy(&move, payload.data() + sizeof(frame) + i * sizeof(move),
+                            sizeof(move));
+                result.pv.push_back(Move(move));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (frame.id == searchId)
+            {
+                if (frame.nodes > node.nodes)
+                {
+                    remoteNodes += frame.nodes - node.nodes;
+                    node.nodes = frame.nodes;
+                }
+
+                node.result    = std::move(result);
+                node.searching = false;
+                cv.notify_all();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    node.alive     = false;
+    node.searching = false;
+    --connected;
+    cv.notify_all();
+}
+
+
+bool SearchCluster::serve(Engine& engine, const std::string& host, int port) {
+
+    close_all();
+
+    addrinfo  hints{};
+    addrinfo* addresses = nullptr;
+    int       fd        = -1;
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses))
+        return false;
+
+    for (addrinfo* a = addresses; a && fd == -1; a = a->ai_next)
+    {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+
+        if (fd != -1 && ::connect(fd, a->ai_addr, a->ai_addrlen))
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(addresses);
+
+    if (fd == -1)
+        return false;
+
+    auto main = add_node(fd, false);
+    serving   = true;
+
+    uint32_t    type;
+    std::string payload;
+    bool        searching  = false;
+    TimePoint   lastReport = now();
+
+    while (true)
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        int    ready = ::poll(&pfd, 1, NodesPeriodMs);
+
+        if (ready < 0 && errno == EINTR)
+            continue;
+
+        // Report the nodes searched so far, for the nps of the main node
+        if (searching && now() - lastReport >= NodesPeriodMs)
+        {
+            NodesFrame frame{threads.nodes_searched(), 0, 0};
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                frame.id = searchId;
+            }
+
+            main->send(NODES, &frame, sizeof(frame));
+            lastReport = now();
+        }
+
+        if (ready == 0)
+            continue;
+
+        if (ready < 0 || !read_frame(fd, type, payload))
+            break;
+
+        if (type == ENTRIES)
+        {
+            store(payload);
+            continue;
+        }
+
+        // Any other command waits for the current search, which answers a STOP
+        engine.stop();
+        engine.wait_for_search_finished();
+        searching = false;
+
+        if (type == POSITION)
+        {
+            std::istringstream       is(payload);
+            std::string              token, fen, chess960;
+            std::vector<std::string> moves;
+
+            is >> chess960;
+
+            while (is >> token && token != "moves")
+                fen += token + " ";
+
+            while (is >> token)
+                moves.push_back(token);
+
+            std::istringstream option("name UCI_Chess960 value "
+                                      + std::string(chess960 == "1" ? "true" : "false"));
+            engine.get_options().setoption(option);
+            engine.set_position(fen, moves);
+        }
+
+        else if (type == GO && payload.size() >= sizeof(uint32_t))
+        {
+            Search::LimitsType limits;
+            std::string        token;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::memcpy(&searchId, payload.data(), sizeof(uint32_t));
+            }
+
+            std::istringstream is(payload.substr(sizeof(uint32_t)));
+
+            while (is >> token)
+                limits.searchmoves.push_back(token);
+
+            limits.startTime = now();
+            limits.infinite  = 1;
+
+            engine.go(limits);
+            searching = true;
+        }
+
+        else if (type == NEW_GAME)
+            engine.new_game();
+    }
+
+    engine.stop();
+    engine.wait_for_search_finished();
+
+    serving = false;
+    main.reset();
+    close_all();
+
+    return true;
+}
+
+
+void SearchCluster::start_search(const std::string&              fen,
+                                 const std::vector<std::string>& moves,
+                                 bool                            chess960,
+                                 const std::vector<std::string>& searchmoves) {
+
+    if (serving || !size())
+        return;
+
+    std::vector<std::shared_ptr<Node>> nodes;
+    uint32_t                           id;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Drop the nodes which disconnected
+        for (auto& node : nodes_)
+            if (!node->alive && node->receiver.joinable())
+                node->receiver.join();
+
+        nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(),
+                                    [](const auto& node) { return !node->alive; }),
+                     nodes_.end());
+
+        id          = ++searchId;
+        remoteNodes = 0;
+
+        for (auto& node : nodes_)
+        {
+            node->searching = true;
+            node->nodes     = 0;
+            node->result    = RemoteResult();
+            nodes.push_back(node);
+        }
+    }
+
+    std::string position = std::string(chess960 ? "1 " : "0 ") + fen + " moves";
+    for (const auto& move : moves)
+        position += " " + move;
+
+    std::string go(reinterpret_cast<const char*>(&id), sizeof(id));
+    for (const auto& move : searchmoves)
+        go += " " + move;
+
+    for (auto& node : nodes)
+    {
+        node->send(POSITION, position.data(), position.size());
+        node->send(GO, go.data(), go.size());
+    }
+}
+
+
+void SearchCluster::stop_search() {
+
+    if (serving || !size())
+        return;
+
+    std::vector<std::shared_ptr<Node>> nodes;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& node : nodes_)
+            if (node->searching)
+                nodes.push_back(node);
+    }
+
+    for (auto& node : nodes)
+        node->send(STOP, nullptr, 0);
+
+    // A node which doesn't answer in time is left out of the voting
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, StopTimeout, [&]() {
+        return std::none_of(nodes.begin(), nodes.end(),
+                            [](const auto& node) { return node->searching; });
+    });
+}
+
+
+void SearchCluster::new_game() {
+
+    if (serving || !size())
+        return;
+
+    std::vector<std::shared_ptr<Node>> nodes;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& node : nodes_)
+            if (node->alive)
+                nodes.push_back(node);
+    }
+
+    for (auto& node : nodes)
+        node->send(NEW_GAME, nullptr, 0);
+}
+
+
+void SearchCluster::send_result(const std::vector<Move>& pv,
+                                Value                    score,
+                                Depth                    depth,
+                                uint64_t                 nodes) {
+
+    if (!serving)
+        return;
+
+    std::shared_ptr<Node> node;
+    ResultFrame           frame{nodes, 0, int32_t(depth), int32_t(score), uint32_t(pv.size())};
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (nodes_.empty())
+            return;
+
+        node     = nodes_.front();
+        frame.id = searchId;
+    }
+
+    std::string payload(reinterpret_cast<const char*>(&frame), sizeof(frame));
+
+    for (Move m : pv)
+    {
+        const uint16_t move = m.raw();
+        payload.append(reinterpret_cast<const char*>(&move), sizeof(move));
+    }
+
+    node->send(RESULT, payload.data(), payload.size());
+}
+
+
+// Sends the entries queued by the search threads to all the nodes
+void SearchCluster::send_entries() {
+
+    std::vector<RemoteEntry> batch;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [&]() { return exit || !queue.empty(); });
+
+            if (exit)
+                return;
+
+            batch.swap(queue);
+        }
+
+        std::vector<std::shared_ptr<Node>> nodes;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& node : nodes_)
+                if (node->alive)
+                    nodes.push_back(node);
+        }
+
+        for (auto& node : nodes)
+            node->send(ENTRIES, batch.data(), batch.size() * sizeof(RemoteEntry));
+
+        batch.clear();
+    }
+}
+
+#else
+
+SearchCluster::Node::~Node() {}
+
+bool SearchCluster::Node::send(FrameType, const void*, size_t) { return false; }
+
+SearchCluster::SearchCluster(TranspositionTable& transpositionTable, ThreadPool& threadPool) :
+    tt(transpositionTable),
+    threads(threadPool) {}
+
+SearchCluster::~SearchCluster() {}
+
+void SearchCluster::close_all() {}
+
+std::shared_ptr<SearchCluster::Node> SearchCluster::add_node(int, bool) { return nullptr; }
+
+bool SearchCluster::listen(int port, const std::string&) { return !port; }
+
+void SearchCluster::receive(Node&) {}
+
+bool SearchCluster::serve(Engine&, const std::string&, int) { return false; }
+
+void SearchCluster::start_search(const std::string&,
+                                 const std::vector<std::string>&,
+                                 bool,
+                                 const std::vector<std::string>&) {}
+
+void SearchCluster::stop_search() {}
+
+void SearchCluster::new_game() {}
+
+void SearchCluster::send_result(const std::vector<Move>&, Value, Depth, uint64_t) {}
+
+void SearchCluster::send_entries() {}
+
+#endif
+
+
+std::vector<RemoteResult> SearchCluster::results() const {
+
+    std::vector<RemoteResult>   results;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!serving)
+        for (auto& node : nodes_)
+            if (node->result.depth > 0 && !node->result.pv.empty())
+                results.push_back(node->result);
+
+    return results;
+}
+
+
+uint64_t SearchCluster::nodes() const { return remoteNodes.load(std::memory_order_relaxed); }
+
+
+void SearchCluster::share(const RemoteEntry* entries, size_t count) {
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        if (queue.size() + count > MaxQueued)
+            return;
+
+        queue.insert(queue.end(), entries, entries + count);
+    }
+
+    queueCv.notify_one();
+}
+
+
+// Stores the entries of another node, replacing the local ones as usual
+void SearchCluster::store(const std::string& payload) {
+
+    std::lock_guard<std::mutex> lock(ttMutex);
+
+    for (size_t i = 0; i + sizeof(RemoteEntry) <= payload.size(); i += sizeof(RemoteEntry))
+    {
+        RemoteEntry e;
+        std::memcpy(&e, payload.data() + i, sizeof(e));
+
+        std::get<2>(tt.probe(e.key))
+          .write(e.key, Value(e.value), e.pv, Bound(e.bound), Depth(e.depth), Move(e.move),
+                 Value(e.eval), tt.generation());
+    }
+}
+
+}  // namespace Stockfish
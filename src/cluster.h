@@ -0,0 +1,158 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLUSTER_H_INCLUDED
+#define CLUSTER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Engine;
+class ThreadPool;
+class TranspositionTable;
+
+// A deep entry of a transposition table, sent to the other nodes of the cluster.
+// The value is stored as in the table, i.e. relative to the position.
+struct RemoteEntry {
+    Key      key;
+    uint16_t move;
+    int16_t  value;
+    int16_t  eval;
+    int16_t  depth;
+    uint8_t  bound;
+    uint8_t  pv;
+};
+
+// The best root move of another node at the end of a search
+struct RemoteResult {
+    uint64_t          nodes = 0;
+    Depth             depth = 0;
+    Value             score = -VALUE_INFINITE;
+    std::vector<Move> pv;
+};
+
+// Lazy SMP across the machines of a cluster, over TCP. The main node listens on
+// the "ClusterPort", the other nodes connect to it with the "cluster" command and
+// then only search for the main node. When the main node starts a search, the
+// other nodes search the same position without limits until it stops, so that
+// time management stays with the main node. Meanwhile, all the nodes send the
+// deep entries they write into their transposition table to the others, in
+// batches, from a thread of their own. The results of the other nodes take part
+// in the voting for the best move (see ThreadPool::get_best_thread), and their
+// nodes are added to the nodes of the main node. The nodes are expected to run
+// the same binary on the same architecture, as the data is sent as is.
+//
+// The nodes trust each other: there is no authentication, and what another node
+// sends is stored into the transposition table and takes part in the choice of
+// the best move. So the main node listens on the loopback address unless the
+// "ClusterAddress" names another one, which should only be reachable from the
+// machines of the cluster.
+class SearchCluster {
+   public:
+    static constexpr Depth  ShareDepth = 8;   // Only deeper entries are sent
+    static constexpr size_t BatchSize  = 64;  // Entries a search thread sends at once
+
+    SearchCluster(TranspositionTable& tt, ThreadPool& threads);
+    ~SearchCluster();
+
+    SearchCluster(const SearchCluster&)            = delete;
+    SearchCluster& operator=(const SearchCluster&) = delete;
+
+    // Main node: accepts the other nodes on the given port of the given IPv4
+    // address, or disconnects them and stops listening if the port is 0. Returns
+    // false if the address or the port can't be used.
+    bool listen(int port, const std::string& address);
+
+    // Other nodes: connects to the main node and searches for it until it
+    // disconnects. Returns false if the main node can't be reached.
+    bool serve(Engine& engine, const std::string& host, int port);
+
+    // Main node: starts the other nodes on the position of a search, and stops
+    // them, waiting for their results, once the search is over.
+    void start_search(const std::string&              fen,
+                      const std::vector<std::string>& moves,
+                      bool                            chess960,
+                      const std::vector<std::string>& searchmoves);
+    void stop_search();
+    void new_game();
+
+    // Main node: the results of the last search of the other nodes, and their
+    // nodes searched so far.
+    std::vector<RemoteResult> results() const;
+    uint64_t                  nodes() const;
+
+    // Other nodes: sends the result of a search to the main node
+    void send_result(const std::vector<Move>& pv, Value score, Depth depth, uint64_t nodes);
+
+    // Queues a batch of entries for the other nodes, without waiting for them to
+    // be sent.
+    void share(const RemoteEntry* entries, size_t count);
+
+    // Connected nodes, the main node for the other ones
+    size_t size() const { return connected.load(std::memory_order_relaxed); }
+
+    // Keeps the entries received from the other nodes from being stored while
+    // the returned lock is held, i.e. while the table is reallocated.
+    std::unique_lock<std::mutex> pause() { return std::unique_lock<std::mutex>(ttMutex); }
+
+   private:
+    struct Node;
+
+    std::shared_ptr<Node> add_node(int fd, bool receiver);
+    void                  receive(Node& node);
+    void                  store(const std::string& payload);
+    void                  send_entries();
+    void                  close_all();
+
+    TranspositionTable& tt;
+    ThreadPool&         threads;
+
+    mutable std::mutex                 mutex;
+    std::condition_variable            cv;
+    std::vector<std::shared_ptr<Node>> nodes_;
+    std::atomic<size_t>                connected{0};
+    std::atomic<uint64_t>              remoteNodes{0};
+    std::atomic<bool>                  serving{false};
+    uint32_t                           searchId = 0;
+
+    std::mutex ttMutex;  // Held while storing entries, see pause()
+
+    int         listenFd = -1;
+    std::thread acceptor;
+
+    std::mutex               queueMutex;
+    std::condition_variable  queueCv;
+    std::vector<RemoteEntry> queue;
+    std::thread              sender;
+    bool                     exit = false;
+};
+
+}  // namespace Stockfish
+
+#endif  // #ifndef CLUSTER_H_INCLUDED
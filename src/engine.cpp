@@ -18,10 +18,17 @@
 
 #include "engine.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <iosfwd>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <string_view>
@@ -29,11 +36,15 @@
 #include <vector>
 
 #include "evaluate.h"
+#include "matesolver.h"
 #include "misc.h"
+#include "movegen.h"
 #include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
 #include "nnue/nnue_common.h"
 #include "perft.h"
 #include "position.h"
+#include "score.h"
 #include "search.h"
 #include "syzygy/tbprobe.h"
 #include "types.h"
@@ -47,7 +58,165 @@ namespace NN = Eval::NNUE;
 constexpr auto StartFEN  = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 constexpr int  MaxHashMB = Is64Bit ? 33554432 : 2048;
 
-Engine::Engine(std::optional<std::string> path) :
+// A group of threads of a batch, searching one position at a time. Each group
+// is an independent thread pool, but all of them share the engine's transposition
+// table, networks and histories (see Engine::make_search_groups()).
+struct SearchGroup {
+    Search::SearchManager::UpdateContext updateContext;
+    ThreadPool                           threads;
+    std::string                          bestmove;  // Of the last search
+};
+
+// The groups of a batch whose search has finished, waited for by the thread
+// running the batch
+class FinishedGroups {
+   public:
+    void push(SearchGroup* g) {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            groups.push_back(g);
+        }
+        cv.notify_one();
+    }
+
+    // Waits for at least one search to finish, and returns the groups of all the
+    // finished ones, once their threads are idle.
+    template<typename Group>
+    std::vector<Group*> wait() {
+        std::vector<SearchGroup*> done;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return !groups.empty(); });
+            std::swap(done, groups);
+        }
+
+        std::vector<Group*> result;
+        for (SearchGroup* g : done)
+        {
+            g->threads.main_thread()->wait_for_search_finished();
+            result.push_back(static_cast<Group*>(g));
+        }
+        return result;
+    }
+
+   private:
+    std::mutex                mutex;
+    std::condition_variable   cv;
+    std::vector<SearchGroup*> groups;
+};
+
+namespace {
+
+// Outcome of the search of one position of a batch analysis. The string views
+// of the info point into the owned strings only once the result is reported.
+struct AnalysisResult {
+    Search::InfoFull info{};
+    std::string      wdl, bound, pv, bestmove;
+};
+
+// A group of threads searching one position of a batch analysis at a time
+struct AnalysisGroup: SearchGroup {
+    size_t         job = 0;
+    AnalysisResult result;
+};
+
+// Sets up a batch entry, a FEN string optionally followed by "moves" and a list
+// of moves in UCI format.
+void set_batch_position(Position&          p,
+                        const std::string& entry,
+                        bool               chess960,
+                        StateListPtr&      states) {
+
+    const size_t split = entry.find(" moves ");
+
+    states = StateListPtr(new std::deque<StateInfo>(1));
+    p.set(entry.substr(0, split), chess960, &states->back());
+
+    if (split == std::string::npos)
+        return;
+
+    std::istringstream is(entry.substr(split + 7));
+    std::string        token;
+
+    while (is >> token)
+    {
+        Move m = UCIEngine::to_move(p, token);
+        if (m == Move::none())
+            break;
+
+        states->emplace_back();
+        p.do_move(m, states->back());
+    }
+}
+
+// A self-play game of the training data generation, played by its own group of
+// threads. The history of the game is kept here, the searches only get a copy of
+// the current state, whose previous states are still those of the history.
+struct SelfPlayGame: SearchGroup {
+    Position                              pos;
+    StateListPtr                          states;
+    int                                   startPly = 0;
+    std::vector<Engine::TrainingPosition> positions;
+    std::vector<Color>                    sides;  // To move in each position
+
+    // Outcome of the last search
+    Score score;
+    bool  noMoves = false;
+};
+
+// Centipawns, or the internal value of mate and tablebase scores
+int training_score(const Score& s) {
+
+    if (s.is<Score::Mate>())
+    {
+        const int plies = s.get<Score::Mate>().plies;
+        return plies > 0 ? VALUE_MATE - plies : -VALUE_MATE - plies;
+    }
+
+    if (s.is<Score::Tablebase>())
+    {
+        const auto tb = s.get<Score::Tablebase>();
+        return tb.win ? VALUE_TB - tb.plies : -VALUE_TB - tb.plies;
+    }
+
+    return s.get<Score::InternalUnits>().value;
+}
+
+// A game of an SPSA iteration, between the plus and the minus engine, whose
+// moves are searched by any group of threads
+struct SpsaGame {
+    Position     pos;
+    StateListPtr states;
+    Color        plus;  // The color of the plus engine
+    int          startPly = 0;
+    int          result   = 0;  // For the plus engine
+    bool         over     = false;
+};
+
+// A group of threads of an SPSA tuning, searching a move of a game at a time
+struct SpsaGroup: SearchGroup {
+    SpsaGame* game = nullptr;
+
+    // Outcome of the last search
+    Score score;
+    bool  noMoves = false;
+};
+
+// One of the two engines of an SPSA tuning. Each has its own TT and histories,
+// so that what the searches with one perturbation learn does not carry over
+// into the searches with the other, which would pull them together.
+struct SpsaEngine {
+    explicit SpsaEngine(NumaReplicationContext& ctx) :
+        histories(ctx) {}
+
+    TranspositionTable                        tt;
+    LazyNumaReplicated<Search::NumaHistories> histories;
+    std::vector<std::unique_ptr<SpsaGroup>>   groups;
+};
+
+}
+
+Engine::Engine(std::optional<std::string> path, const std::string& evalSharedPath) :
     binaryDirectory(path ? CommandLine::get_binary_directory(*path) : ""),
     numaContext(NumaConfig::from_system()),
     states(new std::deque<StateInfo>(1)),
@@ -56,8 +225,14 @@ Engine::Engine(std::optional<std::string> path) :
       numaContext,
       NN::Networks(
         NN::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NN::EmbeddedNNUEType::BIG),
-        NN::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NN::EmbeddedNNUEType::SMALL))) {
+        NN::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NN::EmbeddedNNUEType::SMALL))),
+    histories(numaContext),
+    cluster(tt, threads),
+    server(options, [this](SessionServer::Slots& slots) { set_up_session_slots(slots); }) {
     pos.set(StartFEN, false, &states->back());
+    threads.cluster     = &cluster;
+    threads.resultCache = &resultCache;
+    tt.set_numa_policy(numaContext.get_numa_config(), TTNumaPolicy::Auto);
 
 
     options.add(  //
@@ -70,35 +245,145 @@ Engine::Engine(std::optional<std::string> path) :
       "NumaPolicy", Option("auto", [this](const Option& o) {
           set_numa_config_from_option(o);
           return numa_config_information_as_string() + "\n"
-               + thread_allocation_information_as_string();
+               + thread_allocation_information_as_string() + "\n"
+               + tt_numa_information_as_string();
       }));
 
     options.add(  //
       "Threads", Option(1, 1, 1024, [this](const Option&) {
           resize_threads();
-          return thread_allocation_information_as_string();
+          return thread_allocation_information_as_string() + "\n"
+               + tt_numa_information_as_string();
+      }));
+
+    options.add(  //
+      "ThreadSpinUs", Option(0, 0, 100000, [this](const Option& o) {
+          threads.set_spin_time(o);
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "ClusterAddress", Option("127.0.0.1", [this](const Option&) {
+          return int(options["ClusterPort"]) ? std::optional<std::string>(listen_cluster())
+                                             : std::nullopt;
+      }));
+
+    options.add(  //
+      "ClusterPort", Option(0, 0, 65535, [this](const Option&) {
+          return std::optional<std::string>(listen_cluster());
+      }));
+
+    options.add(  //
+      "ServerAddress", Option("127.0.0.1", [this](const Option&) {
+          return int(options["ServerPort"]) ? std::optional<std::string>(listen_server())
+                                            : std::nullopt;
+      }));
+
+    options.add(  //
+      "ServerPort", Option(0, 0, 65535, [this](const Option&) {
+          return std::optional<std::string>(listen_server());
+      }));
+
+    options.add(  //
+      "SessionThreads", Option(1, 1, 1024, [this](const Option&) {
+          auto sessionsPaused = server.pause();  // The slots are set up again
+          return std::nullopt;
       }));
 
     options.add(  //
       "Hash", Option(16, 1, MaxHashMB, [this](const Option& o) {
           set_tt_size(o);
+          return tt_pages_information_as_string() + "\n" + tt_numa_information_as_string();
+      }));
+
+    options.add(  //
+      "HashRehash", Option(false));
+
+    options.add(  //
+      "HashSharedPath", Option("", [this](const Option&) {
+          set_tt_size(options["Hash"]);
+          return std::optional<std::string>(shared_tt_information_as_string());
+      }));
+
+    options.add(  //
+      "HashNumaPolicy",
+      Option("auto var auto var interleave var bind", "auto", [this](const Option& o) {
+          set_tt_numa_policy_from_option(UCIEngine::to_lower(o));
+          return tt_numa_information_as_string();
+      }));
+
+    options.add(  //
+      "RefreshCacheSize", Option(SQUARE_NB, 1, SQUARE_NB, [this](const Option&) {
+          resize_threads();
           return std::nullopt;
       }));
 
+    options.add(  //
+      "EvalCacheSize", Option(0, 0, 65536, [this](const Option&) {
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "SharedHistories", Option(false, [this](const Option&) {
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "HistoryPrefetch", Option(false));
+
+    options.add(  //
+      "DeferSearchedMoves", Option(false));
+
     options.add(  //
       "Clear Hash", Option([this](const Option&) {
           search_clear();
           return std::nullopt;
       }));
 
+    options.add(  //
+      "FastNewGame", Option(false));
+
+    options.add(  //
+      "Hash File", Option("", [this](const Option& o) {
+          if (std::string(o).empty())
+              return std::optional<std::string>{};
+
+          set_tt_size(options["Hash"]);
+          return std::optional<std::string>(tt_file_information_as_string());
+      }));
+
+    options.add(  //
+      "ResultCache", Option("", [this](const Option&) {
+          set_result_cache();
+          return std::optional<std::string>(result_cache_information_as_string());
+      }));
+
+    options.add(  //
+      "ResultCacheSize", Option(64, 1, MaxHashMB, [this](const Option&) {
+          set_result_cache();
+          return std::optional<std::string>(result_cache_information_as_string());
+      }));
+
+    options.add("PerftHash", Option(0, 0, MaxHashMB));
+
+    options.add("MateSolver", Option(false));
+
+    options.add("MateSolverHash", Option(64, 1, MaxHashMB));
+
     options.add(  //
       "Ponder", Option(false));
 
     options.add(  //
       "MultiPV", Option(1, 1, MAX_MOVES));
 
+    options.add("MultiPVGroups", Option(1, 1, 1024));
+
     options.add("Skill Level", Option(20, 0, 20));
 
+    options.add("Skill Fast", Option(false));
+
     options.add("Move Overhead", Option(10, 0, 5000));
 
     options.add("nodestime", Option(0, 0, 10000));
@@ -113,9 +398,30 @@ Engine::Engine(std::optional<std::string> path) :
 
     options.add("UCI_ShowWDL", Option(false));
 
+    options.add("InfoInterval", Option(0, 0, 60000));
+
+    options.add("InfoChangedOnly", Option(false));
+
+    options.add("SearchStats", Option("off var off var info var json", "off"));
+
+    options.add(  //
+      "SyzygyPath", Option("", [this](const Option& o) {
+          Tablebases::init(o, options["SyzygyPreload"]);
+          Tablebases::replicate(numaContext.get_numa_config(), options["SyzygyNumaReplicate"]);
+          return std::nullopt;
+      }));
+
     options.add(  //
-      "SyzygyPath", Option("", [](const Option& o) {
-          Tablebases::init(o);
+      "SyzygyPreload", Option("none", [this](const Option& o) {
+          Tablebases::init(options["SyzygyPath"], o);
+          Tablebases::replicate(numaContext.get_numa_config(), options["SyzygyNumaReplicate"]);
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "SyzygyNumaReplicate", Option(false, [this](const Option& o) {
+          wait_for_search_finished();
+          Tablebases::replicate(numaContext.get_numa_config(), o);
           return std::nullopt;
       }));
 
@@ -125,6 +431,18 @@ Engine::Engine(std::optional<std::string> path) :
 
     options.add("SyzygyProbeLimit", Option(7, 0, 7));
 
+    options.add(  //
+      "SyzygyAsyncThreads", Option(0, 0, 64, [](const Option& o) {
+          Tablebases::set_async_threads(size_t(int(o)));
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "SyzygyBlockCache", Option(0, 0, 4096, [](const Option& o) {
+          Tablebases::set_block_cache_size(size_t(int(o)));
+          return std::nullopt;
+      }));
+
     options.add(  //
       "EvalFile", Option(EvalFileDefaultNameBig, [this](const Option& o) {
           load_big_network(o);
@@ -137,6 +455,12 @@ Engine::Engine(std::optional<std::string> path) :
           return std::nullopt;
       }));
 
+    options.add(  //
+      "EvalSharedPath", Option(evalSharedPath.c_str(), [this](const Option&) {
+          load_networks();
+          return std::optional<std::string>(shared_networks_information_as_string());
+      }));
+
     load_networks();
     resize_threads();
 }
@@ -144,13 +468,33 @@ Engine::Engine(std::optional<std::string> path) :
 std::uint64_t Engine::perft(const std::string& fen, Depth depth, bool isChess960) {
     verify_networks();
 
-    return Benchmark::perft(fen, depth, isChess960);
+    wait_for_search_finished();
+
+    return Benchmark::perft(fen, depth, isChess960, threads, size_t(int(options["PerftHash"])));
 }
 
 void Engine::go(Search::LimitsType& limits) {
     assert(limits.perft == 0);
     verify_networks();
 
+    // A mate search is left to the proof-number solver, on the threads of the pool
+    if (limits.mate && !limits.ponderMode && limits.searchmoves.empty() && options["MateSolver"])
+    {
+        wait_for_search_finished();
+        threads.stop = false;
+        threads.run_on_thread(0, [this, limits, fen = pos.fen(), chess960 = pos.is_chess960()] {
+            MateSolver::solve(fen, chess960, limits, threads, size_t(int(options["MateSolverHash"])),
+                              updateContext);
+        });
+        return;
+    }
+
+    // The other machines of the cluster replay the game, for the repetitions
+    if (historyStates)
+        cluster.start_search(historyFen, historyMoves, historyChess960, limits.searchmoves);
+    else
+        cluster.start_search(pos.fen(), {}, pos.is_chess960(), limits.searchmoves);
+
     threads.start_thinking(options, pos, states, limits);
 }
 void Engine::stop() { threads.stop = true; }
@@ -158,11 +502,33 @@ void Engine::stop() { threads.stop = true; }
 void Engine::search_clear() {
     wait_for_search_finished();
 
+    auto sessionsPaused = server.pause();
+
     tt.clear(threads);
     threads.clear();
 
     // @TODO wont work with multiple instances
-    Tablebases::init(options["SyzygyPath"]);  // Free mapped files
+    // Free mapped files, unless the tables are meant to stay in memory
+    if (std::string(options["SyzygyPreload"]) == "none")
+        Tablebases::init(options["SyzygyPath"]);
+}
+
+// Prepares for a new game. With FastNewGame the table is only aged and the
+// histories are cleared in the background, so that the next search, rather than
+// the ucinewgame command, waits for whatever clearing is left.
+void Engine::new_game() {
+    cluster.new_game();
+
+    if (!options["FastNewGame"])
+    {
+        search_clear();
+        return;
+    }
+
+    wait_for_search_finished();
+
+    tt.age();
+    threads.clear(true);
 }
 
 void Engine::set_on_update_no_moves(std::function<void(const Engine::InfoShort&)>&& f) {
@@ -181,27 +547,701 @@ void Engine::set_on_bestmove(std::function<void(std::string_view, std::string_vi
     updateContext.onBestmove = std::move(f);
 }
 
+void Engine::set_on_search_stats(std::function<void(const std::vector<Engine::Stats>&)>&& f) {
+    updateContext.onStats = std::move(f);
+}
+
 void Engine::set_on_verify_networks(std::function<void(std::string_view)>&& f) {
     onVerifyNetworks = std::move(f);
 }
 
-void Engine::wait_for_search_finished() { threads.main_thread()->wait_for_search_finished(); }
+void Engine::wait_for_search_finished() { threads.wait_for_all_finished(); }
 
 void Engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
-    // Drop the old state and create a new one
-    states = StateListPtr(new std::deque<StateInfo>(1));
-    pos.set(fen, options["UCI_Chess960"], &states->back());
+    const bool chess960 = options["UCI_Chess960"];
+
+    // GUIs send the whole game again on every move. If the previous position
+    // command is a prefix of this one, only the new moves need to be played.
+    const bool extends = historyStates && fen == historyFen && chess960 == historyChess960
+                      && moves.size() >= historyMoves.size()
+                      && std::equal(historyMoves.begin(), historyMoves.end(), moves.begin());
+
+    if (!extends)
+    {
+        // Drop the old state and create a new one
+        states = StateListPtr(new std::deque<StateInfo>(1));
+        pos.set(fen, chess960, &states->back());
+
+        historyStates   = states.get();
+        historyFen      = fen;
+        historyChess960 = chess960;
+        historyMoves.clear();
+    }
 
-    for (const auto& move : moves)
+    for (size_t i = historyMoves.size(); i < moves.size(); ++i)
     {
-        auto m = UCIEngine::to_move(pos, move);
+        auto m = UCIEngine::to_move(pos, moves[i]);
 
         if (m == Move::none())
             break;
 
-        states->emplace_back();
-        pos.do_move(m, states->back());
+        historyStates->emplace_back();
+        pos.do_move(m, historyStates->back());
+        historyMoves.push_back(moves[i]);
+    }
+}
+
+// Sets up count groups of threadsPerGroup threads for a batch, searching on the
+// given TT and histories. All the threads are distributed at once over the NUMA
+// nodes, each group then gets a contiguous slice of the binding. A group reports
+// the end of each search to finished, with the best move found, the other
+// updates of the searches are left to the caller.
+template<typename Group>
+std::vector<std::unique_ptr<Group>>
+Engine::make_search_groups(size_t                                     count,
+                           size_t                                     threadsPerGroup,
+                           FinishedGroups&                            finished,
+                           TranspositionTable&                        groupTT,
+                           LazyNumaReplicated<Search::NumaHistories>& groupHistories) {
+    const NumaConfig&            numaConfig = numaContext.get_numa_config();
+    const std::vector<NumaIndex> binding =
+      ThreadPool::thread_binding(numaConfig, options, count * threadsPerGroup);
+
+    std::vector<std::unique_ptr<Group>> groups;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto* g = groups.emplace_back(std::make_unique<Group>()).get();
+
+        g->updateContext.onUpdateNoMoves = [](const InfoShort&) {};
+        g->updateContext.onUpdateFull    = [](const InfoFull&) {};
+        g->updateContext.onIter          = [](const InfoIter&) {};
+        g->updateContext.onStats         = [](const std::vector<Stats>&) {};
+
+        g->updateContext.onBestmove = [g, &finished](std::string_view bestmove, std::string_view) {
+            g->bestmove = bestmove;
+            finished.push(g);
+        };
+
+        std::vector<NumaIndex> groupBinding;
+        if (!binding.empty())
+            groupBinding.assign(binding.begin() + i * threadsPerGroup,
+                                binding.begin() + (i + 1) * threadsPerGroup);
+
+        g->threads.set(numaConfig, {options, g->threads, groupTT, networks, groupHistories},
+                       g->updateContext, threadsPerGroup, groupBinding);
+        g->threads.ensure_network_replicated();
+        g->threads.sharesGeneration = true;
     }
+
+    return groups;
+}
+
+void Engine::analyse(const std::vector<std::string>& fens,
+                     size_t                          threadsPerJob,
+                     const Search::LimitsType&       limits,
+                     const OnAnalysis&               onResult) {
+    wait_for_search_finished();
+    verify_networks();
+
+    if (fens.empty())
+        return;
+
+    const size_t groupCount =
+      std::min(fens.size(), std::max<size_t>(1, size_t(options["Threads"]) / threadsPerJob));
+
+    FinishedGroups finished;
+    auto           groups =
+      make_search_groups<AnalysisGroup>(groupCount, threadsPerJob, finished, tt, histories);
+
+    std::vector<AnalysisGroup*> idle;
+
+    for (auto& group : groups)
+    {
+        auto* g = group.get();
+
+        g->updateContext.onUpdateNoMoves = [g](const InfoShort& info) {
+            g->result.info                            = {};
+            static_cast<InfoShort&>(g->result.info) = info;
+        };
+        g->updateContext.onUpdateFull = [g](const InfoFull& info) {
+            if (info.multiPV != 1)
+                return;
+            g->result.info  = info;
+            g->result.wdl   = info.wdl;
+            g->result.bound = info.bound;
+            g->result.pv    = info.pv;
+        };
+        idle.push_back(g);
+    }
+
+    std::map<size_t, AnalysisResult> pending;
+    size_t                           nextJob = 0, nextResult = 0;
+    const bool                       chess960 = options["UCI_Chess960"];
+
+    // The groups search concurrently, so the batch is one search for the TT
+    tt.new_search();
+
+    while (nextResult < fens.size())
+    {
+        while (!idle.empty() && nextJob < fens.size())
+        {
+            AnalysisGroup* g = idle.back();
+            idle.pop_back();
+
+            StateListPtr setupStates;
+            Position     p;
+            set_batch_position(p, fens[nextJob], chess960, setupStates);
+
+            Search::LimitsType jobLimits = limits;
+            jobLimits.startTime          = now();
+
+            g->job    = nextJob++;
+            g->result = {};
+            g->threads.start_thinking(options, p, setupStates, jobLimits);
+        }
+
+        for (AnalysisGroup* g : finished.wait<AnalysisGroup>())
+        {
+            g->result.bestmove = std::move(g->bestmove);
+            pending.emplace(g->job, std::move(g->result));
+            idle.push_back(g);
+        }
+
+        // Report the results in input order
+        for (auto it = pending.find(nextResult); it != pending.end();
+             it      = pending.find(nextResult))
+        {
+            AnalysisResult& r = it->second;
+            r.info.wdl        = r.wdl;
+            r.info.bound      = r.bound;
+            r.info.pv         = r.pv;
+            onResult(nextResult, fens[nextResult], r.info, r.bestmove);
+            pending.erase(it);
+            ++nextResult;
+        }
+    }
+}
+
+void Engine::generate_training_data(const Benchmark::TrainingDataSetup& setup,
+                                    const Search::LimitsType&           limits,
+                                    const OnTrainingGame&               onGame) {
+    wait_for_search_finished();
+    verify_networks();
+
+    if (setup.openings.empty() || !setup.games)
+        return;
+
+    const size_t threadsPerGame = setup.threadsPerGame;
+    const size_t groupCount =
+      std::min(setup.games, std::max<size_t>(1, size_t(options["Threads"]) / threadsPerGame));
+
+    FinishedGroups finished;
+    auto           games =
+      make_search_groups<SelfPlayGame>(groupCount, threadsPerGame, finished, tt, histories);
+
+    for (auto& game : games)
+    {
+        auto* g = game.get();
+
+        g->updateContext.onUpdateNoMoves = [g](const InfoShort& info) {
+            g->noMoves = true;
+            g->score   = info.score;
+        };
+        g->updateContext.onUpdateFull = [g](const InfoFull& info) {
+            if (info.multiPV == 1)
+                g->score = info.score;
+        };
+    }
+
+    PRNG       rng(now());
+    size_t     started = 0, done = 0;
+    const bool chess960 = options["UCI_Chess960"];
+
+    auto search = [&](SelfPlayGame* g) {
+        StateListPtr rootStates(new std::deque<StateInfo>(1, g->states->back()));
+
+        Search::LimitsType moveLimits = limits;
+        moveLimits.startTime          = now();
+
+        g->noMoves = false;
+        g->threads.start_thinking(options, g->pos, rootStates, moveLimits);
+    };
+
+    // The result is from the point of view of white
+    auto finish = [&](SelfPlayGame* g, int result) {
+        for (size_t i = 0; i < g->positions.size(); ++i)
+            g->positions[i].result = g->sides[i] == WHITE ? result : -result;
+
+        onGame(g->positions);
+        ++done;
+    };
+
+    // Starts the next game on the threads of g, if any game is left
+    auto start = [&](SelfPlayGame* g) {
+        while (started < setup.games)
+        {
+            const std::string& opening = setup.openings[started++ % setup.openings.size()];
+            set_batch_position(g->pos, opening, chess960, g->states);
+
+            g->positions.clear();
+            g->sides.clear();
+
+            int i = 0;
+            for (; i < setup.randomMoves; ++i)
+            {
+                MoveList<LEGAL> moves(g->pos);
+                if (!moves.size())
+                    break;
+
+                g->states->emplace_back();
+                g->pos.do_move(*(moves.begin() + rng.rand<uint64_t>() % moves.size()),
+                               g->states->back());
+            }
+
+            // A game that ends during the random moves has no position
+            if (i < setup.randomMoves)
+            {
+                finish(g, 0);
+                continue;
+            }
+
+            g->startPly = g->pos.game_ply();
+            search(g);
+            return;
+        }
+    };
+
+    // The games are played concurrently, so the run is one search for the TT
+    tt.new_search();
+
+    for (auto& g : games)
+        start(g.get());
+
+    while (done < setup.games)
+    {
+        for (SelfPlayGame* g : finished.wait<SelfPlayGame>())
+        {
+            Position&   p  = g->pos;
+            const Color us = p.side_to_move();
+
+            // Checkmate or stalemate
+            if (g->noMoves)
+            {
+                finish(g, !p.checkers() ? 0 : us == WHITE ? -1 : 1);
+                start(g);
+                continue;
+            }
+
+            const int score = training_score(g->score);
+
+            g->positions.push_back({p.fen(), g->bestmove, score, p.game_ply(), 0});
+            g->sides.push_back(us);
+
+            if (!g->score.is<Score::InternalUnits>() || std::abs(score) >= setup.evalLimit)
+            {
+                finish(g, (score > 0) == (us == WHITE) ? 1 : -1);
+                start(g);
+                continue;
+            }
+
+            g->states->emplace_back();
+            p.do_move(UCIEngine::to_move(p, g->bestmove), g->states->back());
+
+            if (p.is_draw(0) || p.count<ALL_PIECES>() == 2
+                || p.game_ply() - g->startPly >= setup.maxPly)
+            {
+                finish(g, 0);
+                start(g);
+                continue;
+            }
+
+            search(g);
+        }
+    }
+}
+
+void Engine::tune_spsa(const Benchmark::SpsaSetup& setup,
+                       const Search::LimitsType&   limits,
+                       Spsa&                       spsa,
+                       const OnSpsaIteration&      onIteration) {
+    wait_for_search_finished();
+    verify_networks();
+
+    if (setup.openings.empty() || !setup.gamePairs || spsa.empty())
+        return;
+
+    const size_t threadsPerGame = setup.threadsPerGame;
+    const size_t groupCount     = std::max<size_t>(1, size_t(options["Threads"]) / threadsPerGame);
+
+    // The plus and the minus engine, each with a TT and histories of its own
+    FinishedGroups                             finished;
+    std::array<std::unique_ptr<SpsaEngine>, 2> engines;
+
+    for (auto& e : engines)
+    {
+        e = std::make_unique<SpsaEngine>(numaContext);
+        e->tt.resize(size_t(options["Hash"]), threads);
+        e->groups =
+          make_search_groups<SpsaGroup>(groupCount, threadsPerGame, finished, e->tt, e->histories);
+    }
+
+    for (auto& e : engines)
+        for (auto& group : e->groups)
+        {
+            auto* g = group.get();
+
+            g->updateContext.onUpdateNoMoves = [g](const InfoShort& info) {
+                g->noMoves = true;
+                g->score   = info.score;
+            };
+            g->updateContext.onUpdateFull = [g](const InfoFull& info) {
+                if (info.multiPV == 1)
+                    g->score = info.score;
+            };
+        }
+
+    PRNG       rng(now());
+    const bool chess960 = options["UCI_Chess960"];
+
+    // Two games per group and iteration, so that each engine in turn has about
+    // a move to search for each group.
+    std::vector<SpsaGame> games(2 * groupCount);
+
+    auto search = [&](SpsaGroup* g) {
+        StateListPtr rootStates(new std::deque<StateInfo>(1, g->game->states->back()));
+
+        Search::LimitsType moveLimits = limits;
+        moveLimits.startTime          = now();
+
+        g->noMoves = false;
+        g->threads.start_thinking(options, g->game->pos, rootStates, moveLimits);
+    };
+
+    auto finish = [](SpsaGame& game, int result) {
+        game.result = result;
+        game.over   = true;
+    };
+
+    // Plays the move found by g, or ends its game
+    auto play = [&](SpsaGroup* g) {
+        SpsaGame& game = *g->game;
+        Position& p    = game.pos;
+        const int sign = p.side_to_move() == game.plus ? 1 : -1;
+
+        // Checkmate or stalemate
+        if (g->noMoves)
+        {
+            finish(game, p.checkers() ? -sign : 0);
+            return;
+        }
+
+        const int score = training_score(g->score);
+
+        if (!g->score.is<Score::InternalUnits>() || std::abs(score) >= setup.evalLimit)
+        {
+            finish(game, score > 0 ? sign : -sign);
+            return;
+        }
+
+        game.states->emplace_back();
+        p.do_move(UCIEngine::to_move(p, g->bestmove), game.states->back());
+
+        if (p.is_draw(0) || p.count<ALL_PIECES>() == 2
+            || p.game_ply() - game.startPly >= setup.maxPly)
+            finish(game, 0);
+    };
+
+    // Searches a move of each game whose side to move is the engine of the given
+    // sign, on the groups as they become free
+    auto play_moves = [&](int sign) {
+        SpsaEngine& e = *engines[sign < 0];
+
+        // No group is searching, so the moves are one search for the TT
+        e.tt.new_search();
+
+        std::vector<SpsaGame*> pending;
+        for (auto& game : games)
+            if (!game.over && (game.pos.side_to_move() == game.plus) == (sign > 0))
+                pending.push_back(&game);
+
+        std::vector<SpsaGroup*> idle;
+        for (auto& g : e.groups)
+            idle.push_back(g.get());
+
+        size_t next = 0, running = 0;
+
+        while (next < pending.size() || running)
+        {
+            for (; next < pending.size() && !idle.empty(); ++running)
+            {
+                SpsaGroup* g = idle.back();
+                idle.pop_back();
+                g->game = pending[next++];
+                search(g);
+            }
+
+            for (SpsaGroup* g : finished.wait<SpsaGroup>())
+            {
+                play(g);
+                idle.push_back(g);
+                --running;
+            }
+        }
+    };
+
+    for (size_t played = 0; played < setup.gamePairs;)
+    {
+        const size_t pairs = std::min(groupCount, setup.gamePairs - played);
+
+        // Both games of a pair start from the same position, with the colors swapped
+        for (size_t i = 0; i < pairs; ++i)
+        {
+            const std::string& opening = setup.openings[(played + i) % setup.openings.size()];
+            std::vector<Move>  moves;
+
+            for (size_t j = 0; j < 2; ++j)
+            {
+                SpsaGame& game = games[2 * i + j];
+                set_batch_position(game.pos, opening, chess960, game.states);
+
+                game.plus = j ? ~game.pos.side_to_move() : game.pos.side_to_move();
+                game.over = false;
+
+                for (int k = 0; k < setup.randomMoves; ++k)
+                {
+                    MoveList<LEGAL> legal(game.pos);
+                    if (!legal.size())
+                    {
+                        finish(game, 0);
+                        break;
+                    }
+
+                    if (!j)
+                        moves.push_back(*(legal.begin() + rng.rand<uint64_t>() % legal.size()));
+
+                    game.states->emplace_back();
+                    game.pos.do_move(moves[k], game.states->back());
+                }
+
+                game.startPly = game.pos.game_ply();
+            }
+        }
+
+        // The games beyond the last pair, in the last iteration
+        for (size_t i = 2 * pairs; i < games.size(); ++i)
+            finish(games[i], 0);
+
+        spsa.perturb(rng);
+
+        // Each engine in turn searches a move in all the games, so that the
+        // parameters are changed only between the searches
+        while (std::any_of(games.begin(), games.end(), [](auto& g) { return !g.over; }))
+            for (int sign : {1, -1})
+            {
+                spsa.apply(sign);
+                play_moves(sign);
+            }
+
+        int score = 0;
+        for (const auto& game : games)
+            score += game.result;
+
+        spsa.update(score, pairs);
+        played += pairs;
+        onIteration(played, score);
+    }
+
+    spsa.finish();
+}
+
+void Engine::evaluate_batch(const std::vector<std::string>& fens,
+                            const OnEvaluation&             onResult) const {
+    verify_networks();
+
+    // Bound the memory used by the positions and their states
+    constexpr size_t ChunkSize = 4096;
+
+    auto accumulators = std::make_unique<NN::AccumulatorStack>();
+    auto caches       = std::make_unique<NN::AccumulatorCaches>(*networks);
+
+    const bool chess960 = options["UCI_Chess960"];
+
+    for (size_t first = 0; first < fens.size(); first += ChunkSize)
+    {
+        const size_t count = std::min(ChunkSize, fens.size() - first);
+
+        std::vector<Position>        positions(count);
+        std::vector<StateListPtr>    stateLists(count);
+        std::vector<const Position*> batch;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            set_batch_position(positions[i], fens[first + i], chess960, stateLists[i]);
+
+            // There is no static evaluation of positions in check
+            if (!positions[i].checkers())
+                batch.push_back(&positions[i]);
+        }
+
+        std::vector<Value> values = Eval::evaluate_batch(*networks, batch, *accumulators, *caches);
+
+        for (size_t i = 0, j = 0; i < count; ++i)
+        {
+            std::optional<Score> score;
+
+            if (j < batch.size() && batch[j] == &positions[i])
+                score = Score(values[j++], positions[i]);
+
+            onResult(first + i, fens[first + i], score);
+        }
+    }
+}
+
+// Times each component over repeated passes on the positions, for at least
+// MinTimeNano per component. Only the work inside timed() is measured, so that
+// the setup a component needs (e.g. a root accumulator) does not count.
+std::vector<Benchmark::ComponentTiming>
+Engine::benchmark_components(const std::vector<std::string>& fens, bool countEvents) const {
+    verify_networks();
+
+    using Clock                    = std::chrono::steady_clock;
+    constexpr uint64_t MinTimeNano = 200'000'000;
+
+    auto accumulators = std::make_unique<NN::AccumulatorStack>();
+    auto caches       = std::make_unique<NN::AccumulatorCaches>(*networks);
+
+    std::vector<Position>     positions(fens.size());
+    std::vector<StateListPtr> stateLists(fens.size());
+
+    for (size_t i = 0; i < fens.size(); ++i)
+        set_batch_position(positions[i], fens[i], options["UCI_Chess960"], stateLists[i]);
+
+    std::vector<Benchmark::ComponentTiming> timings;
+    uint64_t                                sink = 0;
+
+    std::unique_ptr<PerfCounters> counters;
+    if (countEvents)
+        counters = std::make_unique<PerfCounters>();
+
+    auto measure = [&](const std::string& name, auto&& component) {
+        Benchmark::ComponentTiming t{name, 0, 0, {}};
+
+        // The counters are read outside of the timing, which they would slow down
+        auto timed = [&t, &counters](auto&& work) {
+            PerfCounters::Values before;
+            if (counters)
+                before = counters->read();
+
+            const auto start = Clock::now();
+            t.ops += work();
+            t.nanoseconds += uint64_t(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+            if (counters)
+            {
+                const PerfCounters::Values after = counters->read();
+                for (size_t e = 0; e < after.size(); ++e)
+                    if (before[e] && after[e])
+                        t.events[e] = t.events[e].value_or(0) + *after[e] - *before[e];
+            }
+        };
+
+        do
+            for (Position& p : positions)
+                component(p, timed);
+        while (t.ops && t.nanoseconds < MinTimeNano);
+
+        timings.push_back(t);
+    };
+
+    measure("movegen", [&](Position& p, auto&& timed) {
+        timed([&]() {
+            sink += MoveList<LEGAL>(p).size();
+            return 1;
+        });
+    });
+
+    measure("do_move", [&](Position& p, auto&& timed) {
+        const MoveList<LEGAL> moves(p);
+        StateInfo             st;
+
+        timed([&]() {
+            for (const auto& m : moves)
+            {
+                p.do_move(m, st);
+                sink += p.key();
+                p.undo_move(m);
+            }
+            return moves.size();
+        });
+    });
+
+    measure("nnue_incremental", [&](Position& p, auto&& timed) {
+        const MoveList<LEGAL> moves(p);
+        StateInfo             st;
+
+        accumulators->reset();
+        sink += Eval::evaluate(*networks, p, *accumulators, *caches, 0);
+
+        timed([&]() {
+            for (const auto& m : moves)
+            {
+                accumulators->push(p.do_move(m, st));
+                sink += Eval::evaluate(*networks, p, *accumulators, *caches, 0);
+                accumulators->pop();
+                p.undo_move(m);
+            }
+            return moves.size();
+        });
+    });
+
+    // Refreshes from an empty cache, that is the accumulators are computed
+    // from scratch
+    measure("nnue_refresh", [&](Position& p, auto&& timed) {
+        caches->clear(*networks);
+        accumulators->reset();
+
+        timed([&]() {
+            sink += Eval::evaluate(*networks, p, *accumulators, *caches, 0);
+            return 1;
+        });
+    });
+
+    measure("tt_probe", [&](Position& p, auto&& timed) {
+        std::vector<Key> keys{p.key()};
+        StateInfo        st;
+
+        for (const auto& m : MoveList<LEGAL>(p))
+        {
+            p.do_move(m, st);
+            keys.push_back(p.key());
+            p.undo_move(m);
+        }
+
+        timed([&]() {
+            for (Key key : keys)
+                sink += std::get<0>(tt.probe(key));
+            return keys.size();
+        });
+    });
+
+    // Only the positions within the loaded tablebases are probed
+    measure("tb_probe", [&](Position& p, auto&& timed) {
+        if (popcount(p.pieces()) > Tablebases::MaxCardinality || p.can_castle(ANY_CASTLING))
+            return;
+
+        timed([&]() {
+            Tablebases::ProbeState result;
+            sink += Tablebases::probe_wdl(p, &result);
+            return result != Tablebases::FAIL;
+        });
+    });
+
+    // Keep the work of the components from being optimized away
+    [[maybe_unused]] volatile uint64_t result = sink;
+
+    return timings;
 }
 
 // modifiers
@@ -228,20 +1268,139 @@ void Engine::set_numa_config_from_option(const std::string& o) {
     // Force reallocation of threads in case affinities need to change.
     resize_threads();
     threads.ensure_network_replicated();
+
+    // The copies of the preloaded tablebases follow the NUMA nodes
+    Tablebases::replicate(numaContext.get_numa_config(), options["SyzygyNumaReplicate"]);
+}
+
+void Engine::set_tt_numa_policy_from_option(const std::string& o) {
+    const TTNumaPolicy policy = o == "interleave" ? TTNumaPolicy::Interleave
+                              : o == "bind"       ? TTNumaPolicy::Bind
+                                                  : TTNumaPolicy::Auto;
+
+    tt.set_numa_policy(numaContext.get_numa_config(), policy);
+
+    // Pages are placed when first touched, so the table must be reallocated
+    set_tt_size(options["Hash"]);
 }
 
 void Engine::resize_threads() {
     threads.wait_for_search_finished();
-    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks}, updateContext);
 
-    // Reallocate the hash with the new threadpool size
-    set_tt_size(options["Hash"]);
+    auto sessionsPaused = server.pause();
+
+    // When threads are kept, the pool was only resized and the hash is kept as
+    // well. Otherwise reallocate the hash with the new threadpool.
+    if (!threads.set(numaContext.get_numa_config(), {options, threads, tt, networks, histories},
+                     updateContext))
+        set_tt_size(options["Hash"]);
+
     threads.ensure_network_replicated();
 }
 
 void Engine::set_tt_size(size_t mb) {
     wait_for_search_finished();
-    tt.resize(mb, threads);
+
+    auto paused         = cluster.pause();
+    auto sessionsPaused = server.pause();
+
+    // Share the table with the other processes on this host, if a directory is set
+    if (tt.share(options["HashSharedPath"], mb))
+    {
+        ttFileLoaded = false;
+        return;
+    }
+
+    // Warm start from the hash file, if one is set and was saved with this size
+    ttFileLoaded = tt.load(options["Hash File"], mb);
+
+    if (!ttFileLoaded)
+    {
+        if (options["HashRehash"])
+            tt.rehash(mb, threads);
+        else
+            tt.resize(mb, threads);
+    }
+}
+
+// A file of another size is replaced, so the results are kept only while the
+// size stays the same
+void Engine::set_result_cache() {
+    wait_for_search_finished();
+    resultCache.open(options["ResultCache"], size_t(options["ResultCacheSize"]));
+}
+
+bool Engine::save_tt(const std::string& file) {
+    wait_for_search_finished();
+    return tt.save(file);
+}
+
+bool Engine::load_tt(const std::string& file) {
+    wait_for_search_finished();
+
+    auto paused         = cluster.pause();
+    auto sessionsPaused = server.pause();
+    return tt.load(file, options["Hash"]);
+}
+
+bool Engine::serve_cluster(const std::string& host, int port) {
+    wait_for_search_finished();
+    return cluster.serve(*this, host, port);
+}
+
+// Listens for the other nodes of the cluster on the "ClusterPort" of the
+// "ClusterAddress", or disconnects them if the port is 0, and tells how it went.
+std::string Engine::listen_cluster() {
+    wait_for_search_finished();
+
+    const int         port      = options["ClusterPort"];
+    const std::string address   = options["ClusterAddress"];
+    const std::string where     = "port " + std::to_string(port) + " of " + address;
+    const bool        listening = cluster.listen(port, address);
+
+    return !port     ? "Cluster is off"
+         : listening ? "Cluster listening on " + where
+                     : "Cluster can't listen on " + where;
+}
+
+// Starts the server on the "ServerPort" of the "ServerAddress", or stops it if
+// the port is 0, and tells how it went.
+std::string Engine::listen_server() {
+    const int         port      = options["ServerPort"];
+    const std::string address   = options["ServerAddress"];
+    const std::string where     = "port " + std::to_string(port) + " of " + address;
+    const bool        listening = server.listen(port, address);
+
+    return !port     ? "Server is off"
+         : listening ? "Server listening on " + where + " with "
+                           + std::to_string(server.slot_count()) + " slots"
+                     : "Server can't listen on " + where;
+}
+
+// Sets up the slots of the sessions of the server, as many as fit in the threads
+// of the engine, like the groups of a batch analysis.
+void Engine::set_up_session_slots(SessionServer::Slots& slots) {
+    const NumaConfig& numaConfig        = numaContext.get_numa_config();
+    const size_t      threadsPerSession = size_t(options["SessionThreads"]);
+    const size_t      slotCount =
+      std::max<size_t>(1, size_t(options["Threads"]) / threadsPerSession);
+
+    const std::vector<NumaIndex> binding =
+      ThreadPool::thread_binding(numaConfig, options, slotCount * threadsPerSession);
+
+    for (size_t i = 0; i < slotCount; ++i)
+    {
+        auto* s = slots.emplace_back(std::make_unique<SessionServer::Slot>(options)).get();
+
+        std::vector<NumaIndex> slotBinding;
+        if (!binding.empty())
+            slotBinding.assign(binding.begin() + i * threadsPerSession,
+                               binding.begin() + (i + 1) * threadsPerSession);
+
+        s->threads.set(numaConfig, {s->options, s->threads, tt, networks, histories},
+                       s->updateContext, threadsPerSession, slotBinding);
+        s->threads.ensure_network_replicated();
+    }
 }
 
 void Engine::set_ponderhit(bool b) { threads.main_manager()->ponder = b; }
@@ -254,32 +1413,48 @@ void Engine::verify_networks() const {
 }
 
 void Engine::load_networks() {
+    wait_for_search_finished();
+
+    auto sessionsPaused = server.pause();
+
     networks.modify_and_replicate([this](NN::Networks& networks_) {
-        networks_.big.load(binaryDirectory, options["EvalFile"]);
-        networks_.small.load(binaryDirectory, options["EvalFileSmall"]);
+        networks_.big.load(binaryDirectory, options["EvalFile"], options["EvalSharedPath"]);
+        networks_.small.load(binaryDirectory, options["EvalFileSmall"],
+                             options["EvalSharedPath"]);
     });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
 void Engine::load_big_network(const std::string& file) {
-    networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.big.load(binaryDirectory, file); });
+    wait_for_search_finished();
+
+    auto sessionsPaused = server.pause();
+
+    networks.modify_and_replicate([this, &file](NN::Networks& networks_) {
+        networks_.big.load(binaryDirectory, file, options["EvalSharedPath"]);
+    });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
 void Engine::load_small_network(const std::string& file) {
-    networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.small.load(binaryDirectory, file); });
+    wait_for_search_finished();
+
+    auto sessionsPaused = server.pause();
+
+    networks.modify_and_replicate([this, &file](NN::Networks& networks_) {
+        networks_.small.load(binaryDirectory, file, options["EvalSharedPath"]);
+    });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
-void Engine::save_network(const std::pair<std::optional<std::string>, std::string> files[2]) {
-    networks.modify_and_replicate([&files](NN::Networks& networks_) {
-        networks_.big.save(files[0].first);
-        networks_.small.save(files[1].first);
+void Engine::save_network(const std::pair<std::optional<std::string>, std::string> files[2],
+                          bool                                                     raw) {
+    networks.modify_and_replicate([&files, raw](NN::Networks& networks_) {
+        networks_.big.save(files[0].first, raw);
+        networks_.small.save(files[1].first, raw);
     });
 }
 
@@ -300,7 +1475,10 @@ OptionsMap&       Engine::get_options() { return options; }
 
 std::string Engine::fen() const { return pos.fen(); }
 
-void Engine::flip() { pos.flip(); }
+void Engine::flip() {
+    pos.flip();
+    historyStates = nullptr;
+}
 
 std::string Engine::visualize() const {
     std::stringstream ss;
@@ -310,6 +1488,38 @@ std::string Engine::visualize() const {
 
 int Engine::get_hashfull(int maxAge) const { return tt.hashfull(maxAge); }
 
+std::pair<uint64_t, uint64_t> Engine::get_tt_probes_and_hits() const {
+    return {threads.tt_probes(), threads.tt_hits()};
+}
+
+std::pair<int64_t, int64_t> Engine::get_search_latencies() const {
+    return threads.search_latencies();
+}
+
+void Engine::set_perf_counting(bool enabled) {
+    for (auto& count : threads.perfEvents)
+        count = 0;
+    threads.countPerfEvents = enabled;
+}
+
+PerfCounters::Values Engine::get_perf_counts() const {
+    PerfCounters::Values counts = PerfCounters().read();
+
+    for (size_t e = 0; e < counts.size(); ++e)
+        if (counts[e])
+            counts[e] = threads.perfEvents[e].load();
+
+    return counts;
+}
+
+std::pair<uint64_t, uint64_t> Engine::get_tb_block_cache_probes_and_hits() const {
+    return Tablebases::block_cache_probes_and_hits();
+}
+
+size_t Engine::get_refresh_cache_memory() const { return threads.refresh_cache_memory(); }
+
+Tablebases::WDLCache::Stats Engine::get_tb_cache_stats() const { return threads.tb_cache_stats(); }
+
 std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_node() const {
     auto                                   counts = threads.get_bound_thread_count_by_numa_node();
     const NumaConfig&                      cfg    = numaContext.get_numa_config();
@@ -351,6 +1561,135 @@ std::string Engine::thread_binding_information_as_string() const {
     return ss.str();
 }
 
+std::string Engine::tt_numa_information_as_string() const {
+    std::stringstream ss;
+
+    if (numaContext.get_numa_config().num_numa_nodes() <= 1)
+        return ss.str();
+
+    ss << "Hash NUMA policy: " << std::string(options["HashNumaPolicy"]);
+
+    const auto distribution = tt.numa_page_distribution();
+    size_t     total        = 0;
+
+    for (auto [node, count] : distribution)
+        total += count;
+
+    if (total)
+    {
+        ss << ", sampled pages by NUMA node:";
+
+        for (auto [node, count] : distribution)
+            ss << " " << node << ":" << 100 * count / total << "%";
+    }
+
+    return ss.str();
+}
+
+std::string Engine::tt_pages_information_as_string() const {
+    return "Hash uses " + tt.pages_information();
+}
+
+// The bytes used by each part of the engine, one part per line, by NUMA node for
+// the replicated ones, with the pages backing the allocations which may use
+// large pages. The files mapped by Syzygy are left out of the total, as the
+// system can drop their pages at any time.
+std::string Engine::memory_information_as_string() const {
+    std::stringstream ss;
+    size_t            total = 0;
+
+    total += tt.memory();
+    ss << "Memory of the hash: " << tt.memory() << " bytes, "
+       << (tt.is_shared() ? "shared memory" : tt.pages_information());
+
+    const auto workers = threads.worker_memory_by_numa_node();
+    for (size_t n = 0; n < workers.size(); ++n)
+        if (workers[n])
+        {
+            total += workers[n];
+            ss << "\nMemory of the threads on node " << n << ": " << workers[n]
+               << " bytes, regular pages";
+        }
+
+    histories.for_each_replica([&](NumaIndex n, const Search::NumaHistories& h) {
+        total += h.memory();
+        ss << "\nMemory of the shared histories on node " << n << ": " << h.memory()
+           << " bytes, " << h.pages_information();
+    });
+
+    networks.for_each_replica([&](NumaIndex n, const Eval::NNUE::Networks& nets) {
+        const size_t bytes = nets.big.memory() + nets.small.memory();
+        total += bytes;
+        ss << "\nMemory of the networks on node " << n << ": " << bytes << " bytes, big net "
+           << nets.big.pages_information() << ", small net " << nets.small.pages_information();
+    });
+
+    const size_t stateBytes =
+      threads.setup_states_memory() + (states ? states->size() * sizeof(StateInfo) : 0);
+    total += stateBytes;
+    ss << "\nMemory of the position states: " << stateBytes << " bytes";
+
+    const Tablebases::MemoryUse tb = Tablebases::memory_use();
+    total += tb.preloaded + tb.replicated + tb.blockCache;
+    ss << "\nMemory of Syzygy: " << tb.mapped << " bytes of mapped files, " << tb.preloaded
+       << " bytes of preloaded files, " << tb.replicated << " bytes of copies on NUMA nodes, "
+       << tb.blockCache << " bytes of block cache";
+
+    ss << "\nMemory total: " << total << " bytes (" << (total + (1 << 20) - 1) / (1 << 20)
+       << " MiB), not counting the mapped Syzygy files";
+
+    return ss.str();
+}
+
+std::string Engine::tt_file_information_as_string() const {
+    std::stringstream ss;
+
+    if (ttFileLoaded)
+        ss << "Hash loaded from " << std::string(options["Hash File"]);
+    else
+        ss << "Hash not loaded, " << std::string(options["Hash File"])
+           << " is missing or was not saved with Hash " << int(options["Hash"]);
+
+    return ss.str();
+}
+
+std::string Engine::shared_tt_information_as_string() const {
+    const std::string dir = options["HashSharedPath"];
+
+    if (dir.empty())
+        return "Hash is private";
+
+    if (tt.is_shared())
+        return "Hash shared from " + dir;
+
+    return "Hash is private, " + dir + " can't be used for shared memory";
+}
+
+std::string Engine::result_cache_information_as_string() const {
+    const std::string path = options["ResultCache"];
+
+    if (path.empty())
+        return "Result cache is off";
+
+    if (resultCache.is_open())
+        return "Result cache in " + path + ", " + std::to_string(int(options["ResultCacheSize"]))
+             + " MB";
+
+    return "Result cache is off, " + path + " can't be used";
+}
+
+std::string Engine::shared_networks_information_as_string() const {
+    const std::string dir = options["EvalSharedPath"];
+
+    if (dir.empty())
+        return "NNUE weights are private";
+
+    if (networks->big.is_shared() && networks->small.is_shared())
+        return "NNUE weights shared from " + dir;
+
+    return "NNUE weights are private, " + dir + " can't be used for shared memory";
+}
+
 std::string Engine::thread_allocation_information_as_string() const {
     std::stringstream ss;
 
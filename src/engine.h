@@ -21,31 +21,63 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
+#include "cluster.h"
 #include "nnue/network.h"
 #include "numa.h"
 #include "position.h"
+#include "resultcache.h"
+#include "score.h"
 #include "search.h"
+#include "server.h"
 #include "syzygy/tbprobe.h"  // for Stockfish::Depth
 #include "thread.h"
+#include "trainingdata.h"
 #include "tt.h"
+#include "tune.h"
 #include "ucioption.h"
 
 namespace Stockfish {
 
+class FinishedGroups;
+
 class Engine {
    public:
     using InfoShort = Search::InfoShort;
     using InfoFull  = Search::InfoFull;
     using InfoIter  = Search::InfoIteration;
+    using Stats     = Search::SearchStats;
+
+    using TrainingPosition = Stockfish::TrainingPosition;
+
+    // Called once per analysed position, in input order, with the index and
+    // the FEN of the position, the last PV info of the search and the best move.
+    using OnAnalysis =
+      std::function<void(size_t, std::string_view, const InfoFull&, std::string_view)>;
+
+    // Called once per self-play game, in order of completion, with its positions
+    using OnTrainingGame = std::function<void(const std::vector<TrainingPosition>&)>;
 
-    Engine(std::optional<std::string> path = std::nullopt);
+    // Called once per SPSA iteration with the game pairs played so far and the
+    // score of the plus engine in the iteration
+    using OnSpsaIteration = std::function<void(size_t, int)>;
+
+    // Called once per evaluated position, in input order, with the index and
+    // the FEN of the position and its static evaluation, none when in check.
+    using OnEvaluation = std::function<void(size_t, std::string_view, std::optional<Score>)>;
+
+    // The networks are loaded from evalSharedPath, the initial value of the
+    // "EvalSharedPath" option, so that they need not be loaded privately first
+    Engine(std::optional<std::string> path = std::nullopt, const std::string& evalSharedPath = "");
 
     // Cannot be movable due to components holding backreferences to fields
     Engine(const Engine&)            = delete;
@@ -67,18 +99,55 @@ class Engine {
     // set a new position, moves are in UCI format
     void set_position(const std::string& fen, const std::vector<std::string>& moves);
 
+    // blocking call to search many positions concurrently, in groups of threadsPerJob
+    // threads sharing the transposition table and the networks
+    void analyse(const std::vector<std::string>& fens,
+                 size_t                          threadsPerJob,
+                 const Search::LimitsType&       limits,
+                 const OnAnalysis&               onResult);
+
+    // blocking call to play many self-play games concurrently, each on a group
+    // of threads, all sharing the transposition table and the networks
+    void generate_training_data(const Benchmark::TrainingDataSetup& setup,
+                                const Search::LimitsType&           limits,
+                                const OnTrainingGame&               onGame);
+
+    // blocking call to tune the parameters of TUNE() by SPSA, playing the games of
+    // an iteration concurrently, each on a group of threads
+    void tune_spsa(const Benchmark::SpsaSetup& setup,
+                   const Search::LimitsType&   limits,
+                   Spsa&                       spsa,
+                   const OnSpsaIteration&      onIteration);
+
+    // blocking call to statically evaluate many positions, batched by network
+    // and layer stack
+    void evaluate_batch(const std::vector<std::string>& fens, const OnEvaluation& onResult) const;
+
+    // blocking call to time move generation, do_move, NNUE updates, TT and
+    // tablebase probes in isolation, over the given positions
+    std::vector<Benchmark::ComponentTiming>
+    benchmark_components(const std::vector<std::string>& fens, bool countEvents) const;
+
     // modifiers
 
     void set_numa_config_from_option(const std::string& o);
+    void set_tt_numa_policy_from_option(const std::string& o);
     void resize_threads();
     void set_tt_size(size_t mb);
+    void set_result_cache();
     void set_ponderhit(bool);
+    bool save_tt(const std::string& file);
+    bool load_tt(const std::string& file);
+    // blocking call to search for the main machine of a cluster, until it disconnects
+    bool serve_cluster(const std::string& host, int port);
     void search_clear();
+    void new_game();
 
     void set_on_update_no_moves(std::function<void(const InfoShort&)>&&);
     void set_on_update_full(std::function<void(const InfoFull&)>&&);
     void set_on_iter(std::function<void(const InfoIter&)>&&);
     void set_on_bestmove(std::function<void(std::string_view, std::string_view)>&&);
+    void set_on_search_stats(std::function<void(const std::vector<Stats>&)>&&);
     void set_on_verify_networks(std::function<void(std::string_view)>&&);
 
     // network related
@@ -87,7 +156,8 @@ class Engine {
     void load_networks();
     void load_big_network(const std::string& file);
     void load_small_network(const std::string& file);
-    void save_network(const std::pair<std::optional<std::string>, std::string> files[2]);
+    void save_network(const std::pair<std::optional<std::string>, std::string> files[2],
+                      bool raw = false);
 
     // utility functions
 
@@ -98,14 +168,42 @@ class Engine {
 
     int get_hashfull(int maxAge = 0) const;
 
+    // TT probes and hits of the last search
+    std::pair<uint64_t, uint64_t> get_tt_probes_and_hits() const;
+
+    // Microseconds from the last "go" until all the threads searched, and from
+    // the stop of the last search until its best move was sent
+    std::pair<int64_t, int64_t> get_search_latencies() const;
+
+    // The hardware events of the searches since the counting was enabled, see
+    // PerfCounters, std::nullopt for those that cannot be counted
+    void                 set_perf_counting(bool enabled);
+    PerfCounters::Values get_perf_counts() const;
+
+    // Lookups and hits in the cache of decompressed TB blocks, since startup
+    std::pair<uint64_t, uint64_t> get_tb_block_cache_probes_and_hits() const;
+
+    // Bytes used by the NNUE refresh caches of all threads
+    size_t get_refresh_cache_memory() const;
+
+    // Tablebase probe cache statistics of the last search
+    Tablebases::WDLCache::Stats get_tb_cache_stats() const;
+
     std::string                            fen() const;
     void                                   flip();
     std::string                            visualize() const;
     std::vector<std::pair<size_t, size_t>> get_bound_thread_count_by_numa_node() const;
     std::string                            get_numa_config_as_string() const;
     std::string                            numa_config_information_as_string() const;
+    std::string                            shared_networks_information_as_string() const;
+    std::string                            result_cache_information_as_string() const;
+    std::string                            shared_tt_information_as_string() const;
     std::string                            thread_allocation_information_as_string() const;
     std::string                            thread_binding_information_as_string() const;
+    std::string                            tt_file_information_as_string() const;
+    std::string                            tt_numa_information_as_string() const;
+    std::string                            tt_pages_information_as_string() const;
+    std::string                            memory_information_as_string() const;
 
    private:
     const std::string binaryDirectory;
@@ -115,13 +213,38 @@ class Engine {
     Position     pos;
     StateListPtr states;
 
-    OptionsMap                               options;
-    ThreadPool                               threads;
-    TranspositionTable                       tt;
-    LazyNumaReplicated<Eval::NNUE::Networks> networks;
+    // The position command that set up pos, so that a command extending it only
+    // plays the new moves. The states of pos are kept by historyStates, which
+    // the thread pool owns once a search was started from pos.
+    std::deque<StateInfo>*   historyStates = nullptr;
+    std::string              historyFen;
+    std::vector<std::string> historyMoves;
+    bool                     historyChess960 = false;
+
+    OptionsMap                                options;
+    ThreadPool                                threads;
+    TranspositionTable                        tt;
+    bool                                      ttFileLoaded = false;
+    LazyNumaReplicated<Eval::NNUE::Networks>  networks;
+    LazyNumaReplicated<Search::NumaHistories> histories;
+    SearchCluster                             cluster;
+    ResultCache                               resultCache;
+    SessionServer                             server;
 
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
+
+    std::string listen_cluster();
+    std::string listen_server();
+    void        set_up_session_slots(SessionServer::Slots& slots);
+
+    template<typename Group>
+    std::vector<std::unique_ptr<Group>>
+    make_search_groups(size_t                                     count,
+                       size_t                                     threadsPerGroup,
+                       FinishedGroups&                            finished,
+                       TranspositionTable&                        groupTT,
+                       LazyNumaReplicated<Search::NumaHistories>& groupHistories);
 };
 
 }  // namespace Stockfish
@@ -27,6 +27,7 @@
 #include <memory>
 #include <sstream>
 #include <tuple>
+#include <vector>
 
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
@@ -50,44 +51,132 @@ bool Eval::use_smallnet(const Position& pos) {
     return std::abs(simpleEval) > 962;
 }
 
+namespace {
+
+// Combines the outputs of a network, damped by the nnue complexity
+Eval::NetworkScore network_score(Value psqt, Value positional, bool smallNet) {
+
+    Value nnue           = (125 * psqt + 131 * positional) / 128;
+    int   nnueComplexity = std::abs(psqt - positional);
+
+    nnue -= nnue * nnueComplexity / (smallNet ? 20233 : 17879);
+
+    return {nnue, nnueComplexity};
+}
+
+// Higher eval accuracy is worth the time spent when the small net is unsure
+bool needs_big_net(Value psqt, Value positional) {
+    return std::abs((125 * psqt + 131 * positional) / 128) < 236;
+}
+
+}  // namespace
+
+// Blends the network score with optimism and material into the final evaluation
+Value Eval::blend(const Position& pos, NetworkScore score, int optimism) {
+
+    // Blend optimism and eval with nnue complexity
+    optimism += optimism * score.complexity / 468;
+
+    int material = 535 * pos.count<PAWN>() + pos.non_pawn_material();
+    int v        = (score.nnue * (77777 + material) + optimism * (7777 + material)) / 77777;
+
+    // Damp down the evaluation linearly when shuffling
+    v -= v * pos.rule50_count() / 212;
+
+    // Guarantee evaluation does not hit the tablebase range
+    v = std::clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+
+    return v;
+}
+
+// Evaluates the position with the networks, from the point of view of the side
+// to move. The score only depends on the pieces on the board.
+Eval::NetworkScore Eval::evaluate_networks(const Eval::NNUE::Networks&    networks,
+                                           const Position&                pos,
+                                           Eval::NNUE::AccumulatorStack&  accumulators,
+                                           Eval::NNUE::AccumulatorCaches& caches) {
+
+    assert(!pos.checkers());
+
+    bool smallNet           = use_smallnet(pos);
+    auto [psqt, positional] = smallNet ? networks.small.evaluate(pos, accumulators, &caches.small)
+                                       : networks.big.evaluate(pos, accumulators, &caches.big);
+
+    // Re-evaluate the position when higher eval accuracy is worth the time spent
+    if (smallNet && needs_big_net(psqt, positional))
+    {
+        std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, &caches.big);
+        smallNet                   = false;
+    }
+
+    return network_score(psqt, positional, smallNet);
+}
+
 // Evaluate is the evaluator for the outer world. It returns a static evaluation
 // of the position from the point of view of the side to move.
 Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
                      const Position&                pos,
+                     Eval::NNUE::AccumulatorStack&  accumulators,
                      Eval::NNUE::AccumulatorCaches& caches,
                      int                            optimism) {
 
-    assert(!pos.checkers());
+    return blend(pos, evaluate_networks(networks, pos, accumulators, caches), optimism);
+}
 
-    bool smallNet           = use_smallnet(pos);
-    auto [psqt, positional] = smallNet ? networks.small.evaluate(pos, &caches.small)
-                                       : networks.big.evaluate(pos, &caches.big);
+// Like evaluate() without optimism, but for many positions at once. Positions
+// are evaluated from scratch, grouped by network so that the weights of each
+// network are loaded once for the whole batch.
+std::vector<Value> Eval::evaluate_batch(const Eval::NNUE::Networks&         networks,
+                                        const std::vector<const Position*>& positions,
+                                        Eval::NNUE::AccumulatorStack&       accumulators,
+                                        Eval::NNUE::AccumulatorCaches&      caches) {
+
+    std::vector<NNUE::NetworkOutput> outputs(positions.size());
+    std::vector<bool>                smallNet(positions.size());
+    std::vector<size_t>              indices[2];
+    std::vector<const Position*>     batch[2];
+    std::vector<NNUE::NetworkOutput> batchOutputs;
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        assert(!positions[i]->checkers());
 
-    Value nnue = (125 * psqt + 131 * positional) / 128;
+        smallNet[i] = use_smallnet(*positions[i]);
+        indices[smallNet[i]].push_back(i);
+        batch[smallNet[i]].push_back(positions[i]);
+    }
 
-    // Re-evaluate the position when higher eval accuracy is worth the time spent
-    if (smallNet && (std::abs(nnue) < 236))
+    batchOutputs.resize(batch[true].size());
+    networks.small.evaluate_batch(batch[true], accumulators, &caches.small, batchOutputs.data());
+
+    for (size_t j = 0; j < batch[true].size(); ++j)
     {
-        std::tie(psqt, positional) = networks.big.evaluate(pos, &caches.big);
-        nnue                       = (125 * psqt + 131 * positional) / 128;
-        smallNet                   = false;
+        const size_t i = indices[true][j];
+        outputs[i]     = batchOutputs[j];
+
+        if (needs_big_net(std::get<0>(outputs[i]), std::get<1>(outputs[i])))
+        {
+            smallNet[i] = false;
+            indices[false].push_back(i);
+            batch[false].push_back(positions[i]);
+        }
     }
 
-    // Blend optimism and eval with nnue complexity
-    int nnueComplexity = std::abs(psqt - positional);
-    optimism += optimism * nnueComplexity / 468;
-    nnue -= nnue * nnueComplexity / (smallNet ? 20233 : 17879);
+    batchOutputs.resize(batch[false].size());
+    networks.big.evaluate_batch(batch[false], accumulators, &caches.big, batchOutputs.data());
 
-    int material = 535 * pos.count<PAWN>() + pos.non_pawn_material();
-    int v        = (nnue * (77777 + material) + optimism * (7777 + material)) / 77777;
+    for (size_t j = 0; j < batch[false].size(); ++j)
+        outputs[indices[false][j]] = batchOutputs[j];
 
-    // Damp down the evaluation linearly when shuffling
-    v -= v * pos.rule50_count() / 212;
+    std::vector<Value> values(positions.size());
 
-    // Guarantee evaluation does not hit the tablebase range
-    v = std::clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        auto [psqt, positional] = outputs[i];
+        values[i] = blend(*positions[i], network_score(psqt, positional, smallNet[i]), VALUE_ZERO);
+    }
 
-    return v;
+    return values;
 }
 
 // Like evaluate(), but instead of returning a value, it returns
@@ -99,20 +188,21 @@ std::string Eval::trace(Position& pos, const Eval::NNUE::Networks& networks) {
     if (pos.checkers())
         return "Final evaluation: none (in check)";
 
-    auto caches = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
+    auto accumulators = std::make_unique<Eval::NNUE::AccumulatorStack>();
+    auto caches       = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
 
     std::stringstream ss;
     ss << std::showpoint << std::noshowpos << std::fixed << std::setprecision(2);
-    ss << '\n' << NNUE::trace(pos, networks, *caches) << '\n';
+    ss << '\n' << NNUE::trace(pos, networks, *accumulators, *caches) << '\n';
 
     ss << std::showpoint << std::showpos << std::fixed << std::setprecision(2) << std::setw(15);
 
-    auto [psqt, positional] = networks.big.evaluate(pos, &caches->big);
+    auto [psqt, positional] = networks.big.evaluate(pos, *accumulators, &caches->big);
     Value v                 = psqt + positional;
     v                       = pos.side_to_move() == WHITE ? v : -v;
     ss << "NNUE evaluation        " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)\n";
 
-    v = evaluate(networks, pos, *caches, VALUE_ZERO);
+    v = evaluate(networks, pos, *accumulators, *caches, VALUE_ZERO);
     v = pos.side_to_move() == WHITE ? v : -v;
     ss << "Final evaluation       " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)";
     ss << " [with scaled NNUE, ...]";
@@ -19,8 +19,13 @@
 #ifndef EVALUATE_H_INCLUDED
 #define EVALUATE_H_INCLUDED
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
+#include "misc.h"
 #include "types.h"
 
 namespace Stockfish {
@@ -39,16 +44,71 @@ namespace Eval {
 namespace NNUE {
 struct Networks;
 struct AccumulatorCaches;
+class AccumulatorStack;
 }
 
 std::string trace(Position& pos, const Eval::NNUE::Networks& networks);
 
-int   simple_eval(const Position& pos, Color c);
-bool  use_smallnet(const Position& pos);
-Value evaluate(const NNUE::Networks&          networks,
-               const Position&                pos,
-               Eval::NNUE::AccumulatorCaches& caches,
-               int                            optimism);
+// The part of the evaluation computed by the networks. It only depends on the
+// pieces on the board, optimism and the rule50 count are only blended in later.
+struct NetworkScore {
+    Value nnue;
+    int   complexity;
+};
+
+int          simple_eval(const Position& pos, Color c);
+bool         use_smallnet(const Position& pos);
+NetworkScore evaluate_networks(const NNUE::Networks&          networks,
+                               const Position&                pos,
+                               Eval::NNUE::AccumulatorStack&  accumulators,
+                               Eval::NNUE::AccumulatorCaches& caches);
+Value        blend(const Position& pos, NetworkScore score, int optimism);
+Value        evaluate(const NNUE::Networks&          networks,
+                      const Position&                pos,
+                      Eval::NNUE::AccumulatorStack&  accumulators,
+                      Eval::NNUE::AccumulatorCaches& caches,
+                      int                            optimism);
+
+std::vector<Value> evaluate_batch(const NNUE::Networks&               networks,
+                                  const std::vector<const Position*>& positions,
+                                  Eval::NNUE::AccumulatorStack&       accumulators,
+                                  Eval::NNUE::AccumulatorCaches&      caches);
+
+// EvalCache keeps the network scores of a thread by position key, for the
+// positions evaluated again without a usable transposition table entry. It is
+// meant to be small enough to stay in the CPU cache, an entry is simply
+// overwritten by the next position with the same index.
+class EvalCache {
+
+    struct Entry {
+        Key          key   = 0;
+        NetworkScore score = {};
+    };
+
+   public:
+    explicit EvalCache(size_t kbSize) :
+        table(kbSize * 1024 / sizeof(Entry)) {}
+
+    bool enabled() const { return !table.empty(); }
+
+    void clear() { std::fill(table.begin(), table.end(), Entry{}); }
+
+    bool probe(Key key, NetworkScore& score) const {
+        const Entry& e = table[mul_hi64(key, table.size())];
+
+        if (e.key != key)
+            return false;
+
+        score = e.score;
+        return true;
+    }
+
+    void store(Key key, NetworkScore score) { table[mul_hi64(key, table.size())] = {key, score}; }
+
+   private:
+    std::vector<Entry> table;
+};
+
 }  // namespace Eval
 
 }  // namespace Stockfish
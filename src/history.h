@@ -160,6 +160,18 @@ struct CorrHistTypedef<Continuation> {
 template<CorrHistType T>
 using CorrectionHistory = typename Detail::CorrHistTypedef<T>::type;
 
+// The histories indexed by the pawn structure, the material and the last moves,
+// which threads searching the same position can share. With the SharedHistories
+// option, all the threads of a NUMA node update one copy of them, without any
+// synchronization, like the transposition table.
+struct SharedHistories {
+    PawnHistory                     pawnHistory;
+    CorrectionHistory<Pawn>         pawnCorrectionHistory;
+    CorrectionHistory<Minor>        minorPieceCorrectionHistory;
+    CorrectionHistory<NonPawn>      nonPawnCorrectionHistory[COLOR_NB];
+    CorrectionHistory<Continuation> continuationCorrectionHistory;
+};
+
 }  // namespace Stockfish
 
 #endif  // #ifndef HISTORY_H_INCLUDED
@@ -0,0 +1,221 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "libstockfish.h"
+
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bitboard.h"
+#include "engine.h"
+#include "misc.h"
+#include "position.h"
+#include "score.h"
+#include "search.h"
+#include "types.h"
+#include "uci.h"
+#include "ucioption.h"
+
+using namespace Stockfish;
+
+struct sf_engine {
+    explicit sf_engine(const std::string& evalSharedPath) :
+        engine(std::nullopt, evalSharedPath) {}
+
+    Engine engine;
+
+    sf_info_callback     onInfo     = nullptr;
+    sf_bestmove_callback onBestmove = nullptr;
+    void*                userData   = nullptr;
+
+    // The strings of the info being reported, reused to avoid allocations
+    std::string wdl, bound, pv, bestmove, ponder;
+};
+
+namespace {
+
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+template<typename... Ts>
+struct overload: Ts... {
+    using Ts::operator()...;
+};
+
+template<typename... Ts>
+overload(Ts...) -> overload<Ts...>;
+
+// The score as in the "info" lines, see UCIEngine::format_score()
+void set_score(sf_info& info, const Score& s) {
+    constexpr int TB_CP = 20000;
+
+    s.visit(overload{[&](Score::Mate mate) {
+                         info.score_type = SF_SCORE_MATE;
+                         info.score      = (mate.plies > 0 ? (mate.plies + 1) : mate.plies) / 2;
+                     },
+                     [&](Score::Tablebase tb) {
+                         info.score_type = SF_SCORE_CP;
+                         info.score      = tb.win ? TB_CP - tb.plies : -TB_CP - tb.plies;
+                     },
+                     [&](Score::InternalUnits units) {
+                         info.score_type = SF_SCORE_CP;
+                         info.score      = units.value;
+                     }});
+}
+
+void report_full(sf_engine& e, const Engine::InfoFull& i) {
+    e.wdl   = i.wdl;
+    e.bound = i.bound;
+    e.pv    = i.pv;
+
+    sf_info info{};
+    info.depth    = i.depth;
+    info.seldepth = i.selDepth;
+    info.multipv  = int(i.multiPV);
+    info.hashfull = i.hashfull;
+    info.nodes    = i.nodes;
+    info.nps      = i.nps;
+    info.tbhits   = i.tbHits;
+    info.time_ms  = i.timeMs;
+    info.wdl      = e.wdl.c_str();
+    info.bound    = e.bound.c_str();
+    info.pv       = e.pv.c_str();
+    set_score(info, i.score);
+
+    e.onInfo(&info, e.userData);
+}
+
+// No legal move at the root: only the depth and the score are known
+void report_no_moves(sf_engine& e, const Engine::InfoShort& i) {
+    sf_info info{};
+    info.depth = i.depth;
+    info.wdl = info.bound = info.pv = "";
+    set_score(info, i.score);
+
+    e.onInfo(&info, e.userData);
+}
+
+}
+
+extern "C" {
+
+int sf_api_version(void) { return SF_API_VERSION; }
+
+const char* sf_engine_info(void) {
+    static const std::string info = engine_info();
+    return info.c_str();
+}
+
+sf_engine* sf_engine_new(const char* eval_shared_path) {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] { Bitboards::init(); });
+
+    sf_engine* engine = new sf_engine(eval_shared_path ? eval_shared_path : "");
+    sf_set_callbacks(engine, nullptr, nullptr, nullptr);
+    return engine;
+}
+
+void sf_engine_delete(sf_engine* engine) { delete engine; }
+
+int sf_set_option(sf_engine* engine, const char* name, const char* value) {
+    if (!engine->engine.get_options().count(name))
+        return 0;
+
+    std::istringstream is(std::string("name ") + name + " value " + (value ? value : ""));
+    engine->engine.get_options().setoption(is);
+    return 1;
+}
+
+void sf_set_callbacks(sf_engine*           engine,
+                      sf_info_callback     on_info,
+                      sf_bestmove_callback on_bestmove,
+                      void*                user_data) {
+    engine->engine.wait_for_search_finished();
+
+    engine->onInfo     = on_info;
+    engine->onBestmove = on_bestmove;
+    engine->userData   = user_data;
+
+    Engine& e = engine->engine;
+
+    if (on_info)
+    {
+        e.set_on_update_full([engine](const auto& i) { report_full(*engine, i); });
+        e.set_on_update_no_moves([engine](const auto& i) { report_no_moves(*engine, i); });
+    }
+    else
+    {
+        e.set_on_update_full([](const auto&) {});
+        e.set_on_update_no_moves([](const auto&) {});
+    }
+
+    e.set_on_bestmove([engine](std::string_view bestmove, std::string_view ponder) {
+        if (!engine->onBestmove)
+            return;
+
+        engine->bestmove = bestmove;
+        engine->ponder   = ponder;
+        engine->onBestmove(engine->bestmove.c_str(), engine->ponder.c_str(), engine->userData);
+    });
+    e.set_on_iter([](const auto&) {});
+    e.set_on_search_stats([](const auto&) {});
+}
+
+void sf_set_position(sf_engine* engine, const char* fen, const char* const* moves, size_t count) {
+    engine->engine.wait_for_search_finished();
+    engine->engine.set_position(fen ? fen : StartFEN,
+                                std::vector<std::string>(moves, moves + count));
+}
+
+void sf_new_game(sf_engine* engine) {
+    engine->engine.wait_for_search_finished();
+    engine->engine.new_game();
+}
+
+void sf_go(sf_engine* engine, const sf_limits* limits) {
+    Search::LimitsType l;
+
+    l.startTime = now();  // The search starts as early as possible
+
+    l.time[WHITE] = limits->wtime;
+    l.time[BLACK] = limits->btime;
+    l.inc[WHITE]  = limits->winc;
+    l.inc[BLACK]  = limits->binc;
+    l.movestogo   = limits->movestogo;
+    l.depth       = limits->depth;
+    l.nodes       = limits->nodes;
+    l.mate        = limits->mate;
+    l.movetime    = limits->movetime;
+    l.infinite    = limits->infinite;
+    l.ponderMode  = limits->ponder;
+
+    for (size_t i = 0; i < limits->searchmoves_count; ++i)
+        l.searchmoves.push_back(UCIEngine::to_lower(limits->searchmoves[i]));
+
+    engine->engine.go(l);
+}
+
+void sf_stop(sf_engine* engine) { engine->engine.stop(); }
+
+void sf_ponderhit(sf_engine* engine) { engine->engine.set_ponderhit(false); }
+
+void sf_wait(sf_engine* engine) { engine->engine.wait_for_search_finished(); }
+
+}  // extern "C"
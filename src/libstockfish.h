@@ -0,0 +1,118 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIBSTOCKFISH_H_INCLUDED
+#define LIBSTOCKFISH_H_INCLUDED
+
+// The C API of libstockfish, built with "make library". It drives the engine
+// directly rather than through the UCI text protocol: the options, positions
+// and limits are passed as with the UCI commands of the same name, and the
+// search reports to callbacks with the fields of the "info" lines. Several
+// engines can live in one process, each with its own threads and hash. Moves
+// are in UCI format. SF_API_VERSION is only increased by incompatible changes.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SF_API_VERSION 1
+
+typedef struct sf_engine sf_engine;
+
+enum {
+    SF_SCORE_CP   = 0,  // Centipawns, tablebase scores are reported as in UCI
+    SF_SCORE_MATE = 1   // Moves to mate, negative if the side to move is mated
+};
+
+// The fields of an "info" line of the UCI protocol. The strings are only valid
+// during the callback.
+typedef struct {
+    int         depth;
+    int         seldepth;
+    int         multipv;
+    int         score_type;
+    int         score;
+    int         hashfull;
+    uint64_t    nodes;
+    uint64_t    nps;
+    uint64_t    tbhits;
+    uint64_t    time_ms;
+    const char* wdl;    // Empty unless the UCI_ShowWDL option is set
+    const char* bound;  // "lowerbound", "upperbound" or empty
+    const char* pv;     // Moves separated by spaces, empty if there is no legal move
+} sf_info;
+
+// The limits of a search, as in the "go" command, zero meaning no limit
+typedef struct {
+    int64_t            wtime;
+    int64_t            btime;
+    int64_t            winc;
+    int64_t            binc;
+    int                movestogo;
+    int                depth;
+    uint64_t           nodes;
+    int                mate;
+    int64_t            movetime;
+    int                infinite;
+    int                ponder;
+    const char* const* searchmoves;
+    size_t             searchmoves_count;
+} sf_limits;
+
+// The callbacks are called from a search thread of the engine, so they should
+// return quickly. The ponder move is empty if there is none.
+typedef void (*sf_info_callback)(const sf_info* info, void* user_data);
+typedef void (*sf_bestmove_callback)(const char* bestmove, const char* ponder, void* user_data);
+
+int         sf_api_version(void);
+const char* sf_engine_info(void);
+
+// Creates an engine with the default networks. If eval_shared_path is neither
+// NULL nor empty, it is the EvalSharedPath option of the engine, so that all
+// the engines of the processes given the same directory use one copy of each
+// network.
+sf_engine* sf_engine_new(const char* eval_shared_path);
+void       sf_engine_delete(sf_engine* engine);
+
+// Returns 0 if the engine has no such option
+int  sf_set_option(sf_engine* engine, const char* name, const char* value);
+void sf_set_callbacks(sf_engine*           engine,
+                      sf_info_callback     on_info,
+                      sf_bestmove_callback on_bestmove,
+                      void*                user_data);
+
+// The moves are played from fen up to the first illegal one. A NULL fen is the
+// start position.
+void sf_set_position(sf_engine* engine, const char* fen, const char* const* moves, size_t count);
+void sf_new_game(sf_engine* engine);
+
+// sf_go() returns at once, the best move is reported to the callback when the
+// search is over. sf_wait() blocks until then.
+void sf_go(sf_engine* engine, const sf_limits* limits);
+void sf_stop(sf_engine* engine);
+void sf_ponderhit(sf_engine* engine);
+void sf_wait(sf_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef LIBSTOCKFISH_H_INCLUDED
@@ -32,7 +32,6 @@ int main(int argc, char* argv[]) {
     std::cout << engine_info() << std::endl;
 
     Bitboards::init();
-    Position::init();
 
     UCIEngine uci(argc, argv);
 
@@ -0,0 +1,509 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "matesolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "memory.h"
+#include "misc.h"
+#include "movegen.h"
+#include "position.h"
+#include "score.h"
+#include "thread.h"
+#include "types.h"
+#include "uci.h"
+
+namespace Stockfish::MateSolver {
+
+namespace {
+
+using Number = uint32_t;
+
+// The proof or disproof number of a solved node, the largest one that fits
+constexpr Number Infinite = (1u << 28) - 1;
+
+// The proof and disproof numbers of a node. A proven node has pn 0 and the plies
+// to the mate in mateLength, a disproven node has dn 0.
+struct Numbers {
+    Number pn, dn;
+    int    mateLength;
+
+    bool solved() const { return !pn || !dn; }
+};
+
+constexpr Numbers proven(int plies) { return {0, Infinite, plies}; }
+constexpr Numbers Disproven = {Infinite, 0, 0};
+
+// The numbers by position key, shared by the threads without locking like the
+// PerftTable: the key is stored xor-ed with the data, so that a torn entry fails
+// verification. A node is searched with the plies left as depth. Its entry is
+// used at another depth only when it is solved and the solution still holds.
+class Table {
+
+    struct Entry {
+        uint64_t check = 0;
+        uint64_t data  = 0;
+    };
+
+   public:
+    explicit Table(size_t mbSize) :
+        count(std::max<size_t>(1, mbSize * 1024 * 1024 / sizeof(Entry))),
+        table(make_unique_large_page<Entry[]>(count)) {}
+
+    bool probe(Key key, int depth, Numbers& n) const {
+        const Entry&   e    = table[mul_hi64(key, count)];
+        const uint64_t data = e.data;
+
+        if ((e.check ^ data) != key)
+            return false;
+
+        const Number pn = Number(data & Infinite), dn = Number((data >> 28) & Infinite);
+
+        if (!pn)  // Proven, dn is the mate length
+            return int(dn) <= depth ? (n = proven(int(dn)), true) : false;
+
+        if (!dn)
+            return int(data >> 56) >= depth ? (n = Disproven, true) : false;
+
+        return int(data >> 56) == depth ? (n = {pn, dn, 0}, true) : false;
+    }
+
+    void store(Key key, int depth, const Numbers& n) {
+        Entry& e = table[mul_hi64(key, count)];
+
+        // A proof holds at any depth, keep it unless the new one is shorter
+        const uint64_t old = e.data;
+        if ((e.check ^ old) == key && !(old & Infinite)
+            && (n.pn || n.mateLength >= int((old >> 28) & Infinite)))
+            return;
+
+        const uint64_t data =uint64_t(n.pn) | uint64_t(n.pn ? n.dn : Number(n.mateLength)) << 28
+                            | uint64_t(depth) << 56;
+
+        e.data  = data;
+        e.check = key ^ data;
+    }
+
+    int hashfull() const {
+        const size_t sample = std::min<size_t>(count, 1000);
+        size_t       used   = 0;
+
+        for (size_t i = 0; i < sample; ++i)
+            used += table[i].data != 0;
+
+        return int(used * 1000 / sample);
+    }
+
+   private:
+    size_t                count;
+    LargePagePtr<Entry[]> table;
+};
+
+// The numbers of the node of pos, the attacker to move at even plies, without
+// searching it. Draws and nodes without a move are solved, and the others not in
+// the table get the number of moves of the side to move as their initial proof
+// number, or disproof number for the attacker. That is what orders the checks,
+// which leave few replies, first. Sets final if the node is solved regardless of
+// the table, by a draw or the end of the game.
+Numbers evaluate(const Table& table, const Position& pos, int depth, int ply, bool& final) {
+
+    const bool attacker = ply % 2 == 0;
+
+    final = true;
+
+    if (pos.is_draw(ply))
+        return Disproven;
+
+    const Number moves = Number(MoveList<LEGAL>(pos).size());
+
+    if (!moves)
+        return !attacker && pos.checkers() ? proven(0) : Disproven;
+
+    final = false;
+
+    Numbers n;
+    if (table.probe(pos.key(), depth, n))
+        return n;
+
+    if (!depth)
+        return Disproven;
+
+    return attacker ? Numbers{1, moves, 0} : Numbers{moves, 1, 0};
+}
+
+class Solver {
+
+    struct Child {
+        Move    move;
+        Key     key;
+        Numbers n;
+        bool    final;
+    };
+
+   public:
+    Solver(Table&                    t,
+           ThreadPool&               tp,
+           size_t                    idx,
+           const Search::LimitsType& l,
+           std::atomic<uint64_t>&    n) :
+        table(t),
+        threads(tp),
+        threadIdx(idx),
+        limits(l),
+        nodes(n) {}
+
+    ~Solver() { nodes += localNodes % 1024; }
+
+    // The df-pn search of Nagai: searches the node until its proof number
+    // reaches thpn or its disproof number reaches thdn.
+    Numbers mid(Position& pos, uint64_t thpn, uint64_t thdn, int depth, int ply) {
+
+        count_node();
+
+        const bool attacker = ply % 2 == 0;
+        Child      children[MAX_MOVES];
+        size_t     size = 0;
+        StateInfo  st;
+
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            Child& c = children[size++];
+            c.move   = m;
+
+            pos.do_move(m, st);
+            c.key = pos.key();
+            c.n   = evaluate(table, pos, depth - 1, ply + 1, c.final);
+            pos.undo_move(m);
+        }
+
+        // The checks first when choosing between equal numbers
+        if (attacker)
+            std::stable_partition(children, children + size,
+                                  [&](const Child& c) { return pos.gives_check(c.move); });
+
+        Numbers n;
+
+        while (true)
+        {
+            uint64_t sum = 0;
+            Number   best = Infinite, second = Infinite;
+            size_t   bestIdx = 0;
+            int      mateLength = attacker ? MAX_PLY : 0;
+
+            for (size_t k = 0; k < size; ++k)
+            {
+                // The helper threads break the ties differently, to search apart
+                Child& c = children[(k + threadIdx) % size];
+
+                if (!c.final)
+                    table.probe(c.key, depth - 1, c.n);
+
+                const Number own   = attacker ? c.n.pn : c.n.dn;
+                const Number other = attacker ? c.n.dn : c.n.pn;
+
+                sum += other;
+
+                if (!c.n.pn)
+                    mateLength = attacker ? std::min(mateLength, c.n.mateLength)
+                                          : std::max(mateLength, c.n.mateLength);
+
+                if (own < best)
+                {
+                    second  = best;
+                    best    = own;
+                    bestIdx = (k + threadIdx) % size;
+                }
+                else if (own < second)
+                    second = own;
+            }
+
+            // The own number is the minimum over the children and the other one
+            // the sum, proof for the attacker and disproof for the defender.
+            const Number total = Number(std::min<uint64_t>(sum, best ? Infinite - 1 : Infinite));
+
+            if (!best)
+                n = attacker ? proven(mateLength + 1) : Disproven;
+            else if (!total)
+                n = attacker ? Disproven : proven(mateLength + 1);
+            else
+                n = attacker ? Numbers{best, total, 0} : Numbers{total, best, 0};
+
+            if (n.pn >= thpn || n.dn >= thdn || threads.stop.load(std::memory_order_relaxed))
+                break;
+
+            Child& c = children[bestIdx];
+
+            // The thresholds of the child, so that it is searched until another
+            // child becomes better or the node reaches its thresholds
+            const uint64_t ownTh   = std::min<uint64_t>(attacker ? thpn : thdn, second + 1);
+            const uint64_t otherTh = attacker ? thdn - n.dn + c.n.dn : thpn - n.pn + c.n.pn;
+
+            pos.do_move(c.move, st);
+            c.n = attacker ? mid(pos, ownTh, otherTh, depth - 1, ply + 1)
+                           : mid(pos, otherTh, ownTh, depth - 1, ply + 1);
+            pos.undo_move(c.move);
+        }
+
+        if (!threads.stop.load(std::memory_order_relaxed))
+            table.store(pos.key(), depth, n);
+
+        return n;
+    }
+
+   private:
+    void count_node() {
+        if (++localNodes % 1024)
+            return;
+
+        nodes += 1024;
+
+        if (threadIdx)
+            return;
+
+        if ((limits.nodes && nodes >= limits.nodes)
+            || (limits.movetime && now() - limits.startTime >= limits.movetime))
+            threads.stop = true;
+    }
+
+    Table&                    table;
+    ThreadPool&               threads;
+    size_t                    threadIdx;
+    const Search::LimitsType& limits;
+    std::atomic<uint64_t>&    nodes;
+    uint64_t                  localNodes = 0;
+};
+
+// The mate of a proven node, following the shortest mate of the attacker and the
+// longest defence, as far as the table still has the nodes
+std::vector<Move> proof_pv(const Table& table, Position& pos, int depth) {
+
+    std::vector<Move> pv;
+    StateListPtr      states(new std::deque<StateInfo>);
+
+    for (int ply = 0; depth > 0; ++ply, --depth)
+    {
+        const bool attacker   = ply % 2 == 0;
+        Move       best       = Move::none();
+        int        bestLength = attacker ? MAX_PLY : -1;
+        bool       final;
+
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            StateInfo st;
+            pos.do_move(m, st);
+            const Numbers n = evaluate(table, pos, depth - 1, ply + 1, final);
+            pos.undo_move(m);
+
+            // A defence not known to be mated ends the line
+            if (n.pn && !attacker)
+            {
+                best = Move::none();
+                break;
+            }
+
+            if (!n.pn && (attacker ? n.mateLength < bestLength : n.mateLength > bestLength))
+            {
+                best       = m;
+                bestLength = n.mateLength;
+            }
+        }
+
+        if (best == Move::none())
+            break;
+
+        pv.push_back(best);
+        states->emplace_back();
+        pos.do_move(best, states->back());
+
+        if (!bestLength)
+            break;
+    }
+
+    for (auto it = pv.rbegin(); it != pv.rend(); ++it)
+        pos.undo_move(*it);
+
+    return pv;
+}
+
+// The number of nodes of the proof tree: the shortest mate of the attacker and
+// all the defences. Counting stops at budget nodes.
+uint64_t proof_tree_size(const Table& table, Position& pos, int depth, int ply, uint64_t& budget) {
+
+    if (!budget || !depth)
+        return 1;
+
+    --budget;
+
+    const bool attacker   = ply % 2 == 0;
+    uint64_t   size       = 1;
+    Move       best       = Move::none();
+    int        bestLength = MAX_PLY;
+    bool       final;
+    StateInfo  st;
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        pos.do_move(m, st);
+        const Numbers n = evaluate(table, pos, depth - 1, ply + 1, final);
+
+        if (!attacker)
+            size += n.pn || !n.mateLength
+                    ? 1
+                    : proof_tree_size(table, pos, depth - 1, ply + 1, budget);
+        else if (!n.pn && n.mateLength < bestLength)
+        {
+            best       = m;
+            bestLength = n.mateLength;
+        }
+
+        pos.undo_move(m);
+    }
+
+    if (attacker && best != Move::none())
+    {
+        pos.do_move(best, st);
+        size += bestLength ? proof_tree_size(table, pos, depth - 1, ply + 1, budget) : 1;
+        pos.undo_move(best);
+    }
+
+    return size;
+}
+
+}
+
+void solve(const std::string&                          fen,
+           bool                                        isChess960,
+           const Search::LimitsType&                   limits,
+           ThreadPool&                                 threads,
+           size_t                                      hashMB,
+           const Search::SearchManager::UpdateContext& updates) {
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    Position     pos;
+    pos.set(fen, isChess960, &states->back());
+
+    if (!MoveList<LEGAL>(pos).size())
+    {
+        updates.onUpdateNoMoves({0, {pos.checkers() ? -VALUE_MATE : VALUE_DRAW, pos}});
+        updates.onBestmove(UCIEngine::move(Move::none(), isChess960), "");
+        return;
+    }
+
+    // The plies left at the root, the last one a move of the attacker
+    const int depth = 2 * std::clamp(limits.mate, 1, 127) - 1;
+
+    Table                 table(hashMB);
+    std::atomic<uint64_t> nodes{0};
+    std::mutex            mutex;
+    Numbers               root{1, 1, 0};
+
+    auto run = [&](size_t idx) {
+        StateListPtr threadStates(new std::deque<StateInfo>(1));
+        Position     p;
+        p.set(fen, isChess960, &threadStates->back());
+
+        Solver        solver(table, threads, idx, limits, nodes);
+        const Numbers n = solver.mid(p, Infinite, Infinite, depth, 0);
+
+        // The first thread to solve the root stops the others
+        if (n.solved())
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            if (!root.solved())
+                root = n;
+            threads.stop = true;
+        }
+    };
+
+    // This is the main thread, the others are helpers
+    for (size_t i = 1; i < threads.num_threads(); ++i)
+        threads.run_on_thread(i, [&, i]() { run(i); });
+
+    run(0);
+    threads.stop = true;
+
+    for (size_t i = 1; i < threads.num_threads(); ++i)
+        threads.wait_on_thread(i);
+
+    const TimePoint elapsed = std::max(now() - limits.startTime, TimePoint(1));
+    const uint64_t  nps     = nodes * 1000 / elapsed;
+
+    if (root.pn)
+    {
+        sync_cout << "info string Mate solver: " << (root.dn ? "no mate found" : "no mate") << " in "
+                  << limits.mate << ", " << nodes << " nodes, " << nps << " nps" << sync_endl;
+
+        // The most promising move, or any move if the search was too short
+        Move      best   = *MoveList<LEGAL>(pos).begin();
+        Number    bestPn = Infinite;
+        bool      final;
+        StateInfo st;
+
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            pos.do_move(m, st);
+            const Numbers n = evaluate(table, pos, depth - 1, 1, final);
+            pos.undo_move(m);
+
+            if (n.pn < bestPn)
+            {
+                best   = m;
+                bestPn = n.pn;
+            }
+        }
+
+        updates.onBestmove(UCIEngine::move(best, isChess960), "");
+        return;
+    }
+
+    const std::vector<Move> pv = proof_pv(table, pos, depth);
+
+    std::string pvString;
+    for (Move m : pv)
+        pvString += (pvString.empty() ? "" : " ") + UCIEngine::move(m, isChess960);
+
+    Search::InfoFull info{};
+    info.depth    = root.mateLength;
+    info.selDepth = root.mateLength;
+    info.multiPV  = 1;
+    info.score    = {mate_in(root.mateLength), pos};
+    info.timeMs   = size_t(elapsed);
+    info.nodes    = nodes;
+    info.nps      = nps;
+    info.pv       = pvString;
+    info.hashfull = table.hashfull();
+    updates.onUpdateFull(info);
+
+    uint64_t       budget = 10000000;
+    const uint64_t size   = proof_tree_size(table, pos, depth, 0, budget);
+
+    sync_cout << "info string Mate solver: proof tree of " << (budget ? "" : "at least ") << size
+              << " nodes" << sync_endl;
+
+    updates.onBestmove(UCIEngine::move(pv.empty() ? Move::none() : pv[0], isChess960),
+                       pv.size() > 1 ? UCIEngine::move(pv[1], isChess960) : "");
+}
+
+}  // namespace Stockfish::MateSolver
@@ -0,0 +1,49 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATESOLVER_H_INCLUDED
+#define MATESOLVER_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+#include "search.h"
+
+namespace Stockfish {
+
+class ThreadPool;
+
+namespace MateSolver {
+
+// Searches for a mate in at most limits.mate moves with a depth-first proof-number
+// search (df-pn) instead of alpha-beta, which proves long forced mates much
+// faster. The threads of the pool share a table of hashMB megabytes, allocated
+// for the search. The mate, or its absence, is reported through the callbacks
+// like a search, the size of the proof tree in an info string. Stops on
+// threads.stop, or at limits.movetime or limits.nodes.
+void solve(const std::string&                          fen,
+           bool                                        isChess960,
+           const Search::LimitsType&                   limits,
+           ThreadPool&                                 threads,
+           size_t                                      hashMB,
+           const Search::SearchManager::UpdateContext& updates);
+
+}  // namespace MateSolver
+}  // namespace Stockfish
+
+#endif  // #ifndef MATESOLVER_H_INCLUDED
@@ -18,14 +18,28 @@
 
 #include "memory.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 
 #if __has_include("features.h")
     #include <features.h>
 #endif
 
 #if defined(__linux__) && !defined(__ANDROID__)
+    #include <fcntl.h>
+    #include <sys/file.h>
     #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <sys/vfs.h>
+    #include <unistd.h>
 #endif
 
 #if defined(__APPLE__) || defined(__ANDROID__) || defined(__OpenBSD__) \
@@ -193,8 +207,70 @@ void* aligned_large_pages_alloc(size_t allocSize) {
 
 #else
 
+    #if defined(__linux__) && !defined(__ANDROID__) && defined(MAP_HUGETLB)
+        #define USE_HUGETLB
+
+        #ifndef MAP_HUGE_SHIFT
+            #define MAP_HUGE_SHIFT 26
+        #endif
+
+namespace {
+
+// Memory from the pool of explicitly reserved huge pages is mapped rather than
+// allocated, so the mappings are kept here to be unmapped when freed.
+struct HugeTlbMapping {
+    size_t size;
+    size_t pageSize;
+};
+
+std::mutex                                hugeTlbMutex;
+std::unordered_map<void*, HugeTlbMapping> hugeTlbMappings;
+
+// Maps the memory with reserved huge pages of 2^shift bytes. The pages are taken
+// from the pool when mapping, so this fails right away if the pool is too small,
+// instead of crashing at first touch.
+void* map_huge_pages(size_t allocSize, int shift) {
+
+    const size_t pageSize = size_t(1) << shift;
+    const size_t size     = (allocSize + pageSize - 1) / pageSize * pageSize;
+
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+
+    if (mem == MAP_FAILED)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(hugeTlbMutex);
+    hugeTlbMappings[mem] = {size, pageSize};
+    return mem;
+}
+
+}
+
+    #endif
+
+// On Linux, the memory comes from the reserved 1GB pages if it spans at least one
+// of them, else from the reserved 2MB pages. Without reserved pages, it falls back
+// to transparent huge pages, which depend on the system settings and on memory
+// fragmentation.
 void* aligned_large_pages_alloc(size_t allocSize) {
 
+    #if defined(USE_HUGETLB)
+    constexpr size_t HugePageSize = 2 * 1024 * 1024;
+    constexpr size_t GigaPageSize = 1024 * 1024 * 1024;
+
+    void* huge = nullptr;
+
+    if (allocSize >= GigaPageSize)
+        huge = map_huge_pages(allocSize, 30);
+
+    if (!huge && allocSize >= HugePageSize)
+        huge = map_huge_pages(allocSize, 21);
+
+    if (huge)
+        return huge;
+    #endif
+
     #if defined(__linux__)
     constexpr size_t alignment = 2 * 1024 * 1024;  // 2MB page size assumed
     #else
@@ -262,7 +338,283 @@ void aligned_large_pages_free(void* mem) {
 
 #else
 
-void aligned_large_pages_free(void* mem) { std_aligned_free(mem); }
+void aligned_large_pages_free(void* mem) {
+
+    #if defined(USE_HUGETLB)
+    if (mem)
+    {
+        std::lock_guard<std::mutex> lock(hugeTlbMutex);
+        auto                        it = hugeTlbMappings.find(mem);
+
+        if (it != hugeTlbMappings.end())
+        {
+            munmap(mem, it->second.size);
+            hugeTlbMappings.erase(it);
+            return;
+        }
+    }
+    #endif
+
+    std_aligned_free(mem);
+}
+
+#endif
+
+
+// Describes the pages which back the memory from aligned_large_pages_alloc(),
+// to let the user know whether large pages could be used. On Linux, the share
+// of transparent huge pages is read from the memory map of the process.
+std::string large_pages_information(const void* mem) {
+
+    std::stringstream ss;
+
+#if defined(_WIN32)
+
+    ss << (has_large_pages() ? "large pages" : "regular pages");
+
+#elif defined(__linux__) && !defined(__ANDROID__)
+
+    #if defined(USE_HUGETLB)
+    {
+        std::lock_guard<std::mutex> lock(hugeTlbMutex);
+        auto                        it = hugeTlbMappings.find(const_cast<void*>(mem));
+
+        if (it != hugeTlbMappings.end())
+        {
+            const size_t mb = it->second.pageSize >> 20;
+            ss << (mb >= 1024 ? mb >> 10 : mb) << (mb >= 1024 ? "GB" : "MB") << " pages";
+            return ss.str();
+        }
+    }
+    #endif
+
+    // Look up the mapping holding mem in /proc/self/smaps. Its header line starts
+    // with the address range, followed by lines such as "AnonHugePages: 2048 kB".
+    std::ifstream   smaps("/proc/self/smaps");
+    std::string     line, field;
+    const uintptr_t address = reinterpret_cast<uintptr_t>(mem);
+    bool            inRange = false;
+    size_t          rssKb = 0, hugeKb = 0;
+
+    while (std::getline(smaps, line))
+    {
+        std::istringstream is(line);
+
+        if (!(is >> field) || field.empty())
+            continue;
+
+        if (field.back() != ':')
+        {
+            if (inRange)
+                break;
+
+            const size_t    dash  = field.find('-');
+            const uintptr_t begin = std::strtoull(field.c_str(), nullptr, 16);
+            const uintptr_t end =
+              dash == std::string::npos ? 0 : std::strtoull(field.c_str() + dash + 1, nullptr, 16);
+
+            inRange = begin <= address && address < end;
+        }
+        else if (inRange && field == "Rss:")
+            is >> rssKb;
+        else if (inRange && field == "AnonHugePages:")
+            is >> hugeKb;
+    }
+
+    if (hugeKb)
+        ss << "transparent huge pages for " << 100 * hugeKb / std::max<size_t>(rssKb, 1)
+           << "% of the memory";
+    else
+        ss << "4KB pages";
+
+#else
+
+    ss << "regular pages";
+
+#endif
+
+    return ss.str();
+}
+
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+// Shared memory files end with this header, behind the data, so that the data
+// starts on a page boundary. It is written last, once the data is complete.
+namespace {
+
+constexpr uint64_t SharedMemoryMagic = 0x5346534841524544ULL;  // "SFSHARED"
+
+struct SharedMemoryHeader {
+    uint64_t magic;
+    uint64_t key;
+    uint64_t size;
+};
+
+}
+
+void SharedMemoryDeleter::operator()(void* mem) const {
+    if (mem)
+        munmap(mem, size);
+}
+
+namespace {
+
+// The lock belongs to the open file, which a mapping keeps open after the file
+// descriptor is closed, so it has to be released explicitly.
+void unlock_and_close(int fd) {
+    flock(fd, LOCK_UN);
+    ::close(fd);
+}
+
+}
+
+SharedMemoryPtr map_shared_memory(const std::string&                path,
+                                  size_t                            size,
+                                  uint64_t                          key,
+                                  const std::function<bool(void*)>& init,
+                                  bool                              writable) {
+
+    const size_t headerOffset = (size + 63) / 64 * 64;
+
+    // A file that can't be used (filled with another key, or left half filled by
+    // a process that died meanwhile) is unlinked and replaced by a new one. The
+    // processes still mapping the old file keep their mapping, so we retry until
+    // the locked file is the one that the path currently refers to.
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return nullptr;
+
+        struct stat   fileStat, pathStat;
+        struct statfs fsStat;
+
+        if (flock(fd, LOCK_EX) || fstat(fd, &fileStat) || fstatfs(fd, &fsStat))
+        {
+            unlock_and_close(fd);
+            return nullptr;
+        }
+
+        if (stat(path.c_str(), &pathStat) || pathStat.st_ino != fileStat.st_ino)
+        {
+            unlock_and_close(fd);
+            continue;
+        }
+
+        // On hugetlbfs the block size is the huge page size and the file size
+        // must be a multiple of it.
+        const size_t pageSize = std::max(size_t(fsStat.f_bsize), size_t(4096));
+        const size_t fileSize =
+          (headerOffset + sizeof(SharedMemoryHeader) + pageSize - 1) / pageSize * pageSize;
+
+        if (size_t(fileStat.st_size) == fileSize)
+        {
+            const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            void*     mem  = mmap(nullptr, fileSize, prot, MAP_SHARED, fd, 0);
+
+            if (mem == MAP_FAILED)
+            {
+                unlock_and_close(fd);
+                return nullptr;
+            }
+
+            SharedMemoryPtr    ptr(mem, SharedMemoryDeleter{fileSize});
+            SharedMemoryHeader header;
+            std::memcpy(&header, static_cast<char*>(mem) + headerOffset, sizeof(header));
+
+            if (header.magic == SharedMemoryMagic && header.key == key && header.size == size)
+            {
+                unlock_and_close(fd);
+                return ptr;
+            }
+        }
+        else if (fileStat.st_size == 0 && ftruncate(fd, off_t(fileSize)) == 0)
+        {
+            void* mem = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (mem == MAP_FAILED)
+            {
+                unlink(path.c_str());
+                unlock_and_close(fd);
+                return nullptr;
+            }
+
+            SharedMemoryPtr ptr(mem, SharedMemoryDeleter{fileSize});
+
+    #if defined(MADV_HUGEPAGE)
+            madvise(mem, fileSize, MADV_HUGEPAGE);
+    #endif
+
+            if (!init(mem))
+            {
+                unlink(path.c_str());
+                unlock_and_close(fd);
+                return nullptr;
+            }
+
+            const SharedMemoryHeader header{SharedMemoryMagic, key, size};
+            std::memcpy(static_cast<char*>(mem) + headerOffset, &header, sizeof(header));
+
+            if (!writable)
+                mprotect(mem, fileSize, PROT_READ);
+
+            unlock_and_close(fd);
+            return ptr;
+        }
+
+        unlink(path.c_str());
+        unlock_and_close(fd);
+    }
+
+    return nullptr;
+}
+
+SharedMemoryPtr map_file(const std::string& path, size_t* size) {
+    struct stat statbuf;
+    int         fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+        return nullptr;
+
+    if (fstat(fd, &statbuf) || statbuf.st_size == 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* mem = mmap(nullptr, size_t(statbuf.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mem == MAP_FAILED)
+        return nullptr;
+
+    *size = size_t(statbuf.st_size);
+    return SharedMemoryPtr(mem, SharedMemoryDeleter{*size});
+}
+
+int current_numa_node() {
+    #if defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return int(node);
+    #endif
+    return 0;
+}
+
+#else
+
+void SharedMemoryDeleter::operator()(void*) const {}
+
+SharedMemoryPtr
+map_shared_memory(const std::string&, size_t, uint64_t, const std::function<bool(void*)>&, bool) {
+    return nullptr;
+}
+
+SharedMemoryPtr map_file(const std::string&, size_t*) { return nullptr; }
+
+int current_numa_node() { return 0; }
 
 #endif
+
 }  // namespace Stockfish
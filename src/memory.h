@@ -22,8 +22,10 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <new>
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -40,6 +42,36 @@ void  aligned_large_pages_free(void* mem);
 
 bool has_large_pages();
 
+// Describes the pages backing the memory allocated by aligned_large_pages_alloc()
+std::string large_pages_information(const void* mem);
+
+// Memory mapped from a file shared with other processes
+struct SharedMemoryDeleter {
+    size_t size = 0;
+    void   operator()(void* mem) const;
+};
+
+using SharedMemoryPtr = std::unique_ptr<void, SharedMemoryDeleter>;
+
+// Maps size bytes of the file at path, read-only and shared with every other
+// process mapping the same file. The first process to map the file fills it by
+// calling init() on the still writable memory, later ones find it ready. The key
+// identifies the content, a file filled with another key is never mapped. With
+// writable, the memory stays writable for all the processes after init().
+// Returns nullptr if the file can't be used or on systems without support.
+SharedMemoryPtr map_shared_memory(const std::string&                path,
+                                  size_t                            size,
+                                  uint64_t                          key,
+                                  const std::function<bool(void*)>& init,
+                                  bool                              writable = false);
+
+// Maps the whole file at path read-only, sharing its pages with every other
+// process mapping it, and stores its size. Returns nullptr if it can't be mapped.
+SharedMemoryPtr map_file(const std::string& path, size_t* size);
+
+// Returns the NUMA node the calling thread is running on, 0 if unknown
+int current_numa_node();
+
 // Frees memory which was placed there with placement new.
 // Works for both single objects and arrays of unknown bound.
 template<typename T, typename FREE_FUNC>
@@ -24,17 +24,43 @@
 #include <cctype>
 #include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string_view>
+#include <utility>
 
 #include "types.h"
 
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <cpuid.h>
+    #define HAS_CPUID
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <immintrin.h>
+    #include <intrin.h>
+    #define HAS_CPUID
+#endif
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define HAS_PERF_EVENTS
+#endif
+
 namespace Stockfish {
 
 namespace {
@@ -237,9 +263,15 @@ std::string compiler_info() {
 
     compiler += "\nCompilation settings       : ";
     compiler += (Is64Bit ? "64bit" : "32bit");
+#if defined(USE_AMX)
+    compiler += " AMX";
+#endif
 #if defined(USE_VNNI)
     compiler += " VNNI";
 #endif
+#if defined(USE_VBMI2)
+    compiler += " VBMI2";
+#endif
 #if defined(USE_AVX512)
     compiler += " AVX512";
 #endif
@@ -257,6 +289,12 @@ std::string compiler_info() {
     compiler += " SSE2";
 #endif
     compiler += (HasPopCnt ? " POPCNT" : "");
+#if defined(USE_SVE2)
+    compiler += " SVE2";
+#endif
+#if defined(USE_NEON_I8MM)
+    compiler += " I8MM";
+#endif
 #if defined(USE_NEON_DOTPROD)
     compiler += " NEON_DOTPROD";
 #elif defined(USE_NEON)
@@ -267,6 +305,32 @@ std::string compiler_info() {
     compiler += " DEBUG";
 #endif
 
+    const CpuFeatures& cpu = cpu_features();
+
+    if (cpu.detected)
+    {
+        compiler += "\nHost CPU features          :";
+        compiler += (cpu.amx ? " AMX" : "");
+        compiler += (cpu.vnni512 ? " VNNI" : "");
+        compiler += (cpu.vbmi2 ? " VBMI2" : "");
+        compiler += (cpu.avx512 ? " AVX512" : "");
+        compiler += (cpu.bmi2 ? (cpu.fastPext ? " BMI2" : " BMI2(slow pext)") : "");
+        compiler += (cpu.avx2 ? " AVX2" : "");
+        compiler += (cpu.sse41 ? " SSE41" : "");
+        compiler += (cpu.popcnt ? " POPCNT" : "");
+        compiler += "\nBest matching architecture : " + cpu.best_arch();
+    }
+
+    compiler += "\nSlider attack lookup       : ";
+    compiler += (HasPext ? "pext" : "magic multiplication");
+    compiler += (HasPext && cpu.detected && !cpu.fastPext ? ", slow on this CPU" : "");
+#if defined(USE_COMPACT_SLIDERS)
+    compiler += ", compact tables";
+#endif
+#if defined(USE_INT8_FT_WEIGHTS)
+    compiler += "\nFeature transformer weights: int8";
+#endif
+
     compiler += "\nCompiler __VERSION__ macro : ";
 #ifdef __VERSION__
     compiler += __VERSION__;
@@ -280,11 +344,117 @@ std::string compiler_info() {
 }
 
 
-// Debug functions used mainly to collect run-time statistics
+namespace {
+
+#ifdef HAS_CPUID
+void cpuid(unsigned leaf, unsigned regs[4]) {
+    #if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, int(leaf), 0);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = unsigned(r[i]);
+    #else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+uint64_t xgetbv() {
+    #if defined(_MSC_VER)
+    return _xgetbv(0);
+    #else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t(hi) << 32) | lo;
+    #endif
+}
+#endif
+
+CpuFeatures detect_cpu_features() {
+
+    CpuFeatures f;
+
+    // Without cpuid, trust the compilation settings
+    f.fastPext = HasPext;
+
+#ifdef HAS_CPUID
+    unsigned r[4];
+
+    cpuid(0, r);
+    const unsigned maxLeaf = r[0];
+    const bool     amd     = r[1] == 0x68747541 && r[3] == 0x69746e65 && r[2] == 0x444d4163;
+
+    // Family as in the AMD and Intel manuals, including the extended family
+    cpuid(1, r);
+    const unsigned baseFamily = (r[0] >> 8) & 0xF;
+    const unsigned family     = baseFamily + (baseFamily == 0xF ? (r[0] >> 20) & 0xFF : 0);
+    const bool     osxsave    = r[2] & (1 << 27);
+
+    f.sse41  = r[2] & (1 << 19);
+    f.popcnt = r[2] & (1 << 23);
+
+    // The OS must save the AVX (and AVX-512) registers on context switches
+    const uint64_t xcr0     = osxsave ? xgetbv() : 0;
+    const bool     ymmSaved = (xcr0 & 0x06) == 0x06;
+    const bool     zmmSaved = (xcr0 & 0xE6) == 0xE6;
+
+    if (maxLeaf >= 7)
+    {
+        cpuid(7, r);
+        f.avx2    = ymmSaved && (r[1] & (1 << 5));
+        f.bmi2    = r[1] & (1 << 8);
+        f.avx512  = zmmSaved && (r[1] & (1 << 16)) && (r[1] & (1 << 30));
+        f.vnni512 = f.avx512 && (r[2] & (1 << 11));
+        f.vbmi2   = f.avx512 && (r[2] & (1 << 6));
+
+        // AMX-TILE and AMX-INT8, with the tile state saved by the OS. On Linux
+        // the process must also ask for the permission to use the tiles.
+        f.amx = (xcr0 & 0x60000) == 0x60000 && (r[3] & (1 << 24)) && (r[3] & (1 << 25));
+    #if defined(__linux__) && !defined(__ANDROID__)
+        constexpr int ArchReqXcompPerm = 0x1023, XFeatureXTileData = 18;
+        f.amx = f.amx && !syscall(SYS_arch_prctl, ArchReqXcompPerm, XFeatureXTileData);
+    #endif
+    }
+
+    f.fastPext = f.bmi2 && !(amd && family < 0x19);
+    f.detected = true;
+#endif
+
+    return f;
+}
+
+}  // namespace
+
+
+// Returns the Makefile ARCH target that best fits the host CPU
+std::string CpuFeatures::best_arch() const {
+
+    return vnni512 && vbmi2 && amx  ? "x86-64-amx"
+         : vnni512 && vbmi2         ? "x86-64-avx512icl"
+         : vnni512                  ? "x86-64-vnni512"
+         : avx512                   ? "x86-64-avx512"
+         : avx2 && bmi2 && fastPext ? "x86-64-bmi2"
+         : avx2                     ? "x86-64-avx2"
+         : sse41 && popcnt          ? "x86-64-sse41-popcnt"
+                                    : "x86-64";
+}
+
+const CpuFeatures& cpu_features() {
+
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
+
+
+// Debug functions used mainly to collect run-time statistics. Each thread
+// records into its own shard, so that they can stay on under full thread load
+// without contending on shared cache lines. The shards are merged by dbg_print().
 constexpr int MaxDebugSlots = 32;
 
 namespace {
 
+// A shard is written only by its owning thread, so a relaxed load and store
+// is enough to update it. The counters are atomic because dbg_print() may read
+// them from another thread at any time.
 template<size_t N>
 struct DebugInfo {
     std::atomic<int64_t> data[N] = {0};
@@ -293,6 +463,15 @@ struct DebugInfo {
         assert(index < N);
         return data[index];
     }
+
+    [[nodiscard]] int64_t get(size_t index) const {
+        assert(index < N);
+        return data[index].load(std::memory_order_relaxed);
+    }
+
+    void add(size_t index, int64_t value) {
+        (*this)[index].store(get(index) + value, std::memory_order_relaxed);
+    }
 };
 
 struct DebugExtremes: public DebugInfo<3> {
@@ -300,87 +479,188 @@ struct DebugExtremes: public DebugInfo<3> {
         data[1] = std::numeric_limits<int64_t>::min();
         data[2] = std::numeric_limits<int64_t>::max();
     }
+
+    void update(int64_t max, int64_t min) {
+        if (get(1) < max)
+            data[1].store(max, std::memory_order_relaxed);
+        if (get(2) > min)
+            data[2].store(min, std::memory_order_relaxed);
+    }
+};
+
+struct DebugShard {
+    std::array<DebugInfo<2>, MaxDebugSlots>  hit;
+    std::array<DebugInfo<2>, MaxDebugSlots>  mean;
+    std::array<DebugInfo<3>, MaxDebugSlots>  stdev;
+    std::array<DebugInfo<6>, MaxDebugSlots>  correl;
+    std::array<DebugExtremes, MaxDebugSlots> extremes;
+
+    // Adds the counters of another shard, which may be concurrently updated
+    void merge(const DebugShard& s) {
+        for (int i = 0; i < MaxDebugSlots; ++i)
+        {
+            for (size_t j = 0; j < 2; ++j)
+            {
+                hit[i].add(j, s.hit[i].get(j));
+                mean[i].add(j, s.mean[i].get(j));
+            }
+            for (size_t j = 0; j < 3; ++j)
+                stdev[i].add(j, s.stdev[i].get(j));
+            for (size_t j = 0; j < 6; ++j)
+                correl[i].add(j, s.correl[i].get(j));
+
+            extremes[i].add(0, s.extremes[i].get(0));
+            extremes[i].update(s.extremes[i].get(1), s.extremes[i].get(2));
+        }
+    }
 };
 
-std::array<DebugInfo<2>, MaxDebugSlots>  hit;
-std::array<DebugInfo<2>, MaxDebugSlots>  mean;
-std::array<DebugInfo<3>, MaxDebugSlots>  stdev;
-std::array<DebugInfo<6>, MaxDebugSlots>  correl;
-std::array<DebugExtremes, MaxDebugSlots> extremes;
+// Keeps track of the live shards. The counters of exited threads are folded
+// into 'retired' so that they are not lost.
+struct DebugRegistry {
+    std::mutex                             mutex;
+    std::vector<const DebugShard*>         shards;
+    DebugShard                             retired;
+    std::array<std::string, MaxDebugSlots> names;
+    std::atomic<TimePoint>                 printInterval{1000};
+};
+
+DebugRegistry& debug_registry() {
+    static DebugRegistry registry;
+    return registry;
+}
+
+struct DebugShardOwner {
+    DebugShard shard;
+
+    DebugShardOwner() {
+        DebugRegistry&              r = debug_registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.shards.push_back(&shard);
+    }
+
+    ~DebugShardOwner() {
+        DebugRegistry&              r = debug_registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.merge(shard);
+        r.shards.erase(std::find(r.shards.begin(), r.shards.end(), &shard));
+    }
+};
+
+DebugShard& debug_shard() {
+    thread_local DebugShardOwner owner;
+    return owner.shard;
+}
 
 }  // namespace
 
 void dbg_hit_on(bool cond, int slot) {
 
-    ++hit.at(slot)[0];
+    auto& hit = debug_shard().hit.at(slot);
+    hit.add(0, 1);
     if (cond)
-        ++hit.at(slot)[1];
+        hit.add(1, 1);
 }
 
 void dbg_mean_of(int64_t value, int slot) {
 
-    ++mean.at(slot)[0];
-    mean.at(slot)[1] += value;
+    auto& mean = debug_shard().mean.at(slot);
+    mean.add(0, 1);
+    mean.add(1, value);
 }
 
 void dbg_stdev_of(int64_t value, int slot) {
 
-    ++stdev.at(slot)[0];
-    stdev.at(slot)[1] += value;
-    stdev.at(slot)[2] += value * value;
+    auto& stdev = debug_shard().stdev.at(slot);
+    stdev.add(0, 1);
+    stdev.add(1, value);
+    stdev.add(2, value * value);
 }
 
 void dbg_extremes_of(int64_t value, int slot) {
-    ++extremes.at(slot)[0];
-
-    int64_t current_max = extremes.at(slot)[1].load();
-    while (current_max < value && !extremes.at(slot)[1].compare_exchange_weak(current_max, value))
-    {}
 
-    int64_t current_min = extremes.at(slot)[2].load();
-    while (current_min > value && !extremes.at(slot)[2].compare_exchange_weak(current_min, value))
-    {}
+    auto& extremes = debug_shard().extremes.at(slot);
+    extremes.add(0, 1);
+    extremes.update(value, value);
 }
 
 void dbg_correl_of(int64_t value1, int64_t value2, int slot) {
 
-    ++correl.at(slot)[0];
-    correl.at(slot)[1] += value1;
-    correl.at(slot)[2] += value1 * value1;
-    correl.at(slot)[3] += value2;
-    correl.at(slot)[4] += value2 * value2;
-    correl.at(slot)[5] += value1 * value2;
+    auto& correl = debug_shard().correl.at(slot);
+    correl.add(0, 1);
+    correl.add(1, value1);
+    correl.add(2, value1 * value1);
+    correl.add(3, value2);
+    correl.add(4, value2 * value2);
+    correl.add(5, value1 * value2);
+}
+
+// Gives a name to a slot, printed by dbg_print() next to the slot number
+void dbg_name(int slot, std::string_view name) {
+
+    DebugRegistry&              r = debug_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.names.at(slot) = name;
+}
+
+// Sets how often the search dumps the counters, in milliseconds. Zero disables
+// the periodic dumps.
+void dbg_print_interval(TimePoint interval) {
+    debug_registry().printInterval.store(interval, std::memory_order_relaxed);
+}
+
+TimePoint dbg_print_interval() {
+    return debug_registry().printInterval.load(std::memory_order_relaxed);
 }
 
 void dbg_print() {
 
+    DebugRegistry&                         reg   = debug_registry();
+    auto                                   total = std::make_unique<DebugShard>();
+    std::array<std::string, MaxDebugSlots> names;
+
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        total->merge(reg.retired);
+        for (const DebugShard* shard : reg.shards)
+            total->merge(*shard);
+
+        for (int i = 0; i < MaxDebugSlots; ++i)
+            names[i] = reg.names[i].empty() ? "" : " (" + reg.names[i] + ")";
+    }
+
+    auto& [hit, mean, stdev, correl, extremes] = *total;
+
     int64_t n;
     auto    E   = [&n](int64_t x) { return double(x) / n; };
     auto    sqr = [](double x) { return x * x; };
 
     for (int i = 0; i < MaxDebugSlots; ++i)
         if ((n = hit[i][0]))
-            std::cerr << "Hit #" << i << ": Total " << n << " Hits " << hit[i][1]
+            std::cerr << "Hit #" << i << names[i] << ": Total " << n << " Hits " << hit[i][1]
                       << " Hit Rate (%) " << 100.0 * E(hit[i][1]) << std::endl;
 
     for (int i = 0; i < MaxDebugSlots; ++i)
         if ((n = mean[i][0]))
         {
-            std::cerr << "Mean #" << i << ": Total " << n << " Mean " << E(mean[i][1]) << std::endl;
+            std::cerr << "Mean #" << i << names[i] << ": Total " << n << " Mean "
+                      << E(mean[i][1]) << std::endl;
         }
 
     for (int i = 0; i < MaxDebugSlots; ++i)
         if ((n = stdev[i][0]))
         {
             double r = sqrt(E(stdev[i][2]) - sqr(E(stdev[i][1])));
-            std::cerr << "Stdev #" << i << ": Total " << n << " Stdev " << r << std::endl;
+            std::cerr << "Stdev #" << i << names[i] << ": Total " << n << " Stdev " << r
+                      << std::endl;
         }
 
     for (int i = 0; i < MaxDebugSlots; ++i)
         if ((n = extremes[i][0]))
         {
-            std::cerr << "Extremity #" << i << ": Total " << n << " Min " << extremes[i][2]
-                      << " Max " << extremes[i][1] << std::endl;
+            std::cerr << "Extremity #" << i << names[i] << ": Total " << n << " Min "
+                      << extremes[i][2] << " Max " << extremes[i][1] << std::endl;
         }
 
     for (int i = 0; i < MaxDebugSlots; ++i)
@@ -389,7 +669,8 @@ void dbg_print() {
             double r = (E(correl[i][5]) - E(correl[i][1]) * E(correl[i][3]))
                      / (sqrt(E(correl[i][2]) - sqr(E(correl[i][1])))
                         * sqrt(E(correl[i][4]) - sqr(E(correl[i][3]))));
-            std::cerr << "Correl. #" << i << ": Total " << n << " Coefficient " << r << std::endl;
+            std::cerr << "Correl. #" << i << names[i] << ": Total " << n << " Coefficient "
+                      << r << std::endl;
         }
 }
 
@@ -433,6 +714,117 @@ void prefetch(const void* addr) {
 
 #endif
 
+
+#ifdef HAS_PERF_EVENTS
+
+namespace {
+
+// Opens a counter of the event for the calling thread, in user space only
+int open_perf_event(uint32_t type, uint64_t config) {
+
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    // pid 0 and cpu -1 count the calling thread on any CPU
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// The count of the event, scaled up when the kernel had to share the hardware
+// counters between more events than there are, so that each ran part of the time
+std::optional<uint64_t> read_perf_event(int fd) {
+
+    uint64_t values[3];  // Count, time enabled, time running
+    if (fd == -1 || read(fd, values, sizeof(values)) != sizeof(values))
+        return std::nullopt;
+
+    if (values[2] && values[2] < values[1])
+        return uint64_t(double(values[0]) * values[1] / values[2]);
+
+    return values[0];
+}
+
+constexpr uint64_t cache_miss(uint64_t cache) {
+    return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+}
+
+}
+
+PerfCounters::PerfCounters() {
+
+    constexpr std::pair<uint32_t, uint64_t> Events[EVENT_NB] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+      {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+      {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+
+    for (int e = 0; e < EVENT_NB; ++e)
+        fds[e] = open_perf_event(Events[e].first, Events[e].second);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds)
+        if (fd != -1)
+            close(fd);
+}
+
+PerfCounters::Values PerfCounters::read() const {
+
+    Values values;
+    for (int e = 0; e < EVENT_NB; ++e)
+        values[e] = read_perf_event(fds[e]);
+
+    return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() { fds.fill(-1); }
+PerfCounters::~PerfCounters() {}
+PerfCounters::Values PerfCounters::read() const { return {}; }
+
+#endif
+
+std::string_view PerfCounters::name(Event e) {
+    constexpr std::string_view Names[EVENT_NB] = {"cycles",      "instructions", "l1d_misses",
+                                                  "llc_misses",  "dtlb_misses",  "branch_misses"};
+    return Names[e];
+}
+
+#ifdef _WIN32
+
+uint64_t thread_cpu_time() {
+
+    FILETIME creation, exitTime, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exitTime, &kernel, &user))
+        return 0;
+
+    // In units of 100 ns
+    auto ticks = [](const FILETIME& t) {
+        return (uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 10;
+}
+
+#else
+
+uint64_t thread_cpu_time() {
+
+    timespec t;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t))
+        return 0;
+
+    return uint64_t(t.tv_sec) * 1000000 + uint64_t(t.tv_nsec) / 1000;
+}
+
+#endif
+
 #ifdef _WIN32
     #include <direct.h>
     #define GETCWD _getcwd
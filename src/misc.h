@@ -41,6 +41,27 @@ std::string engine_version_info();
 std::string engine_info(bool to_uci = false);
 std::string compiler_info();
 
+// Features of the host CPU, detected once at startup with cpuid. The kernels
+// are chosen at compile time, so apart from the AMX tiles, which the OS has to
+// grant at runtime, they serve diagnostics: telling the user when the binary
+// does not match the host, and which ARCH would fit it.
+struct CpuFeatures {
+    bool detected = false;
+    bool popcnt   = false;
+    bool sse41    = false;
+    bool avx2     = false;
+    bool bmi2     = false;
+    bool avx512   = false;
+    bool vnni512  = false;
+    bool vbmi2    = false;
+    bool amx      = false;  // AMX-INT8, with the permission of the OS to use the tiles
+    bool fastPext = false;  // pext is microcoded, hence very slow, on AMD before Zen 3
+
+    std::string best_arch() const;
+};
+
+const CpuFeatures& cpu_features();
+
 // Preloads the given address in L1/L2 cache. This is a non-blocking
 // function that doesn't stall the CPU waiting for data to be loaded from memory,
 // which can be quite slow.
@@ -48,6 +69,39 @@ void prefetch(const void* addr);
 
 void start_logger(const std::string& fname);
 
+// Counts the hardware events below of the thread that created it. The counts are
+// only available on Linux, when the kernel allows it (see perf_event_paranoid),
+// and an event only if the CPU supports it.
+class PerfCounters {
+   public:
+    enum Event {
+        Cycles,
+        Instructions,
+        L1DMisses,  // Reads missing the L1 data cache
+        LLCMisses,  // Reads missing the last level cache
+        DTLBMisses,
+        BranchMisses,
+        EVENT_NB
+    };
+
+    using Values = std::array<std::optional<uint64_t>, EVENT_NB>;
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    Values read() const;
+
+    static std::string_view name(Event e);
+
+   private:
+    std::array<int, EVENT_NB> fds;
+};
+
+// The CPU time used so far by the calling thread, in microseconds
+uint64_t thread_cpu_time();
+
 size_t str_to_size_t(const std::string& s);
 
 #if defined(__linux__)
@@ -72,10 +126,15 @@ void dbg_mean_of(int64_t value, int slot = 0);
 void dbg_stdev_of(int64_t value, int slot = 0);
 void dbg_extremes_of(int64_t value, int slot = 0);
 void dbg_correl_of(int64_t value1, int64_t value2, int slot = 0);
-void dbg_print();
 
 using TimePoint = std::chrono::milliseconds::rep;  // A value in milliseconds
 static_assert(sizeof(TimePoint) == sizeof(int64_t), "TimePoint should be 64 bits");
+
+void      dbg_name(int slot, std::string_view name);
+void      dbg_print_interval(TimePoint interval);
+TimePoint dbg_print_interval();
+void      dbg_print();
+
 inline TimePoint now() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(
              std::chrono::steady_clock::now().time_since_epoch())
@@ -130,6 +189,7 @@ class ValueList {
    public:
     std::size_t size() const { return size_; }
     void        push_back(const T& value) { values_[size_++] = value; }
+    void        erase(std::size_t index) { values_[index] = values_[--size_]; }  // Unordered
     const T*    begin() const { return values_; }
     const T*    end() const { return values_ + size_; }
     const T&    operator[](int index) const { return values_[index]; }
@@ -245,29 +305,22 @@ class PRNG {
 
     uint64_t s;
 
-    uint64_t rand64() {
+    constexpr uint64_t rand64() {
 
         s ^= s >> 12, s ^= s << 25, s ^= s >> 27;
         return s * 2685821657736338717LL;
     }
 
    public:
-    PRNG(uint64_t seed) :
+    constexpr PRNG(uint64_t seed) :
         s(seed) {
         assert(seed);
     }
 
     template<typename T>
-    T rand() {
+    constexpr T rand() {
         return T(rand64());
     }
-
-    // Special generator used to fast init magic numbers.
-    // Output values only have 1/8th of their bits set on average.
-    template<typename T>
-    T sparse_rand() {
-        return T(rand64() & rand64() & rand64());
-    }
 };
 
 inline uint64_t mul_hi64(uint64_t a, uint64_t b) {
@@ -18,6 +18,7 @@
 
 #include "movegen.h"
 
+#include <algorithm>
 #include <cassert>
 #include <initializer_list>
 
@@ -47,7 +48,9 @@ ExtMove* make_promotions(ExtMove* moveList, [[maybe_unused]] Square to) {
 }
 
 
-template<Color Us, GenType Type>
+// When Legal is set, pinned pawns are skipped (see generate_pinned_moves()) and
+// en passant captures are verified before being added to the list.
+template<Color Us, GenType Type, bool Legal = false>
 ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
 
     constexpr Color     Them     = ~Us;
@@ -60,8 +63,11 @@ ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard ta
     const Bitboard emptySquares = ~pos.pieces();
     const Bitboard enemies      = Type == EVASIONS ? pos.checkers() : pos.pieces(Them);
 
-    Bitboard pawnsOn7    = pos.pieces(Us, PAWN) & TRank7BB;
-    Bitboard pawnsNotOn7 = pos.pieces(Us, PAWN) & ~TRank7BB;
+    const Bitboard pawns =
+      Legal ? pos.pieces(Us, PAWN) & ~pos.blockers_for_king(Us) : pos.pieces(Us, PAWN);
+
+    Bitboard pawnsOn7    = pawns & TRank7BB;
+    Bitboard pawnsNotOn7 = pawns & ~TRank7BB;
 
     // Single and double pawn pushes, no promotions
     if constexpr (Type != CAPTURES)
@@ -134,12 +140,19 @@ ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard ta
             if (Type == EVASIONS && (target & (pos.ep_square() + Up)))
                 return moveList;
 
-            b1 = pawnsNotOn7 & pawn_attacks_bb(Them, pos.ep_square());
+            // Pinned pawns may capture en passant along the pin ray
+            b1 = (Legal ? pos.pieces(Us, PAWN) : pawnsNotOn7)
+               & pawn_attacks_bb(Them, pos.ep_square());
 
             assert(b1);
 
             while (b1)
-                *moveList++ = Move::make<EN_PASSANT>(pop_lsb(b1), pos.ep_square());
+            {
+                Move m = Move::make<EN_PASSANT>(pop_lsb(b1), pos.ep_square());
+
+                if (!Legal || pos.legal(m))
+                    *moveList++ = m;
+            }
         }
     }
 
@@ -147,13 +160,16 @@ ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard ta
 }
 
 
-template<Color Us, PieceType Pt>
+template<Color Us, PieceType Pt, bool Legal = false>
 ExtMove* generate_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
 
     static_assert(Pt != KING && Pt != PAWN, "Unsupported piece type in generate_moves()");
 
     Bitboard bb = pos.pieces(Us, Pt);
 
+    if constexpr (Legal)
+        bb &= ~pos.blockers_for_king(Us);
+
     while (bb)
     {
         Square   from = pop_lsb(bb);
@@ -203,6 +219,122 @@ ExtMove* generate_all(const Position& pos, ExtMove* moveList) {
     return moveList;
 }
 
+
+// Generates the moves of the pinned pieces, which stay on the line through the
+// king and the pinner. When in check, a piece may still be flagged as pinned by
+// a slider behind the checker, in which case capturing the checker is legal.
+// En passant captures are generated together with the other pawn moves.
+template<Color Us>
+ExtMove* generate_pinned_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
+
+    constexpr Bitboard  TRank8BB = (Us == WHITE ? Rank8BB : Rank1BB);
+    constexpr Bitboard  TRank3BB = (Us == WHITE ? Rank3BB : Rank6BB);
+    constexpr Direction Up       = pawn_push(Us);
+
+    const Square ksq = pos.square<KING>(Us);
+    Bitboard     bb  = pos.blockers_for_king(Us) & pos.pieces(Us) & ~pos.pieces(KNIGHT);
+
+    while (bb)
+    {
+        Square    from = pop_lsb(bb);
+        PieceType pt   = type_of(pos.piece_on(from));
+        Bitboard  b;
+
+        if (pt == PAWN)
+        {
+            b = pawn_attacks_bb(Us, from) & pos.pieces(~Us);
+
+            if (!(pos.pieces() & (from + Up)))
+            {
+                b |= square_bb(from + Up);
+
+                if ((TRank3BB & (from + Up)) && !(pos.pieces() & (from + Up + Up)))
+                    b |= square_bb(from + Up + Up);
+            }
+        }
+        else
+            b = attacks_bb(pt, from, pos.pieces()) & ~pos.pieces(Us);
+
+        b &= line_bb(ksq, from) & target;
+
+        while (b)
+        {
+            Square to = pop_lsb(b);
+
+            if (pt == PAWN && (TRank8BB & to))
+                for (PieceType promo : {QUEEN, ROOK, BISHOP, KNIGHT})
+                    *moveList++ = Move::make<PROMOTION>(from, to, promo);
+            else
+                *moveList++ = Move(from, to);
+        }
+    }
+
+    return moveList;
+}
+
+
+// Generates the legal moves directly: pinned pieces are kept on their pin ray,
+// and the king only steps onto squares which are not attacked by the opponent.
+template<Color Us>
+ExtMove* generate_legal(const Position& pos, ExtMove* moveList) {
+
+    constexpr Color Them = ~Us;
+
+    const Square   ksq      = pos.square<KING>(Us);
+    const Bitboard checkers = pos.checkers();
+
+    // Skip generating non-king moves when in double check
+    if (!more_than_one(checkers))
+    {
+        const Bitboard target = checkers ? between_bb(ksq, lsb(checkers)) : ~pos.pieces(Us);
+
+        moveList = checkers ? generate_pawn_moves<Us, EVASIONS, true>(pos, moveList, target)
+                            : generate_pawn_moves<Us, NON_EVASIONS, true>(pos, moveList, target);
+        moveList = generate_moves<Us, KNIGHT, true>(pos, moveList, target);
+        moveList = generate_moves<Us, BISHOP, true>(pos, moveList, target);
+        moveList = generate_moves<Us, ROOK, true>(pos, moveList, target);
+        moveList = generate_moves<Us, QUEEN, true>(pos, moveList, target);
+        moveList = generate_pinned_moves<Us>(pos, moveList, target);
+    }
+
+    // Squares attacked by the opponent. The sliders see through our king, so
+    // that it cannot step back along a checking ray.
+    const Bitboard occupied = pos.pieces() ^ ksq;
+    Bitboard       danger   = pawn_attacks_bb<Them>(pos.pieces(Them, PAWN))
+                    | attacks_bb<KING>(pos.square<KING>(Them));
+
+    for (Bitboard b = pos.pieces(Them, KNIGHT); b;)
+        danger |= attacks_bb<KNIGHT>(pop_lsb(b));
+
+    for (Bitboard b = pos.pieces(Them, BISHOP, QUEEN); b;)
+        danger |= attacks_bb<BISHOP>(pop_lsb(b), occupied);
+
+    for (Bitboard b = pos.pieces(Them, ROOK, QUEEN); b;)
+        danger |= attacks_bb<ROOK>(pop_lsb(b), occupied);
+
+    Bitboard b = attacks_bb<KING>(ksq) & ~pos.pieces(Us) & ~danger;
+
+    while (b)
+        *moveList++ = Move(ksq, pop_lsb(b));
+
+    // After castling, the rook and king final positions are the same in
+    // Chess960 as they would be in standard chess. In Chess960 the rook
+    // may also be blocking a check along the first rank.
+    if (!checkers && pos.can_castle(Us & ANY_CASTLING))
+        for (CastlingRights cr : {Us & KING_SIDE, Us & QUEEN_SIDE})
+            if (!pos.castling_impeded(cr) && pos.can_castle(cr))
+            {
+                const Square rsq = pos.castling_rook_square(cr);
+                const Square kto = relative_square(Us, cr & KING_SIDE ? SQ_G1 : SQ_C1);
+
+                if (!(between_bb(ksq, kto) & danger)
+                    && (!pos.is_chess960() || !(pos.blockers_for_king(Us) & rsq)))
+                    *moveList++ = Move::make<CASTLING>(ksq, rsq);
+            }
+
+    return moveList;
+}
+
 }  // namespace
 
 
@@ -236,21 +368,12 @@ template ExtMove* generate<NON_EVASIONS>(const Position&, ExtMove*);
 template<>
 ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
 
-    Color    us     = pos.side_to_move();
-    Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
-    Square   ksq    = pos.square<KING>(us);
-    ExtMove* cur    = moveList;
-
-    moveList =
-      pos.checkers() ? generate<EVASIONS>(pos, moveList) : generate<NON_EVASIONS>(pos, moveList);
-    while (cur != moveList)
-        if (((pinned & cur->from_sq()) || cur->from_sq() == ksq || cur->type_of() == EN_PASSANT)
-            && !pos.legal(*cur))
-            *cur = *(--moveList);
-        else
-            ++cur;
+    ExtMove* end = pos.side_to_move() == WHITE ? generate_legal<WHITE>(pos, moveList)
+                                               : generate_legal<BLACK>(pos, moveList);
 
-    return moveList;
+    assert(std::all_of(moveList, end, [&](const ExtMove& m) { return pos.legal(m); }));
+
+    return end;
 }
 
 }  // namespace Stockfish
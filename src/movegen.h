@@ -21,6 +21,7 @@
 
 #include <algorithm>  // IWYU pragma: keep
 #include <cstddef>
+#include <cstdint>
 
 #include "types.h"
 
@@ -37,7 +38,8 @@ enum GenType {
 };
 
 struct ExtMove: public Move {
-    int value;
+    std::int16_t see;  // SEE value, only set for the captures of the main search
+    int          value;
 
     void operator=(Move m) { data = m.raw(); }
 
@@ -46,6 +48,8 @@ struct ExtMove: public Move {
     operator float() const = delete;
 };
 
+static_assert(sizeof(ExtMove) == 8, "The SEE value should fit in the padding of ExtMove");
+
 inline bool operator<(const ExtMove& f, const ExtMove& s) { return f.value < s.value; }
 
 template<GenType>
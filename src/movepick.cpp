@@ -21,6 +21,10 @@
 #include <cassert>
 #include <limits>
 
+#if defined(USE_AVX2)
+    #include <immintrin.h>
+#endif
+
 #include "bitboard.h"
 #include "misc.h"
 #include "position.h"
@@ -70,6 +74,61 @@ void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
         }
 }
 
+#if defined(USE_AVX512) || defined(USE_AVX2)
+
+// Helpers for scoring the quiet moves with one move per lane. The history
+// entries are 16-bit, so they are gathered as 32-bit words and sign-extended
+// from the low half. The divisions are done in single precision, which is exact
+// for the range of the histories: a quotient that is not an integer is at
+// least 1/7 away from one, far more than the rounding error.
+//
+// With AVX-512, the zero-masking forms with all the lanes set are used, which
+// compile to the same instructions: gcc implements the plain forms with an
+// undefined source, and warns that it may be used uninitialized.
+    #if defined(USE_AVX512)
+using vec_t                      = __m512i;
+constexpr int       ScoringLanes = 16;
+constexpr __mmask16 AllLanes     = 0xFFFF;
+
+vec_t vec_load(const int* p) { return _mm512_load_si512(p); }
+void  vec_store(int* p, vec_t v) { _mm512_store_si512(p, v); }
+vec_t vec_add(vec_t a, vec_t b) { return _mm512_add_epi32(a, b); }
+vec_t vec_slli(vec_t v, int n) { return _mm512_maskz_slli_epi32(AllLanes, v, unsigned(n)); }
+vec_t vec_gather_i16(const void* base, vec_t idx) {
+    vec_t w = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), AllLanes, idx, base, 2);
+    return _mm512_maskz_srai_epi32(AllLanes, _mm512_maskz_slli_epi32(AllLanes, w, 16), 16);
+}
+vec_t vec_div(vec_t v, int d) {
+    __m512 q = _mm512_div_ps(_mm512_maskz_cvtepi32_ps(AllLanes, v), _mm512_set1_ps(float(d)));
+    return _mm512_maskz_cvttps_epi32(AllLanes, q);
+}
+    #else
+using vec_t                = __m256i;
+constexpr int ScoringLanes = 8;
+
+vec_t vec_load(const int* p) { return _mm256_load_si256(reinterpret_cast<const vec_t*>(p)); }
+void  vec_store(int* p, vec_t v) { _mm256_store_si256(reinterpret_cast<vec_t*>(p), v); }
+vec_t vec_add(vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+vec_t vec_slli(vec_t v, int n) { return _mm256_slli_epi32(v, n); }
+vec_t vec_gather_i16(const void* base, vec_t idx) {
+    const int* p = static_cast<const int*>(base);
+    return _mm256_srai_epi32(_mm256_slli_epi32(_mm256_i32gather_epi32(p, idx, 2), 16), 16);
+}
+vec_t vec_div(vec_t v, int d) {
+    __m256 q = _mm256_div_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(float(d)));
+    return _mm256_cvttps_epi32(q);
+}
+    #endif
+
+    #define USE_VECTOR_SCORING
+
+static_assert(sizeof(ButterflyHistory) == 2 * sizeof(std::int16_t) * SQUARE_NB * SQUARE_NB,
+              "History entries must be 16-bit for the gathers");
+static_assert(sizeof(PieceToHistory) == sizeof(std::int16_t) * PIECE_NB * SQUARE_NB,
+              "History entries must be 16-bit for the gathers");
+
+#endif
+
 }  // namespace
 
 
@@ -119,28 +178,11 @@ MovePicker::MovePicker(const Position& p, Move ttm, int th, const CapturePieceTo
 
 // Assigns a numerical value to each move in a list, used for sorting.
 // Captures are ordered by Most Valuable Victim (MVV), preferring captures
-// with a good history. Quiets moves are ordered using the history tables.
+// with a good history. Quiet moves are scored by score_quiets().
 template<GenType Type>
 void MovePicker::score() {
 
-    static_assert(Type == CAPTURES || Type == QUIETS || Type == EVASIONS, "Wrong type");
-
-    [[maybe_unused]] Bitboard threatenedByPawn, threatenedByMinor, threatenedByRook,
-      threatenedPieces;
-    if constexpr (Type == QUIETS)
-    {
-        Color us = pos.side_to_move();
-
-        threatenedByPawn = pos.attacks_by<PAWN>(~us);
-        threatenedByMinor =
-          pos.attacks_by<KNIGHT>(~us) | pos.attacks_by<BISHOP>(~us) | threatenedByPawn;
-        threatenedByRook = pos.attacks_by<ROOK>(~us) | threatenedByMinor;
-
-        // Pieces threatened by pieces of lesser material value
-        threatenedPieces = (pos.pieces(us, QUEEN) & threatenedByRook)
-                         | (pos.pieces(us, ROOK) & threatenedByMinor)
-                         | (pos.pieces(us, KNIGHT, BISHOP) & threatenedByPawn);
-    }
+    static_assert(Type == CAPTURES || Type == EVASIONS, "Wrong type");
 
     for (auto& m : *this)
         if constexpr (Type == CAPTURES)
@@ -148,42 +190,6 @@ void MovePicker::score() {
               7 * int(PieceValue[pos.piece_on(m.to_sq())])
               + (*captureHistory)[pos.moved_piece(m)][m.to_sq()][type_of(pos.piece_on(m.to_sq()))];
 
-        else if constexpr (Type == QUIETS)
-        {
-            Piece     pc   = pos.moved_piece(m);
-            PieceType pt   = type_of(pc);
-            Square    from = m.from_sq();
-            Square    to   = m.to_sq();
-
-            // histories
-            m.value = 2 * (*mainHistory)[pos.side_to_move()][m.from_to()];
-            m.value += 2 * (*pawnHistory)[pawn_structure_index(pos)][pc][to];
-            m.value += (*continuationHistory[0])[pc][to];
-            m.value += (*continuationHistory[1])[pc][to];
-            m.value += (*continuationHistory[2])[pc][to];
-            m.value += (*continuationHistory[3])[pc][to];
-            m.value += (*continuationHistory[4])[pc][to] / 3;
-            m.value += (*continuationHistory[5])[pc][to];
-
-            // bonus for checks
-            m.value += bool(pos.check_squares(pt) & to) * 16384;
-
-            // bonus for escaping from capture
-            m.value += threatenedPieces & from ? (pt == QUEEN && !(to & threatenedByRook)   ? 51700
-                                                  : pt == ROOK && !(to & threatenedByMinor) ? 25600
-                                                  : !(to & threatenedByPawn)                ? 14450
-                                                                                            : 0)
-                                               : 0;
-
-            // malus for putting piece en prise
-            m.value -= (pt == QUEEN ? bool(to & threatenedByRook) * 49000
-                        : pt == ROOK && bool(to & threatenedByMinor) ? 24335
-                                                                     : 0);
-
-            if (ply < LOW_PLY_HISTORY_SIZE)
-                m.value += 8 * (*lowPlyHistory)[ply][m.from_to()] / (1 + 2 * ply);
-        }
-
         else  // Type == EVASIONS
         {
             if (pos.capture_stage(m))
@@ -195,6 +201,146 @@ void MovePicker::score() {
         }
 }
 
+// Scores the quiet moves. The terms that depend on the board (checks and
+// threats) are computed move by move, then with SIMD the history entries of
+// ScoringLanes moves are gathered and summed at once. The result is the same
+// as with the scalar loop, which scores the remaining moves.
+void MovePicker::score_quiets() {
+
+    Color us = pos.side_to_move();
+
+    Bitboard threatenedByPawn = pos.attacks_by<PAWN>(~us);
+    Bitboard threatenedByMinor =
+      pos.attacks_by<KNIGHT>(~us) | pos.attacks_by<BISHOP>(~us) | threatenedByPawn;
+    Bitboard threatenedByRook = pos.attacks_by<ROOK>(~us) | threatenedByMinor;
+
+    // Pieces threatened by pieces of lesser material value
+    Bitboard threatenedPieces = (pos.pieces(us, QUEEN) & threatenedByRook)
+                              | (pos.pieces(us, ROOK) & threatenedByMinor)
+                              | (pos.pieces(us, KNIGHT, BISHOP) & threatenedByPawn);
+
+    int pawnIndex = pawn_structure_index(pos);
+
+    auto board_terms = [&](PieceType pt, Square from, Square to) {
+        // bonus for checks
+        int value = bool(pos.check_squares(pt) & to) * 16384;
+
+        // bonus for escaping from capture
+        value += threatenedPieces & from ? (pt == QUEEN && !(to & threatenedByRook)   ? 51700
+                                            : pt == ROOK && !(to & threatenedByMinor) ? 25600
+                                            : !(to & threatenedByPawn)                ? 14450
+                                                                                      : 0)
+                                         : 0;
+
+        // malus for putting piece en prise
+        value -= (pt == QUEEN ? bool(to & threatenedByRook) * 49000
+                  : pt == ROOK && bool(to & threatenedByMinor) ? 24335
+                                                               : 0);
+        return value;
+    };
+
+    ExtMove* m = cur;
+
+#ifdef USE_VECTOR_SCORING
+    const auto* mainBase   = &(*mainHistory)[us][0];
+    const auto* lowPlyBase = ply < LOW_PLY_HISTORY_SIZE ? &(*lowPlyHistory)[ply][0] : nullptr;
+    const auto* pawnBase   = &(*pawnHistory)[pawnIndex][0][0];
+
+    for (; m + ScoringLanes <= endMoves; m += ScoringLanes)
+    {
+        alignas(64) int fromTo[ScoringLanes], pieceTo[ScoringLanes], values[ScoringLanes];
+
+        for (int i = 0; i < ScoringLanes; ++i)
+        {
+            Piece  pc   = pos.moved_piece(m[i]);
+            Square from = m[i].from_sq();
+            Square to   = m[i].to_sq();
+
+            fromTo[i]  = m[i].from_to();
+            pieceTo[i] = pc * SQUARE_NB + to;
+            values[i]  = board_terms(type_of(pc), from, to);
+        }
+
+        vec_t ft = vec_load(fromTo);
+        vec_t pt = vec_load(pieceTo);
+
+        vec_t main = vec_gather_i16(mainBase, ft);
+        vec_t pawn = vec_gather_i16(pawnBase, pt);
+        vec_t sum  = vec_slli(vec_add(main, pawn), 1);
+
+        for (int i : {0, 1, 2, 3, 5})
+            sum = vec_add(sum, vec_gather_i16(&(*continuationHistory[i])[0][0], pt));
+
+        sum = vec_add(sum, vec_div(vec_gather_i16(&(*continuationHistory[4])[0][0], pt), 3));
+
+        if (lowPlyBase)
+        {
+            vec_t lowPly = vec_slli(vec_gather_i16(lowPlyBase, ft), 3);
+            sum          = vec_add(sum, vec_div(lowPly, 1 + 2 * ply));
+        }
+
+        vec_store(values, vec_add(sum, vec_load(values)));
+
+        for (int i = 0; i < ScoringLanes; ++i)
+            m[i].value = values[i];
+    }
+#endif
+
+    for (; m < endMoves; ++m)
+    {
+        Piece  pc = pos.moved_piece(*m);
+        Square to = m->to_sq();
+
+        // histories
+        m->value = 2 * (*mainHistory)[us][m->from_to()];
+        m->value += 2 * (*pawnHistory)[pawnIndex][pc][to];
+        m->value += (*continuationHistory[0])[pc][to];
+        m->value += (*continuationHistory[1])[pc][to];
+        m->value += (*continuationHistory[2])[pc][to];
+        m->value += (*continuationHistory[3])[pc][to];
+        m->value += (*continuationHistory[4])[pc][to] / 3;
+        m->value += (*continuationHistory[5])[pc][to];
+
+        m->value += board_terms(type_of(pc), m->from_sq(), to);
+
+        if (ply < LOW_PLY_HISTORY_SIZE)
+            m->value += 8 * (*lowPlyHistory)[ply][m->from_to()] / (1 + 2 * ply);
+    }
+}
+
+// Computes the SEE values of the captures of the main search all at once. The
+// attackers of each target square are computed only once, and the values are
+// kept in the moves, to split the good and bad captures and for see_ge().
+void MovePicker::score_see() {
+
+    Bitboard targets = 0;
+    Bitboard attackers[SQUARE_NB];
+
+    for (auto& m : *this)
+    {
+        Square to = m.to_sq();
+
+        if (!(targets & to))
+        {
+            targets |= to;
+            attackers[to] = pos.attackers_to(to);
+        }
+
+        m.see = pos.see(m, attackers[to]);
+    }
+}
+
+// Tests whether the SEE value of a move is at least the given threshold. For
+// the capture emitted last by the main search, this uses the value computed
+// by score_see() instead of evaluating the exchange again.
+bool MovePicker::see_ge(Move m, int th) const {
+
+    if ((stage == GOOD_CAPTURE || stage == BAD_CAPTURE) && m == *(cur - 1))
+        return (cur - 1)->see >= th;
+
+    return pos.see_ge(m, th);
+}
+
 // Returns the next move satisfying a predicate function.
 // This never returns the TT move, as it was emitted before.
 template<typename Pred>
@@ -233,14 +379,18 @@ top:
 
         score<CAPTURES>();
         partial_insertion_sort(cur, endMoves, std::numeric_limits<int>::min());
+
+        if (stage == CAPTURE_INIT)
+            score_see();
+
         ++stage;
         goto top;
 
     case GOOD_CAPTURE :
         if (select([&]() {
                 // Move losing capture to endBadCaptures to be tried later
-                return pos.see_ge(*cur, -cur->value / 18) ? true
-                                                          : (*endBadCaptures++ = *cur, false);
+                return cur->see >= -cur->value / 18 ? true
+                                                    : (*endBadCaptures++ = *cur, false);
             }))
             return *(cur - 1);
 
@@ -253,7 +403,7 @@ top:
             cur      = endBadCaptures;
             endMoves = beginBadQuiets = endBadQuiets = generate<QUIETS>(pos, cur);
 
-            score<QUIETS>();
+            score_quiets();
             partial_insertion_sort(cur, endMoves, quiet_threshold(depth));
         }
 
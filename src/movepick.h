@@ -50,12 +50,15 @@ class MovePicker {
     MovePicker(const Position&, Move, int, const CapturePieceToHistory*);
     Move next_move();
     void skip_quiet_moves();
+    bool see_ge(Move, int) const;
 
    private:
     template<typename Pred>
     Move select(Pred);
     template<GenType>
     void     score();
+    void     score_quiets();
+    void     score_see();
     ExtMove* begin() { return cur; }
     ExtMove* end() { return endMoves; }
 
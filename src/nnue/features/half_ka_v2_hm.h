@@ -28,7 +28,6 @@
 #include "../nnue_common.h"
 
 namespace Stockfish {
-struct StateInfo;
 class Position;
 }
 
@@ -137,12 +136,12 @@ class HalfKAv2_hm {
 
     // Returns the cost of updating one perspective, the most costly one.
     // Assumes no refresh needed.
-    static int update_cost(const StateInfo* st);
+    static int update_cost(const DirtyPiece& dp);
     static int refresh_cost(const Position& pos);
 
-    // Returns whether the change stored in this StateInfo means
+    // Returns whether the change stored in this DirtyPiece means
     // that a full accumulator refresh is required.
-    static bool requires_refresh(const StateInfo* st, Color perspective);
+    static bool requires_refresh(const DirtyPiece& dp, Color perspective);
 };
 
 }  // namespace Stockfish::Eval::NNUE::Features
@@ -21,10 +21,12 @@
 #ifndef NNUE_LAYERS_AFFINE_TRANSFORM_H_INCLUDED
 #define NNUE_LAYERS_AFFINE_TRANSFORM_H_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 
 #include "../nnue_common.h"
+#include "amx.h"
 #include "simd.h"
 
 /*
@@ -293,6 +295,32 @@ class AffineTransform {
 #endif
     }
 
+#if defined(USE_AMX)
+    // Forward propagation of Amx::TileRows positions at once, whose inputs are
+    // inputStride bytes apart. Each weights tile holds the weights of 16 outputs.
+    void propagate_batch(const InputType* input,
+                         std::size_t      inputStride,
+                         OutputBuffer*    output) const {
+
+        static_assert(PaddedInputDimensions == Amx::DenseInputDimensions);
+        static_assert(OutputDimensions == 32);
+
+        constexpr std::size_t WeightsStride = OutputDimensions * 4;
+
+        _tile_loadd(AMX_DENSE_OUTPUT_LO, biases, 0);
+        _tile_loadd(AMX_DENSE_OUTPUT_HI, biases + 16, 0);
+        _tile_loadd(AMX_DENSE_INPUT, input, inputStride);
+
+        _tile_loadd(AMX_DENSE_WEIGHTS, weights, WeightsStride);
+        _tile_dpbusd(AMX_DENSE_OUTPUT_LO, AMX_DENSE_INPUT, AMX_DENSE_WEIGHTS);
+        _tile_loadd(AMX_DENSE_WEIGHTS, weights + 64, WeightsStride);
+        _tile_dpbusd(AMX_DENSE_OUTPUT_HI, AMX_DENSE_INPUT, AMX_DENSE_WEIGHTS);
+
+        _tile_stored(AMX_DENSE_OUTPUT_LO, output, sizeof(OutputBuffer));
+        _tile_stored(AMX_DENSE_OUTPUT_HI, &output[0][16], sizeof(OutputBuffer));
+    }
+#endif
+
    private:
     using BiasType   = OutputType;
     using WeightType = std::int8_t;
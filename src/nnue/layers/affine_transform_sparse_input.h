@@ -23,12 +23,14 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 
 #include "../../bitboard.h"
 #include "../nnue_common.h"
 #include "affine_transform.h"
+#include "amx.h"
 #include "simd.h"
 
 /*
@@ -77,45 +79,83 @@ alignas(CacheLineSize) static constexpr struct OffsetIndices {
 // Find indices of nonzero numbers in an int32_t array
 template<const IndexType InputDimensions>
 void find_nnz(const std::int32_t* input, std::uint16_t* out, IndexType& count_out) {
-    #if defined(USE_SSSE3)
-        #if defined(USE_AVX512)
+    #if defined(USE_SVE2)
+    // Compact the indices of the nonzero inputs directly, whatever the vector length
+    IndexType count = 0;
+    for (IndexType i = 0; i < InputDimensions; i += IndexType(svcntw()))
+    {
+        const svbool_t      pg      = svwhilelt_b32(i, InputDimensions);
+        const svbool_t      nnz     = svcmpne_n_s32(pg, svld1_s32(pg, input + i), 0);
+        const svuint32_t    indices = svcompact_u32(nnz, svindex_u32(i, 1));
+        const std::uint64_t n       = svcntp_b32(pg, nnz);
+
+        svst1h_u32(svwhilelt_b32(std::uint64_t(0), n), out + count, indices);
+        count += IndexType(n);
+    }
+    count_out = count;
+    #elif defined(USE_VBMI2)
+    // Compress the indices of the nonzero inputs directly, 32 at a time. The
+    // full width store may write past count, but never past InputDimensions.
+    static_assert(InputDimensions % 32 == 0, "InputDimensions must be a multiple of 32");
+
+    const auto    inputVector = reinterpret_cast<const __m512i*>(input);
+    const __m512i zero        = _mm512_setzero_si512();
+    const __m512i increment   = _mm512_set1_epi16(32);
+    IndexType     count       = 0;
+    __m512i       base        = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20,
+                                                 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7,
+                                                 6, 5, 4, 3, 2, 1, 0);
+    for (IndexType i = 0; i < InputDimensions / 32; ++i)
+    {
+        const __mmask32 lo  = _mm512_cmpgt_epi32_mask(inputVector[2 * i], zero);
+        const __mmask32 hi  = _mm512_cmpgt_epi32_mask(inputVector[2 * i + 1], zero);
+        const __mmask32 nnz = lo | hi << 16;
+
+        _mm512_storeu_si512(out + count, _mm512_maskz_compress_epi16(nnz, base));
+        count += popcount(nnz);
+        base = _mm512_add_epi16(base, increment);
+    }
+    count_out = count;
+    #else
+        #if defined(USE_SSSE3)
+            #if defined(USE_AVX512)
     using vec_t = __m512i;
-            #define vec_nnz(a) _mm512_cmpgt_epi32_mask(a, _mm512_setzero_si512())
-        #elif defined(USE_AVX2)
+                #define vec_nnz(a) _mm512_cmpgt_epi32_mask(a, _mm512_setzero_si512())
+            #elif defined(USE_AVX2)
     using vec_t = __m256i;
-            #if defined(USE_VNNI) && !defined(USE_AVXVNNI)
-                #define vec_nnz(a) _mm256_cmpgt_epi32_mask(a, _mm256_setzero_si256())
-            #else
+                #if defined(USE_VNNI) && !defined(USE_AVXVNNI)
+                    #define vec_nnz(a) _mm256_cmpgt_epi32_mask(a, _mm256_setzero_si256())
+                #else
+                    #define vec_nnz(a) \
+                        _mm256_movemask_ps( \
+                          _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, _mm256_setzero_si256())))
+                #endif
+            #elif defined(USE_SSSE3)
+    using vec_t = __m128i;
                 #define vec_nnz(a) \
-                    _mm256_movemask_ps( \
-                      _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, _mm256_setzero_si256())))
+                    _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, _mm_setzero_si128())))
             #endif
-        #elif defined(USE_SSSE3)
-    using vec_t = __m128i;
-            #define vec_nnz(a) \
-                _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, _mm_setzero_si128())))
-        #endif
     using vec128_t = __m128i;
-        #define vec128_zero _mm_setzero_si128()
-        #define vec128_set_16(a) _mm_set1_epi16(a)
-        #if (USE_SSE41)
-            #define vec128_load(a) _mm_cvtepu8_epi16(_mm_loadl_epi64(a))
-        #else
-            #define vec128_load(a) _mm_load_si128(a)
-        #endif
-        #define vec128_storeu(a, b) _mm_storeu_si128(a, b)
-        #define vec128_add(a, b) _mm_add_epi16(a, b)
-    #elif defined(USE_NEON)
+            #define vec128_zero _mm_setzero_si128()
+            #define vec128_set_16(a) _mm_set1_epi16(a)
+            #if (USE_SSE41)
+                #define vec128_load(a) _mm_cvtepu8_epi16(_mm_loadl_epi64(a))
+            #else
+                #define vec128_load(a) _mm_load_si128(a)
+            #endif
+            #define vec128_storeu(a, b) _mm_storeu_si128(a, b)
+            #define vec128_add(a, b) _mm_add_epi16(a, b)
+        #elif defined(USE_NEON)
     using vec_t                        = uint32x4_t;
     static const std::uint32_t Mask[4] = {1, 2, 4, 8};
-        #define vec_nnz(a) vaddvq_u32(vandq_u32(vtstq_u32(a, a), vld1q_u32(Mask)))
+            #define vec_nnz(a) vaddvq_u32(vandq_u32(vtstq_u32(a, a), vld1q_u32(Mask)))
     using vec128_t                     = uint16x8_t;
-        #define vec128_zero vdupq_n_u16(0)
-        #define vec128_set_16(a) vdupq_n_u16(a)
-        #define vec128_load(a) vld1q_u16(reinterpret_cast<const std::uint16_t*>(a))
-        #define vec128_storeu(a, b) vst1q_u16(reinterpret_cast<std::uint16_t*>(a), b)
-        #define vec128_add(a, b) vaddq_u16(a, b)
-    #endif
+            #define vec128_zero vdupq_n_u16(0)
+            #define vec128_set_16(a) vdupq_n_u16(a)
+            #define vec128_load(a) vld1q_u16(reinterpret_cast<const std::uint16_t*>(a))
+            #define vec128_storeu(a, b) vst1q_u16(reinterpret_cast<std::uint16_t*>(a), b)
+            #define vec128_add(a, b) vaddq_u16(a, b)
+        #endif
     constexpr IndexType InputSimdWidth = sizeof(vec_t) / sizeof(std::int32_t);
     // Inputs are processed InputSimdWidth at a time and outputs are processed 8 at a time so we process in chunks of max(InputSimdWidth, 8)
     constexpr IndexType ChunkSize       = std::max<IndexType>(InputSimdWidth, 8);
@@ -147,6 +187,7 @@ void find_nnz(const std::int32_t* input, std::uint16_t* out, IndexType& count_ou
         }
     }
     count_out = count;
+    #endif
 }
     #undef vec_nnz
     #undef vec128_zero
@@ -293,6 +334,30 @@ class AffineTransformSparseInput {
 #endif
     }
 
+#if defined(USE_AMX)
+    // Forward propagation of Amx::TileRows positions at once, whose inputs are
+    // inputStride bytes apart. The inputs are taken as dense: over that many
+    // positions, few blocks of inputs are zero in all of them.
+    void propagate_batch(const InputType* input,
+                         std::size_t      inputStride,
+                         OutputBuffer*    output) const {
+
+        static_assert(OutputDimensions == 16 && PaddedInputDimensions % 64 == 0);
+
+        // Every row starts from the biases, hence the zero stride
+        _tile_loadd(AMX_SPARSE_OUTPUT, biases, 0);
+
+        for (IndexType i = 0; i < PaddedInputDimensions; i += 64)
+        {
+            _tile_loadd(AMX_SPARSE_INPUT, input + i, inputStride);
+            _tile_loadd(AMX_SPARSE_WEIGHTS, &weights[i * OutputDimensions], 64);
+            _tile_dpbusd(AMX_SPARSE_OUTPUT, AMX_SPARSE_INPUT, AMX_SPARSE_WEIGHTS);
+        }
+
+        _tile_stored(AMX_SPARSE_OUTPUT, output, sizeof(OutputBuffer));
+    }
+#endif
+
    private:
     using BiasType   = OutputType;
     using WeightType = std::int8_t;
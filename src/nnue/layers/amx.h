@@ -0,0 +1,92 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Tile configuration of the batched affine layers with Intel AMX
+
+#ifndef NNUE_LAYERS_AMX_H_INCLUDED
+#define NNUE_LAYERS_AMX_H_INCLUDED
+
+#if defined(USE_AMX)
+
+    #include <cstdint>
+    #include <immintrin.h>
+
+    #include "../nnue_common.h"
+
+namespace Stockfish::Eval::NNUE::Layers::Amx {
+
+// The rows of a tile, so the positions whose affine layers are computed at once
+constexpr IndexType TileRows = 16;
+
+// The tiles used by the layers. The layer stacks of both networks have the same
+// dense layer, and sparse input layers with 16 outputs, so that one configuration
+// fits both. The weights tiles are in the layout of VPDPBUSD, which is the one
+// of the layers: the 4 weights of a block of 4 inputs to an output are consecutive.
+// These are macros because the intrinsics of GCC need literal tile numbers.
+    #define AMX_SPARSE_OUTPUT 0    // 16 positions x 16 int32 outputs
+    #define AMX_SPARSE_INPUT 1     // 16 positions x 64 uint8 inputs
+    #define AMX_SPARSE_WEIGHTS 2   // 16 blocks of 4 inputs x 16 outputs x 4 int8 weights
+    #define AMX_DENSE_INPUT 3      // 16 positions x 32 uint8 inputs
+    #define AMX_DENSE_WEIGHTS 4    // 8 blocks of 4 inputs x 16 outputs x 4 int8 weights
+    #define AMX_DENSE_OUTPUT_LO 5  // 16 positions x the first 16 int32 outputs
+    #define AMX_DENSE_OUTPUT_HI 6  // 16 positions x the last 16 int32 outputs
+
+constexpr IndexType DenseInputDimensions = 32;
+
+// Loads the configuration of the tiles, once per thread. The tiles keep it until
+// the thread ends, nothing else in the engine uses them.
+inline void configure_tiles() {
+
+    struct alignas(64) Config {
+        std::uint8_t  palette;
+        std::uint8_t  startRow;
+        std::uint8_t  reserved[14];
+        std::uint16_t colsb[16];  // Bytes per row
+        std::uint8_t  rows[16];
+    };
+
+    thread_local bool configured = false;
+
+    if (configured)
+        return;
+
+    Config config{};
+    config.palette = 1;
+
+    auto set = [&](int t, int rows, int colsb) {
+        config.rows[t]  = std::uint8_t(rows);
+        config.colsb[t] = std::uint16_t(colsb);
+    };
+
+    set(AMX_SPARSE_OUTPUT, TileRows, 64);
+    set(AMX_SPARSE_INPUT, TileRows, 64);
+    set(AMX_SPARSE_WEIGHTS, 16, 64);
+    set(AMX_DENSE_INPUT, TileRows, DenseInputDimensions);
+    set(AMX_DENSE_WEIGHTS, DenseInputDimensions / 4, 64);
+    set(AMX_DENSE_OUTPUT_LO, TileRows, 64);
+    set(AMX_DENSE_OUTPUT_HI, TileRows, 64);
+
+    _tile_loadconfig(&config);
+    configured = true;
+}
+
+}  // namespace Stockfish::Eval::NNUE::Layers::Amx
+
+#endif  // USE_AMX
+
+#endif  // #ifndef NNUE_LAYERS_AMX_H_INCLUDED
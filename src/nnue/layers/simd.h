@@ -33,6 +33,9 @@
 
 #elif defined(USE_NEON)
     #include <arm_neon.h>
+    #if defined(USE_SVE2)
+        #include <arm_sve.h>
+    #endif
 #endif
 
 namespace Stockfish::Simd {
@@ -100,7 +103,12 @@ namespace Stockfish::Simd {
 [[maybe_unused]] static void
 dotprod_m128_add_dpbusd_epi32(int32x4_t& acc, int8x16_t a, int8x16_t b) {
 
+    #if defined(USE_NEON_I8MM)
+    // Like VNNI, multiplies the unsigned inputs by the signed weights
+    acc = vusdotq_s32(acc, vreinterpretq_u8_s8(a), b);
+    #else
     acc = vdotq_s32(acc, a, b);
+    #endif
 }
 #endif
 
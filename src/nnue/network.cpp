@@ -18,11 +18,17 @@
 
 #include "network.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -45,9 +51,18 @@
 //     const unsigned char *const gEmbeddedNNUEEnd;     // a marker to the end
 //     const unsigned int         gEmbeddedNNUESize;    // the size of the embedded file
 // Note that this does not work in Microsoft Visual Studio.
+// Nets saved with "export_net raw" can be embedded instead of the default nets,
+// and are then used in place, by defining NNUE_EMBEDDED_BIG and NNUE_EMBEDDED_SMALL.
+#if !defined(NNUE_EMBEDDED_BIG)
+    #define NNUE_EMBEDDED_BIG EvalFileDefaultNameBig
+#endif
+#if !defined(NNUE_EMBEDDED_SMALL)
+    #define NNUE_EMBEDDED_SMALL EvalFileDefaultNameSmall
+#endif
+
 #if !defined(_MSC_VER) && !defined(NNUE_EMBEDDING_OFF)
-INCBIN(EmbeddedNNUEBig, EvalFileDefaultNameBig);
-INCBIN(EmbeddedNNUESmall, EvalFileDefaultNameSmall);
+INCBIN(EmbeddedNNUEBig, NNUE_EMBEDDED_BIG);
+INCBIN(EmbeddedNNUESmall, NNUE_EMBEDDED_SMALL);
 #else
 const unsigned char        gEmbeddedNNUEBigData[1]   = {0x0};
 const unsigned char* const gEmbeddedNNUEBigEnd       = &gEmbeddedNNUEBigData[1];
@@ -80,6 +95,74 @@ EmbeddedNNUE get_embedded(EmbeddedNNUEType type) {
         return EmbeddedNNUE(gEmbeddedNNUESmallData, gEmbeddedNNUESmallEnd, gEmbeddedNNUESmallSize);
 }
 
+// C++ way to prepare a buffer for a memory stream
+class MemoryBuffer: public std::basic_streambuf<char> {
+   public:
+    MemoryBuffer(char* p, size_t n) {
+        setg(p, p, p + n);
+        setp(p, p + n);
+    }
+};
+
+// Nets in the raw format hold the weights exactly as this build lays them out
+// in memory, after a header which starts with RawMagic where standard nets have
+// their version. The weights start at a page aligned offset.
+constexpr std::uint32_t RawMagic            = 0x57524653;  // "SFRW"
+constexpr std::uint64_t RawHeaderSize       = 36;
+constexpr std::uint64_t RawWeightsAlignment = 4096;
+
+// The layout of the weights depends on the SIMD instructions used by the layers
+std::uint64_t weights_layout_hash(std::size_t weightsSize) {
+    std::string layout = std::to_string(weightsSize);
+    layout += Stockfish::IsLittleEndian ? " LE" : " BE";
+#if defined(USE_AVX512)
+    layout += " AVX512";
+#endif
+#if defined(USE_VNNI)
+    layout += " VNNI";
+#endif
+#if defined(USE_VBMI2)
+    layout += " VBMI2";
+#endif
+#if defined(USE_AVXVNNI)
+    layout += " AVXVNNI";
+#endif
+#if defined(USE_AVX2)
+    layout += " AVX2";
+#endif
+#if defined(USE_SSE41)
+    layout += " SSE41";
+#endif
+#if defined(USE_SSSE3)
+    layout += " SSSE3";
+#endif
+#if defined(USE_SSE2)
+    layout += " SSE2";
+#endif
+#if defined(USE_SVE2)
+    layout += " SVE2";
+#endif
+#if defined(USE_NEON_I8MM)
+    layout += " I8MM";
+#endif
+#if defined(USE_NEON_DOTPROD)
+    layout += " DOTPROD";
+#endif
+#if defined(USE_NEON)
+    layout += " NEON";
+#endif
+#if defined(USE_INT8_FT_WEIGHTS)
+    layout += " FT8";
+#endif
+
+    // FNV-1a, stable across compilers unlike std::hash
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : layout)
+        hash = (hash ^ std::uint8_t(c)) * 0x100000001b3ULL;
+
+    return hash;
+}
+
 }
 
 
@@ -107,47 +190,70 @@ bool write_parameters(std::ostream& stream, T& reference) {
     return reference.write_parameters(stream);
 }
 
+#if defined(USE_INT8_FT_WEIGHTS)
+// The feature transformer reads nets with its weights as int16 or int8, and
+// writes them as int8.
+template<IndexType Dimensions, Accumulator<Dimensions> AccumulatorState::*accPtr>
+bool read_parameters(std::istream& stream, FeatureTransformer<Dimensions, accPtr>& reference) {
+
+    const auto header = read_little_endian<std::uint32_t>(stream);
+    if (stream && header == reference.get_int8_hash_value())
+        return reference.read_int8_parameters(stream);
+    if (!stream || header != reference.get_hash_value())
+        return false;
+    return reference.read_parameters(stream);
+}
+
+template<IndexType Dimensions, Accumulator<Dimensions> AccumulatorState::*accPtr>
+bool write_parameters(std::ostream& stream, FeatureTransformer<Dimensions, accPtr>& reference) {
+
+    write_little_endian<std::uint32_t>(stream, reference.get_int8_hash_value());
+    return reference.write_int8_parameters(stream);
+}
+#endif
+
 }  // namespace Detail
 
+// Copies are used to replicate the network on each NUMA node. Shared weights are
+// mapped from the file of the node the copy is made on, so that each node reads
+// its own copy, shared with the other processes running on that node.
 template<typename Arch, typename Transformer>
 Network<Arch, Transformer>::Network(const Network<Arch, Transformer>& other) :
     evalFile(other.evalFile),
-    embeddedType(other.embeddedType) {
-
-    if (other.featureTransformer)
-        featureTransformer = make_unique_large_page<Transformer>(*other.featureTransformer);
+    embeddedType(other.embeddedType),
+    sharedDirectory(other.sharedDirectory),
+    sharedKey(other.sharedKey) {
 
-    network = make_unique_aligned<Arch[]>(LayerStacks);
+    if (!other.weights)
+        return;
 
-    if (!other.network)
+    if (other.sharedWeights && map_shared([&](Weights& w) {
+            w = *other.weights;
+            return true;
+        }))
         return;
 
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-        network[i] = other.network[i];
+    privateWeights = make_unique_large_page<Weights>(*other.weights);
+    weights        = privateWeights.get();
 }
 
 template<typename Arch, typename Transformer>
 Network<Arch, Transformer>&
 Network<Arch, Transformer>::operator=(const Network<Arch, Transformer>& other) {
-    evalFile     = other.evalFile;
-    embeddedType = other.embeddedType;
-
-    if (other.featureTransformer)
-        featureTransformer = make_unique_large_page<Transformer>(*other.featureTransformer);
-
-    network = make_unique_aligned<Arch[]>(LayerStacks);
-
-    if (!other.network)
-        return *this;
-
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-        network[i] = other.network[i];
-
-    return *this;
+    return *this = Network(other);
 }
 
 template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::string evalfilePath) {
+void Network<Arch, Transformer>::load(const std::string& rootDirectory,
+                                      std::string        evalfilePath,
+                                      const std::string& sharedDir) {
+    // Changing where the weights live requires loading the net again
+    if (sharedDir != sharedDirectory)
+    {
+        sharedDirectory  = sharedDir;
+        evalFile.current = "None";
+    }
+
 #if defined(DEFAULT_NNUE_DIRECTORY)
     std::vector<std::string> dirs = {"<internal>", "", rootDirectory,
                                      stringify(DEFAULT_NNUE_DIRECTORY)};
@@ -177,7 +283,7 @@ void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::str
 
 
 template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename) const {
+bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename, bool raw) const {
     std::string actualFilename;
     std::string msg;
 
@@ -185,10 +291,12 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
         actualFilename = filename.value();
     else
     {
-        if (evalFile.current != evalFile.defaultName)
+        if (evalFile.current != evalFile.defaultName || raw)
         {
-            msg = "Failed to export a net. "
-                  "A non-embedded net can only be saved if the filename is specified";
+            msg = raw ? "Failed to export a net. "
+                        "A raw net can only be saved if the filename is specified"
+                      : "Failed to export a net. "
+                        "A non-embedded net can only be saved if the filename is specified";
 
             sync_cout << msg << sync_endl;
             return false;
@@ -198,7 +306,11 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
     }
 
     std::ofstream stream(actualFilename, std::ios_base::binary);
-    bool          saved = save(stream, evalFile.current, evalFile.netDescription);
+    bool          saved = save(stream, evalFile.current, evalFile.netDescription, raw);
+
+    // The file is complete only once the stream is closed, which may fail too
+    stream.close();
+    saved = saved && !stream.fail();
 
     msg = saved ? "Network saved successfully to " + actualFilename : "Failed to export a net";
 
@@ -210,6 +322,7 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
 template<typename Arch, typename Transformer>
 NetworkOutput
 Network<Arch, Transformer>::evaluate(const Position&                         pos,
+                                     AccumulatorStack&                       accumulators,
                                      AccumulatorCaches::Cache<FTDimensions>* cache) const {
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
@@ -230,12 +343,90 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
     ASSERT_ALIGNED(transformedFeatures, alignment);
 
     const int  bucket     = (pos.count<ALL_PIECES>() - 1) / 4;
-    const auto psqt       = featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-    const auto positional = network[bucket].propagate(transformedFeatures);
+    const auto psqt       = weights->featureTransformer.transform(pos, accumulators, cache,
+                                                                  transformedFeatures, bucket);
+    const auto positional = weights->network[bucket].propagate(transformedFeatures);
     return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
 }
 
 
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::evaluate_batch(
+  const std::vector<const Position*>&     positions,
+  AccumulatorStack&                       accumulators,
+  AccumulatorCaches::Cache<FTDimensions>* cache,
+  NetworkOutput*                          output) const {
+
+    constexpr size_t BatchSize  = 32;
+    constexpr size_t BufferSize = FeatureTransformer<FTDimensions, nullptr>::BufferSize;
+
+    struct alignas(CacheLineSize) TransformedFeatures {
+        TransformedFeatureType data[BufferSize];
+    };
+
+    auto transformedFeatures = make_unique_aligned<TransformedFeatures[]>(BatchSize);
+
+    // Group the positions by layer stack bucket, so that each chunk of the batch
+    // runs through a single set of layer weights which then stays in cache.
+    std::vector<size_t> order(positions.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return positions[a]->count<ALL_PIECES>() < positions[b]->count<ALL_PIECES>();
+    });
+
+    for (size_t start = 0; start < order.size();)
+    {
+        const int    bucket = (positions[order[start]]->count<ALL_PIECES>() - 1) / 4;
+        size_t       end    = start;
+        std::int32_t psqt[BatchSize];
+
+        // First stream the feature transformer weights over the whole chunk...
+        while (end < order.size() && end - start < BatchSize
+               && (positions[order[end]]->count<ALL_PIECES>() - 1) / 4 == bucket)
+        {
+            // Every position is a new root, its accumulator has to be refreshed
+            accumulators.reset();
+            psqt[end - start] = weights->featureTransformer.transform(
+              *positions[order[end]], accumulators, cache, transformedFeatures[end - start].data,
+              bucket);
+            ++end;
+        }
+
+        // ...then run the chunk through the layer stack of the bucket
+        size_t i = start;
+
+#if defined(USE_AMX)
+        // With AMX, TileRows positions at a time. The rows beyond the end of the
+        // chunk are computed too, but not reported.
+        constexpr size_t Rows = Layers::Amx::TileRows;
+        static_assert(BatchSize % Rows == 0);
+
+        if (cpu_features().amx)
+            for (; i < end; i += Rows)
+            {
+                std::int32_t positional[Rows];
+                weights->network[bucket].propagate_batch(transformedFeatures[i - start].data,
+                                                         sizeof(TransformedFeatures), positional);
+
+                for (size_t j = i; j < std::min(i + Rows, end); ++j)
+                    output[order[j]] = {static_cast<Value>(psqt[j - start] / OutputScale),
+                                        static_cast<Value>(positional[j - i] / OutputScale)};
+            }
+#endif
+
+        for (; i < end; ++i)
+        {
+            const auto positional =
+              weights->network[bucket].propagate(transformedFeatures[i - start].data);
+            output[order[i]]      = {static_cast<Value>(psqt[i - start] / OutputScale),
+                                     static_cast<Value>(positional / OutputScale)};
+        }
+
+        start = end;
+    }
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string                                  evalfilePath,
                                         const std::function<void(std::string_view)>& f) const {
@@ -267,12 +458,12 @@ void Network<Arch, Transformer>::verify(std::string
 
     if (f)
     {
-        size_t size = sizeof(*featureTransformer) + sizeof(Arch) * LayerStacks;
+        size_t size = sizeof(Weights);
         f("info string NNUE evaluation using " + evalfilePath + " ("
-          + std::to_string(size / (1024 * 1024)) + "MiB, ("
-          + std::to_string(featureTransformer->InputDimensions) + ", "
-          + std::to_string(network[0].TransformedFeatureDimensions) + ", "
-          + std::to_string(network[0].FC_0_OUTPUTS) + ", " + std::to_string(network[0].FC_1_OUTPUTS)
+          + std::to_string(size / (1024 * 1024)) + "MiB" + (is_shared() ? " shared" : "") + ", ("
+          + std::to_string(Transformer::InputDimensions) + ", "
+          + std::to_string(Arch::TransformedFeatureDimensions) + ", "
+          + std::to_string(Arch::FC_0_OUTPUTS) + ", " + std::to_string(Arch::FC_1_OUTPUTS)
           + ", 1))");
     }
 }
@@ -280,13 +471,16 @@ void Network<Arch, Transformer>::verify(std::string
 
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::hint_common_access(
-  const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    featureTransformer->hint_common_access(pos, cache);
+  const Position&                         pos,
+  AccumulatorStack&                       accumulators,
+  AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    weights->featureTransformer.hint_common_access(pos, accumulators, cache);
 }
 
 template<typename Arch, typename Transformer>
 NnueEvalTrace
 Network<Arch, Transformer>::trace_evaluate(const Position&                         pos,
+                                           AccumulatorStack&                       accumulators,
                                            AccumulatorCaches::Cache<FTDimensions>* cache) const {
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
@@ -309,9 +503,9 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
     t.correctBucket = (pos.count<ALL_PIECES>() - 1) / 4;
     for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
     {
-        const auto materialist =
-          featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-        const auto positional = network[bucket].propagate(transformedFeatures);
+        const auto materialist = weights->featureTransformer.transform(
+          pos, accumulators, cache, transformedFeatures, bucket);
+        const auto positional = weights->network[bucket].propagate(transformedFeatures);
 
         t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
         t.positional[bucket] = static_cast<Value>(positional / OutputScale);
@@ -324,8 +518,33 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_user_net(const std::string& dir,
                                                const std::string& evalfilePath) {
-    std::ifstream stream(dir + evalfilePath, std::ios::binary);
-    auto          description = load(stream);
+    std::optional<std::string> description;
+
+    // The shared memory is keyed by the content of the file, so read it whole
+    if (!sharedDirectory.empty())
+    {
+        if (auto data = read_file_to_string(dir + evalfilePath))
+            description = load_shared(*data);
+    }
+
+    // Raw nets are used in place, straight from the page cache
+    else
+    {
+        size_t size    = 0;
+        auto   mapping = map_file(dir + evalfilePath, &size);
+
+        if (mapping)
+        {
+            const std::string_view data(static_cast<const char*>(mapping.get()), size);
+            description = load_raw(data, std::move(mapping));
+        }
+    }
+
+    if (!description.has_value())
+    {
+        std::ifstream stream(dir + evalfilePath, std::ios::binary);
+        description = load(stream);
+    }
 
     if (description.has_value())
     {
@@ -337,22 +556,22 @@ void Network<Arch, Transformer>::load_user_net(const std::string& dir,
 
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_internal() {
-    // C++ way to prepare a buffer for a memory stream
-    class MemoryBuffer: public std::basic_streambuf<char> {
-       public:
-        MemoryBuffer(char* p, size_t n) {
-            setg(p, p, p + n);
-            setp(p, p + n);
-        }
-    };
-
     const auto embedded = get_embedded(embeddedType);
 
-    MemoryBuffer buffer(const_cast<char*>(reinterpret_cast<const char*>(embedded.data)),
-                        size_t(embedded.size));
+    const std::string_view data(reinterpret_cast<const char*>(embedded.data),
+                                size_t(embedded.size));
 
-    std::istream stream(&buffer);
-    auto         description = load(stream);
+    std::optional<std::string> description =
+      sharedDirectory.empty() ? load_raw(data, nullptr) : load_shared(data);
+
+    if (!description.has_value())
+    {
+        MemoryBuffer buffer(const_cast<char*>(reinterpret_cast<const char*>(embedded.data)),
+                            size_t(embedded.size));
+
+        std::istream stream(&buffer);
+        description = load(stream);
+    }
 
     if (description.has_value())
     {
@@ -362,21 +581,129 @@ void Network<Arch, Transformer>::load_internal() {
 }
 
 
+// Maps the weights of the net in data from shared memory, reading them into it
+// first if no other process on this NUMA node has done so yet. The shared file
+// is named after the content of the net and the layout of the weights in this
+// build, so different nets or binaries never share a file.
+template<typename Arch, typename Transformer>
+std::optional<std::string> Network<Arch, Transformer>::load_shared(std::string_view data) {
+    MemoryBuffer buffer(const_cast<char*>(data.data()), data.size());
+    std::istream stream(&buffer);
+
+    std::uint32_t hashValue;
+    std::string   description;
+    const char*   raw = find_raw_weights(data, &description);
+
+    if (!raw && (!read_header(stream, &hashValue, &description) || hashValue != Network::hash))
+        return std::nullopt;
+
+    sharedKey = std::hash<std::string_view>{}(data) ^ weights_layout_hash(sizeof(Weights));
+
+    const bool mapped = map_shared([&](Weights& w) {
+        if (raw)
+        {
+            std::memcpy(static_cast<void*>(&w), raw, sizeof(Weights));
+            return true;
+        }
+
+        MemoryBuffer netBuffer(const_cast<char*>(data.data()), data.size());
+        std::istream netStream(&netBuffer);
+        std::string  netDescription;
+
+        // Point to the shared memory while it is filled, read_parameters() uses it
+        weights = &w;
+        return read_parameters(netStream, netDescription);
+    });
+
+    return mapped ? std::make_optional(description) : std::nullopt;
+}
+
+
+// Maps the shared memory file of the current NUMA node, calling init() on the
+// weights if this process is the first one to map it.
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::map_shared(const std::function<bool(Weights&)>& init) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/stockfish-nnue-%016llx-node%d",
+                  static_cast<unsigned long long>(sharedKey), current_numa_node());
+
+    auto mem = map_shared_memory(sharedDirectory + name, sizeof(Weights), sharedKey,
+                                 [&](void* m) { return init(*new (m) Weights); });
+
+    weights = nullptr;
+    privateWeights.reset();
+    sharedWeights = std::move(mem);
+
+    if (sharedWeights)
+        weights = static_cast<Weights*>(sharedWeights.get());
+
+    return bool(sharedWeights);
+}
+
+
+// Uses the weights of a raw net in place, keeping the mapping they live in, or
+// copies them if they are not suitably aligned. Returns std::nullopt if data is
+// not a raw net saved by a build with the same weights layout.
+template<typename Arch, typename Transformer>
+std::optional<std::string> Network<Arch, Transformer>::load_raw(std::string_view data,
+                                                                SharedMemoryPtr  mapping) {
+    std::string description;
+    const char* raw = find_raw_weights(data, &description);
+
+    if (!raw)
+        return std::nullopt;
+
+    if (reinterpret_cast<std::uintptr_t>(raw) % alignof(Weights) == 0)
+    {
+        privateWeights.reset();
+        sharedWeights = std::move(mapping);
+        weights       = const_cast<Weights*>(reinterpret_cast<const Weights*>(raw));
+    }
+    else
+    {
+        initialize();
+        std::memcpy(static_cast<void*>(weights), raw, sizeof(Weights));
+    }
+
+    return description;
+}
+
+
+// Returns a pointer to the weights of the raw net in data, nullptr if data
+// doesn't hold a complete raw net matching this build.
+template<typename Arch, typename Transformer>
+const char* Network<Arch, Transformer>::find_raw_weights(std::string_view data,
+                                                         std::string*     desc) const {
+    MemoryBuffer buffer(const_cast<char*>(data.data()), data.size());
+    std::istream stream(&buffer);
+
+    const std::uint64_t offset = read_raw_header(stream, desc);
+
+    if (!offset || data.size() != offset + sizeof(Weights))
+        return nullptr;
+
+    return data.data() + offset;
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::initialize() {
-    featureTransformer = make_unique_large_page<Transformer>();
-    network            = make_unique_aligned<Arch[]>(LayerStacks);
+    sharedWeights.reset();
+    privateWeights = make_unique_large_page<Weights>();
+    weights        = privateWeights.get();
 }
 
 
 template<typename Arch, typename Transformer>
 bool Network<Arch, Transformer>::save(std::ostream&      stream,
                                       const std::string& name,
-                                      const std::string& netDescription) const {
+                                      const std::string& netDescription,
+                                      bool               raw) const {
     if (name.empty() || name == "None")
         return false;
 
-    return write_parameters(stream, netDescription);
+    return raw ? write_raw_parameters(stream, netDescription)
+               : write_parameters(stream, netDescription);
 }
 
 
@@ -385,7 +712,11 @@ std::optional<std::string> Network<Arch, Transformer>::load(std::istream& stream
     initialize();
     std::string description;
 
-    return read_parameters(stream, description) ? std::make_optional(description) : std::nullopt;
+    const bool raw    = stream.peek() == int(RawMagic & 0xFF);
+    const bool loaded = raw ? read_raw_parameters(stream, description)
+                            : read_parameters(stream, description);
+
+    return loaded ? std::make_optional(description) : std::nullopt;
 }
 
 
@@ -428,11 +759,11 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
         return false;
     if (hashValue != Network::hash)
         return false;
-    if (!Detail::read_parameters(stream, *featureTransformer))
+    if (!Detail::read_parameters(stream, weights->featureTransformer))
         return false;
     for (std::size_t i = 0; i < LayerStacks; ++i)
     {
-        if (!Detail::read_parameters(stream, network[i]))
+        if (!Detail::read_parameters(stream, weights->network[i]))
             return false;
     }
     return stream && stream.peek() == std::ios::traits_type::eof();
@@ -442,26 +773,101 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
 template<typename Arch, typename Transformer>
 bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
                                                   const std::string& netDescription) const {
+    // Writing transforms the weights back and forth in place, which read-only
+    // weights don't allow, so these are written from a private copy.
+    LargePagePtr<Weights> copy;
+    Weights*              w = weights;
+
+    if (w != privateWeights.get())
+    {
+        copy = make_unique_large_page<Weights>(*weights);
+        w    = copy.get();
+    }
+
     if (!write_header(stream, Network::hash, netDescription))
         return false;
-    if (!Detail::write_parameters(stream, *featureTransformer))
+    if (!Detail::write_parameters(stream, w->featureTransformer))
         return false;
     for (std::size_t i = 0; i < LayerStacks; ++i)
     {
-        if (!Detail::write_parameters(stream, network[i]))
+        if (!Detail::write_parameters(stream, w->network[i]))
             return false;
     }
     return bool(stream);
 }
 
+
+// Read the header of a raw net, returning the offset of the weights or 0 if the
+// net was saved by a build with another network or weights layout.
+template<typename Arch, typename Transformer>
+std::uint64_t Network<Arch, Transformer>::read_raw_header(std::istream& stream,
+                                                          std::string*  desc) const {
+    const auto magic     = read_little_endian<std::uint32_t>(stream);
+    const auto hashValue = read_little_endian<std::uint32_t>(stream);
+    const auto layout    = read_little_endian<std::uint64_t>(stream);
+    const auto size      = read_little_endian<std::uint64_t>(stream);
+    const auto offset    = read_little_endian<std::uint64_t>(stream);
+    const auto descSize  = read_little_endian<std::uint32_t>(stream);
+
+    if (!stream || magic != RawMagic || hashValue != Network::hash
+        || layout != weights_layout_hash(sizeof(Weights)) || size != sizeof(Weights)
+        || offset % RawWeightsAlignment || offset < RawHeaderSize + descSize)
+        return 0;
+
+    desc->resize(descSize);
+    stream.read(&(*desc)[0], descSize);
+    return stream.fail() ? 0 : offset;
+}
+
+
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::read_raw_parameters(std::istream& stream,
+                                                     std::string&  netDescription) const {
+    const std::uint64_t offset = read_raw_header(stream, &netDescription);
+    if (!offset)
+        return false;
+
+    stream.ignore(std::streamsize(offset - RawHeaderSize - netDescription.size()));
+    stream.read(reinterpret_cast<char*>(weights), sizeof(Weights));
+    return stream && stream.peek() == std::ios::traits_type::eof();
+}
+
+
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::write_raw_parameters(std::ostream&      stream,
+                                                      const std::string& netDescription) const {
+    const std::uint64_t offset = (RawHeaderSize + netDescription.size() + RawWeightsAlignment - 1)
+                               / RawWeightsAlignment * RawWeightsAlignment;
+
+    write_little_endian<std::uint32_t>(stream, RawMagic);
+    write_little_endian<std::uint32_t>(stream, Network::hash);
+    write_little_endian<std::uint64_t>(stream, weights_layout_hash(sizeof(Weights)));
+    write_little_endian<std::uint64_t>(stream, sizeof(Weights));
+    write_little_endian<std::uint64_t>(stream, offset);
+    write_little_endian<std::uint32_t>(stream, std::uint32_t(netDescription.size()));
+    stream.write(netDescription.data(), std::streamsize(netDescription.size()));
+
+    const std::string padding(offset - RawHeaderSize - netDescription.size(), '\0');
+    stream.write(padding.data(), std::streamsize(padding.size()));
+    stream.write(reinterpret_cast<const char*>(weights), sizeof(Weights));
+    return bool(stream);
+}
+
+template<typename Arch, typename Transformer>
+std::string Network<Arch, Transformer>::pages_information() const {
+    return privateWeights ? large_pages_information(privateWeights.get())
+         : is_shared()    ? "shared memory"
+                          : "embedded data";
+}
+
 // Explicit template instantiation
 
 template class Network<
   NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>,
-  FeatureTransformer<TransformedFeatureDimensionsBig, &StateInfo::accumulatorBig>>;
+  FeatureTransformer<TransformedFeatureDimensionsBig, &AccumulatorState::accumulatorBig>>;
 
 template class Network<
   NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>,
-  FeatureTransformer<TransformedFeatureDimensionsSmall, &StateInfo::accumulatorSmall>>;
+  FeatureTransformer<TransformedFeatureDimensionsSmall, &AccumulatorState::accumulatorSmall>>;
 
 }  // namespace Stockfish::Eval::NNUE
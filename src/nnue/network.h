@@ -60,27 +60,62 @@ class Network {
     Network& operator=(const Network& other);
     Network& operator=(Network&& other) = default;
 
-    void load(const std::string& rootDirectory, std::string evalfilePath);
-    bool save(const std::optional<std::string>& filename) const;
+    void load(const std::string& rootDirectory,
+              std::string        evalfilePath,
+              const std::string& sharedDirectory = "");
+    bool save(const std::optional<std::string>& filename, bool raw = false) const;
+
+    // True if the weights are mapped from shared memory rather than private
+    bool is_shared() const { return bool(sharedWeights); }
+
+    // Bytes of the private weights, none when they are shared or embedded, and
+    // where the weights are
+    size_t      memory() const { return privateWeights ? sizeof(Weights) : 0; }
+    std::string pages_information() const;
 
     NetworkOutput evaluate(const Position&                         pos,
+                           AccumulatorStack&                       accumulators,
                            AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
 
     void hint_common_access(const Position&                         pos,
+                            AccumulatorStack&                       accumulators,
                             AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
+    // Evaluates many positions from scratch, writing the results to output in
+    // the same order. Positions sharing a layer stack are processed together.
+    void evaluate_batch(const std::vector<const Position*>&     positions,
+                        AccumulatorStack&                       accumulators,
+                        AccumulatorCaches::Cache<FTDimensions>* cache,
+                        NetworkOutput*                          output) const;
+
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
+                                 AccumulatorStack&                       accumulators,
                                  AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
    private:
+    // Input feature converter and evaluation function, stored together so that
+    // they can be placed in a single block of shared memory.
+    struct Weights {
+        Transformer featureTransformer;
+        Arch        network[LayerStacks];
+    };
+
     void load_user_net(const std::string&, const std::string&);
     void load_internal();
 
+    std::optional<std::string> load_shared(std::string_view data);
+    bool                       map_shared(const std::function<bool(Weights&)>& init);
+    std::optional<std::string> load_raw(std::string_view data, SharedMemoryPtr mapping);
+    const char*                find_raw_weights(std::string_view data, std::string* desc) const;
+
     void initialize();
 
-    bool                       save(std::ostream&, const std::string&, const std::string&) const;
+    bool                       save(std::ostream&,
+                                    const std::string&,
+                                    const std::string&,
+                                    bool) const;
     std::optional<std::string> load(std::istream&);
 
     bool read_header(std::istream&, std::uint32_t*, std::string*) const;
@@ -89,15 +124,24 @@ class Network {
     bool read_parameters(std::istream&, std::string&) const;
     bool write_parameters(std::ostream&, const std::string&) const;
 
-    // Input feature converter
-    LargePagePtr<Transformer> featureTransformer;
+    std::uint64_t read_raw_header(std::istream&, std::string*) const;
+    bool          read_raw_parameters(std::istream&, std::string&) const;
+    bool          write_raw_parameters(std::ostream&, const std::string&) const;
 
-    // Evaluation function
-    AlignedPtr<Arch[]> network;
+    // Points either to privateWeights, into sharedWeights, or into the embedded
+    // data when it holds a raw net.
+    Weights*              weights = nullptr;
+    LargePagePtr<Weights> privateWeights;
+    SharedMemoryPtr       sharedWeights;
 
     EvalFile         evalFile;
     EmbeddedNNUEType embeddedType;
 
+    // Directory of the shared memory files, empty if the weights are private,
+    // and the key of the content of the mapped file
+    std::string   sharedDirectory;
+    std::uint64_t sharedKey = 0;
+
     // Hash value of evaluation function structure
     static constexpr std::uint32_t hash = Transformer::get_hash_value() ^ Arch::get_hash_value();
 
@@ -107,12 +151,12 @@ class Network {
 
 // Definitions of the network types
 using SmallFeatureTransformer =
-  FeatureTransformer<TransformedFeatureDimensionsSmall, &StateInfo::accumulatorSmall>;
+  FeatureTransformer<TransformedFeatureDimensionsSmall, &AccumulatorState::accumulatorSmall>;
 using SmallNetworkArchitecture =
   NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
 
 using BigFeatureTransformer =
-  FeatureTransformer<TransformedFeatureDimensionsBig, &StateInfo::accumulatorBig>;
+  FeatureTransformer<TransformedFeatureDimensionsBig, &AccumulatorState::accumulatorBig>;
 using BigNetworkArchitecture = NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>;
 
 using NetworkBig   = Network<BigNetworkArchitecture, BigFeatureTransformer>;
@@ -21,8 +21,16 @@
 #ifndef NNUE_ACCUMULATOR_H_INCLUDED
 #define NNUE_ACCUMULATOR_H_INCLUDED
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
+#include "../memory.h"
+#include "../types.h"
 #include "nnue_architecture.h"
 #include "nnue_common.h"
 
@@ -47,10 +55,15 @@ struct alignas(CacheLineSize) Accumulator {
 // efficiently update the accumulator, instead of rebuilding it from scratch.
 // This idea, was first described by Luecx (author of Koivisto) and
 // is commonly referred to as "Finny Tables".
+// With many threads the caches compete with the TT for the shared cache levels,
+// so a cache may also hold entries for only a few king squares per perspective,
+// reusing the entry of the least recently used king square on a miss.
 struct AccumulatorCaches {
 
     template<typename Networks>
-    AccumulatorCaches(const Networks& networks) {
+    AccumulatorCaches(const Networks& networks, size_t squares = SQUARE_NB) :
+        big(squares),
+        small(squares) {
         clear(networks);
     }
 
@@ -73,16 +86,62 @@ struct AccumulatorCaches {
             }
         };
 
+        explicit Cache(size_t squareCount) :
+            squares(std::clamp(squareCount, size_t(1), size_t(SQUARE_NB))),
+            entries(make_unique_aligned<Entry[]>(squares * COLOR_NB)),
+            kingSquares(squares * COLOR_NB),
+            lastUse(squares * COLOR_NB) {}
+
         template<typename Network>
         void clear(const Network& network) {
-            for (auto& entries1D : entries)
-                for (auto& entry : entries1D)
-                    entry.clear(network.featureTransformer->biases);
+            std::memcpy(biases, network.weights->featureTransformer.biases, sizeof(biases));
+
+            for (size_t i = 0; i < squares * COLOR_NB; ++i)
+            {
+                entries[i].clear(biases);
+                kingSquares[i] = SQ_NONE;
+                lastUse[i]     = 0;
+            }
+
+            clock = 0;
         }
 
-        std::array<Entry, COLOR_NB>& operator[](Square sq) { return entries[sq]; }
+        Entry& entry(Square ksq, Color perspective) {
+            if (squares == SQUARE_NB)
+                return entries[ksq * COLOR_NB + perspective];
+
+            size_t victim = perspective;
+
+            for (size_t i = perspective; i < squares * COLOR_NB; i += COLOR_NB)
+            {
+                if (kingSquares[i] == ksq)
+                {
+                    lastUse[i] = ++clock;
+                    return entries[i];
+                }
+
+                if (lastUse[i] < lastUse[victim])
+                    victim = i;
+            }
+
+            // The evicted entry starts over from an empty board
+            kingSquares[victim] = ksq;
+            lastUse[victim]     = ++clock;
+            entries[victim].clear(biases);
 
-        std::array<std::array<Entry, COLOR_NB>, SQUARE_NB> entries;
+            return entries[victim];
+        }
+
+        // Bytes used by the entries
+        size_t memory() const { return squares * COLOR_NB * sizeof(Entry); }
+
+       private:
+        size_t                squares;
+        AlignedPtr<Entry[]>   entries;  // [squares][COLOR_NB]
+        std::vector<Square>   kingSquares;
+        std::vector<uint64_t> lastUse;
+        uint64_t              clock = 0;
+        BiasType              biases[Size];
     };
 
     template<typename Networks>
@@ -91,10 +150,77 @@ struct AccumulatorCaches {
         small.clear(networks.small);
     }
 
+    size_t memory() const { return big.memory() + small.memory(); }
+
     Cache<TransformedFeatureDimensionsBig>   big;
     Cache<TransformedFeatureDimensionsSmall> small;
 };
 
+
+// The accumulators of one position of the search path, together with the
+// pieces changed by the move leading to it.
+struct AccumulatorState {
+    Accumulator<TransformedFeatureDimensionsBig>   accumulatorBig;
+    Accumulator<TransformedFeatureDimensionsSmall> accumulatorSmall;
+    DirtyPiece                                     dirtyPiece;
+
+    void reset(const DirtyPiece& dp) {
+        dirtyPiece                       = dp;
+        accumulatorBig.computed[WHITE]   = accumulatorBig.computed[BLACK] = false;
+        accumulatorSmall.computed[WHITE] = accumulatorSmall.computed[BLACK] = false;
+    }
+};
+
+
+// AccumulatorStack holds the accumulators of the positions along the current
+// search path, indexed by the ply from the root position. Making a move only
+// records the changed pieces, the accumulators themselves are computed lazily
+// by the feature transformer when a position is actually evaluated.
+class AccumulatorStack {
+   public:
+    AccumulatorStack() :
+        accumulators(MAX_PLY + 1),
+        count(1) {}
+
+    size_t size() const { return count; }
+
+    AccumulatorState&       operator[](size_t ply) { return accumulators[ply]; }
+    const AccumulatorState& operator[](size_t ply) const { return accumulators[ply]; }
+
+    AccumulatorState&       latest() { return accumulators[count - 1]; }
+    const AccumulatorState& latest() const { return accumulators[count - 1]; }
+
+    // Starts over from a new root position, whose accumulators have to be refreshed
+    void reset() {
+        DirtyPiece dp;
+        dp.dirty_num = 0;
+        dp.piece[0]  = NO_PIECE;  // Avoid checks in update_accumulator()
+
+        accumulators[0].reset(dp);
+        count              = 1;
+        incrementalUpdates = refreshes = 0;
+    }
+
+    void push(const DirtyPiece& dirtyPiece) {
+        assert(count < accumulators.size());
+        accumulators[count++].reset(dirtyPiece);
+    }
+
+    void pop() {
+        assert(count > 1);
+        --count;
+    }
+
+    // Counted per perspective and network since the last reset(), for the
+    // search statistics
+    uint64_t incrementalUpdates = 0;
+    uint64_t refreshes          = 0;
+
+   private:
+    std::vector<AccumulatorState> accumulators;
+    size_t                        count;
+};
+
 }  // namespace Stockfish::Eval::NNUE
 
 #endif  // NNUE_ACCUMULATOR_H_INCLUDED
@@ -21,6 +21,7 @@
 #ifndef NNUE_ARCHITECTURE_H_INCLUDED
 #define NNUE_ARCHITECTURE_H_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
@@ -28,6 +29,7 @@
 #include "features/half_ka_v2_hm.h"
 #include "layers/affine_transform.h"
 #include "layers/affine_transform_sparse_input.h"
+#include "layers/amx.h"
 #include "layers/clipped_relu.h"
 #include "layers/sqr_clipped_relu.h"
 #include "nnue_common.h"
@@ -130,6 +132,58 @@ struct NetworkArchitecture {
 
         return outputValue;
     }
+
+#if defined(USE_AMX)
+    // Forward propagation of Layers::Amx::TileRows positions, whose transformed
+    // features are stride bytes apart, as propagate() does for each of them, but
+    // with the affine layers of all of them computed at once with AMX.
+    void propagate_batch(const TransformedFeatureType* transformedFeatures,
+                         std::size_t                   stride,
+                         std::int32_t*                 output) {
+
+        constexpr IndexType Rows = Layers::Amx::TileRows;
+
+        struct alignas(CacheLineSize) Buffer {
+            alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out[Rows];
+            alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
+              ac_sqr_0_out[Rows][ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
+            alignas(CacheLineSize) typename decltype(ac_0)::OutputBuffer ac_0_out;
+            alignas(CacheLineSize) typename decltype(fc_1)::OutputBuffer fc_1_out[Rows];
+            alignas(CacheLineSize) typename decltype(ac_1)::OutputBuffer ac_1_out;
+            alignas(CacheLineSize) typename decltype(fc_2)::OutputBuffer fc_2_out;
+
+            Buffer() { std::memset(this, 0, sizeof(*this)); }
+        };
+
+        alignas(CacheLineSize) static thread_local Buffer buffer;
+
+        Layers::Amx::configure_tiles();
+
+        fc_0.propagate_batch(transformedFeatures, stride, buffer.fc_0_out);
+
+        for (IndexType i = 0; i < Rows; ++i)
+        {
+            ac_sqr_0.propagate(buffer.fc_0_out[i], buffer.ac_sqr_0_out[i]);
+            ac_0.propagate(buffer.fc_0_out[i], buffer.ac_0_out);
+            std::memcpy(buffer.ac_sqr_0_out[i] + FC_0_OUTPUTS, buffer.ac_0_out,
+                        FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
+        }
+
+        fc_1.propagate_batch(buffer.ac_sqr_0_out[0], sizeof(buffer.ac_sqr_0_out[0]),
+                             buffer.fc_1_out);
+
+        for (IndexType i = 0; i < Rows; ++i)
+        {
+            ac_1.propagate(buffer.fc_1_out[i], buffer.ac_1_out);
+            fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
+
+            // See propagate()
+            std::int32_t fwdOut = (buffer.fc_0_out[i][FC_0_OUTPUTS]) * (600 * OutputScale)
+                                / (127 * (1 << WeightScaleBits));
+            output[i]           = buffer.fc_2_out[0] + fwdOut;
+        }
+    }
+#endif
 };
 
 }  // namespace Stockfish::Eval::NNUE
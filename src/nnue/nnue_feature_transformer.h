@@ -26,8 +26,11 @@
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
+#include <limits>
+#include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "../position.h"
 #include "../types.h"
@@ -37,8 +40,14 @@
 
 namespace Stockfish::Eval::NNUE {
 
-using BiasType       = std::int16_t;
-using WeightType     = std::int16_t;
+using BiasType = std::int16_t;
+#if defined(USE_INT8_FT_WEIGHTS)
+// Stored as int8 to halve the memory traffic of the accumulator updates, then
+// widened to the int16 lanes of the accumulation, see FeatureTransformer::weightShift.
+using WeightType = std::int8_t;
+#else
+using WeightType = std::int16_t;
+#endif
 using PSQTWeightType = std::int32_t;
 
 // If vector instructions are enabled, we update and refresh the
@@ -69,6 +78,11 @@ using psqt_vec_t = __m256i;
     #define vec_add_psqt_32(a, b) _mm256_add_epi32(a, b)
     #define vec_sub_psqt_32(a, b) _mm256_sub_epi32(a, b)
     #define vec_zero_psqt() _mm256_setzero_si256()
+    // Loads int8 weights into a vector of int16, multiplied by 2^s
+    #define vec_load_weights_8(a, s) \
+        _mm512_sll_epi16( \
+          _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(a))), \
+          _mm_cvtsi32_si128(s))
     #define NumRegistersSIMD 16
     #define MaxChunkSize 64
 
@@ -92,6 +106,10 @@ using psqt_vec_t = __m256i;
     #define vec_add_psqt_32(a, b) _mm256_add_epi32(a, b)
     #define vec_sub_psqt_32(a, b) _mm256_sub_epi32(a, b)
     #define vec_zero_psqt() _mm256_setzero_si256()
+    #define vec_load_weights_8(a, s) \
+        _mm256_sll_epi16( \
+          _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a))), \
+          _mm_cvtsi32_si128(s))
     #define NumRegistersSIMD 16
     #define MaxChunkSize 32
 
@@ -114,6 +132,21 @@ using psqt_vec_t = __m128i;
     #define vec_add_psqt_32(a, b) _mm_add_epi32(a, b)
     #define vec_sub_psqt_32(a, b) _mm_sub_epi32(a, b)
     #define vec_zero_psqt() _mm_setzero_si128()
+    #ifdef USE_SSE41
+        #define vec_load_weights_8(a, s) \
+            _mm_sll_epi16( \
+              _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a))), \
+              _mm_cvtsi32_si128(s))
+    #else
+        // Sign extends by shifting the weight down from the high byte of each lane
+        #define vec_load_weights_8(a, s) \
+            _mm_sll_epi16( \
+              _mm_srai_epi16( \
+                _mm_unpacklo_epi8(_mm_setzero_si128(), \
+                                  _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a))), \
+                8), \
+              _mm_cvtsi32_si128(s))
+    #endif
     #define NumRegistersSIMD (Is64Bit ? 16 : 8)
     #define MaxChunkSize 16
 
@@ -138,6 +171,7 @@ using psqt_vec_t = int32x4_t;
     #define vec_sub_psqt_32(a, b) vsubq_s32(a, b)
     #define vec_zero_psqt() \
         psqt_vec_t { 0 }
+    #define vec_load_weights_8(a, s) vshlq_s16(vmovl_s8(vld1_s8(a)), vec_set_16(s))
     #define NumRegistersSIMD 16
     #define MaxChunkSize 16
 
@@ -229,7 +263,7 @@ class SIMDTiling {
 
    public:
     static constexpr int NumRegs =
-      BestRegisterCount<vec_t, WeightType, TransformedFeatureWidth, NumRegistersSIMD>();
+      BestRegisterCount<vec_t, BiasType, TransformedFeatureWidth, NumRegistersSIMD>();
     static constexpr int NumPsqtRegs =
       BestRegisterCount<psqt_vec_t, PSQTWeightType, PSQTBuckets, NumRegistersSIMD>();
 
@@ -244,7 +278,7 @@ class SIMDTiling {
 
 // Input feature converter
 template<IndexType                                 TransformedFeatureDimensions,
-         Accumulator<TransformedFeatureDimensions> StateInfo::*accPtr>
+         Accumulator<TransformedFeatureDimensions> AccumulatorState::*accPtr>
 class FeatureTransformer {
 
     // Number of output dimensions for one side
@@ -292,23 +326,28 @@ class FeatureTransformer {
         return FeatureSet::HashValue ^ (OutputDimensions * 2);
     }
 
+    // The weights are permuted in blocks of 8, the 16 bytes of 8 int16 lanes
     void permute_weights() {
         permute<16>(biases, PackusEpi16Order);
-        permute<16>(weights, PackusEpi16Order);
+        permute<8 * sizeof(WeightType)>(weights, PackusEpi16Order);
     }
 
     void unpermute_weights() {
         permute<16>(biases, InversePackusEpi16Order);
-        permute<16>(weights, InversePackusEpi16Order);
+        permute<8 * sizeof(WeightType)>(weights, InversePackusEpi16Order);
     }
 
     inline void scale_weights(bool read) {
+#if defined(USE_INT8_FT_WEIGHTS)
+        weightShift += read ? 1 : -1;
+#else
         for (IndexType j = 0; j < InputDimensions; ++j)
         {
             WeightType* w = &weights[j * HalfDimensions];
             for (IndexType i = 0; i < HalfDimensions; ++i)
                 w[i] = read ? w[i] * 2 : w[i] / 2;
         }
+#endif
 
         for (IndexType i = 0; i < HalfDimensions; ++i)
             biases[i] = read ? biases[i] * 2 : biases[i] / 2;
@@ -318,7 +357,13 @@ class FeatureTransformer {
     bool read_parameters(std::istream& stream) {
 
         read_leb_128<BiasType>(stream, biases, HalfDimensions);
+#if defined(USE_INT8_FT_WEIGHTS)
+        auto wideWeights = std::make_unique<std::int16_t[]>(HalfDimensions * InputDimensions);
+        read_leb_128<std::int16_t>(stream, wideWeights.get(), HalfDimensions * InputDimensions);
+        quantize_weights(wideWeights.get());
+#else
         read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+#endif
         read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
 
         permute_weights();
@@ -326,6 +371,41 @@ class FeatureTransformer {
         return !stream.fail();
     }
 
+#if defined(USE_INT8_FT_WEIGHTS)
+    // Hash value of the feature transformer in nets written by builds storing its
+    // weights as int8. The nets of other builds are quantized when loaded, while
+    // these are loaded as they are, and only by such builds.
+    static constexpr std::uint32_t get_int8_hash_value() { return get_hash_value() ^ 0x8u; }
+
+    // Read network parameters written by write_int8_parameters()
+    bool read_int8_parameters(std::istream& stream) {
+
+        read_leb_128<BiasType>(stream, biases, HalfDimensions);
+        weightShift = read_little_endian<std::uint8_t>(stream);
+        read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+        read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
+
+        permute_weights();
+        scale_weights(true);
+        return !stream.fail() && weightShift <= MaxWeightShift + 1;
+    }
+
+    // Write network parameters, with the weights as int8 and their shift
+    bool write_int8_parameters(std::ostream& stream) {
+
+        unpermute_weights();
+        scale_weights(false);
+
+        write_leb_128<BiasType>(stream, biases, HalfDimensions);
+        write_little_endian<std::uint8_t>(stream, std::uint8_t(weightShift));
+        write_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+        write_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
+
+        permute_weights();
+        scale_weights(true);
+        return !stream.fail();
+    }
+#else
     // Write network parameters
     bool write_parameters(std::ostream& stream) {
 
@@ -340,22 +420,24 @@ class FeatureTransformer {
         scale_weights(true);
         return !stream.fail();
     }
+#endif
 
     // Convert input features
     std::int32_t transform(const Position&                           pos,
+                           AccumulatorStack&                         accumulators,
                            AccumulatorCaches::Cache<HalfDimensions>* cache,
                            OutputType*                               output,
                            int                                       bucket) const {
-        update_accumulator<WHITE>(pos, cache);
-        update_accumulator<BLACK>(pos, cache);
+        update_accumulator<WHITE>(pos, accumulators, cache);
+        update_accumulator<BLACK>(pos, accumulators, cache);
 
         const Color perspectives[2]  = {pos.side_to_move(), ~pos.side_to_move()};
-        const auto& psqtAccumulation = (pos.state()->*accPtr).psqtAccumulation;
+        const auto& psqtAccumulation = (accumulators.latest().*accPtr).psqtAccumulation;
         const auto  psqt =
           (psqtAccumulation[perspectives[0]][bucket] - psqtAccumulation[perspectives[1]][bucket])
           / 2;
 
-        const auto& accumulation = (pos.state()->*accPtr).accumulation;
+        const auto& accumulation = (accumulators.latest().*accPtr).accumulation;
 
         for (IndexType p = 0; p < 2; ++p)
         {
@@ -469,196 +551,429 @@ class FeatureTransformer {
     }  // end of function transform()
 
     void hint_common_access(const Position&                           pos,
+                            AccumulatorStack&                         accumulators,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
-        update_accumulator<WHITE>(pos, cache);
-        update_accumulator<BLACK>(pos, cache);
+        update_accumulator<WHITE>(pos, accumulators, cache);
+        update_accumulator<BLACK>(pos, accumulators, cache);
     }
 
    private:
+#if defined(USE_INT8_FT_WEIGHTS)
+    // The int16 weights of a net, doubled when loaded, must fit in 15 bits, so
+    // int8 weights need at most a shift of 7 before being doubled.
+    static constexpr int MaxWeightShift = 7;
+
+    // Stores the int16 weights w as int8, divided by 2^weightShift and rounded.
+    // The shift is the one with the least squared error over all the weights,
+    // clamping the few largest ones if this lets the others keep more precision.
+    void quantize_weights(const std::int16_t* w) {
+        constexpr std::size_t Count = std::size_t(HalfDimensions) * InputDimensions;
+
+        auto quantize = [](int v, int shift) {
+            return std::clamp((v + (1 << shift >> 1)) >> shift, -128, 127);
+        };
+
+        std::vector<std::uint64_t> histogram(1 << 16);
+        for (std::size_t i = 0; i < Count; ++i)
+            histogram[std::uint16_t(w[i])]++;
+
+        double bestError = std::numeric_limits<double>::max();
+        for (int shift = 0; shift <= MaxWeightShift; ++shift)
+        {
+            double error = 0;
+            for (int v = -32768; v < 32768; ++v)
+                if (const auto n = histogram[std::uint16_t(v)])
+                {
+                    const double diff = v - quantize(v, shift) * (1 << shift);
+                    error += double(n) * diff * diff;
+                }
+
+            if (error < bestError)
+            {
+                bestError   = error;
+                weightShift = shift;
+            }
+        }
+
+        for (std::size_t i = 0; i < Count; ++i)
+            weights[i] = WeightType(quantize(w[i], weightShift));
+    }
+#endif
+
+#ifdef VECTOR
+    #if defined(USE_INT8_FT_WEIGHTS)
+    // The weights of a feature from offset on, read by vectors of int16 lanes
+    // like the accumulation
+    struct WeightColumn {
+        vec_t operator[](IndexType k) const {
+            return vec_load_weights_8(&w[k * (sizeof(vec_t) / sizeof(BiasType))], shift);
+        }
+
+        const WeightType* w;
+        int               shift;
+    };
+
+    WeightColumn weight_column(IndexType offset) const { return {&weights[offset], weightShift}; }
+    #else
+    const vec_t* weight_column(IndexType offset) const {
+        return reinterpret_cast<const vec_t*>(&weights[offset]);
+    }
+    #endif
+#endif
+
+    // A weight at the scale of the accumulation
+    BiasType weight(IndexType i) const {
+#if defined(USE_INT8_FT_WEIGHTS)
+        return BiasType(weights[i] * (1 << weightShift));
+#else
+        return weights[i];
+#endif
+    }
+
     template<Color Perspective>
-    StateInfo* try_find_computed_accumulator(const Position& pos) const {
+    size_t try_find_computed_accumulator(const Position&         pos,
+                                         const AccumulatorStack& accumulators) const {
         // Look for a usable accumulator of an earlier position. We keep track
         // of the estimated gain in terms of features to be added/subtracted.
-        StateInfo* st   = pos.state();
-        int        gain = FeatureSet::refresh_cost(pos);
-        while (st->previous && !(st->*accPtr).computed[Perspective])
+        size_t ply  = accumulators.size() - 1;
+        int    gain = FeatureSet::refresh_cost(pos);
+        while (ply > 0 && !(accumulators[ply].*accPtr).computed[Perspective])
         {
             // This governs when a full feature refresh is needed and how many
             // updates are better than just one full refresh.
-            if (FeatureSet::requires_refresh(st, Perspective)
-                || (gain -= FeatureSet::update_cost(st) + 1) < 0)
+            const DirtyPiece& dp = accumulators[ply].dirtyPiece;
+            if (FeatureSet::requires_refresh(dp, Perspective)
+                || (gain -= FeatureSet::update_cost(dp) + 1) < 0)
                 break;
-            st = st->previous;
+            --ply;
         }
-        return st;
+        return ply;
     }
 
-    // Given a computed accumulator, computes the accumulator of the next position.
+    // Given a computed accumulator, computes the accumulators of the next
+    // positions, up to the current one.
     template<Color Perspective>
-    void update_accumulator_incremental(const Position& pos, StateInfo* computed) const {
-        assert((computed->*accPtr).computed[Perspective]);
-        assert(computed->next != nullptr);
+    void update_accumulator_incremental(const Position&   pos,
+                                        AccumulatorStack& accumulators,
+                                        size_t            computedPly) const {
+        assert((accumulators[computedPly].*accPtr).computed[Perspective]);
+        assert(computedPly + 1 < accumulators.size());
+
+        if (computedPly + 2 < accumulators.size())
+        {
+            update_accumulator_fused<Perspective>(pos, accumulators, computedPly);
+            return;
+        }
 
         const Square ksq = pos.square<KING>(Perspective);
 
-        // The size must be enough to contain the largest possible update.
-        // That might depend on the feature set and generally relies on the
-        // feature set's update cost calculation to be correct and never allow
-        // updates with more added/removed features than MaxActiveDimensions.
-        // In this case, the maximum size of both feature addition and removal
-        // is 2, since we are incrementally updating one move at a time.
+        for (size_t ply = computedPly + 1; ply < accumulators.size(); ++ply)
+        {
+            const auto&       computed = accumulators[ply - 1].*accPtr;
+            auto&             next     = accumulators[ply].*accPtr;
+            const DirtyPiece& dp       = accumulators[ply].dirtyPiece;
+
+            // The size must be enough to contain the largest possible update.
+            // That might depend on the feature set and generally relies on the
+            // feature set's update cost calculation to be correct and never allow
+            // updates with more added/removed features than MaxActiveDimensions.
+            // In this case, the maximum size of both feature addition and removal
+            // is 2, since we are incrementally updating one move at a time.
+            FeatureSet::IndexList removed, added;
+            FeatureSet::append_changed_indices<Perspective>(ksq, dp, removed, added);
+
+            assert(!next.computed[Perspective]);
+
+            if (removed.size() == 0 && added.size() == 0)
+            {
+                std::memcpy(next.accumulation[Perspective],
+                            computed.accumulation[Perspective],
+                            HalfDimensions * sizeof(BiasType));
+                std::memcpy(next.psqtAccumulation[Perspective],
+                            computed.psqtAccumulation[Perspective],
+                            PSQTBuckets * sizeof(PSQTWeightType));
+            }
+            else
+            {
+                assert(added.size() == 1 || added.size() == 2);
+                assert(removed.size() == 1 || removed.size() == 2);
+                assert(added.size() <= removed.size());
+
+#ifdef VECTOR
+                constexpr IndexType NumVecs = HalfDimensions * sizeof(BiasType) / sizeof(vec_t);
+                constexpr IndexType NumPsqtVecs =
+                  PSQTBuckets * sizeof(PSQTWeightType) / sizeof(psqt_vec_t);
+
+                auto* accIn =
+                  reinterpret_cast<const vec_t*>(&computed.accumulation[Perspective][0]);
+                auto* accOut = reinterpret_cast<vec_t*>(&next.accumulation[Perspective][0]);
+
+                const IndexType offsetA0 = HalfDimensions * added[0];
+                const auto      columnA0 = weight_column(offsetA0);
+                const IndexType offsetR0 = HalfDimensions * removed[0];
+                const auto      columnR0 = weight_column(offsetR0);
+
+                if (removed.size() == 1)
+                {
+                    for (IndexType i = 0; i < NumVecs; ++i)
+                        accOut[i] = vec_add_16(vec_sub_16(accIn[i], columnR0[i]), columnA0[i]);
+                }
+                else if (added.size() == 1)
+                {
+                    const IndexType offsetR1 = HalfDimensions * removed[1];
+                    const auto      columnR1 = weight_column(offsetR1);
+
+                    for (IndexType i = 0; i < NumVecs; ++i)
+                        accOut[i] = vec_sub_16(vec_add_16(accIn[i], columnA0[i]),
+                                               vec_add_16(columnR0[i], columnR1[i]));
+                }
+                else
+                {
+                    const IndexType offsetA1 = HalfDimensions * added[1];
+                    const auto      columnA1 = weight_column(offsetA1);
+                    const IndexType offsetR1 = HalfDimensions * removed[1];
+                    const auto      columnR1 = weight_column(offsetR1);
+
+                    for (IndexType i = 0; i < NumVecs; ++i)
+                        accOut[i] =
+                          vec_add_16(accIn[i], vec_sub_16(vec_add_16(columnA0[i], columnA1[i]),
+                                                          vec_add_16(columnR0[i], columnR1[i])));
+                }
+
+                auto* accPsqtIn =
+                  reinterpret_cast<const psqt_vec_t*>(&computed.psqtAccumulation[Perspective][0]);
+                auto* accPsqtOut =
+                  reinterpret_cast<psqt_vec_t*>(&next.psqtAccumulation[Perspective][0]);
+
+                const IndexType offsetPsqtA0 = PSQTBuckets * added[0];
+                auto*           columnPsqtA0 =
+                  reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtA0]);
+                const IndexType offsetPsqtR0 = PSQTBuckets * removed[0];
+                auto*           columnPsqtR0 =
+                  reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR0]);
+
+                if (removed.size() == 1)
+                {
+                    for (std::size_t i = 0; i < NumPsqtVecs; ++i)
+                        accPsqtOut[i] = vec_add_psqt_32(
+                          vec_sub_psqt_32(accPsqtIn[i], columnPsqtR0[i]), columnPsqtA0[i]);
+                }
+                else if (added.size() == 1)
+                {
+                    const IndexType offsetPsqtR1 = PSQTBuckets * removed[1];
+                    auto*           columnPsqtR1 =
+                      reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR1]);
+
+                    for (std::size_t i = 0; i < NumPsqtVecs; ++i)
+                        accPsqtOut[i] =
+                          vec_sub_psqt_32(vec_add_psqt_32(accPsqtIn[i], columnPsqtA0[i]),
+                                          vec_add_psqt_32(columnPsqtR0[i], columnPsqtR1[i]));
+                }
+                else
+                {
+                    const IndexType offsetPsqtA1 = PSQTBuckets * added[1];
+                    auto*           columnPsqtA1 =
+                      reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtA1]);
+                    const IndexType offsetPsqtR1 = PSQTBuckets * removed[1];
+                    auto*           columnPsqtR1 =
+                      reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR1]);
+
+                    for (std::size_t i = 0; i < NumPsqtVecs; ++i)
+                        accPsqtOut[i] = vec_add_psqt_32(
+                          accPsqtIn[i],
+                          vec_sub_psqt_32(vec_add_psqt_32(columnPsqtA0[i], columnPsqtA1[i]),
+                                          vec_add_psqt_32(columnPsqtR0[i], columnPsqtR1[i])));
+                }
+#else
+                std::memcpy(next.accumulation[Perspective],
+                            computed.accumulation[Perspective],
+                            HalfDimensions * sizeof(BiasType));
+                std::memcpy(next.psqtAccumulation[Perspective],
+                            computed.psqtAccumulation[Perspective],
+                            PSQTBuckets * sizeof(PSQTWeightType));
+
+                // Difference calculation for the deactivated features
+                for (const auto index : removed)
+                {
+                    const IndexType offset = HalfDimensions * index;
+                    for (IndexType i = 0; i < HalfDimensions; ++i)
+                        next.accumulation[Perspective][i] -= weight(offset + i);
+
+                    for (std::size_t i = 0; i < PSQTBuckets; ++i)
+                        next.psqtAccumulation[Perspective][i] -=
+                          psqtWeights[index * PSQTBuckets + i];
+                }
+
+                // Difference calculation for the activated features
+                for (const auto index : added)
+                {
+                    const IndexType offset = HalfDimensions * index;
+                    for (IndexType i = 0; i < HalfDimensions; ++i)
+                        next.accumulation[Perspective][i] += weight(offset + i);
+
+                    for (std::size_t i = 0; i < PSQTBuckets; ++i)
+                        next.psqtAccumulation[Perspective][i] +=
+                          psqtWeights[index * PSQTBuckets + i];
+                }
+#endif
+            }
+
+            next.computed[Perspective] = true;
+        }
+    }
+
+
+    // Given a computed accumulator several plies back, computes the accumulator
+    // of the current position only. The features changed by all the moves in
+    // between are gathered first, so that a feature added and removed again
+    // cancels out, then they are applied in a single pass with the accumulation
+    // held in registers. The accumulators in between are left uncomputed.
+    template<Color Perspective>
+    void update_accumulator_fused(const Position&   pos,
+                                  AccumulatorStack& accumulators,
+                                  size_t            computedPly) const {
+
+        const Square          ksq = pos.square<KING>(Perspective);
         FeatureSet::IndexList removed, added;
-        FeatureSet::append_changed_indices<Perspective>(ksq, computed->next->dirtyPiece, removed,
-                                                        added);
 
-        StateInfo* next = computed->next;
-        assert(!(next->*accPtr).computed[Perspective]);
+        // Removes the index from the list, returns false if it wasn't there
+        auto cancel = [](FeatureSet::IndexList& list, IndexType index) {
+            for (std::size_t i = 0; i < list.size(); ++i)
+                if (list[i] == index)
+                {
+                    list.erase(i);
+                    return true;
+                }
+            return false;
+        };
 
-        if (removed.size() == 0 && added.size() == 0)
+        // The budget of try_find_computed_accumulator() keeps the lists within
+        // MaxActiveDimensions, as each changed piece costs at least one feature.
+        for (size_t ply = computedPly + 1; ply < accumulators.size(); ++ply)
         {
-            std::memcpy((next->*accPtr).accumulation[Perspective],
-                        (computed->*accPtr).accumulation[Perspective],
-                        HalfDimensions * sizeof(BiasType));
-            std::memcpy((next->*accPtr).psqtAccumulation[Perspective],
-                        (computed->*accPtr).psqtAccumulation[Perspective],
-                        PSQTBuckets * sizeof(PSQTWeightType));
+            FeatureSet::IndexList plyRemoved, plyAdded;
+            FeatureSet::append_changed_indices<Perspective>(ksq, accumulators[ply].dirtyPiece,
+                                                            plyRemoved, plyAdded);
+
+            for (const auto index : plyRemoved)
+                if (!cancel(added, index))
+                    removed.push_back(index);
+
+            for (const auto index : plyAdded)
+                if (!cancel(removed, index))
+                    added.push_back(index);
         }
-        else
-        {
-            assert(added.size() == 1 || added.size() == 2);
-            assert(removed.size() == 1 || removed.size() == 2);
-            assert(added.size() <= removed.size());
+
+        const auto& computed = accumulators[computedPly].*accPtr;
+        auto&       next     = accumulators.latest().*accPtr;
+
+        assert(!next.computed[Perspective]);
 
 #ifdef VECTOR
-            auto* accIn =
-              reinterpret_cast<const vec_t*>(&(computed->*accPtr).accumulation[Perspective][0]);
-            auto* accOut = reinterpret_cast<vec_t*>(&(next->*accPtr).accumulation[Perspective][0]);
+        vec_t      acc[Tiling::NumRegs];
+        psqt_vec_t psqt[Tiling::NumPsqtRegs];
 
-            const IndexType offsetA0 = HalfDimensions * added[0];
-            auto*           columnA0 = reinterpret_cast<const vec_t*>(&weights[offsetA0]);
-            const IndexType offsetR0 = HalfDimensions * removed[0];
-            auto*           columnR0 = reinterpret_cast<const vec_t*>(&weights[offsetR0]);
+        for (IndexType j = 0; j < HalfDimensions / Tiling::TileHeight; ++j)
+        {
+            auto* inTile = reinterpret_cast<const vec_t*>(
+              &computed.accumulation[Perspective][j * Tiling::TileHeight]);
+            auto* outTile =
+              reinterpret_cast<vec_t*>(&next.accumulation[Perspective][j * Tiling::TileHeight]);
 
-            if (removed.size() == 1)
-            {
-                for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(vec_t); ++i)
-                    accOut[i] = vec_add_16(vec_sub_16(accIn[i], columnR0[i]), columnA0[i]);
-            }
-            else if (added.size() == 1)
+            for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                acc[k] = inTile[k];
+
+            for (const auto index : removed)
             {
-                const IndexType offsetR1 = HalfDimensions * removed[1];
-                auto*           columnR1 = reinterpret_cast<const vec_t*>(&weights[offsetR1]);
+                const IndexType offset = HalfDimensions * index + j * Tiling::TileHeight;
+                const auto      column = weight_column(offset);
 
-                for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(vec_t); ++i)
-                    accOut[i] = vec_sub_16(vec_add_16(accIn[i], columnA0[i]),
-                                           vec_add_16(columnR0[i], columnR1[i]));
+                for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                    acc[k] = vec_sub_16(acc[k], column[k]);
             }
-            else
+            for (const auto index : added)
             {
-                const IndexType offsetA1 = HalfDimensions * added[1];
-                auto*           columnA1 = reinterpret_cast<const vec_t*>(&weights[offsetA1]);
-                const IndexType offsetR1 = HalfDimensions * removed[1];
-                auto*           columnR1 = reinterpret_cast<const vec_t*>(&weights[offsetR1]);
-
-                for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(vec_t); ++i)
-                    accOut[i] =
-                      vec_add_16(accIn[i], vec_sub_16(vec_add_16(columnA0[i], columnA1[i]),
-                                                      vec_add_16(columnR0[i], columnR1[i])));
+                const IndexType offset = HalfDimensions * index + j * Tiling::TileHeight;
+                const auto      column = weight_column(offset);
+
+                for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                    acc[k] = vec_add_16(acc[k], column[k]);
             }
 
-            auto* accPsqtIn = reinterpret_cast<const psqt_vec_t*>(
-              &(computed->*accPtr).psqtAccumulation[Perspective][0]);
-            auto* accPsqtOut =
-              reinterpret_cast<psqt_vec_t*>(&(next->*accPtr).psqtAccumulation[Perspective][0]);
+            for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                vec_store(&outTile[k], acc[k]);
+        }
+
+        for (IndexType j = 0; j < PSQTBuckets / Tiling::PsqtTileHeight; ++j)
+        {
+            auto* inTilePsqt = reinterpret_cast<const psqt_vec_t*>(
+              &computed.psqtAccumulation[Perspective][j * Tiling::PsqtTileHeight]);
+            auto* outTilePsqt = reinterpret_cast<psqt_vec_t*>(
+              &next.psqtAccumulation[Perspective][j * Tiling::PsqtTileHeight]);
 
-            const IndexType offsetPsqtA0 = PSQTBuckets * added[0];
-            auto* columnPsqtA0 = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtA0]);
-            const IndexType offsetPsqtR0 = PSQTBuckets * removed[0];
-            auto* columnPsqtR0 = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR0]);
+            for (std::size_t k = 0; k < Tiling::NumPsqtRegs; ++k)
+                psqt[k] = inTilePsqt[k];
 
-            if (removed.size() == 1)
-            {
-                for (std::size_t i = 0;
-                     i < PSQTBuckets * sizeof(PSQTWeightType) / sizeof(psqt_vec_t); ++i)
-                    accPsqtOut[i] = vec_add_psqt_32(vec_sub_psqt_32(accPsqtIn[i], columnPsqtR0[i]),
-                                                    columnPsqtA0[i]);
-            }
-            else if (added.size() == 1)
-            {
-                const IndexType offsetPsqtR1 = PSQTBuckets * removed[1];
-                auto*           columnPsqtR1 =
-                  reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR1]);
-
-                for (std::size_t i = 0;
-                     i < PSQTBuckets * sizeof(PSQTWeightType) / sizeof(psqt_vec_t); ++i)
-                    accPsqtOut[i] =
-                      vec_sub_psqt_32(vec_add_psqt_32(accPsqtIn[i], columnPsqtA0[i]),
-                                      vec_add_psqt_32(columnPsqtR0[i], columnPsqtR1[i]));
-            }
-            else
-            {
-                const IndexType offsetPsqtA1 = PSQTBuckets * added[1];
-                auto*           columnPsqtA1 =
-                  reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtA1]);
-                const IndexType offsetPsqtR1 = PSQTBuckets * removed[1];
-                auto*           columnPsqtR1 =
-                  reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR1]);
-
-                for (std::size_t i = 0;
-                     i < PSQTBuckets * sizeof(PSQTWeightType) / sizeof(psqt_vec_t); ++i)
-                    accPsqtOut[i] = vec_add_psqt_32(
-                      accPsqtIn[i],
-                      vec_sub_psqt_32(vec_add_psqt_32(columnPsqtA0[i], columnPsqtA1[i]),
-                                      vec_add_psqt_32(columnPsqtR0[i], columnPsqtR1[i])));
-            }
-#else
-            std::memcpy((next->*accPtr).accumulation[Perspective],
-                        (computed->*accPtr).accumulation[Perspective],
-                        HalfDimensions * sizeof(BiasType));
-            std::memcpy((next->*accPtr).psqtAccumulation[Perspective],
-                        (computed->*accPtr).psqtAccumulation[Perspective],
-                        PSQTBuckets * sizeof(PSQTWeightType));
-
-            // Difference calculation for the deactivated features
             for (const auto index : removed)
             {
-                const IndexType offset = HalfDimensions * index;
-                for (IndexType i = 0; i < HalfDimensions; ++i)
-                    (next->*accPtr).accumulation[Perspective][i] -= weights[offset + i];
+                const IndexType offset = PSQTBuckets * index + j * Tiling::PsqtTileHeight;
+                auto* columnPsqt       = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offset]);
 
-                for (std::size_t i = 0; i < PSQTBuckets; ++i)
-                    (next->*accPtr).psqtAccumulation[Perspective][i] -=
-                      psqtWeights[index * PSQTBuckets + i];
+                for (std::size_t k = 0; k < Tiling::NumPsqtRegs; ++k)
+                    psqt[k] = vec_sub_psqt_32(psqt[k], columnPsqt[k]);
             }
-
-            // Difference calculation for the activated features
             for (const auto index : added)
             {
-                const IndexType offset = HalfDimensions * index;
-                for (IndexType i = 0; i < HalfDimensions; ++i)
-                    (next->*accPtr).accumulation[Perspective][i] += weights[offset + i];
+                const IndexType offset = PSQTBuckets * index + j * Tiling::PsqtTileHeight;
+                auto* columnPsqt       = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offset]);
 
-                for (std::size_t i = 0; i < PSQTBuckets; ++i)
-                    (next->*accPtr).psqtAccumulation[Perspective][i] +=
-                      psqtWeights[index * PSQTBuckets + i];
+                for (std::size_t k = 0; k < Tiling::NumPsqtRegs; ++k)
+                    psqt[k] = vec_add_psqt_32(psqt[k], columnPsqt[k]);
             }
-#endif
+
+            for (std::size_t k = 0; k < Tiling::NumPsqtRegs; ++k)
+                vec_store_psqt(&outTilePsqt[k], psqt[k]);
+        }
+
+#else
+
+        std::memcpy(next.accumulation[Perspective], computed.accumulation[Perspective],
+                    HalfDimensions * sizeof(BiasType));
+        std::memcpy(next.psqtAccumulation[Perspective], computed.psqtAccumulation[Perspective],
+                    PSQTBuckets * sizeof(PSQTWeightType));
+
+        for (const auto index : removed)
+        {
+            const IndexType offset = HalfDimensions * index;
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+                next.accumulation[Perspective][i] -= weight(offset + i);
+
+            for (std::size_t i = 0; i < PSQTBuckets; ++i)
+                next.psqtAccumulation[Perspective][i] -= psqtWeights[index * PSQTBuckets + i];
         }
+        for (const auto index : added)
+        {
+            const IndexType offset = HalfDimensions * index;
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+                next.accumulation[Perspective][i] += weight(offset + i);
 
-        (next->*accPtr).computed[Perspective] = true;
+            for (std::size_t i = 0; i < PSQTBuckets; ++i)
+                next.psqtAccumulation[Perspective][i] += psqtWeights[index * PSQTBuckets + i];
+        }
+#endif
 
-        if (next != pos.state())
-            update_accumulator_incremental<Perspective>(pos, next);
+        next.computed[Perspective] = true;
     }
 
 
     template<Color Perspective>
     void update_accumulator_refresh_cache(const Position&                           pos,
+                                          AccumulatorStack&                         accumulators,
                                           AccumulatorCaches::Cache<HalfDimensions>* cache) const {
         assert(cache != nullptr);
 
         Square                ksq   = pos.square<KING>(Perspective);
-        auto&                 entry = (*cache)[ksq][Perspective];
+        auto&                 entry = cache->entry(ksq, Perspective);
         FeatureSet::IndexList removed, added;
 
         for (Color c : {WHITE, BLACK})
@@ -684,7 +999,7 @@ class FeatureTransformer {
             }
         }
 
-        auto& accumulator                 = pos.state()->*accPtr;
+        auto& accumulator                 = accumulators.latest().*accPtr;
         accumulator.computed[Perspective] = true;
 
 #ifdef VECTOR
@@ -705,10 +1020,10 @@ class FeatureTransformer {
             {
                 IndexType       indexR  = removed[i];
                 const IndexType offsetR = HalfDimensions * indexR + j * Tiling::TileHeight;
-                auto*           columnR = reinterpret_cast<const vec_t*>(&weights[offsetR]);
+                const auto      columnR = weight_column(offsetR);
                 IndexType       indexA  = added[i];
                 const IndexType offsetA = HalfDimensions * indexA + j * Tiling::TileHeight;
-                auto*           columnA = reinterpret_cast<const vec_t*>(&weights[offsetA]);
+                const auto      columnA = weight_column(offsetA);
 
                 for (IndexType k = 0; k < Tiling::NumRegs; ++k)
                     acc[k] = vec_add_16(acc[k], vec_sub_16(columnA[k], columnR[k]));
@@ -717,7 +1032,7 @@ class FeatureTransformer {
             {
                 IndexType       index  = removed[i];
                 const IndexType offset = HalfDimensions * index + j * Tiling::TileHeight;
-                auto*           column = reinterpret_cast<const vec_t*>(&weights[offset]);
+                const auto      column = weight_column(offset);
 
                 for (IndexType k = 0; k < Tiling::NumRegs; ++k)
                     acc[k] = vec_sub_16(acc[k], column[k]);
@@ -726,7 +1041,7 @@ class FeatureTransformer {
             {
                 IndexType       index  = added[i];
                 const IndexType offset = HalfDimensions * index + j * Tiling::TileHeight;
-                auto*           column = reinterpret_cast<const vec_t*>(&weights[offset]);
+                const auto      column = weight_column(offset);
 
                 for (IndexType k = 0; k < Tiling::NumRegs; ++k)
                     acc[k] = vec_add_16(acc[k], column[k]);
@@ -779,7 +1094,7 @@ class FeatureTransformer {
         {
             const IndexType offset = HalfDimensions * index;
             for (IndexType j = 0; j < HalfDimensions; ++j)
-                entry.accumulation[j] -= weights[offset + j];
+                entry.accumulation[j] -= weight(offset + j);
 
             for (std::size_t k = 0; k < PSQTBuckets; ++k)
                 entry.psqtAccumulation[k] -= psqtWeights[index * PSQTBuckets + k];
@@ -788,7 +1103,7 @@ class FeatureTransformer {
         {
             const IndexType offset = HalfDimensions * index;
             for (IndexType j = 0; j < HalfDimensions; ++j)
-                entry.accumulation[j] += weights[offset + j];
+                entry.accumulation[j] += weight(offset + j);
 
             for (std::size_t k = 0; k < PSQTBuckets; ++k)
                 entry.psqtAccumulation[k] += psqtWeights[index * PSQTBuckets + k];
@@ -814,17 +1129,25 @@ class FeatureTransformer {
 
     template<Color Perspective>
     void update_accumulator(const Position&                           pos,
+                            AccumulatorStack&                         accumulators,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
-        if ((pos.state()->*accPtr).computed[Perspective])
+        if ((accumulators.latest().*accPtr).computed[Perspective])
             return;
-        StateInfo* oldest = try_find_computed_accumulator<Perspective>(pos);
+        size_t oldest = try_find_computed_accumulator<Perspective>(pos, accumulators);
 
-        if ((oldest->*accPtr).computed[Perspective] && oldest != pos.state())
+        if ((accumulators[oldest].*accPtr).computed[Perspective]
+            && oldest != accumulators.size() - 1)
+        {
             // Start from the oldest computed accumulator, update all the
             // accumulators up to the current position.
-            update_accumulator_incremental<Perspective>(pos, oldest);
+            update_accumulator_incremental<Perspective>(pos, accumulators, oldest);
+            accumulators.incrementalUpdates++;
+        }
         else
-            update_accumulator_refresh_cache<Perspective>(pos, cache);
+        {
+            update_accumulator_refresh_cache<Perspective>(pos, accumulators, cache);
+            accumulators.refreshes++;
+        }
     }
 
     template<IndexType Size>
@@ -833,6 +1156,10 @@ class FeatureTransformer {
     alignas(CacheLineSize) BiasType biases[HalfDimensions];
     alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
     alignas(CacheLineSize) PSQTWeightType psqtWeights[InputDimensions * PSQTBuckets];
+#if defined(USE_INT8_FT_WEIGHTS)
+    // The weights are multiplied by 2^weightShift when widened to int16
+    int weightShift;
+#endif
 };
 
 }  // namespace Stockfish::Eval::NNUE
@@ -45,11 +45,12 @@ constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
 
 void hint_common_parent_position(const Position&    pos,
                                  const Networks&    networks,
+                                 AccumulatorStack&  accumulators,
                                  AccumulatorCaches& caches) {
     if (Eval::use_smallnet(pos))
-        networks.small.hint_common_access(pos, &caches.small);
+        networks.small.hint_common_access(pos, accumulators, &caches.small);
     else
-        networks.big.hint_common_access(pos, &caches.big);
+        networks.big.hint_common_access(pos, accumulators, &caches.big);
 }
 
 namespace {
@@ -105,8 +106,10 @@ void format_cp_aligned_dot(Value v, std::stringstream& stream, const Position& p
 
 // Returns a string with the value of each piece on a board,
 // and a table for (PSQT, Layers) values bucket by bucket.
-std::string
-trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::AccumulatorCaches& caches) {
+std::string trace(Position&                      pos,
+                  const Eval::NNUE::Networks&    networks,
+                  Eval::NNUE::AccumulatorStack&  accumulators,
+                  Eval::NNUE::AccumulatorCaches& caches) {
 
     std::stringstream ss;
 
@@ -132,7 +135,7 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
 
     // We estimate the value of each piece by doing a differential evaluation from
     // the current base eval, simulating the removal of the piece from its square.
-    auto [psqt, positional] = networks.big.evaluate(pos, &caches.big);
+    auto [psqt, positional] = networks.big.evaluate(pos, accumulators, &caches.big);
     Value base              = psqt + positional;
     base                    = pos.side_to_move() == WHITE ? base : -base;
 
@@ -145,18 +148,16 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
 
             if (pc != NO_PIECE && type_of(pc) != KING)
             {
-                auto st = pos.state();
-
                 pos.remove_piece(sq);
-                st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
+                accumulators.reset();
 
-                std::tie(psqt, positional) = networks.big.evaluate(pos, &caches.big);
+                std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, &caches.big);
                 Value eval                 = psqt + positional;
                 eval                       = pos.side_to_move() == WHITE ? eval : -eval;
                 v                          = base - eval;
 
                 pos.put_piece(pc, sq);
-                st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
+                accumulators.reset();
             }
 
             writeSquare(f, r, pc, v);
@@ -167,7 +168,7 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
         ss << board[row] << '\n';
     ss << '\n';
 
-    auto t = networks.big.trace_evaluate(pos, &caches.big);
+    auto t = networks.big.trace_evaluate(pos, accumulators, &caches.big);
 
     ss << " NNUE network contributions "
        << (pos.side_to_move() == WHITE ? "(White to move)" : "(Black to move)") << std::endl
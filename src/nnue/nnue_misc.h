@@ -52,10 +52,15 @@ struct NnueEvalTrace {
 
 struct Networks;
 struct AccumulatorCaches;
+class AccumulatorStack;
 
-std::string trace(Position& pos, const Networks& networks, AccumulatorCaches& caches);
+std::string trace(Position&          pos,
+                  const Networks&    networks,
+                  AccumulatorStack&  accumulators,
+                  AccumulatorCaches& caches);
 void        hint_common_parent_position(const Position&    pos,
                                         const Networks&    networks,
+                                        AccumulatorStack&  accumulators,
                                         AccumulatorCaches& caches);
 
 }  // namespace Stockfish::Eval::NNUE
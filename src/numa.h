@@ -1200,6 +1200,16 @@ class LazyNumaReplicated: public NumaReplicatedBase {
 
     const T* operator->() const { return instances[0].get(); }
 
+    // Calls f(idx, replica) for each replica made so far, by NUMA node index
+    template<typename FuncT>
+    void for_each_replica(FuncT&& f) const {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        for (NumaIndex idx = 0; idx < instances.size(); ++idx)
+            if (instances[idx] != nullptr)
+                f(idx, *instances[idx]);
+    }
+
     template<typename FuncT>
     void modify_and_replicate(FuncT&& f) {
         auto source = std::move(instances[0]);
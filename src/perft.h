@@ -19,49 +19,165 @@
 #ifndef PERFT_H_INCLUDED
 #define PERFT_H_INCLUDED
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
+#include "memory.h"
+#include "misc.h"
 #include "movegen.h"
 #include "position.h"
+#include "thread.h"
 #include "types.h"
 #include "uci.h"
 
 namespace Stockfish::Benchmark {
 
-// Utility to verify move generation. All the leaf nodes up
-// to the given depth are generated and counted, and the sum is returned.
-template<bool Root>
-uint64_t perft(Position& pos, Depth depth) {
+// PerftTable stores subtree leaf counts by position key and remaining depth.
+// It is shared by all the perft threads without locking: the key is stored
+// xor-ed with the data, so that an entry torn by a concurrent write simply
+// fails verification and the count stays exact.
+class PerftTable {
 
-    StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
+    struct Entry {
+        uint64_t check = 0;
+        uint64_t data  = 0;
+    };
 
-    uint64_t   cnt, nodes = 0;
+   public:
+    explicit PerftTable(size_t mbSize) :
+        count(mbSize * 1024 * 1024 / sizeof(Entry)) {
+        if (count)
+            table = make_unique_large_page<Entry[]>(count);
+    }
+
+    bool enabled() const { return count != 0; }
+
+    bool probe(Key key, Depth depth, uint64_t& nodes) const {
+        const Entry&   e    = table[mul_hi64(key, count)];
+        const uint64_t data = e.data;
+
+        if ((e.check ^ data) != key || Depth(data & 0xFF) != depth)
+            return false;
+
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(Key key, Depth depth, uint64_t nodes) {
+        Entry&         e    = table[mul_hi64(key, count)];
+        const uint64_t data = (nodes << 8) | uint64_t(depth);
+
+        e.data  = data;
+        e.check = key ^ data;
+    }
+
+   private:
+    size_t                count;
+    LargePagePtr<Entry[]> table;
+};
+
+// Utility to verify move generation. All the leaf nodes up to the
+// given depth (at least 2) are generated and counted, and the sum is returned.
+inline uint64_t perft(Position& pos, Depth depth, PerftTable& table) {
+
+    uint64_t nodes = 0;
+
+    if (table.enabled() && table.probe(pos.key(), depth, nodes))
+        return nodes;
+
+    StateInfo  st;
     const bool leaf = (depth == 2);
 
     for (const auto& m : MoveList<LEGAL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
-        else
-        {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
-        }
-        if (Root)
-            sync_cout << UCIEngine::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
+        pos.do_move(m, st);
+        nodes += leaf ? MoveList<LEGAL>(pos).size() : perft(pos, depth - 1, table);
+        pos.undo_move(m);
     }
+
+    if (table.enabled())
+        table.store(pos.key(), depth, nodes);
+
     return nodes;
 }
 
-inline uint64_t perft(const std::string& fen, Depth depth, bool isChess960) {
+// Runs a perft from the given position, splitting the root moves among the
+// threads of the pool. Each thread picks the next unclaimed root move, so that
+// the work stays balanced even when the subtrees differ a lot in size.
+inline uint64_t
+perft(const std::string& fen, Depth depth, bool isChess960, ThreadPool& threads, size_t hashMB) {
+
+    struct ThreadStats {
+        uint64_t  nodes   = 0;
+        TimePoint elapsed = 0;
+    };
+
     StateListPtr states(new std::deque<StateInfo>(1));
     Position     p;
     p.set(fen, isChess960, &states->back());
 
-    return perft<true>(p, depth);
+    const MoveList<LEGAL>    rootMoves(p);
+    const size_t             threadCount = threads.num_threads();
+    std::vector<uint64_t>    counts(rootMoves.size(), 1);
+    std::vector<ThreadStats> stats(threadCount);
+    std::atomic<size_t>      nextMove{0};
+    PerftTable               table(depth > 2 ? hashMB : 0);
+    const TimePoint          start = now();
+
+    if (depth > 1)
+    {
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.run_on_thread(i, [&, i]() {
+                StateListPtr threadStates(new std::deque<StateInfo>(2));
+                Position     pos;
+                pos.set(fen, isChess960, &threadStates->front());
+
+                for (size_t idx; (idx = nextMove.fetch_add(1)) < rootMoves.size();)
+                {
+                    const Move m = *(rootMoves.begin() + idx);
+
+                    pos.do_move(m, threadStates->back());
+                    counts[idx] = depth == 2 ? MoveList<LEGAL>(pos).size()
+                                             : perft(pos, depth - 1, table);
+                    pos.undo_move(m);
+
+                    stats[i].nodes += counts[idx];
+                }
+
+                stats[i].elapsed = now() - start;
+            });
+
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.wait_on_thread(i);
+    }
+
+    uint64_t nodes = 0;
+
+    for (size_t idx = 0; idx < rootMoves.size(); ++idx)
+    {
+        nodes += counts[idx];
+        sync_cout << UCIEngine::move(*(rootMoves.begin() + idx), p.is_chess960()) << ": "
+                  << counts[idx] << sync_endl;
+    }
+
+    const TimePoint elapsed = std::max(now() - start, TimePoint(1));
+
+    if (depth > 1 && threadCount > 1)
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            const TimePoint threadElapsed = std::max(stats[i].elapsed, TimePoint(1));
+            sync_cout << "info string Perft thread " << i << ": " << stats[i].nodes
+                      << " nodes, " << stats[i].nodes * 1000 / threadElapsed << " nps" << sync_endl;
+        }
+
+    sync_cout << "info string Perft: " << elapsed << " ms, " << nodes * 1000 / elapsed
+              << " nps" << sync_endl;
+
+    return nodes;
 }
 }
 
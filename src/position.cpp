@@ -34,7 +34,6 @@
 #include "bitboard.h"
 #include "misc.h"
 #include "movegen.h"
-#include "nnue/nnue_common.h"
 #include "syzygy/tbprobe.h"
 #include "tt.h"
 #include "uci.h"
@@ -43,22 +42,54 @@ using std::string;
 
 namespace Stockfish {
 
-namespace Zobrist {
-
-Key psq[PIECE_NB][SQUARE_NB];
-Key enpassant[FILE_NB];
-Key castling[CASTLING_RIGHT_NB];
-Key side, noPawns;
-}
-
 namespace {
 
 constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
 
 constexpr Piece Pieces[] = {W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
                             B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING};
+
+struct ZobristKeys {
+    Key psq[PIECE_NB][SQUARE_NB];
+    Key enpassant[FILE_NB];
+    Key castling[CASTLING_RIGHT_NB];
+    Key side, noPawns;
+};
+
+// The hash keys, generated at compile time from a fixed seed
+constexpr ZobristKeys Keys = []() {
+    ZobristKeys k{};
+    PRNG        rng(1070372);
+
+    for (Piece pc : Pieces)
+        for (int s = SQ_A1; s <= SQ_H8; ++s)
+            k.psq[pc][s] = rng.rand<Key>();
+    // pawns on these squares will promote
+    for (File f = FILE_A; f <= FILE_H; f = File(f + 1))
+        k.psq[W_PAWN][make_square(f, RANK_8)] = k.psq[B_PAWN][make_square(f, RANK_1)] = 0;
+
+    for (File f = FILE_A; f <= FILE_H; f = File(f + 1))
+        k.enpassant[f] = rng.rand<Key>();
+
+    for (int cr = NO_CASTLING; cr <= ANY_CASTLING; ++cr)
+        k.castling[cr] = rng.rand<Key>();
+
+    k.side    = rng.rand<Key>();
+    k.noPawns = rng.rand<Key>();
+
+    return k;
+}();
 }  // namespace
 
+namespace Zobrist {
+
+constexpr auto& psq       = Keys.psq;
+constexpr auto& enpassant = Keys.enpassant;
+constexpr auto& castling  = Keys.castling;
+constexpr Key   side      = Keys.side;
+constexpr Key   noPawns   = Keys.noPawns;
+}
+
 
 // Returns an ASCII representation of the position
 std::ostream& operator<<(std::ostream& os, const Position& pos) {
@@ -83,7 +114,6 @@ std::ostream& operator<<(std::ostream& os, const Position& pos) {
     if (int(Tablebases::MaxCardinality) >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         StateInfo st;
-        ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
         Position p;
         p.set(pos.fen(), pos.is_chess960(), &st);
@@ -104,50 +134,41 @@ std::ostream& operator<<(std::ostream& os, const Position& pos) {
 // http://web.archive.org/web/20201107002606/https://marcelk.net/2013-04-06/paper/upcoming-rep-v2.pdf
 
 // First and second hash functions for indexing the cuckoo tables
-inline int H1(Key h) { return h & 0x1fff; }
-inline int H2(Key h) { return (h >> 16) & 0x1fff; }
+constexpr int H1(Key h) { return h & 0x1fff; }
+constexpr int H2(Key h) { return (h >> 16) & 0x1fff; }
 
 // Cuckoo tables with Zobrist hashes of valid reversible moves, and the moves themselves
-std::array<Key, 8192>  cuckoo;
-std::array<Move, 8192> cuckooMove;
+struct CuckooTables {
+    std::array<Key, 8192>  keys;
+    std::array<Move, 8192> moves;
+};
 
-// Initializes at startup the various arrays used to compute hash keys
-void Position::init() {
+// Fills the cuckoo tables at compile time. The empty slots hold Move::none().
+constexpr CuckooTables Cuckoo = []() {
+    CuckooTables t{};
+    Bitboard     attacks[PIECE_TYPE_NB][SQUARE_NB]{};
 
-    PRNG rng(1070372);
+    for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN, KING})
+        for (int s = SQ_A1; s <= SQ_H8; ++s)
+            attacks[pt][s] = slow_attacks_bb(pt, Square(s));
 
-    for (Piece pc : Pieces)
-        for (Square s = SQ_A1; s <= SQ_H8; ++s)
-            Zobrist::psq[pc][s] = rng.rand<Key>();
-    // pawns on these squares will promote
-    std::fill_n(Zobrist::psq[W_PAWN] + SQ_A8, 8, 0);
-    std::fill_n(Zobrist::psq[B_PAWN], 8, 0);
-
-    for (File f = FILE_A; f <= FILE_H; ++f)
-        Zobrist::enpassant[f] = rng.rand<Key>();
-
-    for (int cr = NO_CASTLING; cr <= ANY_CASTLING; ++cr)
-        Zobrist::castling[cr] = rng.rand<Key>();
-
-    Zobrist::side    = rng.rand<Key>();
-    Zobrist::noPawns = rng.rand<Key>();
-
-    // Prepare the cuckoo tables
-    cuckoo.fill(0);
-    cuckooMove.fill(Move::none());
     [[maybe_unused]] int count = 0;
     for (Piece pc : Pieces)
-        for (Square s1 = SQ_A1; s1 <= SQ_H8; ++s1)
-            for (Square s2 = Square(s1 + 1); s2 <= SQ_H8; ++s2)
-                if ((type_of(pc) != PAWN) && (attacks_bb(type_of(pc), s1, 0) & s2))
+        for (int s1 = SQ_A1; s1 <= SQ_H8; ++s1)
+            for (int s2 = s1 + 1; s2 <= SQ_H8; ++s2)
+                if ((type_of(pc) != PAWN) && (attacks[type_of(pc)][s1] & square_bb(Square(s2))))
                 {
-                    Move move = Move(s1, s2);
+                    Move move = Move(Square(s1), Square(s2));
                     Key  key  = Zobrist::psq[pc][s1] ^ Zobrist::psq[pc][s2] ^ Zobrist::side;
                     int  i    = H1(key);
                     while (true)
                     {
-                        std::swap(cuckoo[i], key);
-                        std::swap(cuckooMove[i], move);
+                        const Key  k = t.keys[i];
+                        const Move m = t.moves[i];
+                        t.keys[i]    = key;
+                        t.moves[i]   = move;
+                        key          = k;
+                        move         = m;
                         if (move == Move::none())  // Arrived at empty slot?
                             break;
                         i = (i == H1(key)) ? H2(key) : H1(key);  // Push victim to alternative slot
@@ -155,7 +176,12 @@ void Position::init() {
                     count++;
                 }
     assert(count == 3668);
-}
+
+    return t;
+}();
+
+constexpr const auto& cuckoo     = Cuckoo.keys;
+constexpr const auto& cuckooMove = Cuckoo.moves;
 
 
 // Initializes the position object with the given FEN string.
@@ -684,11 +710,12 @@ bool Position::gives_check(Move m) const {
 // to a StateInfo object. The move is assumed to be legal. Pseudo-legal
 // moves should be filtered out before this function is called.
 // If a pointer to the TT table is passed, the entry for the new position
-// will be prefetched
-void Position::do_move(Move                      m,
-                       StateInfo&                newSt,
-                       bool                      givesCheck,
-                       const TranspositionTable* tt = nullptr) {
+// will be prefetched. Returns the pieces changed by the move, needed by NNUE
+// to update the accumulators incrementally.
+DirtyPiece Position::do_move(Move                      m,
+                             StateInfo&                newSt,
+                             bool                      givesCheck,
+                             const TranspositionTable* tt = nullptr) {
 
     assert(m.is_ok());
     assert(&newSt != st);
@@ -709,11 +736,7 @@ void Position::do_move(Move                      m,
     ++st->rule50;
     ++st->pliesFromNull;
 
-    // Used by NNUE
-    st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
-      st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
-
-    auto& dp     = st->dirtyPiece;
+    DirtyPiece dp;
     dp.dirty_num = 1;
 
     Color  us       = sideToMove;
@@ -733,7 +756,7 @@ void Position::do_move(Move                      m,
         assert(captured == make_piece(us, ROOK));
 
         Square rfrom, rto;
-        do_castling<true>(us, from, to, rfrom, rto);
+        do_castling<true>(us, from, to, rfrom, rto, &dp);
 
         k ^= Zobrist::psq[captured][rfrom] ^ Zobrist::psq[captured][rto];
         st->nonPawnKey[us] ^= Zobrist::psq[captured][rfrom] ^ Zobrist::psq[captured][rto];
@@ -906,6 +929,8 @@ void Position::do_move(Move                      m,
     }
 
     assert(pos_is_ok());
+
+    return dp;
 }
 
 
@@ -939,7 +964,7 @@ void Position::undo_move(Move m) {
     if (m.type_of() == CASTLING)
     {
         Square rfrom, rto;
-        do_castling<false>(us, from, to, rfrom, rto);
+        do_castling<false>(us, from, to, rfrom, rto, nullptr);
     }
     else
     {
@@ -975,7 +1000,8 @@ void Position::undo_move(Move m) {
 // Helper used to do/undo a castling move. This is a bit
 // tricky in Chess960 where from/to squares can overlap.
 template<bool Do>
-void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Square& rto) {
+void Position::do_castling(
+  Color us, Square from, Square& to, Square& rfrom, Square& rto, DirtyPiece* const dp) {
 
     bool kingSide = to > from;
     rfrom         = to;  // Castling is encoded as "king captures friendly rook"
@@ -984,14 +1010,14 @@ void Position::do_castling(Color us, Square from, Square& to, Square& rfrom, Squ
 
     if (Do)
     {
-        auto& dp     = st->dirtyPiece;
-        dp.piece[0]  = make_piece(us, KING);
-        dp.from[0]   = from;
-        dp.to[0]     = to;
-        dp.piece[1]  = make_piece(us, ROOK);
-        dp.from[1]   = rfrom;
-        dp.to[1]     = rto;
-        dp.dirty_num = 2;
+        assert(dp);
+        dp->piece[0]  = make_piece(us, KING);
+        dp->from[0]   = from;
+        dp->to[0]     = to;
+        dp->piece[1]  = make_piece(us, ROOK);
+        dp->from[1]   = rfrom;
+        dp->to[1]     = rto;
+        dp->dirty_num = 2;
     }
 
     // Remove both pieces first since squares could overlap in Chess960
@@ -1011,7 +1037,7 @@ void Position::do_null_move(StateInfo& newSt, const TranspositionTable& tt) {
     assert(!checkers());
     assert(&newSt != st);
 
-    std::memcpy(&newSt, st, offsetof(StateInfo, accumulatorBig));
+    std::memcpy(&newSt, st, sizeof(StateInfo));
 
     newSt.previous = st;
     st->next       = &newSt;
@@ -1026,11 +1052,6 @@ void Position::do_null_move(StateInfo& newSt, const TranspositionTable& tt) {
     st->key ^= Zobrist::side;
     prefetch(tt.first_entry(key()));
 
-    st->dirtyPiece.dirty_num               = 0;
-    st->dirtyPiece.piece[0]                = NO_PIECE;  // Avoid checks in UpdateAccumulator()
-    st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
-      st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
-
     st->pliesFromNull = 0;
 
     sideToMove = ~sideToMove;
@@ -1158,6 +1179,81 @@ bool Position::see_ge(Move m, int threshold) const {
     return bool(res);
 }
 
+// Returns the SEE value of a move: the material balance after the best sequence
+// of captures on the destination square, where each side may stop capturing.
+// The recaptures are picked as in see_ge(), so see(m, ...) >= threshold if and
+// only if see_ge(m, threshold). The caller passes attackers_to(m.to_sq()), which
+// can be shared by all the moves to the same square.
+int Position::see(Move m, Bitboard attackers) const {
+
+    assert(m.is_ok());
+    assert(attackers == attackers_to(m.to_sq()));
+
+    if (m.type_of() != NORMAL)
+        return VALUE_ZERO;
+
+    Square   from     = m.from_sq(), to = m.to_sq();
+    Bitboard occupied = pieces() ^ from ^ to;
+    Color    stm      = sideToMove;
+    int      gain[32], d = 0;
+    int      victim = PieceValue[piece_on(from)];
+    Bitboard stmAttackers, bb;
+
+    // Add the X-ray attackers behind the moving piece
+    if (attacks_bb<BISHOP>(to) & from)
+        attackers |= attacks_bb<BISHOP>(to, occupied) & pieces(BISHOP, QUEEN);
+    else if (attacks_bb<ROOK>(to) & from)
+        attackers |= attacks_bb<ROOK>(to, occupied) & pieces(ROOK, QUEEN);
+
+    gain[0] = PieceValue[piece_on(to)];
+
+    while (true)
+    {
+        stm = ~stm;
+        attackers &= occupied;
+
+        if (!(stmAttackers = attackers & pieces(stm)))
+            break;
+
+        if (pinners(~stm) & occupied)
+        {
+            stmAttackers &= ~blockers_for_king(stm);
+
+            if (!stmAttackers)
+                break;
+        }
+
+        // Locate the least valuable attacker
+        PieceType pt = PAWN;
+        while (!(bb = stmAttackers & pieces(pt)))
+            ++pt;
+
+        // The king can only capture if the opponent has no attackers left
+        if (pt == KING && (attackers & ~pieces(stm)))
+            break;
+
+        // Speculative gain of the capture, if the opponent stands pat afterwards
+        ++d;
+        gain[d] = victim - gain[d - 1];
+        victim  = PieceValue[pt];
+
+        // Remove it, and add any X-ray attackers behind it
+        occupied ^= least_significant_square_bb(bb);
+
+        if (pt == PAWN || pt == BISHOP || pt == QUEEN)
+            attackers |= attacks_bb<BISHOP>(to, occupied) & pieces(BISHOP, QUEEN);
+
+        if (pt == ROOK || pt == QUEEN)
+            attackers |= attacks_bb<ROOK>(to, occupied) & pieces(ROOK, QUEEN);
+    }
+
+    // Each side picks the better of standing pat and capturing
+    while (d--)
+        gain[d] = std::min(gain[d], -gain[d + 1]);
+
+    return gain[0];
+}
+
 // Tests whether the position is drawn by 50-move rule
 // or by repetition. It does not detect stalemates.
 bool Position::is_draw(int ply) const {
@@ -26,8 +26,6 @@
 #include <string>
 
 #include "bitboard.h"
-#include "nnue/nnue_accumulator.h"
-#include "nnue/nnue_architecture.h"
 #include "types.h"
 
 namespace Stockfish {
@@ -61,11 +59,6 @@ struct StateInfo {
     Bitboard   checkSquares[PIECE_TYPE_NB];
     Piece      capturedPiece;
     int        repetition;
-
-    // Used by NNUE
-    Eval::NNUE::Accumulator<Eval::NNUE::TransformedFeatureDimensionsBig>   accumulatorBig;
-    Eval::NNUE::Accumulator<Eval::NNUE::TransformedFeatureDimensionsSmall> accumulatorSmall;
-    DirtyPiece                                                             dirtyPiece;
 };
 
 
@@ -82,8 +75,6 @@ using StateListPtr = std::unique_ptr<std::deque<StateInfo>>;
 // traversing the search tree.
 class Position {
    public:
-    static void init();
-
     Position()                           = default;
     Position(const Position&)            = delete;
     Position& operator=(const Position&) = delete;
@@ -140,14 +131,15 @@ class Position {
     Piece captured_piece() const;
 
     // Doing and undoing moves
-    void do_move(Move m, StateInfo& newSt, const TranspositionTable* tt);
-    void do_move(Move m, StateInfo& newSt, bool givesCheck, const TranspositionTable* tt);
+    DirtyPiece do_move(Move m, StateInfo& newSt, const TranspositionTable* tt);
+    DirtyPiece do_move(Move m, StateInfo& newSt, bool givesCheck, const TranspositionTable* tt);
     void undo_move(Move m);
     void do_null_move(StateInfo& newSt, const TranspositionTable& tt);
     void undo_null_move();
 
     // Static Exchange Evaluation
     bool see_ge(Move m, int threshold = 0) const;
+    int  see(Move m, Bitboard attackers) const;
 
     // Accessing hash keys
     Key key() const;
@@ -187,7 +179,7 @@ class Position {
     // Other helpers
     void move_piece(Square from, Square to);
     template<bool Do>
-    void do_castling(Color us, Square from, Square& to, Square& rfrom, Square& rto);
+    void do_castling(Color us, Square from, Square& to, Square& rfrom, Square& rto, DirtyPiece* dp);
     template<bool AfterMove>
     Key adjust_key50(Key k) const;
 
@@ -365,8 +357,9 @@ inline void Position::move_piece(Square from, Square to) {
     board[to]   = pc;
 }
 
-inline void Position::do_move(Move m, StateInfo& newSt, const TranspositionTable* tt = nullptr) {
-    do_move(m, newSt, gives_check(m), tt);
+inline DirtyPiece
+Position::do_move(Move m, StateInfo& newSt, const TranspositionTable* tt = nullptr) {
+    return do_move(m, newSt, gives_check(m), tt);
 }
 
 inline StateInfo* Position::state() const { return st; }
@@ -0,0 +1,209 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resultcache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "misc.h"
+
+namespace Stockfish {
+
+namespace {
+
+constexpr uint64_t ResultCacheKey = 0x5346524553554c54ULL;  // "SFRESULT"
+
+// The longest PV kept, so that an entry is two cache lines
+constexpr size_t MaxPvLength = 55;
+
+}
+
+// An entry is guarded by a sequence lock, as it is too big to be written racily
+// like a TT entry: its version is odd while a writer fills it, and a reader
+// keeps what it read only if the version was even and didn't change meanwhile.
+// A writer that finds the entry being written by another process gives up.
+struct ResultCacheEntry {
+    std::atomic<uint32_t> version;
+    uint8_t               depth8;  // 0 for an empty entry
+    uint8_t               bound8;
+    int16_t               value16;
+    Key                   key;
+    uint16_t              pvLength;
+    uint16_t              pv[MaxPvLength];
+};
+
+static_assert(sizeof(ResultCacheEntry) == 128, "Unexpected ResultCacheEntry size");
+
+struct ResultCache::Bucket {
+    static constexpr int Size = 4;
+
+    alignas(64) ResultCacheEntry entry[Size];
+};
+
+bool ResultCache::open(const std::string& path, size_t sizeMB) {
+
+    close();
+
+    if (path.empty())
+        return false;
+
+    const size_t   count = sizeMB * 1024 * 1024 / sizeof(Bucket);
+    const uint64_t key   = ResultCacheKey ^ (uint64_t(sizeof(Bucket)) << 48) ^ count;
+
+    // The file is created zeroed, which are empty entries
+    memory = map_shared_memory(path, count * sizeof(Bucket), key, [](void*) { return true; }, true);
+
+    if (!memory)
+        return false;
+
+    buckets     = static_cast<Bucket*>(memory.get());
+    bucketCount = count;
+    filePath    = path;
+    exit        = false;
+    thread      = std::thread(&ResultCache::run, this);
+    return true;
+}
+
+// Writes the queued results before unmapping the file
+void ResultCache::close() {
+
+    if (thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            exit = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    memory.reset();
+    buckets     = nullptr;
+    bucketCount = 0;
+    filePath.clear();
+}
+
+std::optional<CachedResult> ResultCache::probe(Key key) const {
+
+    if (!buckets)
+        return std::nullopt;
+
+    const Bucket& b = buckets[mul_hi64(key, bucketCount)];
+
+    for (const ResultCacheEntry& e : b.entry)
+    {
+        uint32_t v = e.version.load(std::memory_order_acquire);
+
+        if ((v & 1) || e.key != key || !e.depth8)
+            continue;
+
+        CachedResult r{e.depth8, e.value16, Bound(e.bound8), {}};
+        size_t       length = std::min<size_t>(e.pvLength, MaxPvLength);
+
+        for (size_t i = 0; i < length; ++i)
+            r.pv.push_back(Move(e.pv[i]));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (e.version.load(std::memory_order_relaxed) == v && e.key == key && !r.pv.empty())
+            return r;
+    }
+
+    return std::nullopt;
+}
+
+void ResultCache::store(Key key, CachedResult&& result) {
+
+    if (!buckets || result.pv.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        queue.emplace_back(key, std::move(result));
+    }
+    cv.notify_one();
+}
+
+void ResultCache::run() {
+
+    std::deque<std::pair<Key, CachedResult>> results;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return exit || !queue.empty(); });
+
+            if (queue.empty())
+                break;
+
+            std::swap(results, queue);
+        }
+
+        for (const auto& [key, result] : results)
+            write(key, result);
+        results.clear();
+    }
+}
+
+// A result replaces the one of the same position unless it is shallower, else
+// the shallowest entry of the bucket.
+void ResultCache::write(Key key, const CachedResult& result) {
+
+    Bucket&           b       = buckets[mul_hi64(key, bucketCount)];
+    ResultCacheEntry* replace = &b.entry[0];
+
+    for (ResultCacheEntry& e : b.entry)
+    {
+        if (e.key == key && e.depth8)
+        {
+            if (e.depth8 > result.depth)
+                return;
+
+            replace = &e;
+            break;
+        }
+
+        if (e.depth8 < replace->depth8)
+            replace = &e;
+    }
+
+    uint32_t v = replace->version.load(std::memory_order_relaxed);
+
+    if ((v & 1) || !replace->version.compare_exchange_strong(v, v + 1, std::memory_order_acquire))
+        return;
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const size_t length = std::min(result.pv.size(), MaxPvLength);
+
+    replace->depth8   = uint8_t(std::clamp(result.depth, 1, 255));
+    replace->bound8   = uint8_t(result.bound);
+    replace->value16  = int16_t(result.score);
+    replace->key      = key;
+    replace->pvLength = uint16_t(length);
+
+    for (size_t i = 0; i < length; ++i)
+        replace->pv[i] = result.pv[i].raw();
+
+    replace->version.store(v + 2, std::memory_order_release);
+}
+
+}  // namespace Stockfish
@@ -0,0 +1,96 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULTCACHE_H_INCLUDED
+#define RESULTCACHE_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "memory.h"
+#include "types.h"
+
+namespace Stockfish {
+
+// The result of a completed search, from the side to move of its root
+struct CachedResult {
+    Depth             depth;
+    Value             score;
+    Bound             bound;
+    std::vector<Move> pv;
+};
+
+// A table of the results of completed searches kept in a file, so that it
+// persists across runs and is shared by the processes mapping the same file.
+// Like the TT, it is keyed by Position::key(), so blind to the history of the
+// position: the search keeps it out of roots with repetitions or a high 50-move
+// counter. A search whose depth limit a result meets is answered from it at
+// once, otherwise the result orders the root moves and seeds the TT along its PV
+// (see Search::Worker::use_cached_result()).
+class ResultCache {
+
+   public:
+    ResultCache() = default;
+    ~ResultCache() { close(); }
+
+    ResultCache(const ResultCache&)            = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Maps sizeMB megabytes of the file at path, which is created if needed. A
+    // file of another size is replaced by an empty one. Returns false if the file
+    // can't be used.
+    bool open(const std::string& path, size_t sizeMB);
+    void close();
+
+    bool               is_open() const { return buckets != nullptr; }
+    const std::string& path() const { return filePath; }
+
+    std::optional<CachedResult> probe(Key key) const;
+
+    // Results are written by a thread of the cache, so that the search never
+    // waits for the pages of the file to be read in.
+    void store(Key key, CachedResult&& result);
+
+   private:
+    struct Bucket;
+
+    void run();
+    void write(Key key, const CachedResult& result);
+
+    SharedMemoryPtr memory;
+    Bucket*         buckets     = nullptr;
+    size_t          bucketCount = 0;
+    std::string     filePath;
+
+    std::mutex                               mutex;
+    std::condition_variable                  cv;
+    std::deque<std::pair<Key, CachedResult>> queue;
+    bool                                     exit = false;
+    std::thread                              thread;
+};
+
+}  // namespace Stockfish
+
+#endif  // #ifndef RESULTCACHE_H_INCLUDED
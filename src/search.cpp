@@ -33,6 +33,7 @@
 #include <string>
 #include <utility>
 
+#include "cluster.h"
 #include "evaluate.h"
 #include "history.h"
 #include "misc.h"
@@ -43,6 +44,7 @@
 #include "nnue/nnue_common.h"
 #include "nnue/nnue_misc.h"
 #include "position.h"
+#include "resultcache.h"
 #include "syzygy/tbprobe.h"
 #include "thread.h"
 #include "timeman.h"
@@ -79,17 +81,57 @@ Value futility_margin(Depth d, bool noTtCutNode, bool improving, bool oppWorseni
     return futilityMult * d - improvingDeduction - worseningDeduction;
 }
 
+// Adds the hardware events of the calling thread, from its construction to its
+// destruction, to the totals of the thread pool when it counts them.
+class ScopedHardwareCount {
+   public:
+    explicit ScopedHardwareCount(ThreadPool& tp) :
+        threads(tp) {
+        if (threads.countPerfEvents)
+            perfCounters = std::make_unique<PerfCounters>();
+    }
+
+    ~ScopedHardwareCount() {
+        if (perfCounters)
+        {
+            const PerfCounters::Values values = perfCounters->read();
+            for (size_t e = 0; e < values.size(); ++e)
+                threads.perfEvents[e] += values[e].value_or(0);
+        }
+    }
+
+   private:
+    ThreadPool&                   threads;
+    std::unique_ptr<PerfCounters> perfCounters;
+};
+
+// The least depth at which the threads tell each other the moves they search,
+// see SearchingTable. Shallower subtrees are cheaper to search twice than to
+// keep track of.
+constexpr Depth DeferDepth = 6;
+
+// A result of the ResultCache is keyed by the position alone, so it is stored
+// and used only for roots whose search hardly depends on the moves before: no
+// position repeated since the last irreversible move, and a 50-move counter too
+// low to change the evaluation noticeably or to bring a draw in sight.
+constexpr int MaxCachedRule50 = 8;
+
+bool cacheable_root(const Position& pos) {
+    return pos.rule50_count() <= MaxCachedRule50 && !pos.has_repeated();
+}
+
 constexpr int futility_move_count(bool improving, Depth depth) {
     return (3 + depth * depth) / (2 - improving);
 }
 
 int correction_value(const Worker& w, const Position& pos, const Stack* const ss) {
+    const auto& h     = w.histories;
     const Color us    = pos.side_to_move();
     const auto  m     = (ss - 1)->currentMove;
-    const auto  pcv   = w.pawnCorrectionHistory[pawn_structure_index<Correction>(pos)][us];
-    const auto  micv  = w.minorPieceCorrectionHistory[minor_piece_index(pos)][us];
-    const auto  wnpcv = w.nonPawnCorrectionHistory[WHITE][non_pawn_index<WHITE>(pos)][us];
-    const auto  bnpcv = w.nonPawnCorrectionHistory[BLACK][non_pawn_index<BLACK>(pos)][us];
+    const auto  pcv   = h.pawnCorrectionHistory[pawn_structure_index<Correction>(pos)][us];
+    const auto  micv  = h.minorPieceCorrectionHistory[minor_piece_index(pos)][us];
+    const auto  wnpcv = h.nonPawnCorrectionHistory[WHITE][non_pawn_index<WHITE>(pos)][us];
+    const auto  bnpcv = h.nonPawnCorrectionHistory[BLACK][non_pawn_index<BLACK>(pos)][us];
     const auto  cntcv =
       m.is_ok() ? (*(ss - 2)->continuationCorrectionHistory)[pos.piece_on(m.to_sq())][m.to_sq()]
                  : 0;
@@ -107,17 +149,17 @@ void update_correction_history(const Position& pos,
                                Stack* const    ss,
                                Search::Worker& workerThread,
                                const int       bonus) {
+    auto&       h  = workerThread.histories;
     const Move  m  = (ss - 1)->currentMove;
     const Color us = pos.side_to_move();
 
     static constexpr int nonPawnWeight = 165;
 
-    workerThread.pawnCorrectionHistory[pawn_structure_index<Correction>(pos)][us]
-      << bonus * 109 / 128;
-    workerThread.minorPieceCorrectionHistory[minor_piece_index(pos)][us] << bonus * 141 / 128;
-    workerThread.nonPawnCorrectionHistory[WHITE][non_pawn_index<WHITE>(pos)][us]
+    h.pawnCorrectionHistory[pawn_structure_index<Correction>(pos)][us] << bonus * 109 / 128;
+    h.minorPieceCorrectionHistory[minor_piece_index(pos)][us] << bonus * 141 / 128;
+    h.nonPawnCorrectionHistory[WHITE][non_pawn_index<WHITE>(pos)][us]
       << bonus * nonPawnWeight / 128;
-    workerThread.nonPawnCorrectionHistory[BLACK][non_pawn_index<BLACK>(pos)][us]
+    h.nonPawnCorrectionHistory[BLACK][non_pawn_index<BLACK>(pos)][us]
       << bonus * nonPawnWeight / 128;
 
     if (m.is_ok())
@@ -157,6 +199,10 @@ Search::Worker::Worker(SharedState&                    sharedState,
                        size_t                          threadId,
                        NumaReplicatedAccessToken       token) :
     // Unpack the SharedState struct into member variables
+    ownHistories(sharedState.options["SharedHistories"]
+                   ? nullptr
+                   : make_unique_large_page<SharedHistories>()),
+    histories(ownHistories ? *ownHistories : sharedState.histories[token].get()),
     threadIdx(threadId),
     numaAccessToken(token),
     manager(std::move(sm)),
@@ -164,7 +210,9 @@ Search::Worker::Worker(SharedState&                    sharedState,
     threads(sharedState.threads),
     tt(sharedState.tt),
     networks(sharedState.networks),
-    refreshTable(networks[token]) {
+    refreshTable(networks[token], size_t(int(options["RefreshCacheSize"]))),
+    evalCache(size_t(int(options["EvalCacheSize"]))) {
+    tbCache.numaNode = token.get_numa_index();
     clear();
 }
 
@@ -174,18 +222,76 @@ void Search::Worker::ensure_network_replicated() {
     (void) (networks[numaAccessToken]);
 }
 
+Search::SearchStats& Search::SearchStats::operator+=(const SearchStats& s) {
+    nodes += s.nodes;
+    qsearchNodes += s.qsearchNodes;
+    ttProbes += s.ttProbes;
+    ttHits += s.ttHits;
+    cutoffs += s.cutoffs;
+    firstMoveCutoffs += s.firstMoveCutoffs;
+    deferredMoves += s.deferredMoves;
+    nnueUpdates += s.nnueUpdates;
+    nnueRefreshes += s.nnueRefreshes;
+    evalCacheProbes += s.evalCacheProbes;
+    evalCacheHits += s.evalCacheHits;
+    tbProbes += s.tbProbes;
+    tbHits += s.tbHits;
+    tbDeferred += s.tbDeferred;
+    cpuTime += s.cpuTime;
+    return *this;
+}
+
+// Gathers the counters kept by the worker and by its accumulator stack
+Search::SearchStats Search::Worker::search_stats() const {
+
+    SearchStats s = stats;
+
+    s.nodes         = nodes.load(std::memory_order_relaxed);
+    s.ttProbes      = ttProbes.load(std::memory_order_relaxed);
+    s.ttHits        = ttHits.load(std::memory_order_relaxed);
+    s.tbHits        = tbHits.load(std::memory_order_relaxed);
+    s.tbProbes      = tbCache.stats.probes;
+    s.tbDeferred    = tbCache.stats.deferred;
+    s.nnueUpdates   = accumulatorStack.incrementalUpdates;
+    s.nnueRefreshes = accumulatorStack.refreshes;
+    return s;
+}
+
 void Search::Worker::start_searching() {
 
+    const uint64_t cpuTimeStart = thread_cpu_time();
+
+    searchStart       = std::chrono::steady_clock::now();
+    prefetchHistories = bool(options["HistoryPrefetch"]);
+    deferSearched     = bool(options["DeferSearchedMoves"]) && threads.size() > 1;
+    shareEntries      = threads.cluster && threads.cluster->size();
+    sharedEntries.clear();
+
+    // With a nodes limit, the nodes not yet published stay within 0.1% of it
+    maxNodesBatch =
+      limits.nodes ? std::clamp<uint64_t>(limits.nodes / 1024 / threads.size(), 1, 1024) : 1024;
+
+    ScopedHardwareCount hardwareCount(threads);
+
     // Non-main threads go directly to iterative_deepening()
     if (!is_mainthread())
     {
         iterative_deepening();
+        publish_nodes();
+        stats.cpuTime = thread_cpu_time() - cpuTimeStart;
         return;
     }
 
     main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options,
                             main_manager()->originalTimeAdjust);
-    tt.new_search();
+    main_manager()->nextPvTime = 0;
+    main_manager()->pvSkipped  = false;
+
+    if (!threads.sharesGeneration)
+        tt.new_search();
+
+    // A result of an earlier search of the position may answer this one
+    const bool answered = threads.resultCache && !rootMoves.empty() && use_cached_result();
 
     if (rootMoves.empty())
     {
@@ -193,10 +299,11 @@ void Search::Worker::start_searching() {
         main_manager()->updates.onUpdateNoMoves(
           {0, {rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW, rootPos}});
     }
-    else
+    else if (!answered)
     {
         threads.start_searching();  // start non-main threads
         iterative_deepening();      // main thread start searching
+        publish_nodes();
     }
 
     // When we reach the maximum depth, we can arrive here without a raise of
@@ -209,11 +316,15 @@ void Search::Worker::start_searching() {
 
     // Stop the threads if not already stopped (also raise the stop if
     // "ponderhit" just reset threads.ponder)
-    threads.stop = true;
+    threads.stop     = true;
+    threads.stopTime = std::chrono::steady_clock::now();
 
-    // Wait until all threads have finished
+    // Wait until all threads have finished, and the other machines of the cluster
     threads.wait_for_search_finished();
 
+    if (threads.cluster)
+        threads.cluster->stop_search();
+
     // When playing in 'nodes as time' mode, subtract the searched nodes from
     // the available ones before exiting.
     if (limits.npmsec)
@@ -224,6 +335,9 @@ void Search::Worker::start_searching() {
     Skill   skill =
       Skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
 
+    // The result of another machine of the cluster may replace the one of this thread
+    const std::vector<Move> mainPV = rootMoves[0].pv;
+
     if (int(options["MultiPV"]) == 1 && !limits.depth && !limits.mate && !skill.enabled()
         && rootMoves[0].pv[0] != Move::none())
         bestThread = threads.get_best_thread()->worker.get();
@@ -231,9 +345,14 @@ void Search::Worker::start_searching() {
     main_manager()->bestPreviousScore        = bestThread->rootMoves[0].score;
     main_manager()->bestPreviousAverageScore = bestThread->rootMoves[0].averageScore;
 
-    // Send again PV info if we have a new best thread
-    if (bestThread != this)
-        main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth);
+    // Send again PV info if we have a new best thread, or if the last one was
+    // held back by InfoInterval.
+    if (bestThread != this || rootMoves[0].pv != mainPV || main_manager()->pvSkipped)
+        main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth, true);
+
+    if (threads.cluster)
+        threads.cluster->send_result(bestThread->rootMoves[0].pv, bestThread->rootMoves[0].score,
+                                     bestThread->completedDepth, threads.nodes_searched());
 
     std::string ponder;
 
@@ -242,7 +361,104 @@ void Search::Worker::start_searching() {
         ponder = UCIEngine::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
 
     auto bestmove = UCIEngine::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
+
+    threads.bestmoveTime = std::chrono::steady_clock::now();
     main_manager()->updates.onBestmove(bestmove, ponder);
+
+    // Keep the result for the later searches of the position
+    const RootMove& best = bestThread->rootMoves[0];
+
+    if (threads.resultCache && !answered && bestThread->completedDepth > 0
+        && limits.searchmoves.empty() && !limits.mate && !skill.enabled()
+        && cacheable_root(rootPos))
+        threads.resultCache->store(rootPos.key(), {bestThread->completedDepth, best.uciScore,
+                                                   best.scoreLowerbound   ? BOUND_LOWER
+                                                   : best.scoreUpperbound ? BOUND_UPPER
+                                                                          : BOUND_EXACT,
+                                                   best.pv});
+
+    if (options["SearchStats"] != "off")
+    {
+        stats.cpuTime = thread_cpu_time() - cpuTimeStart;
+        main_manager()->updates.onStats(threads.search_stats());
+    }
+}
+
+// A result answers a depth-limited search for a single PV of at most its depth,
+// if its score is exact. Otherwise its best move is searched first and its PV is
+// put in the TT as the moves to search first down the line.
+bool Search::Worker::use_cached_result() {
+
+    Skill skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
+
+    if (!limits.searchmoves.empty() || limits.mate || skill.enabled() || !cacheable_root(rootPos))
+        return false;
+
+    auto result = threads.resultCache->probe(rootPos.key());
+
+    // The key of another position would rarely have a legal move first
+    if (!result || !std::count(rootMoves.begin(), rootMoves.end(), result->pv[0]))
+        return false;
+
+    // Keep the legal part of the PV, the result may come from another position
+    // with the same key or from a file written by another version.
+    StateInfo st[MAX_PLY];
+    size_t    length = 0;
+
+    for (; length < result->pv.size() && length < MAX_PLY; ++length)
+    {
+        Move m = result->pv[length];
+
+        if (!m.is_ok() || !rootPos.pseudo_legal(m) || !rootPos.legal(m))
+            break;
+
+        rootPos.do_move(m, st[length], &tt);
+    }
+
+    result->pv.resize(length);
+
+    // Seed the TT along the PV as the search of the result would have left it:
+    // the score from the side to move at each ply, with its bound flipped for
+    // the opponent, at the depth left. Deeper entries of the TT are kept.
+    for (size_t i = length; i-- > 0;)
+    {
+        rootPos.undo_move(result->pv[i]);
+
+        const Depth depth = result->depth - int(i);
+        const Value value = i % 2 ? -result->score : result->score;
+        const Bound bound = i % 2 && result->bound != BOUND_EXACT
+                            ? Bound(result->bound ^ BOUND_EXACT)
+                            : result->bound;
+
+        auto [ttHit, ttData, ttWriter] = tt.probe(rootPos.key());
+        if (depth > 0 && is_valid(result->score) && (!ttHit || ttData.depth < depth))
+            ttWriter.write(rootPos.key(), value_to_tt(value, int(i)), true, bound, depth,
+                           result->pv[i], VALUE_NONE, tt.generation());
+    }
+
+    auto first = [&](const RootMove& rm) { return rm == result->pv[0]; };
+
+    if (limits.depth && result->depth >= limits.depth && result->bound == BOUND_EXACT
+        && int(options["MultiPV"]) == 1 && !limits.infinite && !main_manager()->ponder)
+    {
+        Utility::move_to_front(rootMoves, first);
+
+        rootMoves[0].score = rootMoves[0].uciScore = result->score;
+        rootMoves[0].selDepth                      = result->depth;
+        rootMoves[0].pv                            = result->pv;
+
+        pvIdx     = 0;
+        rootDepth = completedDepth = result->depth;
+        main_manager()->pv(*this, threads, tt, completedDepth, true);
+        return true;
+    }
+
+    // With tablebases the root moves are sorted by rank, which has to be kept
+    if (std::find_if(rootMoves.begin(), rootMoves.end(), first)->tbRank == rootMoves[0].tbRank)
+        for (auto&& th : threads)
+            Utility::move_to_front(th->worker->rootMoves, first);
+
+    return false;
 }
 
 // Main iterative deepening loop. It calls search()
@@ -254,6 +470,10 @@ void Search::Worker::iterative_deepening() {
 
     Move pv[MAX_PLY + 1];
 
+    // The root position is shared by all iterations, so its accumulator has to be
+    // computed from scratch only once per search.
+    accumulatorStack.reset();
+
     Depth lastBestMoveDepth = 0;
     Value lastBestScore     = -VALUE_INFINITE;
     auto  lastBestPV        = std::vector{Move::none()};
@@ -274,7 +494,8 @@ void Search::Worker::iterative_deepening() {
     {
         (ss - i)->continuationHistory =
           &this->continuationHistory[0][0][NO_PIECE][0];  // Use as a sentinel
-        (ss - i)->continuationCorrectionHistory = &this->continuationCorrectionHistory[NO_PIECE][0];
+        (ss - i)->continuationCorrectionHistory =
+          &this->histories.continuationCorrectionHistory[NO_PIECE][0];
         (ss - i)->staticEval                    = VALUE_NONE;
         (ss - i)->reduction                     = 0;
     }
@@ -297,6 +518,7 @@ void Search::Worker::iterative_deepening() {
 
     size_t multiPV = size_t(options["MultiPV"]);
     Skill skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
+    bool  skillFast = bool(options["Skill Fast"]);
 
     // When playing with strength handicap enable MultiPV search that we will
     // use behind-the-scenes to retrieve a set of possible moves.
@@ -305,6 +527,11 @@ void Search::Worker::iterative_deepening() {
 
     multiPV = std::min(multiPV, rootMoves.size());
 
+    // With MultiPVGroups, the threads are split in groups which each search only
+    // some of the lines, see MultiPVLines
+    const size_t pvGroups = std::min({size_t(options["MultiPVGroups"]), threads.size(), multiPV});
+    const size_t pvGroup  = threadIdx % pvGroups;
+
     int searchAgainCounter = 0;
 
     lowPlyHistory.fill(95);
@@ -339,6 +566,10 @@ void Search::Worker::iterative_deepening() {
                         break;
             }
 
+            // A line of another group is searched only until that group has a result
+            const bool taken = pvIdx % pvGroups != pvGroup
+                            && threads.multiPVLines.take(pvIdx, rootMoves, pvLast);
+
             // Reset UCI info selDepth for each depth and each PV line
             selDepth = 0;
 
@@ -356,7 +587,7 @@ void Search::Worker::iterative_deepening() {
             // high/low, re-search with a bigger window until we don't fail
             // high/low anymore.
             int failedHighCnt = 0;
-            while (true)
+            while (!taken)
             {
                 // Adjust the effective depth searched, but ensure at least one
                 // effective increment for every four searchAgain steps (see issue #2717).
@@ -410,6 +641,9 @@ void Search::Worker::iterative_deepening() {
                 assert(alpha >= -VALUE_INFINITE && beta <= VALUE_INFINITE);
             }
 
+            if (pvGroups > 1 && !taken && !threads.stop)
+                threads.multiPVLines.publish(pvIdx, rootMoves[pvIdx], rootDepth);
+
             // Sort the PV lines searched so far and update the GUI
             std::stable_sort(rootMoves.begin() + pvFirst, rootMoves.begin() + pvIdx + 1);
 
@@ -460,10 +694,22 @@ void Search::Worker::iterative_deepening() {
                     && VALUE_MATE + rootMoves[0].score <= 2 * limits.mate)))
             threads.stop = true;
 
-        // If the skill level is enabled and time is up, pick a sub-optimal best move
+        // If the skill level is enabled and time is up, pick a sub-optimal best move.
+        // The deeper iterations can't change it, so with "Skill Fast" they are not
+        // searched, which makes the strength handicap much cheaper.
         if (skill.enabled() && skill.time_to_pick(rootDepth))
+        {
             skill.pick_best(rootMoves, multiPV);
 
+            if (skillFast && !limits.infinite)
+            {
+                if (mainThread->ponder)
+                    mainThread->stopOnPonderhit = true;
+                else
+                    threads.stop = true;
+            }
+        }
+
         // Use part of the gained time from a previous stable move for the current move
         for (auto&& th : threads)
         {
@@ -536,15 +782,20 @@ void Search::Worker::clear() {
     mainHistory.fill(65);
     lowPlyHistory.fill(107);
     captureHistory.fill(-655);
-    pawnHistory.fill(-1215);
-    pawnCorrectionHistory.fill(4);
-    minorPieceCorrectionHistory.fill(0);
-    nonPawnCorrectionHistory[WHITE].fill(0);
-    nonPawnCorrectionHistory[BLACK].fill(0);
 
-    for (auto& to : continuationCorrectionHistory)
-        for (auto& h : to)
-            h.fill(0);
+    // Shared histories are cleared once per NUMA node
+    if (ownHistories || firstOnNumaNode)
+    {
+        histories.pawnHistory.fill(-1215);
+        histories.pawnCorrectionHistory.fill(4);
+        histories.minorPieceCorrectionHistory.fill(0);
+        histories.nonPawnCorrectionHistory[WHITE].fill(0);
+        histories.nonPawnCorrectionHistory[BLACK].fill(0);
+
+        for (auto& to : histories.continuationCorrectionHistory)
+            for (auto& h : to)
+                h.fill(0);
+    }
 
     for (bool inCheck : {false, true})
         for (StatsType c : {NoCaptures, Captures})
@@ -556,6 +807,7 @@ void Search::Worker::clear() {
         reductions[i] = int(2937 / 128.0 * std::log(i));
 
     refreshTable.clear(networks[numaAccessToken]);
+    evalCache.clear();
 }
 
 
@@ -593,7 +845,6 @@ Value Search::Worker::search(
 
     Move      pv[MAX_PLY + 1];
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     Key   posKey;
     Move  move, excludedMove, bestMove;
@@ -656,6 +907,7 @@ Value Search::Worker::search(
     excludedMove                   = ss->excludedMove;
     posKey                         = pos.key();
     auto [ttHit, ttData, ttWriter] = tt.probe(posKey);
+    thisThread->count_tt_probe(ttHit);
     // Need further processing of the saved data
     ss->ttHit    = ttHit;
     ttData.move  = rootNode ? thisThread->rootMoves[thisThread->pvIdx].pv[0]
@@ -702,8 +954,12 @@ Value Search::Worker::search(
             && (piecesCount < tbConfig.cardinality || depth >= tbConfig.probeDepth)
             && pos.rule50_count() == 0 && !pos.can_castle(ANY_CASTLING))
         {
+            // Below this depth the search goes on without the result rather than
+            // waiting for the storage, see the "SyzygyAsyncThreads" option.
+            constexpr Depth AsyncProbeDepth = 10;
+
             TB::ProbeState err;
-            TB::WDLScore   wdl = Tablebases::probe_wdl(pos, &err);
+            TB::WDLScore   wdl = thisThread->tbCache.probe(pos, &err, depth < AsyncProbeDepth);
 
             // Force check of time on the next occasion
             if (is_mainthread())
@@ -712,6 +968,7 @@ Value Search::Worker::search(
             if (err != TB::ProbeState::FAIL)
             {
                 thisThread->tbHits.fetch_add(1, std::memory_order_relaxed);
+                thisThread->counters->tbHits.fetch_add(1, std::memory_order_relaxed);
 
                 int drawScore = tbConfig.useRule50 ? 1 : 0;
 
@@ -759,7 +1016,8 @@ Value Search::Worker::search(
     else if (excludedMove)
     {
         // Providing the hint that this node's accumulator will be used often
-        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
+        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], accumulatorStack,
+                                                refreshTable);
         unadjustedStaticEval = eval = ss->staticEval;
     }
     else if (ss->ttHit)
@@ -769,7 +1027,8 @@ Value Search::Worker::search(
         if (!is_valid(unadjustedStaticEval))
             unadjustedStaticEval = evaluate(pos);
         else if (PvNode)
-            Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
+            Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken],
+                                                    accumulatorStack, refreshTable);
 
         ss->staticEval = eval = to_corrected_static_eval(unadjustedStaticEval, correctionValue);
 
@@ -794,7 +1053,8 @@ Value Search::Worker::search(
         int bonus = std::clamp(-10 * int((ss - 1)->staticEval + ss->staticEval), -1906, 1450) + 638;
         thisThread->mainHistory[~us][((ss - 1)->currentMove).from_to()] << bonus * 1136 / 1024;
         if (type_of(pos.piece_on(prevSq)) != PAWN && ((ss - 1)->currentMove).type_of() != PROMOTION)
-            thisThread->pawnHistory[pawn_structure_index(pos)][pos.piece_on(prevSq)][prevSq]
+            thisThread->histories
+                .pawnHistory[pawn_structure_index(pos)][pos.piece_on(prevSq)][prevSq]
               << bonus * 1195 / 1024;
     }
 
@@ -838,7 +1098,8 @@ Value Search::Worker::search(
 
         ss->currentMove                   = Move::null();
         ss->continuationHistory           = &thisThread->continuationHistory[0][0][NO_PIECE][0];
-        ss->continuationCorrectionHistory = &thisThread->continuationCorrectionHistory[NO_PIECE][0];
+        ss->continuationCorrectionHistory =
+          &thisThread->histories.continuationCorrectionHistory[NO_PIECE][0];
 
         pos.do_null_move(st, tt);
 
@@ -906,15 +1167,15 @@ Value Search::Worker::search(
 
             movedPiece = pos.moved_piece(move);
 
-            pos.do_move(move, st, &tt);
-            thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+            do_move(pos, move, st, ss);
+            thisThread->count_node();
 
             ss->currentMove = move;
             ss->isTTMove    = (move == ttData.move);
             ss->continuationHistory =
               &this->continuationHistory[ss->inCheck][true][movedPiece][move.to_sq()];
             ss->continuationCorrectionHistory =
-              &this->continuationCorrectionHistory[movedPiece][move.to_sq()];
+              &this->histories.continuationCorrectionHistory[movedPiece][move.to_sq()];
 
             // Perform a preliminary qsearch to verify that the move holds
             value = -qsearch<NonPV>(pos, ss + 1, -probCutBeta, -probCutBeta + 1);
@@ -924,7 +1185,7 @@ Value Search::Worker::search(
                 value = -search<NonPV>(pos, ss + 1, -probCutBeta, -probCutBeta + 1, probCutDepth,
                                        !cutNode);
 
-            pos.undo_move(move);
+            undo_move(pos, move);
 
             if (value >= probCutBeta)
             {
@@ -952,15 +1213,23 @@ moves_loop:  // When in check, search starts here
 
 
     MovePicker mp(pos, ttData.move, depth, &thisThread->mainHistory, &thisThread->lowPlyHistory,
-                  &thisThread->captureHistory, contHist, &thisThread->pawnHistory, ss->ply);
+                  &thisThread->captureHistory, contHist, &thisThread->histories.pawnHistory,
+                  ss->ply);
 
     value = bestValue;
 
     int moveCount = 0;
 
+    // Moves put off because another thread is searching them, see SearchingTable
+    const bool          shareWork = deferSearched && !rootNode && depth >= DeferDepth;
+    ValueList<Move, 32> deferredMoves;
+    std::size_t         deferredIdx = 0;
+
     // Step 13. Loop through all pseudo-legal moves until no moves remain
-    // or a beta cutoff occurs.
-    while ((move = mp.next_move()) != Move::none())
+    // or a beta cutoff occurs, then through the moves put off.
+    while ((move = mp.next_move()) != Move::none()
+           || (deferredIdx < deferredMoves.size()
+               && (move = deferredMoves[deferredIdx++]) != Move::none()))
     {
         assert(move.is_ok());
 
@@ -979,6 +1248,18 @@ moves_loop:  // When in check, search starts here
                            thisThread->rootMoves.begin() + thisThread->pvLast, move))
             continue;
 
+        // Helper threads put off a move another thread is searching at the same
+        // depth (ABDADA), unless it would be their first move here.
+        const Key searchingKey = shareWork ? SearchingTable::key(pos.key(), move, depth) : 0;
+
+        if (shareWork && moveCount && !deferredIdx && deferredMoves.size() < 32
+            && !is_mainthread() && threads.searching.contains(searchingKey))
+        {
+            deferredMoves.push_back(move);
+            thisThread->stats.deferredMoves++;
+            continue;
+        }
+
         ss->moveCount = ++moveCount;
 
         if (rootNode && is_mainthread() && nodes > 10000000)
@@ -1037,15 +1318,15 @@ moves_loop:  // When in check, search starts here
 
                 // SEE based pruning for captures and checks
                 int seeHist = std::clamp(captHist / 36, -153 * depth, 134 * depth);
-                if (!pos.see_ge(move, -157 * depth - seeHist))
+                if (!mp.see_ge(move, -157 * depth - seeHist))
                     continue;
             }
             else
             {
-                int history =
-                  (*contHist[0])[movedPiece][move.to_sq()]
-                  + (*contHist[1])[movedPiece][move.to_sq()]
-                  + thisThread->pawnHistory[pawn_structure_index(pos)][movedPiece][move.to_sq()];
+                int history = (*contHist[0])[movedPiece][move.to_sq()]
+                             + (*contHist[1])[movedPiece][move.to_sq()]
+                             + thisThread->histories.pawnHistory[pawn_structure_index(pos)]
+                                                                [movedPiece][move.to_sq()];
 
                 // Continuation history based pruning
                 if (history < -4107 * depth)
@@ -1146,8 +1427,11 @@ moves_loop:  // When in check, search starts here
         }
 
         // Step 16. Make the move
-        pos.do_move(move, st, givesCheck, &tt);
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        if (shareWork)
+            threads.searching.insert(searchingKey);
+
+        do_move(pos, move, st, givesCheck, ss);
+        thisThread->count_node();
 
         // Add extension to new depth
         newDepth += extension;
@@ -1158,7 +1442,7 @@ moves_loop:  // When in check, search starts here
         ss->continuationHistory =
           &thisThread->continuationHistory[ss->inCheck][capture][movedPiece][move.to_sq()];
         ss->continuationCorrectionHistory =
-          &thisThread->continuationCorrectionHistory[movedPiece][move.to_sq()];
+          &thisThread->histories.continuationCorrectionHistory[movedPiece][move.to_sq()];
         uint64_t nodeCount = rootNode ? uint64_t(nodes) : 0;
 
         // Decrease reduction for PvNodes (*Scaler)
@@ -1266,7 +1550,10 @@ moves_loop:  // When in check, search starts here
         }
 
         // Step 19. Undo move
-        pos.undo_move(move);
+        undo_move(pos, move);
+
+        if (shareWork)
+            threads.searching.erase(searchingKey);
 
         assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
 
@@ -1349,6 +1636,8 @@ moves_loop:  // When in check, search starts here
                 {
                     // (* Scaler) Especially if they make cutoffCnt increment more often.
                     ss->cutoffCnt += (extension < 2) || PvNode;
+                    thisThread->stats.cutoffs++;
+                    thisThread->stats.firstMoveCutoffs += moveCount == 1;
                     assert(value >= beta);  // Fail high
                     break;
                 }
@@ -1416,7 +1705,8 @@ moves_loop:  // When in check, search starts here
           << scaledBonus * 219 / 32768;
 
         if (type_of(pos.piece_on(prevSq)) != PAWN && ((ss - 1)->currentMove).type_of() != PROMOTION)
-            thisThread->pawnHistory[pawn_structure_index(pos)][pos.piece_on(prevSq)][prevSq]
+            thisThread->histories
+                .pawnHistory[pawn_structure_index(pos)][pos.piece_on(prevSq)][prevSq]
               << scaledBonus * 1103 / 32768;
     }
 
@@ -1440,11 +1730,19 @@ moves_loop:  // When in check, search starts here
     // Write gathered information in transposition table. Note that the
     // static evaluation is saved as it was before correction history.
     if (!excludedMove && !(rootNode && thisThread->pvIdx))
-        ttWriter.write(posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
-                       bestValue >= beta    ? BOUND_LOWER
-                       : PvNode && bestMove ? BOUND_EXACT
-                                            : BOUND_UPPER,
-                       depth, bestMove, unadjustedStaticEval, tt.generation());
+    {
+        const Bound bound = bestValue >= beta    ? BOUND_LOWER
+                            : PvNode && bestMove ? BOUND_EXACT
+                                                 : BOUND_UPPER;
+
+        ttWriter.write(posKey, value_to_tt(bestValue, ss->ply), ss->ttPv, bound, depth, bestMove,
+                       unadjustedStaticEval, tt.generation());
+
+        if (shareEntries && depth >= SearchCluster::ShareDepth)
+            share_entry({posKey, bestMove.raw(), int16_t(value_to_tt(bestValue, ss->ply)),
+                         int16_t(unadjustedStaticEval), int16_t(depth), uint8_t(bound),
+                         uint8_t(ss->ttPv)});
+    }
 
     // Adjust correction history
     if (!ss->inCheck && !(bestMove && pos.capture(bestMove))
@@ -1487,7 +1785,6 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
     Move      pv[MAX_PLY + 1];
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     Key   posKey;
     Move  move, bestMove;
@@ -1520,6 +1817,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     // Step 3. Transposition table lookup
     posKey                         = pos.key();
     auto [ttHit, ttData, ttWriter] = tt.probe(posKey);
+    thisThread->count_tt_probe(ttHit);
     // Need further processing of the saved data
     ss->ttHit    = ttHit;
     ttData.move  = ttHit ? ttData.move : Move::none();
@@ -1589,7 +1887,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     // the moves. We presently use two stages of move generator in quiescence search:
     // captures, or evasions only when in check.
     MovePicker mp(pos, ttData.move, DEPTH_QS, &thisThread->mainHistory, &thisThread->lowPlyHistory,
-                  &thisThread->captureHistory, contHist, &thisThread->pawnHistory, ss->ply);
+                  &thisThread->captureHistory, contHist, &thisThread->histories.pawnHistory,
+                  ss->ply);
 
     // Step 5. Loop through all pseudo-legal moves until no moves remain or a beta
     // cutoff occurs.
@@ -1638,8 +1937,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
             if (!capture
                 && (*contHist[0])[pos.moved_piece(move)][move.to_sq()]
                        + (*contHist[1])[pos.moved_piece(move)][move.to_sq()]
-                       + thisThread->pawnHistory[pawn_structure_index(pos)][pos.moved_piece(move)]
-                                                [move.to_sq()]
+                       + thisThread->histories.pawnHistory[pawn_structure_index(pos)]
+                                                          [pos.moved_piece(move)][move.to_sq()]
                      <= 5389)
                 continue;
 
@@ -1651,18 +1950,19 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
         // Step 7. Make and search the move
         Piece movedPiece = pos.moved_piece(move);
 
-        pos.do_move(move, st, givesCheck, &tt);
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        do_move(pos, move, st, givesCheck, ss);
+        thisThread->count_node();
+        thisThread->stats.qsearchNodes++;
 
         // Update the current move
         ss->currentMove = move;
         ss->continuationHistory =
           &thisThread->continuationHistory[ss->inCheck][capture][movedPiece][move.to_sq()];
         ss->continuationCorrectionHistory =
-          &thisThread->continuationCorrectionHistory[movedPiece][move.to_sq()];
+          &thisThread->histories.continuationCorrectionHistory[movedPiece][move.to_sq()];
 
         value = -qsearch<nodeType>(pos, ss + 1, -beta, -alpha);
-        pos.undo_move(move);
+        undo_move(pos, move);
 
         assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
 
@@ -1728,9 +2028,74 @@ TimePoint Search::Worker::elapsed() const {
 
 TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elapsed_time(); }
 
+void Search::Worker::do_move(Position& pos, const Move move, StateInfo& st, const Stack* ss) {
+    do_move(pos, move, st, pos.gives_check(move), ss);
+}
+
+void Search::Worker::do_move(Position&    pos,
+                             const Move   move,
+                             StateInfo&   st,
+                             const bool   givesCheck,
+                             const Stack* ss) {
+    DirtyPiece dp = pos.do_move(move, st, givesCheck, &tt);
+    accumulatorStack.push(dp);
+
+    // The child reads these entries in correction_value() as soon as it is
+    // entered, and with large or shared histories they are often not in cache.
+    if (prefetchHistories)
+    {
+        const Square to = move.to_sq();
+
+        prefetch(&histories.pawnCorrectionHistory[pawn_structure_index<Correction>(pos)]);
+        prefetch(&histories.minorPieceCorrectionHistory[minor_piece_index(pos)]);
+        prefetch(&histories.nonPawnCorrectionHistory[WHITE][non_pawn_index<WHITE>(pos)]);
+        prefetch(&histories.nonPawnCorrectionHistory[BLACK][non_pawn_index<BLACK>(pos)]);
+        prefetch(&(*(ss - 1)->continuationCorrectionHistory)[pos.piece_on(to)][to]);
+    }
+}
+
+void Search::Worker::undo_move(Position& pos, const Move move) {
+    pos.undo_move(move);
+    accumulatorStack.pop();
+}
+
+// Collects a deep entry for the other machines of the cluster, which get the
+// entries in batches, so that the thread rarely takes the lock of the queue.
+void Search::Worker::share_entry(const RemoteEntry& e) {
+
+    sharedEntries.push_back(e);
+
+    if (sharedEntries.size() >= SearchCluster::BatchSize)
+    {
+        threads.cluster->share(sharedEntries.data(), sharedEntries.size());
+        sharedEntries.clear();
+    }
+}
+
+// Evaluates the position, reusing the network score of the eval cache if the
+// position was evaluated recently.
 Value Search::Worker::evaluate(const Position& pos) {
-    return Eval::evaluate(networks[numaAccessToken], pos, refreshTable,
-                          optimism[pos.side_to_move()]);
+
+    const Value        optimismUs = optimism[pos.side_to_move()];
+    Eval::NetworkScore score;
+
+    if (evalCache.enabled())
+    {
+        stats.evalCacheProbes++;
+
+        if (evalCache.probe(pos.key(), score))
+        {
+            stats.evalCacheHits++;
+            return Eval::blend(pos, score, optimismUs);
+        }
+    }
+
+    score = Eval::evaluate_networks(networks[numaAccessToken], pos, accumulatorStack, refreshTable);
+
+    if (evalCache.enabled())
+        evalCache.store(pos.key(), score);
+
+    return Eval::blend(pos, score, optimismUs);
 }
 
 namespace {
@@ -1870,7 +2235,8 @@ void update_quiet_histories(
     update_continuation_histories(ss, pos.moved_piece(move), move.to_sq(), bonus * 964 / 1024);
 
     int pIndex = pawn_structure_index(pos);
-    workerThread.pawnHistory[pIndex][pos.moved_piece(move)][move.to_sq()] << bonus * 615 / 1024;
+    workerThread.histories.pawnHistory[pIndex][pos.moved_piece(move)][move.to_sq()]
+      << bonus * 615 / 1024;
 }
 
 }
@@ -1916,12 +2282,10 @@ void SearchManager::check_time(Search::Worker& worker) {
     // When using nodes, ensure checking rate is not lower than 0.1% of nodes
     callsCnt = worker.limits.nodes ? std::min(512, int(worker.limits.nodes / 1024)) : 512;
 
-    static TimePoint lastInfoTime = now();
-
     TimePoint elapsed = tm.elapsed([&worker]() { return worker.threads.nodes_searched(); });
     TimePoint tick    = worker.limits.startTime + elapsed;
 
-    if (tick - lastInfoTime >= 1000)
+    if (dbg_print_interval() && tick - lastInfoTime >= dbg_print_interval())
     {
         lastInfoTime = tick;
         dbg_print();
@@ -2077,17 +2441,85 @@ void syzygy_extend_pv(const OptionsMap&         options,
           << sync_endl;
 }
 
+void Search::MultiPVLines::clear(size_t lineCount) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lines.clear();
+    lines.resize(lineCount);
+}
+
+void Search::MultiPVLines::publish(size_t line, const RootMove& rm, Depth depth) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The threads of a group can be at different depths, keep the deepest
+    if (depth >= lines[line].depth)
+        lines[line] = {depth, rm};
+}
+
+bool Search::MultiPVLines::take(size_t line, RootMoves& rootMoves, size_t last) const {
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const Line& l = lines[line];
+
+    if (!l.depth)
+        return false;
+
+    // The move may be in an earlier line of this thread, which can lag behind
+    // the group that published it, then the thread searches the line itself.
+    auto it = std::find(rootMoves.begin() + line, rootMoves.begin() + last, l.rm.pv[0]);
+
+    if (it == rootMoves.begin() + last)
+        return false;
+
+    // Keep the order of the other moves, as the stable sorts of the search do
+    std::rotate(rootMoves.begin() + line, it, it + 1);
+
+    RootMove& rm        = rootMoves[line];
+    rm.score            = l.rm.score;
+    rm.uciScore         = l.rm.uciScore;
+    rm.averageScore     = l.rm.averageScore;
+    rm.meanSquaredScore = l.rm.meanSquaredScore;
+    rm.scoreLowerbound  = l.rm.scoreLowerbound;
+    rm.scoreUpperbound  = l.rm.scoreUpperbound;
+    rm.selDepth         = l.rm.selDepth;
+    rm.pv               = l.rm.pv;
+    return true;
+}
+
+// Sends the PV lines. With the InfoInterval option the reports are at least
+// that many ms apart, except the final one, and with InfoChangedOnly only the
+// lines whose score, bound, PV or rank changed since the last report are sent,
+// which keeps the output of a high MultiPV analysis small.
 void SearchManager::pv(Search::Worker&           worker,
                        const ThreadPool&         threads,
                        const TranspositionTable& tt,
-                       Depth                     depth) {
+                       Depth                     depth,
+                       bool                      final) {
+
+    const TimePoint time = std::max(TimePoint(1), tm.elapsed_time());
+
+    if (!final && time < nextPvTime)
+    {
+        pvSkipped = true;
+        return;
+    }
+
+    nextPvTime = time + TimePoint(worker.options["InfoInterval"]);
+    pvSkipped  = false;
 
-    const auto nodes     = threads.nodes_searched();
-    auto&      rootMoves = worker.rootMoves;
-    auto&      pos       = worker.rootPos;
-    size_t     pvIdx     = worker.pvIdx;
-    size_t     multiPV   = std::min(size_t(worker.options["MultiPV"]), rootMoves.size());
-    uint64_t   tbHits    = threads.tb_hits() + (worker.tbConfig.rootInTB ? rootMoves.size() : 0);
+    // The worker is the main thread, which sends this, or a thread that has finished
+    worker.publish_nodes();
+
+    const auto nodes       = threads.nodes_searched();
+    auto&      rootMoves   = worker.rootMoves;
+    auto&      pos         = worker.rootPos;
+    size_t     pvIdx       = worker.pvIdx;
+    size_t     multiPV     = std::min(size_t(worker.options["MultiPV"]), rootMoves.size());
+    uint64_t   tbHits      = threads.tb_hits() + (worker.tbConfig.rootInTB ? rootMoves.size() : 0);
+    int        hashfull    = -1;  // Sampled for the first line sent only
+    bool       changedOnly = worker.options["InfoChangedOnly"];
 
     for (size_t i = 0; i < multiPV; ++i)
     {
@@ -2106,6 +2538,16 @@ void SearchManager::pv(Search::Worker&           worker,
         v       = tb ? rootMoves[i].tbScore : v;
 
         bool isExact = i != pvIdx || tb || !updated;  // tablebase- and previous-scores are exact
+        int  bound   = isExact                      ? 0
+                     : rootMoves[i].scoreLowerbound ? 1
+                     : rootMoves[i].scoreUpperbound ? 2
+                                                    : 0;  // 1 lowerbound, 2 upperbound
+
+        // The PV is compared before the extension below, as the one reported
+        // was extended the same way.
+        if (changedOnly && rootMoves[i].reportedMultiPV == i + 1 && rootMoves[i].reportedScore == v
+            && rootMoves[i].reportedBound == bound && rootMoves[i].reportedPv == rootMoves[i].pv)
+            continue;
 
         // Potentially correct and extend the PV, and in exceptional cases v
         if (is_decisive(v) && std::abs(v) < VALUE_MATE_IN_MAX_PLY
@@ -2120,10 +2562,15 @@ void SearchManager::pv(Search::Worker&           worker,
         if (!pv.empty())
             pv.pop_back();
 
-        auto wdl   = worker.options["UCI_ShowWDL"] ? UCIEngine::wdl(v, pos) : "";
-        auto bound = rootMoves[i].scoreLowerbound
-                     ? "lowerbound"
-                     : (rootMoves[i].scoreUpperbound ? "upperbound" : "");
+        auto wdl = worker.options["UCI_ShowWDL"] ? UCIEngine::wdl(v, pos) : "";
+
+        if (hashfull < 0)
+            hashfull = tt.hashfull();
+
+        rootMoves[i].reportedMultiPV = i + 1;
+        rootMoves[i].reportedScore   = v;
+        rootMoves[i].reportedBound   = bound;
+        rootMoves[i].reportedPv      = rootMoves[i].pv;
 
         InfoFull info;
 
@@ -2132,17 +2579,13 @@ void SearchManager::pv(Search::Worker&           worker,
         info.multiPV  = i + 1;
         info.score    = {v, pos};
         info.wdl      = wdl;
-
-        if (!isExact)
-            info.bound = bound;
-
-        TimePoint time = std::max(TimePoint(1), tm.elapsed_time());
-        info.timeMs    = time;
-        info.nodes     = nodes;
-        info.nps       = nodes * 1000 / time;
-        info.tbHits    = tbHits;
-        info.pv        = pv;
-        info.hashfull  = tt.hashfull();
+        info.bound    = bound == 1 ? "lowerbound" : bound == 2 ? "upperbound" : "";
+        info.timeMs   = time;
+        info.nodes    = nodes;
+        info.nps      = nodes * 1000 / time;
+        info.tbHits   = tbHits;
+        info.pv       = pv;
+        info.hashfull = hashfull;
 
         updates.onUpdateFull(info);
     }
@@ -2155,7 +2598,6 @@ void SearchManager::pv(Search::Worker&           worker,
 bool RootMove::extract_ponder_from_tt(const TranspositionTable& tt, Position& pos) {
 
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     assert(pv.size() == 1);
     if (pv[0] == Move::none())
@@ -23,15 +23,20 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "cluster.h"
+#include "evaluate.h"
 #include "history.h"
+#include "memory.h"
 #include "misc.h"
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
@@ -105,6 +110,12 @@ struct RootMove {
     int               tbRank           = 0;
     Value             tbScore;
     std::vector<Move> pv;
+
+    // What was last sent in an "info" line for the move, see SearchManager::pv()
+    size_t            reportedMultiPV = 0;
+    Value             reportedScore   = VALUE_NONE;
+    int               reportedBound   = 0;
+    std::vector<Move> reportedPv;
 };
 
 using RootMoves = std::vector<RootMove>;
@@ -131,22 +142,46 @@ struct LimitsType {
 };
 
 
+// The shared histories of the threads bound to one NUMA node. Replication only
+// serves to have one copy per node, so a copy gets new tables, allocated on the
+// node making the copy, rather than the values of the original.
+class NumaHistories {
+   public:
+    NumaHistories() :
+        tables(make_unique_large_page<SharedHistories>()) {}
+    NumaHistories(const NumaHistories&) :
+        NumaHistories() {}
+    NumaHistories(NumaHistories&&) = default;
+
+    // The replicas are const, but the threads of the node update the tables
+    SharedHistories& get() const { return *tables; }
+
+    size_t      memory() const { return sizeof(SharedHistories); }
+    std::string pages_information() const { return large_pages_information(tables.get()); }
+
+   private:
+    LargePagePtr<SharedHistories> tables;
+};
+
 // The UCI stores the uci options, thread pool, and transposition table.
 // This struct is used to easily forward data to the Search::Worker class.
 struct SharedState {
     SharedState(const OptionsMap&                               optionsMap,
                 ThreadPool&                                     threadPool,
                 TranspositionTable&                             transpositionTable,
-                const LazyNumaReplicated<Eval::NNUE::Networks>& nets) :
+                const LazyNumaReplicated<Eval::NNUE::Networks>& nets,
+                const LazyNumaReplicated<NumaHistories>&        numaHistories) :
         options(optionsMap),
         threads(threadPool),
         tt(transpositionTable),
-        networks(nets) {}
+        networks(nets),
+        histories(numaHistories) {}
 
     const OptionsMap&                               options;
     ThreadPool&                                     threads;
     TranspositionTable&                             tt;
     const LazyNumaReplicated<Eval::NNUE::Networks>& networks;
+    const LazyNumaReplicated<NumaHistories>&        histories;
 };
 
 class Worker;
@@ -183,6 +218,28 @@ struct InfoIteration {
     size_t           currmovenumber;
 };
 
+// Counters describing a search. They are kept by each worker, which is the only
+// writer, and are cheap enough to be always on.
+struct SearchStats {
+    uint64_t nodes            = 0;
+    uint64_t qsearchNodes     = 0;
+    uint64_t ttProbes         = 0;
+    uint64_t ttHits           = 0;
+    uint64_t cutoffs          = 0;  // Beta cutoffs in the main search,
+    uint64_t firstMoveCutoffs = 0;  // of which by the first move searched
+    uint64_t deferredMoves    = 0;  // Put off as another thread searched them
+    uint64_t nnueUpdates      = 0;  // Accumulators computed incrementally
+    uint64_t nnueRefreshes    = 0;  // Accumulators refreshed from the cache
+    uint64_t evalCacheProbes  = 0;
+    uint64_t evalCacheHits    = 0;
+    uint64_t tbProbes         = 0;
+    uint64_t tbHits           = 0;
+    uint64_t tbDeferred       = 0;  // TB probes left to the async threads
+    uint64_t cpuTime          = 0;  // Of the thread, in microseconds
+
+    SearchStats& operator+=(const SearchStats& s);
+};
+
 // Skill structure is used to implement strength limit. If we have a UCI_Elo,
 // we convert it to an appropriate skill level, anchored to the Stash engine.
 // This method is based on a fit of the Elo results for games played between
@@ -219,16 +276,19 @@ class SearchManager: public ISearchManager {
     using UpdateFull     = std::function<void(const InfoFull&)>;
     using UpdateIter     = std::function<void(const InfoIteration&)>;
     using UpdateBestmove = std::function<void(std::string_view, std::string_view)>;
+    using UpdateStats    = std::function<void(const std::vector<SearchStats>&)>;
 
     struct UpdateContext {
         UpdateShort    onUpdateNoMoves;
         UpdateFull     onUpdateFull;
         UpdateIter     onIter;
         UpdateBestmove onBestmove;
+        UpdateStats    onStats;
     };
 
 
     SearchManager(const UpdateContext& updateContext) :
+        lastInfoTime(now()),
         updates(updateContext) {}
 
     void check_time(Search::Worker& worker) override;
@@ -236,7 +296,8 @@ class SearchManager: public ISearchManager {
     void pv(Search::Worker&           worker,
             const ThreadPool&         threads,
             const TranspositionTable& tt,
-            Depth                     depth);
+            Depth                     depth,
+            bool                      final = false);
 
     Stockfish::TimeManagement tm;
     double                    originalTimeAdjust;
@@ -248,6 +309,9 @@ class SearchManager: public ISearchManager {
     Value                bestPreviousScore;
     Value                bestPreviousAverageScore;
     bool                 stopOnPonderhit;
+    TimePoint            lastInfoTime;
+    TimePoint            nextPvTime;
+    bool                 pvSkipped;
 
     size_t id;
 
@@ -259,6 +323,37 @@ class NullSearchManager: public ISearchManager {
     void check_time(Search::Worker&) override {}
 };
 
+// The nodes and tablebase hits of some of the threads of a pool, which they add
+// up here so that the totals are read from a few cache lines, whatever the
+// number of threads. See Worker::count_node().
+struct alignas(64) SharedCounters {
+    std::atomic<uint64_t> nodes{0}, tbHits{0};
+};
+
+// The PV lines of a MultiPV search split between groups of threads, see the
+// "MultiPVGroups" option. The threads of group g search the lines g, g + groups,
+// and so on, and publish here the deepest result of each line. The other lines
+// are taken from here instead of being searched.
+class MultiPVLines {
+   public:
+    void clear(size_t lineCount);
+    void publish(size_t line, const RootMove& rm, Depth depth);
+
+    // Brings the move of the line to rootMoves[line], with the score and PV
+    // found by the group searching it, if the move is among rootMoves[line..last).
+    // Returns false if the line has no result yet or its move is not there.
+    bool take(size_t line, RootMoves& rootMoves, size_t last) const;
+
+   private:
+    struct Line {
+        Depth    depth = 0;
+        RootMove rm{Move::none()};
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Line>  lines;
+};
+
 
 // Search::Worker is the class that does the actual search.
 // It is instantiated once per thread, and it is responsible for keeping track
@@ -279,22 +374,31 @@ class Worker {
 
     void ensure_network_replicated();
 
+    // Only meaningful when the worker is not searching
+    SearchStats search_stats() const;
+
     // Public because they need to be updatable by the stats
     ButterflyHistory mainHistory;
     LowPlyHistory    lowPlyHistory;
 
     CapturePieceToHistory captureHistory;
     ContinuationHistory   continuationHistory[2][2];
-    PawnHistory           pawnHistory;
 
-    CorrectionHistory<Pawn>         pawnCorrectionHistory;
-    CorrectionHistory<Minor>        minorPieceCorrectionHistory;
-    CorrectionHistory<NonPawn>      nonPawnCorrectionHistory[COLOR_NB];
-    CorrectionHistory<Continuation> continuationCorrectionHistory;
+    // Either owned by this thread, or shared with the threads of its NUMA node
+    LargePagePtr<SharedHistories> ownHistories;
+    SharedHistories&              histories;
+
+    // Set by the thread pool on the first thread of each NUMA node, which clears
+    // the histories shared by the node.
+    bool firstOnNumaNode = false;
 
    private:
     void iterative_deepening();
 
+    // Answers the search with a deep enough result of an earlier one, else uses
+    // it to seed the search. Returns true if the search was answered.
+    bool use_cached_result();
+
     // This is the main search function, for both PV and non-PV nodes
     template<NodeType nodeType>
     Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
@@ -316,12 +420,58 @@ class Worker {
 
     Value evaluate(const Position&);
 
+    // Make and unmake moves while keeping the NNUE accumulator stack in sync.
+    // do_move() also prefetches the history rows read by the child node ss + 1.
+    void do_move(Position& pos, const Move move, StateInfo& st, const Stack* ss);
+    void do_move(Position&    pos,
+                 const Move   move,
+                 StateInfo&   st,
+                 const bool   givesCheck,
+                 const Stack* ss);
+    void undo_move(Position& pos, const Move move);
+
+    // Only this thread writes the counters, so no atomic read-modify-write is needed
+    void count_tt_probe(bool hit) {
+        ttProbes.store(ttProbes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        ttHits.store(ttHits.load(std::memory_order_relaxed) + hit, std::memory_order_relaxed);
+    }
+
+    // The nodes are added to the shared counters in batches, of at most 1/64 of
+    // the nodes of the thread so that the totals are close from the start.
+    void count_node() {
+        nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (++unpublishedNodes >= nodesBatch)
+            publish_nodes();
+    }
+
+    void publish_nodes() {
+        counters->nodes.fetch_add(unpublishedNodes, std::memory_order_relaxed);
+        unpublishedNodes = 0;
+        nodesBatch = std::clamp<uint64_t>(nodes.load(std::memory_order_relaxed) / 64, 1,
+                                          maxNodesBatch);
+    }
+
+    SharedCounters* counters = nullptr;  // Set by ThreadPool::set()
+    uint64_t        unpublishedNodes = 0, nodesBatch = 1, maxNodesBatch = 1;
+
     LimitsType limits;
 
     size_t                pvIdx, pvLast;
     std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
+    std::atomic<uint64_t> ttProbes, ttHits;
+    SearchStats           stats;
     int                   selDepth, nmpMinPly;
 
+    std::chrono::steady_clock::time_point searchStart;  // See ThreadPool::search_latencies()
+
+    bool prefetchHistories;  // The "HistoryPrefetch" option
+    bool deferSearched;      // The "DeferSearchedMoves" option, with several threads
+
+    // Deep entries waiting to be sent to the other machines of the cluster
+    void                     share_entry(const RemoteEntry& e);
+    bool                     shareEntries = false;
+    std::vector<RemoteEntry> sharedEntries;
+
     Value optimism[COLOR_NB];
 
     Position  rootPos;
@@ -339,7 +489,8 @@ class Worker {
     // The main thread has a SearchManager, the others have a NullSearchManager
     std::unique_ptr<ISearchManager> manager;
 
-    Tablebases::Config tbConfig;
+    Tablebases::Config   tbConfig;
+    Tablebases::WDLCache tbCache;
 
     const OptionsMap&                               options;
     ThreadPool&                                     threads;
@@ -347,7 +498,9 @@ class Worker {
     const LazyNumaReplicated<Eval::NNUE::Networks>& networks;
 
     // Used by NNUE
+    Eval::NNUE::AccumulatorStack  accumulatorStack;
     Eval::NNUE::AccumulatorCaches refreshTable;
+    Eval::EvalCache               evalCache;
 
     friend class Stockfish::ThreadPool;
     friend class SearchManager;
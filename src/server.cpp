@@ -0,0 +1,671 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "misc.h"
+#include "position.h"
+#include "types.h"
+#include "uci.h"
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif
+
+namespace Stockfish {
+
+namespace {
+
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+constexpr size_t MaxLineSize = 1 << 16;  // Longer lines close the session
+
+}  // namespace
+
+
+// A connection to the server. The position and the options are only used by the
+// server thread, the lines are sent from it and from the search threads.
+struct SessionServer::Session {
+    explicit Session(int socket) :
+        fd(socket) {
+        set_position(StartFEN, {}, false);
+    }
+    ~Session();
+
+    void send(const std::string& line);
+    void set_position(const std::string&              newFen,
+                      const std::vector<std::string>& newMoves,
+                      bool                            isChess960);
+
+    int         fd;
+    std::mutex  sendMutex;
+    std::string input;  // Received, up to the end of the last complete line
+
+    std::string                                      fen;
+    std::vector<std::string>                         moves;
+    bool                                             chess960 = false;
+    Position                                         pos;
+    StateListPtr                                     states;  // Given to the slot by "go"
+    std::vector<std::pair<std::string, std::string>> options;
+
+    // Guarded by the mutex of the server
+    Search::LimitsType limits;  // Of the search waiting for a slot
+    bool               waiting = false;
+    bool               stopped = false;  // Before it got a slot
+};
+
+void SessionServer::Session::set_position(const std::string&              newFen,
+                                          const std::vector<std::string>& newMoves,
+                                          bool                            isChess960) {
+    fen      = newFen;
+    chess960 = isChess960;
+    moves.clear();
+
+    states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(fen, chess960, &states->back());
+
+    for (const auto& move : newMoves)
+    {
+        Move m = UCIEngine::to_move(pos, move);
+
+        if (m == Move::none())
+            break;
+
+        states->emplace_back();
+        pos.do_move(m, states->back());
+        moves.push_back(move);
+    }
+}
+
+
+SessionServer::Slot::Slot(const OptionsMap& engineOptions) {
+
+    // The options without their actions on the engine
+    for (const auto& [name, option] : engineOptions.options_map)
+    {
+        Option copy    = option;
+        copy.on_change = nullptr;
+        options.add(name, copy);
+        options.options_map[name].idx = option.idx;
+    }
+}
+
+
+SessionServer::SessionServer(const OptionsMap& options, std::function<void(Slots&)> setUpSlots) :
+    engineOptions(options),
+    setUp(std::move(setUpSlots)) {}
+
+SessionServer::~SessionServer() { listen(0, ""); }
+
+size_t SessionServer::slot_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
+
+SessionServer::Pause SessionServer::pause() {
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (pauses++ == 0)
+        for (auto& slot : slots)
+            if (slot->session)
+                slot->threads.stop = true;
+
+    cv.wait(lock, [&] { return idle.size() == slots.size(); });
+
+    return Pause(*this);
+}
+
+void SessionServer::resume() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (pauses > 1)
+        {
+            --pauses;
+            return;
+        }
+    }
+
+    // Nothing is dispatched to the slots while they are replaced
+    set_up_slots();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pauses = 0;
+    }
+
+    wake();
+}
+
+void SessionServer::set_up_slots() {
+
+    Slots newSlots;
+
+    if (listenFd != -1)
+    {
+        setUp(newSlots);
+
+        for (auto& slot : newSlots)
+        {
+            Slot* s = slot.get();
+
+            s->updateContext.onUpdateNoMoves = [s](const Search::InfoShort& info) {
+                s->session->send(UCIEngine::format_update_no_moves(info));
+            };
+            s->updateContext.onUpdateFull = [s](const Search::InfoFull& info) {
+                s->session->send(UCIEngine::format_update_full(info, s->options["UCI_ShowWDL"]));
+            };
+            s->updateContext.onIter = [s](const Search::InfoIteration& info) {
+                s->session->send(UCIEngine::format_iter(info));
+            };
+            s->updateContext.onStats    = [](const std::vector<Search::SearchStats>&) {};
+            s->updateContext.onBestmove = [this, s](std::string_view bestmove,
+                                                    std::string_view ponder) {
+                s->session->send(UCIEngine::format_bestmove(bestmove, ponder));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.push_back(s);
+                }
+                wake();
+            };
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    slots.swap(newSlots);
+    idle.clear();
+    finished.clear();
+
+    for (auto& slot : slots)
+        idle.push_back(slot.get());
+}
+
+// Gives the idle slots to the sessions waiting for one, in the order of their
+// "go" commands. Only called by the server thread.
+void SessionServer::dispatch() {
+
+    std::vector<std::pair<Slot*, std::shared_ptr<Session>>> starting;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        while (!pauses && !idle.empty() && !waiting.empty())
+        {
+            Slot* slot = idle.back();
+            idle.pop_back();
+
+            slot->session = std::move(waiting.front());
+            waiting.pop_front();
+            slot->session->waiting = false;
+
+            starting.emplace_back(slot, slot->session);
+        }
+    }
+
+    for (auto& [slot, session] : starting)
+    {
+        // Undo the options of the previous session, then set those of this one
+        for (auto it = slot->changed.rbegin(); it != slot->changed.rend(); ++it)
+            slot->options.options_map[it->first].currentValue = it->second;
+
+        slot->changed.clear();
+
+        for (const auto& [name, value] : session->options)
+        {
+            Option& o = slot->options.options_map[name];
+            slot->changed.emplace_back(name, o.currentValue);
+            o = value;
+        }
+
+        // The states of the last search were given to the slot that ran it
+        if (!session->states)
+            session->set_position(session->fen, session->moves, session->chess960);
+
+        Search::LimitsType limits;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            limits = session->limits;
+        }
+
+        slot->threads.start_thinking(slot->options, session->pos, session->states, limits);
+
+        // Stopped before it started, by the session or by a pause
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (session->stopped || pauses)
+            slot->threads.stop = true;
+    }
+}
+
+// Makes a slot idle again once its search is over. Only called by the server thread.
+void SessionServer::finish(Slot& slot) {
+
+    slot.threads.main_thread()->wait_for_search_finished();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    slot.session.reset();
+    idle.push_back(&slot);
+    cv.notify_all();
+}
+
+void SessionServer::handle(const std::shared_ptr<Session>& session, const std::string& line) {
+
+    std::istringstream is(line);
+    std::string        token;
+
+    is >> std::skipws >> token;
+
+    if (token == "quit")
+        close(session);
+
+    else if (token == "stop" || token == "ponderhit")
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto slot = std::find_if(slots.begin(), slots.end(),
+                                 [&](const auto& s) { return s->session == session; });
+
+        if (slot != slots.end())
+        {
+            if (token == "stop")
+                (*slot)->threads.stop = true;
+            else
+                (*slot)->threads.main_manager()->ponder = false;
+        }
+        else if (session->waiting)
+        {
+            if (token == "stop")
+                session->stopped = true;
+            else
+                session->limits.ponderMode = false;
+        }
+    }
+
+    else if (token == "go")
+        go(session, is);
+
+    else if (token == "position")
+    {
+        std::string fen;
+        is >> token;
+
+        if (token == "startpos")
+        {
+            fen = StartFEN;
+            is >> token;  // Consume the "moves" token, if any
+        }
+        else if (token == "fen")
+            while (is >> token && token != "moves")
+                fen += token + " ";
+        else
+            return;
+
+        std::vector<std::string> moves;
+
+        while (is >> token)
+            moves.push_back(token);
+
+        bool chess960 = engineOptions["UCI_Chess960"];
+
+        for (const auto& [name, value] : session->options)
+            if (!CaseInsensitiveLess()(name, "UCI_Chess960")
+                && !CaseInsensitiveLess()("UCI_Chess960", name))
+                chess960 = value == "true";
+
+        session->set_position(fen, moves, chess960);
+    }
+
+    else if (token == "setoption")
+    {
+        std::string name, value;
+
+        is >> token;  // Consume the "name" token
+
+        while (is >> token && token != "value")
+            name += (name.empty() ? "" : " ") + token;
+
+        while (is >> token)
+            value += (value.empty() ? "" : " ") + token;
+
+        auto option = engineOptions.options_map.find(name);
+
+        if (option == engineOptions.options_map.end())
+        {
+            session->send("No such option: " + name);
+            return;
+        }
+
+        // A value the engine can't convert would terminate all the sessions
+        char* end = nullptr;
+        if (option->second.type == "spin" && (std::strtod(value.c_str(), &end), *end))
+        {
+            session->send("Invalid value: " + value);
+            return;
+        }
+
+        auto it = std::find_if(session->options.begin(), session->options.end(), [&](auto& o) {
+            return !CaseInsensitiveLess()(o.first, name) && !CaseInsensitiveLess()(name, o.first);
+        });
+
+        if (it != session->options.end())
+            it->second = value;
+        else
+            session->options.emplace_back(name, value);
+    }
+
+    else if (token == "uci")
+    {
+        std::stringstream ss;
+        ss << "id name " << engine_info(true) << "\n" << engineOptions;
+        session->send(ss.str());
+        session->send("uciok");
+    }
+
+    else if (token == "isready")
+        session->send("readyok");
+
+    // The tables are shared with the other sessions, so there is nothing to clear
+    else if (token == "ucinewgame")
+        session->set_position(StartFEN, {}, session->chess960);
+
+    else if (!token.empty() && token[0] != '#')
+        session->send("Unknown command: '" + line + "'.");
+}
+
+void SessionServer::go(const std::shared_ptr<Session>& session, std::istringstream& is) {
+
+    // The search starts as early as possible, so the time waiting for a slot counts
+    Search::LimitsType limits = UCIEngine::parse_limits(is);
+
+    if (limits.perft)
+    {
+        session->send("info string perft is not available in a session");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (session->waiting
+        || std::any_of(slots.begin(), slots.end(),
+                       [&](const auto& s) { return s->session == session; }))
+        return;
+
+    session->limits  = limits;
+    session->waiting = true;
+    session->stopped = false;
+    waiting.push_back(session);
+}
+
+
+#ifndef _WIN32
+
+namespace {
+
+bool write_all(int fd, const char* data, size_t size) {
+
+    while (size)
+    {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return false;
+
+        data += n;
+        size -= size_t(n);
+    }
+
+    return true;
+}
+
+}  // namespace
+
+
+SessionServer::Session::~Session() { ::close(fd); }
+
+// A failure to send shows up as a closed connection to the server thread
+void SessionServer::Session::send(const std::string& line) {
+
+    const std::string data = line + "\n";
+
+    std::lock_guard<std::mutex> lock(sendMutex);
+    write_all(fd, data.data(), data.size());
+}
+
+void SessionServer::wake() {
+
+    const char c = 0;
+    [[maybe_unused]] ssize_t n = ::write(wakeFds[1], &c, 1);
+}
+
+// Disconnects a session. A search of the session is stopped, its slot keeps the
+// session until the search is over. Only called by the server thread.
+void SessionServer::close(const std::shared_ptr<Session>& session) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        waiting.erase(std::remove(waiting.begin(), waiting.end(), session), waiting.end());
+
+        for (auto& slot : slots)
+            if (slot->session == session)
+                slot->threads.stop = true;
+    }
+
+    ::shutdown(session->fd, SHUT_RDWR);
+    sessions.erase(std::remove(sessions.begin(), sessions.end(), session), sessions.end());
+}
+
+bool SessionServer::listen(int port, const std::string& address) {
+
+    if (server.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            exit = true;
+        }
+
+        wake();
+        server.join();
+
+        ::close(listenFd);
+        ::close(wakeFds[0]);
+        ::close(wakeFds[1]);
+        listenFd = wakeFds[0] = wakeFds[1] = -1;
+
+        set_up_slots();  // Removes the slots
+    }
+
+    if (!port)
+        return true;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(uint16_t(port));
+
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+        return false;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd == -1)
+        return false;
+
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) || ::listen(fd, 128)
+        || ::pipe(wakeFds))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+
+    listenFd = fd;
+    exit     = false;
+    set_up_slots();
+    server = std::thread(&SessionServer::run, this);
+
+    return true;
+}
+
+// The server thread, multiplexing the connections of all the sessions
+void SessionServer::run() {
+
+    std::vector<pollfd> fds;
+    char                buffer[4096];
+
+    while (true)
+    {
+        fds.assign({{wakeFds[0], POLLIN, 0}, {listenFd, POLLIN, 0}});
+
+        for (auto& session : sessions)
+            fds.push_back({session->fd, POLLIN, 0});
+
+        if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+            break;
+
+        if (fds[0].revents)
+        {
+            while (::read(wakeFds[0], buffer, sizeof(buffer)) > 0)
+            {}
+
+            std::vector<Slot*> done;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (exit)
+                    break;
+
+                done.swap(finished);
+            }
+
+            for (Slot* slot : done)
+                finish(*slot);
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+
+            if (fd != -1)
+            {
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                sessions.push_back(std::make_shared<Session>(fd));
+            }
+        }
+
+        // The sessions polled, as handling their lines may close some of them
+        std::vector<std::shared_ptr<Session>> polled(sessions.begin(),
+                                                     sessions.begin() + (fds.size() - 2));
+
+        for (size_t i = 0; i < polled.size(); ++i)
+        {
+            if (!fds[i + 2].revents)
+                continue;
+
+            auto&   session = polled[i];
+            ssize_t n       = ::recv(session->fd, buffer, sizeof(buffer), 0);
+
+            if (n <= 0 || session->input.size() > MaxLineSize)
+            {
+                close(session);
+                continue;
+            }
+
+            session->input.append(buffer, size_t(n));
+
+            for (size_t end; (end = session->input.find('\n')) != std::string::npos;)
+            {
+                std::string line = session->input.substr(0, end);
+                session->input.erase(0, end + 1);
+
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+
+                handle(session, line);
+
+                if (std::find(sessions.begin(), sessions.end(), session) == sessions.end())
+                    break;
+            }
+        }
+
+        dispatch();
+    }
+
+    // Stop the searches, their slots keep the sessions until they are over
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        waiting.clear();
+
+        for (auto& slot : slots)
+            if (slot->session)
+                slot->threads.stop = true;
+    }
+
+    for (auto& slot : slots)
+        slot->threads.main_thread()->wait_for_search_finished();
+
+    sessions.clear();
+}
+
+#else
+
+SessionServer::Session::~Session() {}
+
+void SessionServer::Session::send(const std::string&) {}
+
+void SessionServer::wake() {}
+
+void SessionServer::close(const std::shared_ptr<Session>&) {}
+
+bool SessionServer::listen(int port, const std::string&) { return !port; }
+
+void SessionServer::run() {}
+
+#endif
+
+}  // namespace Stockfish
@@ -0,0 +1,139 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "search.h"
+#include "thread.h"
+#include "ucioption.h"
+
+namespace Stockfish {
+
+// Many UCI sessions in one process, to host many games at once. Each connection
+// to the "ServerPort" is a session with its own position and options, which
+// speaks UCI. The searches run on a fixed set of slots, thread pools sharing the
+// transposition table, the networks and the histories of the engine, given to
+// the sessions in the order of their "go" commands. The time of a search counts
+// from its "go" command, so waiting for a slot doesn't give a session more time.
+// The options a session sets only affect its searches, the options that are not
+// read by the search (Hash, Threads, EvalFile...) are the engine's. There is no
+// authentication, anyone who can connect gets the engine, so the server listens
+// on the loopback address unless the "ServerAddress" names another one.
+class SessionServer {
+    struct Session;
+
+   public:
+    struct Slot {
+        explicit Slot(const OptionsMap& engineOptions);
+
+        Search::SearchManager::UpdateContext updateContext;
+        OptionsMap                           options;  // Of the session searching
+        ThreadPool                           threads;
+
+        // Guarded by the mutex of the server, set while searching
+        std::shared_ptr<Session> session;
+
+        // The options changed by the session searching, with their values before
+        std::vector<std::pair<std::string, std::string>> changed;
+    };
+
+    using Slots = std::vector<std::unique_ptr<Slot>>;
+
+    // Stops the searches of the sessions and keeps new ones from starting, while
+    // the engine changes what the slots share. The slots are set up again once
+    // the last pause is over.
+    class Pause {
+       public:
+        explicit Pause(SessionServer& s) :
+            server(&s) {}
+        Pause(Pause&& other) noexcept :
+            server(other.server) {
+            other.server = nullptr;
+        }
+        Pause(const Pause&)            = delete;
+        Pause& operator=(const Pause&) = delete;
+        Pause& operator=(Pause&&)      = delete;
+        ~Pause() {
+            if (server)
+                server->resume();
+        }
+
+       private:
+        SessionServer* server;
+    };
+
+    SessionServer(const OptionsMap& options, std::function<void(Slots&)> setUpSlots);
+    ~SessionServer();
+
+    SessionServer(const SessionServer&)            = delete;
+    SessionServer& operator=(const SessionServer&) = delete;
+
+    // Accepts sessions on the given port of the given IPv4 address, or disconnects
+    // them and stops if the port is 0. Returns false if the address or the port
+    // can't be used.
+    bool listen(int port, const std::string& address);
+
+    [[nodiscard]] Pause pause();
+
+    size_t slot_count() const;
+
+   private:
+    void run();
+    void handle(const std::shared_ptr<Session>& session, const std::string& line);
+    void go(const std::shared_ptr<Session>& session, std::istringstream& is);
+    void dispatch();
+    void finish(Slot& slot);
+    void close(const std::shared_ptr<Session>& session);
+    void set_up_slots();
+    void resume();
+    void wake();
+
+    const OptionsMap&           engineOptions;
+    std::function<void(Slots&)> setUp;
+
+    int                                   listenFd = -1;
+    int                                   wakeFds[2]{-1, -1};
+    std::thread                           server;
+    std::vector<std::shared_ptr<Session>> sessions;  // Only used by the server thread
+
+    // Guarded by mutex
+    mutable std::mutex                   mutex;
+    std::condition_variable              cv;
+    Slots                                slots;
+    std::vector<Slot*>                   idle, finished;
+    std::deque<std::shared_ptr<Session>> waiting;
+    int                                  pauses = 0;
+    bool                                 exit   = false;
+};
+
+}  // namespace Stockfish
+
+#endif  // #ifndef SERVER_H_INCLUDED
@@ -21,24 +21,35 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string_view>
 #include <sys/stat.h>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "../bitboard.h"
+#include "../memory.h"
 #include "../misc.h"
 #include "../movegen.h"
+#include "../numa.h"
 #include "../position.h"
 #include "../search.h"
 #include "../types.h"
@@ -179,6 +190,38 @@ struct LR {
 
 static_assert(sizeof(LR) == 3, "LR tree entry must be 3 bytes");
 
+// Set by the search threads for the probes that must not wait on the storage.
+// Such a probe gives up, setting WouldBlock, before touching a page of a TB
+// file that is not in memory. The result of the probe is then meaningless.
+thread_local bool NonBlocking, WouldBlock;
+
+// Set by the search threads to the NUMA node they are bound to, so that their
+// probes read the copies of the WDL tables on that node, if there are any.
+thread_local size_t ProbeNode;
+
+// Whether the pages of [addr, addr + size) are in memory, so that reading them
+// doesn't wait on the storage. Always true where mincore() is not available.
+bool resident(const void* addr, size_t size) {
+#if defined(__linux__)
+    static const uintptr_t PageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+
+    const uintptr_t first = uintptr_t(addr) & ~(PageSize - 1);
+    const uintptr_t last  = (uintptr_t(addr) + size - 1) & ~(PageSize - 1);
+    unsigned char   vec[2];  // Blocks are at most 1024 bytes, so span at most two pages
+
+    assert(last - first <= PageSize);
+
+    if (mincore((void*) first, last - first + PageSize, vec))
+        return true;  // Let the probe go on, as without a residency check
+
+    return (vec[0] & 1) && (first == last || (vec[1] & 1));
+#else
+    (void) addr;
+    (void) size;
+    return true;
+#endif
+}
+
 // Tablebases data layout is structured as following:
 //
 //  TBFile:   memory maps/unmaps the physical .rtbw and .rtbz files
@@ -187,7 +230,7 @@ static_assert(sizeof(LR) == 3, "LR tree entry must be 3 bytes");
 
 // class TBFile memory maps/unmaps the single .rtbw and .rtbz files. Files are
 // memory mapped for best performance. Files are mapped at first access: at init
-// time only existence of the file is checked.
+// time only existence of the file is checked, unless they are preloaded.
 class TBFile: public std::ifstream {
 
     std::string fname;
@@ -221,7 +264,7 @@ class TBFile: public std::ifstream {
     }
 
     // Memory map the file and check it.
-    uint8_t* map(void** baseAddress, uint64_t* mapping, TBType type) {
+    uint8_t* map(void** baseAddress, uint64_t* mapping, uint64_t* size, TBType type) {
         if (is_open())
             close();  // Need to re-open to get native file descriptor
 
@@ -241,6 +284,7 @@ class TBFile: public std::ifstream {
         }
 
         *mapping     = statbuf.st_size;
+        *size        = statbuf.st_size;
         *baseAddress = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
     #if defined(MADV_RANDOM)
         madvise(*baseAddress, statbuf.st_size, MADV_RANDOM);
@@ -279,6 +323,7 @@ class TBFile: public std::ifstream {
         }
 
         *mapping     = uint64_t(mmap);
+        *size        = (uint64_t(size_high) << 32) | size_low;
         *baseAddress = MapViewOfFile(mmap, FILE_MAP_READ, 0, 0, 0);
 
         if (!*baseAddress)
@@ -290,11 +335,8 @@ class TBFile: public std::ifstream {
 #endif
         uint8_t* data = (uint8_t*) *baseAddress;
 
-        constexpr uint8_t Magics[][4] = {{0xD7, 0x66, 0x0C, 0xA5}, {0x71, 0xE8, 0x23, 0x5D}};
-
-        if (memcmp(data, Magics[type == WDL], 4))
+        if (!has_magic(data, type))
         {
-            std::cerr << "Corrupted table in file " << fname << std::endl;
             unmap(*baseAddress, *mapping);
             return *baseAddress = nullptr, nullptr;
         }
@@ -302,6 +344,65 @@ class TBFile: public std::ifstream {
         return data + 4;  // Skip Magics's header
     }
 
+    // Read the whole file into memory, backed by large pages when possible, and
+    // check it. Used instead of map() to preload the file.
+    uint8_t* read(void** baseAddress, uint64_t* mapping, TBType type) {
+        if (is_open())
+            close();  // Need to re-open in binary mode
+
+        std::ifstream file(fname, std::ios::binary | std::ios::ate);
+
+        if (!file)
+            return *baseAddress = nullptr, nullptr;
+
+        const uint64_t size = uint64_t(file.tellg());
+
+        if (size % 64 != 16)
+        {
+            std::cerr << "Corrupt tablebase file " << fname << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        *mapping     = size;
+        *baseAddress = aligned_large_pages_alloc(size);
+
+        if (!*baseAddress)
+        {
+            std::cerr << "Failed to allocate " << size << " bytes for " << fname << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        file.seekg(0);
+        file.read((char*) *baseAddress, std::streamsize(size));
+
+        if (!file)
+        {
+            std::cerr << "Could not read " << fname << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        uint8_t* data = (uint8_t*) *baseAddress;
+
+        if (!has_magic(data, type))
+        {
+            aligned_large_pages_free(*baseAddress);
+            return *baseAddress = nullptr, nullptr;
+        }
+
+        return data + 4;  // Skip Magics's header
+    }
+
+    bool has_magic(const uint8_t* data, TBType type) const {
+
+        constexpr uint8_t Magics[][4] = {{0xD7, 0x66, 0x0C, 0xA5}, {0x71, 0xE8, 0x23, 0x5D}};
+
+        if (!memcmp(data, Magics[type == WDL], 4))
+            return true;
+
+        std::cerr << "Corrupted table in file " << fname << std::endl;
+        return false;
+    }
+
     static void unmap(void* baseAddress, uint64_t mapping) {
 
 #ifndef _WIN32
@@ -353,9 +454,11 @@ struct TBTable {
     static constexpr int Sides = Type == WDL ? 2 : 1;
 
     std::atomic_bool ready;
+    bool             preloaded;
     void*            baseAddress;
     uint8_t*         map;
     uint64_t         mapping;
+    uint64_t         size;  // Of the file, once mapped or preloaded
     Key              key;
     Key              key2;
     int              pieceCount;
@@ -364,16 +467,23 @@ struct TBTable {
     uint8_t          pawnCount[2];     // [Lead color / other color]
     PairsData        items[Sides][4];  // [wtm / btm][FILE_A..FILE_D or 0]
 
+    // Copies of a preloaded WDL table in the memory of each NUMA node, by node
+    std::vector<std::unique_ptr<TBTable>> replicas;
+
     PairsData* get(int stm, int f) { return &items[stm % Sides][hasPawns ? f : 0]; }
 
     TBTable() :
         ready(false),
-        baseAddress(nullptr) {}
+        preloaded(false),
+        baseAddress(nullptr),
+        size(0) {}
     explicit TBTable(const std::string& code);
     explicit TBTable(const TBTable<WDL>& wdl);
 
     ~TBTable() {
-        if (baseAddress)
+        if (baseAddress && preloaded)
+            aligned_large_pages_free(baseAddress);
+        else if (baseAddress)
             TBFile::unmap(baseAddress, mapping);
     }
 };
@@ -420,6 +530,27 @@ TBTable<DTZ>::TBTable(const TBTable<WDL>& wdl) :
     pawnCount[1]    = wdl.pawnCount[1];
 }
 
+// Calls job(i) for i in [0, count) on up to maxThreads threads. Used at init
+// time for the file operations, which are mostly waiting on the storage, so
+// the number of threads does not depend on the number of cores.
+template<typename Job>
+void run_in_parallel(size_t count, size_t maxThreads, Job&& job) {
+
+    const size_t threadCount = std::min(count, maxThreads);
+
+    std::atomic<size_t>      next(0);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threadCount; ++t)
+        threads.emplace_back([&]() {
+            for (size_t i = next++; i < count; i = next++)
+                job(i);
+        });
+
+    for (auto& th : threads)
+        th.join();
+}
+
 // class TBTables creates and keeps ownership of the TBTable objects, one for
 // each TB file found. It supports a fast, hash-based, table lookup. Populated
 // at init time, accessed at probe time.
@@ -443,6 +574,7 @@ class TBTables {
 
     std::deque<TBTable<WDL>> wdlTable;
     std::deque<TBTable<DTZ>> dtzTable;
+    std::vector<std::string> codes;  // Like "KRvK", in the order of the tables
     size_t                   foundDTZFiles = 0;
     size_t                   foundWDLFiles = 0;
 
@@ -488,55 +620,381 @@ class TBTables {
         memset(hashTable, 0, sizeof(hashTable));
         wdlTable.clear();
         dtzTable.clear();
+        codes.clear();
         foundDTZFiles = 0;
         foundWDLFiles = 0;
     }
 
+    // Adds the bytes of the files mapped so far, of the preloaded ones and of
+    // their copies on the NUMA nodes
+    void memory(Tablebases::MemoryUse& use) const {
+        auto add = [&](const auto& e) {
+            if (e.ready.load(std::memory_order_acquire) && e.baseAddress)
+                (e.preloaded ? use.preloaded : use.mapped) += e.size;
+
+            for (const auto& r : e.replicas)
+                use.replicated += r->size;
+        };
+
+        for (const auto& e : wdlTable)
+            add(e);
+        for (const auto& e : dtzTable)
+            add(e);
+    }
+
     void info() const {
         sync_cout << "info string Found " << foundWDLFiles << " WDL and " << foundDTZFiles
                   << " DTZ tablebase files (up to " << MaxCardinality << "-man)." << sync_endl;
     }
 
-    void add(const std::vector<PieceType>& pieces);
+    void add(const std::vector<std::vector<PieceType>>& tables);
+    void preload(const std::string& mode);
+    void replicate(const NumaConfig& config, bool enabled);
 };
 
 TBTables TBTables;
 
+// Incremented by every init(), so that the probe caches drop stale results
+int TablesGeneration;
+
+// class AsyncProber runs the probes that the search deferred because they would
+// have waited on the storage. The result is not used: the probe reads the TB
+// file pages that the position needs, so that the search finds them in memory
+// when it probes the position again. Being mostly waiting on the storage, the
+// threads are not bound to the search threads or counted in the Threads option.
+class AsyncProber {
+
+    static constexpr size_t MaxQueued = 1024;
+
+    std::mutex                              mutex;
+    std::condition_variable                 cv;
+    std::deque<std::pair<Key, std::string>> queue;
+    std::unordered_set<Key>                 pending;  // Queued or being probed
+    std::vector<std::thread>                threads;
+    std::atomic<bool>                       running{false};
+    bool                                    exit = false;
+
+    void idle_loop() {
+
+        while (true)
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return exit || !queue.empty(); });
+
+            if (exit)
+                return;
+
+            auto [key, fen] = std::move(queue.front());
+            queue.pop_front();
+            lk.unlock();
+
+            StateInfo  st;
+            Position   pos;
+            ProbeState result;
+
+            pos.set(fen, false, &st);
+            Tablebases::probe_wdl(pos, &result);
+
+            lk.lock();
+            pending.erase(key);
+            cv.notify_all();  // Wake up wait_idle()
+        }
+    }
+
+   public:
+    ~AsyncProber() { resize(0); }
+
+    bool enabled() const { return running.load(std::memory_order_relaxed); }
+
+    void resize(size_t count) {
+
+        {
+            std::scoped_lock<std::mutex> lk(mutex);
+            exit = true;
+            queue.clear();
+            pending.clear();
+        }
+        cv.notify_all();
+
+        for (auto& th : threads)
+            th.join();
+
+        threads.clear();
+        exit = false;
+
+        for (size_t i = 0; i < count; ++i)
+            threads.emplace_back(&AsyncProber::idle_loop, this);
+
+        running = count > 0;
+    }
+
+    // Queues the position unless it already is, or the queue is full
+    void push(const Position& pos) {
+
+        {
+            std::scoped_lock<std::mutex> lk(mutex);
+
+            if (queue.size() >= MaxQueued || !pending.insert(pos.key()).second)
+                return;
+
+            queue.emplace_back(pos.key(), pos.fen());
+        }
+        cv.notify_one();
+    }
+
+    // Drops the queued probes and waits for the running ones, so that the
+    // tables can be changed.
+    void wait_idle() {
+
+        std::unique_lock<std::mutex> lk(mutex);
+
+        for (const auto& [key, fen] : queue)
+            pending.erase(key);
+
+        queue.clear();
+        cv.wait(lk, [&] { return pending.empty(); });
+    }
+};
+
+AsyncProber AsyncProbes;
+
 // If the corresponding file exists two new objects TBTable<WDL> and TBTable<DTZ>
 // are created and added to the lists and hash table. Called at init time.
-void TBTables::add(const std::vector<PieceType>& pieces) {
+void TBTables::add(const std::vector<std::vector<PieceType>>& tables) {
 
-    std::string code;
+    // Look for the files of all the tables at once: on network storage each
+    // lookup may take milliseconds, so do them in parallel.
+    std::vector<std::string> tableCodes(tables.size());
+    std::vector<uint8_t>     hasWDL(tables.size()), hasDTZ(tables.size());
 
-    for (PieceType pt : pieces)
-        code += PieceToChar[pt];
-    code.insert(code.find('K', 1), "v");
+    run_in_parallel(tables.size(), 16, [&](size_t i) {
+        for (PieceType pt : tables[i])
+            tableCodes[i] += PieceToChar[pt];
+        tableCodes[i].insert(tableCodes[i].find('K', 1), "v");  // KRK -> KRvK
 
-    TBFile file_dtz(code + ".rtbz");  // KRK -> KRvK
-    if (file_dtz.is_open())
+        hasDTZ[i] = TBFile(tableCodes[i] + ".rtbz").is_open();
+        hasWDL[i] = TBFile(tableCodes[i] + ".rtbw").is_open();
+    });
+
+    // Then create the tables in the order of the list
+    for (size_t i = 0; i < tables.size(); ++i)
     {
-        file_dtz.close();
-        foundDTZFiles++;
+        foundDTZFiles += hasDTZ[i];
+
+        if (!hasWDL[i])  // Only WDL file is checked
+            continue;
+
+        foundWDLFiles++;
+
+        MaxCardinality = std::max(int(tables[i].size()), MaxCardinality);
+
+        wdlTable.emplace_back(tableCodes[i]);
+        dtzTable.emplace_back(wdlTable.back());
+        codes.push_back(tableCodes[i]);
+
+        // Insert into the hash keys for both colors: KRvK with KR white and black
+        insert(wdlTable.back().key, &wdlTable.back(), &dtzTable.back());
+        insert(wdlTable.back().key2, &wdlTable.back(), &dtzTable.back());
     }
+}
 
-    TBFile file(code + ".rtbw");  // KRK -> KRvK
+// Calls f(sym) for the symbols of the block starting at ptr, in order, until f
+// returns true, and returns that symbol.
+template<typename F>
+Sym read_symbols(PairsData* d, uint32_t* ptr, F&& f) {
 
-    if (!file.is_open())  // Only WDL file is checked
-        return;
+    // Read the first 64 bits in our block, this is a (truncated) sequence of
+    // unknown number of symbols of unknown length but we know the first one
+    // is at the beginning of this 64-bit sequence.
+    uint64_t buf64 = number<uint64_t, BigEndian>(ptr);
+    ptr += 2;
+    int buf64Size = 64;
+
+    while (true)
+    {
+        int len = 0;  // This is the symbol length - d->min_sym_len
 
-    file.close();
-    foundWDLFiles++;
+        // Now get the symbol length. For any symbol s64 of length l right-padded
+        // to 64 bits we know that d->base64[l-1] >= s64 >= d->base64[l] so we
+        // can find the symbol length iterating through base64[].
+        while (buf64 < d->base64[len])
+            ++len;
 
-    MaxCardinality = std::max(int(pieces.size()), MaxCardinality);
+        // All the symbols of a given length are consecutive integers (numerical
+        // sequence property), so we can compute the offset of our symbol of
+        // length len, stored at the beginning of buf64.
+        Sym sym = Sym((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+
+        // Now add the value of the lowest symbol of length len to get our symbol
+        sym += number<Sym, LittleEndian>(&d->lowestSym[len]);
 
-    wdlTable.emplace_back(code);
-    dtzTable.emplace_back(wdlTable.back());
+        if (f(sym))
+            return sym;
 
-    // Insert into the hash keys for both colors: KRvK with KR white and black
-    insert(wdlTable.back().key, &wdlTable.back(), &dtzTable.back());
-    insert(wdlTable.back().key2, &wdlTable.back(), &dtzTable.back());
+        len += d->minSymLen;  // Get the real length
+        buf64 <<= len;        // Consume the just processed symbol
+        buf64Size -= len;
+
+        if (buf64Size <= 32)
+        {  // Refill the buffer
+            buf64Size += 32;
+            buf64 |= uint64_t(number<uint32_t, BigEndian>(ptr++)) << (64 - buf64Size);
+        }
+    }
 }
 
+// class BlockCache keeps the recently decompressed blocks, shared by all the
+// threads and split in shards, each with its own lock and LRU list. A block is
+// stored as the list of its symbols, each with the offset of its first value,
+// so that a probe finds its symbol with a binary search instead of reading the
+// symbols of the block from the start. Only blocks larger than a cache line,
+// mostly the DTZ ones, are cached: smaller blocks are faster to read again.
+class BlockCache {
+
+    static constexpr size_t ShardsNb = 64;
+
+    struct BlockKey {
+        const PairsData* d;
+        uint32_t         block;
+
+        bool operator==(const BlockKey& k) const { return d == k.d && block == k.block; }
+    };
+
+    struct BlockKeyHash {
+        size_t operator()(const BlockKey& k) const {
+            return std::hash<const void*>()(k.d) ^ (size_t(k.block) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    // The symbols of a block, packed as (offset of the first value << 16) | symbol
+    using Symbols = std::vector<uint32_t>;
+    using LRUList = std::list<std::pair<BlockKey, Symbols>>;
+    using Index   = std::unordered_map<BlockKey, LRUList::iterator, BlockKeyHash>;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        LRUList    lru;  // Most recent first
+        Index      blocks;
+        size_t     bytes  = 0;
+        uint64_t   probes = 0, hits = 0;
+    };
+
+    static size_t bytes_of(const Symbols& symbols) {
+        return symbols.size() * sizeof(uint32_t) + sizeof(LRUList::value_type) + 64;
+    }
+
+    // Finds the symbol holding the value at the given offset in the block, and
+    // makes the offset relative to the first value of that symbol.
+    static Sym find(const Symbols& symbols, int& offset) {
+
+        const uint32_t last = (uint32_t(offset) << 16) | 0xFFFF;
+
+        auto it = std::upper_bound(symbols.begin(), symbols.end(), last);
+        offset -= int(*--it >> 16);
+        return Sym(*it & 0xFFFF);
+    }
+
+    Shard  shards[ShardsNb];
+    size_t shardCapacity = 0;
+
+   public:
+    bool enabled() const { return shardCapacity > 0; }
+
+    // Sets the total size in MiB, 0 disables the cache. Not thread safe.
+    void resize(size_t mb) {
+        clear();
+        shardCapacity = mb * 1024 * 1024 / ShardsNb;
+    }
+
+    // Drops all the blocks, the stats are kept. Not thread safe.
+    void clear() {
+        for (auto& s : shards)
+        {
+            s.blocks.clear();
+            s.lru.clear();
+            s.bytes = 0;
+        }
+    }
+
+    size_t bytes() {
+
+        size_t sum = 0;
+        for (auto& s : shards)
+        {
+            std::scoped_lock<std::mutex> lk(s.mutex);
+            sum += s.bytes;
+        }
+        return sum;
+    }
+
+    std::pair<uint64_t, uint64_t> probes_and_hits() {
+
+        uint64_t probes = 0, hits = 0;
+        for (auto& s : shards)
+        {
+            std::scoped_lock<std::mutex> lk(s.mutex);
+            probes += s.probes;
+            hits += s.hits;
+        }
+        return {probes, hits};
+    }
+
+    // Returns the symbol holding the value at the given offset of the block,
+    // starting at ptr, decompressing the block on a miss. Same as reading the
+    // symbols until the offset is reached.
+    Sym symbol(PairsData* d, uint32_t block, uint32_t* ptr, int& offset) {
+
+        const BlockKey key{d, block};
+        Shard&         s = shards[BlockKeyHash()(key) % ShardsNb];
+
+        {
+            std::scoped_lock<std::mutex> lk(s.mutex);
+
+            ++s.probes;
+
+            if (auto it = s.blocks.find(key); it != s.blocks.end())
+            {
+                ++s.hits;
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                return find(it->second->second, offset);
+            }
+        }
+
+        // Decompress the whole block out of the lock, other threads may do the same
+        Symbols   symbols;
+        const int count = d->blockLength[block] + 1;
+        int       first = 0;
+
+        read_symbols(d, ptr, [&](Sym sym) {
+            symbols.push_back((uint32_t(first) << 16) | sym);
+            first += d->symlen[sym] + 1;
+            return first >= count;
+        });
+
+        Sym sym = find(symbols, offset);
+
+        std::scoped_lock<std::mutex> lk(s.mutex);
+
+        if (s.blocks.count(key))
+            return sym;
+
+        s.bytes += bytes_of(symbols);
+        s.lru.emplace_front(key, std::move(symbols));
+        s.blocks[key] = s.lru.begin();
+
+        while (s.bytes > shardCapacity && !s.lru.empty())
+        {
+            s.bytes -= bytes_of(s.lru.back().second);
+            s.blocks.erase(s.lru.back().first);
+            s.lru.pop_back();
+        }
+
+        return sym;
+    }
+};
+
+BlockCache BlockCache;
+
 // TB tables are compressed with canonical Huffman code. The compressed data is divided into
 // blocks of size d->sizeofBlock, and each block stores a variable number of symbols.
 // Each symbol represents either a WDL or a (remapped) DTZ value, or a pair of other symbols
@@ -552,6 +1010,9 @@ void TBTables::add(const std::vector<PieceType>& pieces) {
 // Huffman codes are the same for all blocks in the table. A non-symmetric pawnless TB file
 // will have one table for wtm and one for btm, a TB file with pawns will have tables per
 // file a,b,c,d also, in this case, one set for wtm and one for btm.
+//
+// In a non-blocking probe, the function returns early with WouldBlock set when
+// the TB file pages it needs are not in memory.
 int decompress_pairs(PairsData* d, uint64_t idx) {
 
     // Special case where all table positions store the same value
@@ -575,6 +1036,9 @@ int decompress_pairs(PairsData* d, uint64_t idx) {
     // First step is to get the 'k' of the I(k) nearest to our idx, using definition (1)
     uint32_t k = uint32_t(idx / d->span);
 
+    if (NonBlocking && !resident(&d->sparseIndex[k], sizeof(SparseEntry)))
+        return WouldBlock = true, 0;
+
     // Then we read the corresponding SparseIndex[] entry
     uint32_t block  = number<uint32_t, LittleEndian>(&d->sparseIndex[k].block);
     int      offset = number<uint16_t, LittleEndian>(&d->sparseIndex[k].offset);
@@ -589,6 +1053,9 @@ int decompress_pairs(PairsData* d, uint64_t idx) {
     // Sum the above to offset to find the offset corresponding to our idx
     offset += diff;
 
+    if (NonBlocking && !resident(&d->blockLength[block], sizeof(uint16_t)))
+        return WouldBlock = true, 0;
+
     // Move to the previous/next block, until we reach the correct block that contains idx,
     // that is when 0 <= offset <= d->blockLength[block]
     while (offset < 0)
@@ -600,49 +1067,22 @@ int decompress_pairs(PairsData* d, uint64_t idx) {
     // Finally, we find the start address of our block of canonical Huffman symbols
     uint32_t* ptr = (uint32_t*) (d->data + (uint64_t(block) * d->sizeofBlock));
 
-    // Read the first 64 bits in our block, this is a (truncated) sequence of
-    // unknown number of symbols of unknown length but we know the first one
-    // is at the beginning of this 64-bit sequence.
-    uint64_t buf64 = number<uint64_t, BigEndian>(ptr);
-    ptr += 2;
-    int buf64Size = 64;
-    Sym sym;
+    if (NonBlocking && !resident(ptr, d->sizeofBlock))
+        return WouldBlock = true, 0;
 
-    while (true)
-    {
-        int len = 0;  // This is the symbol length - d->min_sym_len
+    // Get the symbol that holds our value, reading the symbols from the start of
+    // the block, unless the block is cached
+    Sym sym = BlockCache.enabled() && d->sizeofBlock > 64
+              ? BlockCache.symbol(d, block, ptr, offset)
+              : read_symbols(d, ptr, [&](Sym s) {
+                    // If our offset is within the number of values represented by
+                    // symbol s, we are done, otherwise update the offset and continue.
+                    if (offset < d->symlen[s] + 1)
+                        return true;
 
-        // Now get the symbol length. For any symbol s64 of length l right-padded
-        // to 64 bits we know that d->base64[l-1] >= s64 >= d->base64[l] so we
-        // can find the symbol length iterating through base64[].
-        while (buf64 < d->base64[len])
-            ++len;
-
-        // All the symbols of a given length are consecutive integers (numerical
-        // sequence property), so we can compute the offset of our symbol of
-        // length len, stored at the beginning of buf64.
-        sym = Sym((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
-
-        // Now add the value of the lowest symbol of length len to get our symbol
-        sym += number<Sym, LittleEndian>(&d->lowestSym[len]);
-
-        // If our offset is within the number of values represented by symbol sym,
-        // we are done.
-        if (offset < d->symlen[sym] + 1)
-            break;
-
-        // ...otherwise update the offset and continue to iterate
-        offset -= d->symlen[sym] + 1;
-        len += d->minSymLen;  // Get the real length
-        buf64 <<= len;        // Consume the just processed symbol
-        buf64Size -= len;
-
-        if (buf64Size <= 32)
-        {  // Refill the buffer
-            buf64Size += 32;
-            buf64 |= uint64_t(number<uint32_t, BigEndian>(ptr++)) << (64 - buf64Size);
-        }
-    }
+                    offset -= d->symlen[s] + 1;
+                    return false;
+                });
 
     // Now we have our symbol that expands into d->symlen[sym] + 1 symbols.
     // We binary-search for our value recursively expanding into the left and
@@ -1220,6 +1660,10 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     if (e.ready.load(std::memory_order_acquire))
         return e.baseAddress;  // Could be nullptr if file does not exist
 
+    // Mapping the file reads its header, leave that to a blocking probe
+    if (NonBlocking)
+        return WouldBlock = true, nullptr;
+
     std::scoped_lock<std::mutex> lk(mutex);
 
     if (e.ready.load(std::memory_order_relaxed))  // Recheck under lock
@@ -1236,7 +1680,7 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     fname =
       (e.key == pos.material_key() ? w + 'v' + b : b + 'v' + w) + (Type == WDL ? ".rtbw" : ".rtbz");
 
-    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
+    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, &e.size, Type);
 
     if (data)
         set(e, data);
@@ -1245,6 +1689,143 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     return e.baseAddress;
 }
 
+// Read the TB file of the table into memory and init it, so that mapped() finds
+// it ready. Returns the number of bytes read. Called at init time only.
+template<TBType Type>
+uint64_t preload_table(TBTable<Type>& e, const std::string& code) {
+
+    uint8_t* data = TBFile(code + (Type == WDL ? ".rtbw" : ".rtbz"))
+                      .read(&e.baseAddress, &e.mapping, Type);
+
+    if (data)
+    {
+        e.preloaded = true;
+        e.size      = e.mapping;
+        set(e, data);
+    }
+
+    e.ready.store(true, std::memory_order_release);
+    return data ? e.mapping : 0;
+}
+
+// Preload the tables selected by the SyzygyPreload option: "all", "wdl" for all
+// the WDL tables only, or a number of pieces for the tables up to that many
+// pieces. The files are read in parallel, which helps on network storage.
+void TBTables::preload(const std::string& mode) {
+
+    const bool wdlOnly   = mode == "wdl";
+    int        maxPieces = 0;
+
+    if (mode == "all" || wdlOnly)
+        maxPieces = TBPIECES;
+    else if (mode.size() == 1 && std::isdigit(mode[0]))
+        maxPieces = mode[0] - '0';
+
+    std::vector<std::function<uint64_t()>> jobs;
+
+    for (size_t i = 0; i < wdlTable.size(); ++i)
+        if (wdlTable[i].pieceCount <= maxPieces)
+        {
+            jobs.push_back([this, i]() { return preload_table(wdlTable[i], codes[i]); });
+
+            if (!wdlOnly)
+                jobs.push_back([this, i]() { return preload_table(dtzTable[i], codes[i]); });
+        }
+
+    if (jobs.empty())
+        return;
+
+    std::atomic<size_t>   files(0);
+    std::atomic<uint64_t> bytes(0);
+    TimePoint             elapsed = now();
+
+    run_in_parallel(jobs.size(), 8, [&](size_t j) {
+        if (uint64_t size = jobs[j]())
+        {
+            bytes += size;
+            ++files;
+        }
+    });
+
+    elapsed = now() - elapsed;
+
+    sync_cout << "info string Preloaded " << files << " tablebase files ("
+              << bytes / (1024 * 1024) << " MiB) in " << elapsed << " ms." << sync_endl;
+}
+
+// Copies the preloaded WDL tables into the memory of each NUMA node, from a
+// thread bound to the node, so that the search threads of the node probe a local
+// copy instead of the pages of a single node. Without replication, the copies
+// are dropped. The mapped files stay shared, the system places their pages.
+// Called at init time only.
+void TBTables::replicate(const NumaConfig& config, bool enabled) {
+
+    // The cached blocks are keyed by the address of their table
+    BlockCache.clear();
+
+    for (auto& e : wdlTable)
+        e.replicas.clear();
+
+    if (!enabled || !config.requires_memory_replication())
+        return;
+
+    size_t    files   = 0;
+    uint64_t  bytes   = 0;
+    TimePoint elapsed = now();
+
+    for (auto& e : wdlTable)
+        if (e.preloaded && e.baseAddress)
+        {
+            e.replicas.resize(config.num_numa_nodes());
+            ++files;
+        }
+
+    if (!files)
+        return;
+
+    for (NumaIndex n = 0; n < config.num_numa_nodes(); ++n)
+        config.execute_on_numa_node(n, [&]() {
+            for (size_t i = 0; i < wdlTable.size(); ++i)
+                if (auto& e = wdlTable[i]; !e.replicas.empty())
+                {
+                    auto r = std::make_unique<TBTable<WDL>>();
+
+                    r->key             = e.key;
+                    r->key2            = e.key2;
+                    r->pieceCount      = e.pieceCount;
+                    r->hasPawns        = e.hasPawns;
+                    r->hasUniquePieces = e.hasUniquePieces;
+                    r->pawnCount[0]    = e.pawnCount[0];
+                    r->pawnCount[1]    = e.pawnCount[1];
+                    r->preloaded       = true;
+                    r->mapping         = e.size;
+                    r->size            = e.size;
+                    r->baseAddress     = aligned_large_pages_alloc(e.size);
+
+                    if (!r->baseAddress)
+                    {
+                        std::cerr << "Failed to allocate " << e.size << " bytes for a copy of "
+                                  << codes[i] << std::endl;
+                        exit(EXIT_FAILURE);
+                    }
+
+                    // Written by this thread, so the pages are on its node
+                    std::memcpy(r->baseAddress, e.baseAddress, e.size);
+                    set(*r, (uint8_t*) r->baseAddress + 4);
+                    r->ready.store(true, std::memory_order_release);
+
+                    bytes += e.size;
+                    e.replicas[n] = std::move(r);
+                }
+        });
+
+    elapsed = now() - elapsed;
+
+    sync_cout << "info string Replicated " << files << " WDL tablebase files ("
+              << bytes / (1024 * 1024) << " MiB) on " << config.num_numa_nodes()
+              << " NUMA nodes in " << elapsed << " ms." << sync_endl;
+}
+
 template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
 Ret probe_table(const Position& pos, ProbeState* result, WDLScore wdl = WDLDraw) {
 
@@ -1256,6 +1837,10 @@ Ret probe_table(const Position& pos, ProbeState* result, WDLScore wdl = WDLDraw)
     if (!entry || !mapped(*entry, pos))
         return *result = FAIL, Ret();
 
+    // Read the copy of the table on the NUMA node of the thread, if there is one
+    if (ProbeNode < entry->replicas.size())
+        entry = entry->replicas[ProbeNode].get();
+
     return do_probe_table(pos, entry, wdl, result);
 }
 
@@ -1337,12 +1922,16 @@ WDLScore search(Position& pos, ProbeState* result) {
 
 // Called at startup and after every change to
 // "SyzygyPath" UCI option to (re)create the various tables. It is not thread
-// safe, nor it needs to be.
-void Tablebases::init(const std::string& paths) {
+// safe, nor it needs to be. The tables selected by the preload mode are read
+// into memory before returning, see TBTables::preload().
+void Tablebases::init(const std::string& paths, const std::string& preload) {
 
+    AsyncProbes.wait_idle();
+    BlockCache.clear();
     TBTables.clear();
     MaxCardinality = 0;
     TBFile::Paths  = paths;
+    ++TablesGeneration;
 
     if (paths.empty())
         return;
@@ -1442,49 +2031,53 @@ void Tablebases::init(const std::string& paths) {
         }
 
     // Add entries in TB tables if the corresponding ".rtbw" file exists
+    std::vector<std::vector<PieceType>> tables;
+
     for (PieceType p1 = PAWN; p1 < KING; ++p1)
     {
-        TBTables.add({KING, p1, KING});
+        tables.push_back({KING, p1, KING});
 
         for (PieceType p2 = PAWN; p2 <= p1; ++p2)
         {
-            TBTables.add({KING, p1, p2, KING});
-            TBTables.add({KING, p1, KING, p2});
+            tables.push_back({KING, p1, p2, KING});
+            tables.push_back({KING, p1, KING, p2});
 
             for (PieceType p3 = PAWN; p3 < KING; ++p3)
-                TBTables.add({KING, p1, p2, KING, p3});
+                tables.push_back({KING, p1, p2, KING, p3});
 
             for (PieceType p3 = PAWN; p3 <= p2; ++p3)
             {
-                TBTables.add({KING, p1, p2, p3, KING});
+                tables.push_back({KING, p1, p2, p3, KING});
 
                 for (PieceType p4 = PAWN; p4 <= p3; ++p4)
                 {
-                    TBTables.add({KING, p1, p2, p3, p4, KING});
+                    tables.push_back({KING, p1, p2, p3, p4, KING});
 
                     for (PieceType p5 = PAWN; p5 <= p4; ++p5)
-                        TBTables.add({KING, p1, p2, p3, p4, p5, KING});
+                        tables.push_back({KING, p1, p2, p3, p4, p5, KING});
 
                     for (PieceType p5 = PAWN; p5 < KING; ++p5)
-                        TBTables.add({KING, p1, p2, p3, p4, KING, p5});
+                        tables.push_back({KING, p1, p2, p3, p4, KING, p5});
                 }
 
                 for (PieceType p4 = PAWN; p4 < KING; ++p4)
                 {
-                    TBTables.add({KING, p1, p2, p3, KING, p4});
+                    tables.push_back({KING, p1, p2, p3, KING, p4});
 
                     for (PieceType p5 = PAWN; p5 <= p4; ++p5)
-                        TBTables.add({KING, p1, p2, p3, KING, p4, p5});
+                        tables.push_back({KING, p1, p2, p3, KING, p4, p5});
                 }
             }
 
             for (PieceType p3 = PAWN; p3 <= p1; ++p3)
                 for (PieceType p4 = PAWN; p4 <= (p1 == p3 ? p2 : p3); ++p4)
-                    TBTables.add({KING, p1, p2, KING, p3, p4});
+                    tables.push_back({KING, p1, p2, KING, p3, p4});
         }
     }
 
+    TBTables.add(tables);
     TBTables.info();
+    TBTables.preload(preload);
 }
 
 // Probe the WDL table for a particular position.
@@ -1501,6 +2094,84 @@ WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result) {
     return search<false>(pos, result);
 }
 
+// Starts the given number of threads for the deferred probes, 0 to disable them.
+// Called when the "SyzygyAsyncThreads" option changes, while not searching.
+void Tablebases::set_async_threads(size_t count) { AsyncProbes.resize(count); }
+
+// Copies the preloaded WDL tables to each NUMA node of the config, or drops the
+// copies. Called when the tables, the NUMA config or the "SyzygyNumaReplicate"
+// option change, while not searching.
+void Tablebases::replicate(const NumaConfig& config, bool enabled) {
+    TBTables.replicate(config, enabled);
+}
+
+// Sets the size in MiB of the cache of decompressed blocks, 0 to disable it.
+// Called when the "SyzygyBlockCache" option changes, while not searching.
+void Tablebases::set_block_cache_size(size_t mb) { BlockCache.resize(mb); }
+
+// Number of lookups in the cache of decompressed blocks and how many of them
+// found the block, since the start of the program.
+std::pair<uint64_t, uint64_t> Tablebases::block_cache_probes_and_hits() {
+    return BlockCache.probes_and_hits();
+}
+
+Tablebases::MemoryUse Tablebases::memory_use() {
+
+    MemoryUse use{0, 0, 0, BlockCache.bytes()};
+    TBTables.memory(use);
+    return use;
+}
+
+// Like probe_wdl(), but first looks up the position in the cache
+WDLScore Tablebases::WDLCache::probe(Position& pos, ProbeState* result, bool mayDefer) {
+
+    if (generation != TablesGeneration)
+        clear();
+
+    Entry& e = entries[pos.key() & (Size - 1)];
+
+    ++stats.probes;
+
+    if (e.key == pos.key())
+    {
+        ++stats.hits;
+        *result = ProbeState(e.state);
+        return WDLScore(e.wdl);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    NonBlocking  = mayDefer && AsyncProbes.enabled();
+    WouldBlock   = false;
+    ProbeNode    = numaNode;
+    WDLScore wdl = probe_wdl(pos, result);
+    NonBlocking  = false;
+    ProbeNode    = 0;
+
+    stats.missNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    // Not cached: when the search comes back, the pages should be in memory
+    if (WouldBlock)
+    {
+        AsyncProbes.push(pos);
+        ++stats.deferred;
+        return *result = FAIL, WDLDraw;
+    }
+
+    e = {pos.key(), int8_t(wdl), int8_t(*result)};
+    return wdl;
+}
+
+void Tablebases::WDLCache::clear() {
+
+    for (auto& e : entries)
+        e = {0, 0, 0};
+
+    generation = TablesGeneration;
+}
+
 // Probe the DTZ table for a particular position.
 // If *result != FAIL, the probe was successful.
 // The return value is from the point of view of the side to move:
@@ -1589,16 +2260,44 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
 }
 
 
+namespace {
+
+// Probes every root move with the given runner, or serially on the root position
+// if there is none. Returns false if any of the probes failed, in which case the
+// remaining moves may not have been probed.
+template<typename ProbeMove>
+bool probe_root_moves(Position&                          pos,
+                      const Search::RootMoves&           rootMoves,
+                      const Tablebases::RootProbeRunner& runner,
+                      ProbeMove                          probeMove) {
+
+    std::atomic<bool> failed{false};
+
+    auto job = [&](Position& p, size_t i) {
+        if (!failed.load(std::memory_order_relaxed) && !probeMove(p, rootMoves[i].pv[0], i))
+            failed = true;
+    };
+
+    if (runner)
+        runner(rootMoves.size(), job);
+    else
+        for (size_t i = 0; i < rootMoves.size(); ++i)
+            job(pos, i);
+
+    return !failed;
+}
+
+}  // namespace
+
+
 // Use the DTZ tables to rank root moves.
 //
 // A return value false indicates that not all probes were successful.
-bool Tablebases::root_probe(Position&          pos,
-                            Search::RootMoves& rootMoves,
-                            bool               rule50,
-                            bool               rankDTZ) {
-
-    ProbeState result = OK;
-    StateInfo  st;
+bool Tablebases::root_probe(Position&              pos,
+                            Search::RootMoves&     rootMoves,
+                            bool                   rule50,
+                            bool                   rankDTZ,
+                            const RootProbeRunner& runner) {
 
     // Obtain 50-move counter for the root position
     int cnt50 = pos.rule50_count();
@@ -1606,42 +2305,54 @@ bool Tablebases::root_probe(Position&          pos,
     // Check whether a position was repeated since the last zeroing move.
     bool rep = pos.has_repeated();
 
-    int dtz, bound = rule50 ? (MAX_DTZ / 2 - 100) : 1;
+    int              bound = rule50 ? (MAX_DTZ / 2 - 100) : 1;
+    std::vector<int> dtzs(rootMoves.size());
 
-    // Probe and rank each move
-    for (auto& m : rootMoves)
-    {
-        pos.do_move(m.pv[0], st);
+    // Probe each move, possibly in parallel
+    if (!probe_root_moves(pos, rootMoves, runner, [&](Position& p, Move move, size_t i) {
+            ProbeState result = OK;
+            StateInfo  st;
+            int        dtz;
 
-        // Calculate dtz for the current move counting from the root position
-        if (pos.rule50_count() == 0)
-        {
-            // In case of a zeroing move, dtz is one of -101/-1/0/1/101
-            WDLScore wdl = -probe_wdl(pos, &result);
-            dtz          = dtz_before_zeroing(wdl);
-        }
-        else if ((rule50 && pos.is_draw(1)) || pos.is_repetition(1))
-        {
-            // In case a root move leads to a draw by repetition or 50-move rule,
-            // we set dtz to zero. Note: since we are only 1 ply from the root,
-            // this must be a true 3-fold repetition inside the game history.
-            dtz = 0;
-        }
-        else
-        {
-            // Otherwise, take dtz for the new position and correct by 1 ply
-            dtz = -probe_dtz(pos, &result);
-            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
-        }
+            p.do_move(move, st);
 
-        // Make sure that a mating move is assigned a dtz value of 1
-        if (pos.checkers() && dtz == 2 && MoveList<LEGAL>(pos).size() == 0)
-            dtz = 1;
+            // Calculate dtz for the current move counting from the root position
+            if (p.rule50_count() == 0)
+            {
+                // In case of a zeroing move, dtz is one of -101/-1/0/1/101
+                WDLScore wdl = -probe_wdl(p, &result);
+                dtz          = dtz_before_zeroing(wdl);
+            }
+            else if ((rule50 && p.is_draw(1)) || p.is_repetition(1))
+            {
+                // In case a root move leads to a draw by repetition or 50-move rule,
+                // we set dtz to zero. Note: since we are only 1 ply from the root,
+                // this must be a true 3-fold repetition inside the game history.
+                dtz = 0;
+            }
+            else
+            {
+                // Otherwise, take dtz for the new position and correct by 1 ply
+                dtz = -probe_dtz(p, &result);
+                dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+            }
+
+            // Make sure that a mating move is assigned a dtz value of 1
+            if (p.checkers() && dtz == 2 && MoveList<LEGAL>(p).size() == 0)
+                dtz = 1;
+
+            p.undo_move(move);
 
-        pos.undo_move(m.pv[0]);
+            dtzs[i] = dtz;
+            return result != FAIL;
+        }))
+        return false;
 
-        if (result == FAIL)
-            return false;
+    // Rank each move
+    for (size_t i = 0; i < rootMoves.size(); ++i)
+    {
+        auto& m   = rootMoves[i];
+        int   dtz = dtzs[i];
 
         // Better moves are ranked higher. Certain wins are ranked equally.
         // Losing moves are ranked equally unless a 50-move draw is in sight.
@@ -1671,29 +2382,35 @@ bool Tablebases::root_probe(Position&          pos,
 // This is a fallback for the case that some or all DTZ tables are missing.
 //
 // A return value false indicates that not all probes were successful.
-bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50) {
+bool Tablebases::root_probe_wdl(Position&              pos,
+                                Search::RootMoves&     rootMoves,
+                                bool                   rule50,
+                                const RootProbeRunner& runner) {
 
     static const int WDL_to_rank[] = {-MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
 
-    ProbeState result = OK;
-    StateInfo  st;
-    WDLScore   wdl;
+    std::vector<WDLScore> wdls(rootMoves.size());
 
+    // Probe each move, possibly in parallel
+    if (!probe_root_moves(pos, rootMoves, runner, [&](Position& p, Move move, size_t i) {
+            ProbeState result = OK;
+            StateInfo  st;
 
-    // Probe and rank each move
-    for (auto& m : rootMoves)
-    {
-        pos.do_move(m.pv[0], st);
+            p.do_move(move, st);
 
-        if (pos.is_draw(1))
-            wdl = WDLDraw;
-        else
-            wdl = -probe_wdl(pos, &result);
+            wdls[i] = p.is_draw(1) ? WDLDraw : -probe_wdl(p, &result);
 
-        pos.undo_move(m.pv[0]);
+            p.undo_move(move);
 
-        if (result == FAIL)
-            return false;
+            return result != FAIL;
+        }))
+        return false;
+
+    // Rank each move
+    for (size_t i = 0; i < rootMoves.size(); ++i)
+    {
+        auto&    m   = rootMoves[i];
+        WDLScore wdl = wdls[i];
 
         m.tbRank = WDL_to_rank[wdl + 2];
 
@@ -1705,10 +2422,11 @@ bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, boo
     return true;
 }
 
-Config Tablebases::rank_root_moves(const OptionsMap&  options,
-                                   Position&          pos,
-                                   Search::RootMoves& rootMoves,
-                                   bool               rankDTZ) {
+Config Tablebases::rank_root_moves(const OptionsMap&      options,
+                                   Position&              pos,
+                                   Search::RootMoves&     rootMoves,
+                                   bool                   rankDTZ,
+                                   const RootProbeRunner& runner) {
     Config config;
 
     if (rootMoves.empty())
@@ -1732,13 +2450,13 @@ Config Tablebases::rank_root_moves(const OptionsMap&  options,
     if (config.cardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         // Rank moves using DTZ tables
-        config.rootInTB = root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ);
+        config.rootInTB = root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ, runner);
 
         if (!config.rootInTB)
         {
             // DTZ tables are missing; try to rank moves using WDL tables
             dtz_available   = false;
-            config.rootInTB = root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"]);
+            config.rootInTB = root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"], runner);
         }
     }
 
@@ -19,13 +19,19 @@
 #ifndef TBPROBE_H
 #define TBPROBE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../types.h"
 
 namespace Stockfish {
 class Position;
 class OptionsMap;
+class NumaConfig;
 
 using Depth = int;
 
@@ -62,16 +68,76 @@ enum ProbeState {
 
 extern int MaxCardinality;
 
+// Small cache of recent WDL probe results, owned by a single search thread so
+// that no synchronization is needed. The search only probes positions with a
+// zero 50-move counter, so the position key fully determines the result.
+class WDLCache {
+   public:
+    struct Stats {
+        uint64_t probes, hits;
+        uint64_t missNanoseconds;  // Time spent in the probes missing the cache
+        uint64_t deferred;         // Probes that would have waited on the storage
+    };
+
+    // With mayDefer, and the async threads running, a probe needing TB pages that
+    // are not resident fails at once and the pages are read by the async threads.
+    WDLScore probe(Position& pos, ProbeState* result, bool mayDefer = false);
+    void     clear();
+
+    Stats  stats{};
+    size_t numaNode = 0;  // Of the owning thread, to probe the replicas of that node
+
+   private:
+    struct Entry {
+        Key    key;
+        int8_t wdl;
+        int8_t state;
+    };
+
+    static constexpr size_t Size = 2048;
+
+    Entry entries[Size];
+    int   generation = -1;
+};
+
+
+// Calls job(pos, i) for every i in [0, count). The calls may run concurrently, in
+// any order, each thread passing its own copy of the root position. When empty,
+// the root probes run serially on the caller's position.
+using RootProbeRunner =
+  std::function<void(size_t count, const std::function<void(Position&, size_t)>& job)>;
 
-void     init(const std::string& paths);
+void     init(const std::string& paths, const std::string& preload = "none");
+void     set_async_threads(size_t count);
+void     set_block_cache_size(size_t mb);
+void     replicate(const NumaConfig& config, bool enabled);
 WDLScore probe_wdl(Position& pos, ProbeState* result);
 int      probe_dtz(Position& pos, ProbeState* result);
-bool     root_probe(Position& pos, Search::RootMoves& rootMoves, bool rule50, bool rankDTZ);
-bool     root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50);
-Config   rank_root_moves(const OptionsMap&  options,
-                         Position&          pos,
-                         Search::RootMoves& rootMoves,
-                         bool               rankDTZ = false);
+bool     root_probe(Position&              pos,
+                    Search::RootMoves&     rootMoves,
+                    bool                   rule50,
+                    bool                   rankDTZ,
+                    const RootProbeRunner& runner = {});
+bool     root_probe_wdl(Position&              pos,
+                        Search::RootMoves&     rootMoves,
+                        bool                   rule50,
+                        const RootProbeRunner& runner = {});
+Config   rank_root_moves(const OptionsMap&      options,
+                         Position&              pos,
+                         Search::RootMoves&     rootMoves,
+                         bool                   rankDTZ = false,
+                         const RootProbeRunner& runner  = {});
+
+std::pair<uint64_t, uint64_t> block_cache_probes_and_hits();
+
+// Bytes of the files mapped so far, shared with the page cache of the system, of
+// the files read into memory by SyzygyPreload, of their copies on the NUMA nodes,
+// and of the blocks in the cache
+struct MemoryUse {
+    uint64_t mapped, preloaded, replicated, blockCache;
+};
+
+MemoryUse memory_use();
 
 }  // namespace Stockfish::Tablebases
 
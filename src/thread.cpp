@@ -19,13 +19,16 @@
 #include "thread.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
+#include "cluster.h"
 #include "movegen.h"
 #include "search.h"
 #include "syzygy/tbprobe.h"
@@ -36,6 +39,32 @@
 
 namespace Stockfish {
 
+namespace {
+
+// Spins for at most the given time until the condition is true, hinting the CPU
+// that this is a spin loop. Used before sleeping on a condition variable, so
+// that a thread woken up soon after doesn't wait for the OS to schedule it.
+template<typename Condition>
+void spin_until(int microseconds, Condition condition) {
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+
+    for (int i = 1; !condition(); ++i)
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+        asm volatile("yield");
+#endif
+
+        // Reading the clock is much slower than a pause, so don't do it every time
+        if (i % 64 == 0 && std::chrono::steady_clock::now() >= deadline)
+            return;
+    }
+}
+
+}  // namespace
+
 // Constructor launches the thread and waits until it goes to sleep
 // in idle_loop(). Note that 'searching' and 'exit' should be already set.
 Thread::Thread(Search::SharedState&                    sharedState,
@@ -44,6 +73,7 @@ Thread::Thread(Search::SharedState&                    sharedState,
                OptionalThreadToNumaNodeBinder          binder) :
     idx(n),
     nthreads(sharedState.options["Threads"]),
+    spinMicroseconds(int(sharedState.options["ThreadSpinUs"])),
     stdThread(&Thread::idle_loop, this) {
 
     wait_for_search_finished();
@@ -87,6 +117,9 @@ void Thread::clear_worker() {
 // Blocks on the condition variable until the thread has finished searching
 void Thread::wait_for_search_finished() {
 
+    if (int us = spinMicroseconds.load(std::memory_order_relaxed))
+        spin_until(us, [&] { return !searching.load(std::memory_order_acquire); });
+
     std::unique_lock<std::mutex> lk(mutex);
     cv.wait(lk, [&] { return !searching; });
 }
@@ -113,7 +146,15 @@ void Thread::idle_loop() {
         std::unique_lock<std::mutex> lk(mutex);
         searching = false;
         cv.notify_one();  // Wake up anyone waiting for search finished
-        cv.wait(lk, [&] { return searching; });
+
+        if (int us = spinMicroseconds.load(std::memory_order_relaxed))
+        {
+            lk.unlock();
+            spin_until(us, [&] { return searching.load(std::memory_order_acquire); });
+            lk.lock();
+        }
+
+        cv.wait(lk, [&] { return searching.load(); });
 
         if (exit)
             return;
@@ -130,50 +171,124 @@ void Thread::idle_loop() {
 
 Search::SearchManager* ThreadPool::main_manager() { return main_thread()->worker->main_manager(); }
 
-uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
-uint64_t ThreadPool::tb_hits() const { return accumulate(&Search::Worker::tbHits); }
+// Includes the nodes of the other machines of the cluster, if any. While searching,
+// the nodes the threads have not added to the shared counters yet are missing.
+uint64_t ThreadPool::nodes_searched() const {
+    return accumulate(&Search::SharedCounters::nodes) + (cluster ? cluster->nodes() : 0);
+}
+
+uint64_t ThreadPool::tb_hits() const { return accumulate(&Search::SharedCounters::tbHits); }
+uint64_t ThreadPool::tt_probes() const { return accumulate(&Search::Worker::ttProbes); }
+uint64_t ThreadPool::tt_hits() const { return accumulate(&Search::Worker::ttHits); }
+
+std::vector<Search::SearchStats> ThreadPool::search_stats() const {
+
+    std::vector<Search::SearchStats> stats;
+
+    for (auto&& th : threads)
+        stats.push_back(th->worker->search_stats());
+
+    return stats;
+}
+
+Tablebases::WDLCache::Stats ThreadPool::tb_cache_stats() const {
+
+    Tablebases::WDLCache::Stats sum{};
+    for (auto&& th : threads)
+    {
+        const auto& s = th->worker->tbCache.stats;
+        sum.probes += s.probes;
+        sum.hits += s.hits;
+        sum.missNanoseconds += s.missNanoseconds;
+        sum.deferred += s.deferred;
+    }
+    return sum;
+}
+
+size_t ThreadPool::refresh_cache_memory() const {
+
+    size_t sum = 0;
+    for (auto&& th : threads)
+        sum += th->worker->refreshTable.memory();
+    return sum;
+}
+
+std::vector<size_t> ThreadPool::worker_memory_by_numa_node() const {
+
+    std::vector<size_t> memory;
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        const NumaIndex n = i < boundThreadToNumaNode.size() ? boundThreadToNumaNode[i] : 0;
+
+        if (memory.size() <= n)
+            memory.resize(n + 1, 0);
+
+        const auto& worker = threads[i]->worker;
+
+        memory[n] += sizeof(Search::Worker) + worker->refreshTable.memory()
+                   + (worker->ownHistories ? sizeof(SharedHistories) : 0);
+    }
+
+    return memory;
+}
+
+size_t ThreadPool::setup_states_memory() const {
+    return setupStates ? setupStates->size() * sizeof(StateInfo) : 0;
+}
 
 // Creates/destroys threads to match the requested number.
 // Created and launched threads will immediately go to sleep in idle_loop.
 // Upon resizing, threads are recreated to allow for binding if necessary.
-void ThreadPool::set(const NumaConfig&                           numaConfig,
+bool ThreadPool::set(const NumaConfig&                           numaConfig,
                      Search::SharedState                         sharedState,
                      const Search::SearchManager::UpdateContext& updateContext) {
 
-    if (threads.size() > 0)  // destroy any existing thread(s)
+    const size_t requested = sharedState.options["Threads"];
+
+    return set(numaConfig, sharedState, updateContext, requested,
+               thread_binding(numaConfig, sharedState.options, requested));
+}
+
+// Same as above, but with an explicit number of threads and NUMA node for each
+// thread (an empty binding means the threads are not bound). This allows a
+// single thread budget to be split among several thread pools.
+//
+// The existing threads are kept, with their warmed up histories and caches, as
+// long as their workers were built with the same settings and they stay bound
+// to the same NUMA node: only the threads past them are destroyed or created.
+// Returns true if any thread was kept.
+bool ThreadPool::set(const NumaConfig&                           numaConfig,
+                     Search::SharedState                         sharedState,
+                     const Search::SearchManager::UpdateContext& updateContext,
+                     size_t                                      requested,
+                     const std::vector<NumaIndex>&               threadBinding) {
+
+    const std::string settings = worker_settings(numaConfig, sharedState.options);
+    size_t            kept     = 0;
+
+    searching.resize(requested);
+
+    if (settings == workerSettings && threadBinding.empty() == boundThreadToNumaNode.empty())
+        while (kept < std::min(threads.size(), requested)
+               && (threadBinding.empty() || threadBinding[kept] == boundThreadToNumaNode[kept]))
+            ++kept;
+
+    if (threads.size() > kept)  // destroy the other thread(s)
     {
         main_thread()->wait_for_search_finished();
 
-        threads.clear();
-
-        boundThreadToNumaNode.clear();
+        threads.resize(kept);
     }
 
-    const size_t requested = sharedState.options["Threads"];
+    workerSettings        = settings;
+    boundThreadToNumaNode = threadBinding;
 
-    if (requested > 0)  // create new thread(s)
+    if (requested > kept)  // create new thread(s)
     {
-        // Binding threads may be problematic when there's multiple NUMA nodes and
-        // multiple Stockfish instances running. In particular, if each instance
-        // runs a single thread then they would all be mapped to the first NUMA node.
-        // This is undesirable, and so the default behaviour (i.e. when the user does not
-        // change the NumaConfig UCI setting) is to not bind the threads to processors
-        // unless we know for sure that we span NUMA nodes and replication is required.
-        const std::string numaPolicy(sharedState.options["NumaPolicy"]);
-        const bool        doBindThreads = [&]() {
-            if (numaPolicy == "none")
-                return false;
-
-            if (numaPolicy == "auto")
-                return numaConfig.suggests_binding_threads(requested);
-
-            // numaPolicy == "system", or explicitly set by the user
-            return true;
-        }();
-
-        boundThreadToNumaNode = doBindThreads
-                                ? numaConfig.distribute_threads_among_numa_nodes(requested)
-                                : std::vector<NumaIndex>{};
+        const bool doBindThreads = !threadBinding.empty();
+
+        assert(!doBindThreads || threadBinding.size() == requested);
 
         while (threads.size() < requested)
         {
@@ -192,25 +307,89 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
 
             threads.emplace_back(
               std::make_unique<Thread>(sharedState, std::move(manager), threadId, binder));
+
+            const auto nodeBegin = boundThreadToNumaNode.begin();
+            threads.back()->worker->firstOnNumaNode =
+              !doBindThreads ? threadId == 0
+                             : std::find(nodeBegin, nodeBegin + threadId, numaId)
+                                 == nodeBegin + threadId;
         }
 
-        clear();
+        // The new workers are cleared on construction, a new main thread also
+        // needs the search manager to be reset.
+        if (!kept)
+            clear();
 
         main_thread()->wait_for_search_finished();
     }
+
+    // The threads of a NUMA node share its counters, in turn
+    const size_t        nodeCount = numaConfig.num_numa_nodes();
+    std::vector<size_t> threadsOnNode(nodeCount);
+
+    counters = std::vector<Search::SharedCounters>(nodeCount * CountersPerNumaNode);
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        const NumaIndex n = boundThreadToNumaNode.empty() ? 0 : boundThreadToNumaNode[i];
+        threads[i]->worker->counters =
+          &counters[n * CountersPerNumaNode + threadsOnNode[n]++ % CountersPerNumaNode];
+    }
+
+    return kept > 0;
+}
+
+// The settings the workers depend on when they are built. Threads built with
+// other settings can't be kept by set().
+std::string ThreadPool::worker_settings(const NumaConfig& numaConfig, const OptionsMap& options) {
+
+    return numaConfig.to_string() + " " + std::to_string(int(options["RefreshCacheSize"])) + " "
+         + std::to_string(int(options["EvalCacheSize"])) + " "
+         + std::to_string(bool(options["SharedHistories"]));
+}
+
+// Returns the NUMA node each of the requested threads should be bound to,
+// or an empty vector if the threads should not be bound at all.
+std::vector<NumaIndex> ThreadPool::thread_binding(const NumaConfig& numaConfig,
+                                                  const OptionsMap& options,
+                                                  size_t            requested) {
+
+    // Binding threads may be problematic when there's multiple NUMA nodes and
+    // multiple Stockfish instances running. In particular, if each instance
+    // runs a single thread then they would all be mapped to the first NUMA node.
+    // This is undesirable, and so the default behaviour (i.e. when the user does not
+    // change the NumaConfig UCI setting) is to not bind the threads to processors
+    // unless we know for sure that we span NUMA nodes and replication is required.
+    const std::string numaPolicy(options["NumaPolicy"]);
+    const bool        doBindThreads = [&]() {
+        if (numaPolicy == "none")
+            return false;
+
+        if (numaPolicy == "auto")
+            return numaConfig.suggests_binding_threads(requested);
+
+        // numaPolicy == "system", or explicitly set by the user
+        return true;
+    }();
+
+    return doBindThreads ? numaConfig.distribute_threads_among_numa_nodes(requested)
+                         : std::vector<NumaIndex>{};
 }
 
 
-// Sets threadPool data to initial values
-void ThreadPool::clear() {
+// Sets threadPool data to initial values. When deferred, the histories are
+// cleared by the idle threads in the background: a thread only starts a new job
+// once its clearing is done, so the next search waits for it if needed.
+void ThreadPool::clear(bool deferred) {
     if (threads.size() == 0)
         return;
 
     for (auto&& th : threads)
         th->clear_worker();
 
-    for (auto&& th : threads)
-        th->wait_for_search_finished();
+    if (!deferred)
+        for (auto&& th : threads)
+            th->wait_for_search_finished();
 
     // These two affect the time taken on the first move of a game:
     main_manager()->bestPreviousAverageScore = VALUE_INFINITE;
@@ -244,11 +423,16 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
 
     main_thread()->wait_for_search_finished();
 
+    goTime = std::chrono::steady_clock::now();
+
     main_manager()->stopOnPonderhit = stop = abortedSearch = false;
     main_manager()->ponder                                 = limits.ponderMode;
 
     increaseDepth = true;
 
+    for (auto& c : counters)
+        c.nodes = c.tbHits = 0;
+
     Search::RootMoves rootMoves;
     const auto        legalmoves = MoveList<LEGAL>(pos);
 
@@ -264,8 +448,6 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
         for (const auto& m : legalmoves)
             rootMoves.emplace_back(m);
 
-    Tablebases::Config tbConfig = Tablebases::rank_root_moves(options, pos, rootMoves);
-
     // After ownership transfer 'states' becomes empty, so if we stop the search
     // and call 'go' again without setting a new position states.get() == nullptr.
     assert(states.get() || setupStates.get());
@@ -278,17 +460,50 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
     // be deduced from a fen string, so set() clears them and they are set from
     // setupStates->back() later. The rootState is per thread, earlier states are
     // shared since they are read-only.
+    for (auto&& th : threads)
+    {
+        th->run_custom_job([&]() {
+            th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
+            th->worker->rootState = setupStates->back();
+        });
+    }
+
+    for (auto&& th : threads)
+        th->wait_for_search_finished();
+
+    // The root moves are probed by all the threads, each on its own root position,
+    // because with cold tables and DTZ decompression this can take a while.
+    auto probeRunner = [&](size_t count, const std::function<void(Position&, size_t)>& job) {
+        std::atomic<size_t> next{0};
+
+        for (auto&& th : threads)
+            th->run_custom_job([&]() {
+                for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+                    job(th->worker->rootPos, i);
+            });
+
+        for (auto&& th : threads)
+            th->wait_for_search_finished();
+    };
+
+    Tablebases::Config tbConfig =
+      Tablebases::rank_root_moves(options, pos, rootMoves, false, probeRunner);
+
+    multiPVLines.clear(rootMoves.size());
+
     for (auto&& th : threads)
     {
         th->run_custom_job([&]() {
             th->worker->limits = limits;
             th->worker->nodes = th->worker->tbHits = th->worker->nmpMinPly =
               th->worker->bestMoveChanges          = 0;
+            th->worker->ttProbes = th->worker->ttHits = th->worker->unpublishedNodes = 0;
+            th->worker->nodesBatch                    = 1;
+            th->worker->stats                         = {};
+            th->worker->tbCache.stats                 = {};
             th->worker->rootDepth = th->worker->completedDepth = 0;
             th->worker->rootMoves                              = rootMoves;
-            th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
-            th->worker->rootState = setupStates->back();
-            th->worker->tbConfig  = tbConfig;
+            th->worker->tbConfig                               = tbConfig;
         });
     }
 
@@ -298,33 +513,56 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
     main_thread()->start_searching();
 }
 
-Thread* ThreadPool::get_best_thread() const {
+Thread* ThreadPool::get_best_thread() {
+
+    // The threads vote along with the other machines of the cluster, if any
+    struct Vote {
+        Value                    score;
+        Depth                    depth;
+        const std::vector<Move>* pv;
+        Thread*                  thread;  // nullptr for another machine
+    };
+
+    Search::Worker&           mainWorker = *threads.front()->worker;
+    std::vector<RemoteResult> remote;
+    std::vector<Vote>         candidates;
+
+    if (cluster)
+        remote = cluster->results();
+
+    for (auto&& th : threads)
+        candidates.push_back({th->worker->rootMoves[0].score, th->worker->completedDepth,
+                              &th->worker->rootMoves[0].pv, th.get()});
+
+    for (const auto& r : remote)
+        if (std::count(mainWorker.rootMoves.begin(), mainWorker.rootMoves.end(), r.pv[0]))
+            candidates.push_back({r.score, r.depth, &r.pv, nullptr});
 
-    Thread* bestThread = threads.front().get();
-    Value   minScore   = VALUE_NONE;
+    const Vote* bestThread = &candidates.front();
+    Value       minScore   = VALUE_NONE;
 
     std::unordered_map<Move, int64_t, Move::MoveHash> votes(
-      2 * std::min(size(), bestThread->worker->rootMoves.size()));
+      2 * std::min(candidates.size(), mainWorker.rootMoves.size()));
 
     // Find the minimum score of all threads
-    for (auto&& th : threads)
-        minScore = std::min(minScore, th->worker->rootMoves[0].score);
+    for (const auto& th : candidates)
+        minScore = std::min(minScore, th.score);
 
     // Vote according to score and depth, and select the best thread
-    auto thread_voting_value = [minScore](Thread* th) {
-        return (th->worker->rootMoves[0].score - minScore + 14) * int(th->worker->completedDepth);
+    auto thread_voting_value = [minScore](const Vote* th) {
+        return (th->score - minScore + 14) * int(th->depth);
     };
 
-    for (auto&& th : threads)
-        votes[th->worker->rootMoves[0].pv[0]] += thread_voting_value(th.get());
+    for (const auto& th : candidates)
+        votes[(*th.pv)[0]] += thread_voting_value(&th);
 
-    for (auto&& th : threads)
+    for (const auto& th : candidates)
     {
-        const auto bestThreadScore = bestThread->worker->rootMoves[0].score;
-        const auto newThreadScore  = th->worker->rootMoves[0].score;
+        const auto bestThreadScore = bestThread->score;
+        const auto newThreadScore  = th.score;
 
-        const auto& bestThreadPV = bestThread->worker->rootMoves[0].pv;
-        const auto& newThreadPV  = th->worker->rootMoves[0].pv;
+        const auto& bestThreadPV = *bestThread->pv;
+        const auto& newThreadPV  = *th.pv;
 
         const auto bestThreadMoveVote = votes[bestThreadPV[0]];
         const auto newThreadMoveVote  = votes[newThreadPV[0]];
@@ -339,29 +577,42 @@ Thread* ThreadPool::get_best_thread() const {
 
         // We make sure not to pick a thread with truncated principal variation
         const bool betterVotingValue =
-          thread_voting_value(th.get()) * int(newThreadPV.size() > 2)
+          thread_voting_value(&th) * int(newThreadPV.size() > 2)
           > thread_voting_value(bestThread) * int(bestThreadPV.size() > 2);
 
         if (bestThreadInProvenWin)
         {
             // Make sure we pick the shortest mate / TB conversion
             if (newThreadScore > bestThreadScore)
-                bestThread = th.get();
+                bestThread = &th;
         }
         else if (bestThreadInProvenLoss)
         {
             // Make sure we pick the shortest mated / TB conversion
             if (newThreadInProvenLoss && newThreadScore < bestThreadScore)
-                bestThread = th.get();
+                bestThread = &th;
         }
         else if (newThreadInProvenWin || newThreadInProvenLoss
                  || (!is_loss(newThreadScore)
                      && (newThreadMoveVote > bestThreadMoveVote
                          || (newThreadMoveVote == bestThreadMoveVote && betterVotingValue))))
-            bestThread = th.get();
+            bestThread = &th;
     }
 
-    return bestThread;
+    if (bestThread->thread)
+        return bestThread->thread;
+
+    // Another machine won, its result becomes the one of the main thread
+    auto& rootMoves = mainWorker.rootMoves;
+    auto  rm        = std::find(rootMoves.begin(), rootMoves.end(), (*bestThread->pv)[0]);
+
+    rm->score           = rm->uciScore = bestThread->score;
+    rm->scoreLowerbound = rm->scoreUpperbound = false;
+    rm->pv              = *bestThread->pv;
+    std::rotate(rootMoves.begin(), rm, rm + 1);
+    mainWorker.completedDepth = bestThread->depth;
+
+    return threads.front().get();
 }
 
 
@@ -383,6 +634,32 @@ void ThreadPool::wait_for_search_finished() const {
             th->wait_for_search_finished();
 }
 
+// Waits for all the threads, the main one included, to finish their job
+void ThreadPool::wait_for_all_finished() const {
+
+    for (auto&& th : threads)
+        th->wait_for_search_finished();
+}
+
+void ThreadPool::set_spin_time(int microseconds) {
+
+    for (auto&& th : threads)
+        th->set_spin_time(microseconds);
+}
+
+std::pair<int64_t, int64_t> ThreadPool::search_latencies() const {
+
+    auto lastStart = goTime;
+    for (auto&& th : threads)
+        lastStart = std::max(lastStart, th->worker->searchStart);
+
+    auto us = [](auto duration) {
+        return int64_t(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    };
+
+    return {us(lastStart - goTime), us(bestmoveTime - stopTime)};
+}
+
 std::vector<size_t> ThreadPool::get_bound_thread_count_by_numa_node() const {
     std::vector<size_t> counts;
 
@@ -19,23 +19,29 @@
 #ifndef THREAD_H_INCLUDED
 #define THREAD_H_INCLUDED
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
+#include "misc.h"
 #include "numa.h"
 #include "position.h"
 #include "search.h"
 #include "thread_win32_osx.h"
+#include "tt.h"
 
 namespace Stockfish {
 
-
+class ResultCache;
+class SearchCluster;
 class OptionsMap;
 using Value = int;
 
@@ -85,6 +91,10 @@ class Thread {
 
     void ensure_network_replicated();
 
+    // Time in microseconds to spin before sleeping when idle or waiting for the
+    // thread to finish, 0 to sleep at once.
+    void set_spin_time(int microseconds) { spinMicroseconds = microseconds; }
+
     // Thread has been slightly altered to allow running custom jobs, so
     // this name is no longer correct. However, this class (and ThreadPool)
     // require further work to make them properly generic while maintaining
@@ -100,7 +110,9 @@ class Thread {
     std::mutex                mutex;
     std::condition_variable   cv;
     size_t                    idx, nthreads;
-    bool                      exit = false, searching = true;  // Set before starting std::thread
+    bool                      exit = false;
+    std::atomic<bool>         searching{true};  // Set before starting std::thread
+    std::atomic<int>          spinMicroseconds{0};
     NativeThread              stdThread;
     NumaReplicatedAccessToken numaAccessToken;
 };
@@ -133,24 +145,79 @@ class ThreadPool {
     void   run_on_thread(size_t threadId, std::function<void()> f);
     void   wait_on_thread(size_t threadId);
     size_t num_threads() const;
-    void   clear();
-    void   set(const NumaConfig& numaConfig,
+    void   clear(bool deferred = false);
+    bool   set(const NumaConfig& numaConfig,
                Search::SharedState,
                const Search::SearchManager::UpdateContext&);
+    bool   set(const NumaConfig&                           numaConfig,
+               Search::SharedState,
+               const Search::SearchManager::UpdateContext& updateContext,
+               size_t                                      requested,
+               const std::vector<NumaIndex>&               threadBinding);
+
+    static std::vector<NumaIndex>
+    thread_binding(const NumaConfig& numaConfig, const OptionsMap& options, size_t requested);
 
     Search::SearchManager* main_manager();
     Thread*                main_thread() const { return threads.front().get(); }
     uint64_t               nodes_searched() const;
     uint64_t               tb_hits() const;
-    Thread*                get_best_thread() const;
+    uint64_t               tt_probes() const;
+    uint64_t               tt_hits() const;
+    size_t                 refresh_cache_memory() const;
+
+    // Bytes used by the workers, with their NNUE refresh caches, and by the
+    // states of the root position, the workers by the NUMA node of their thread
+    std::vector<size_t> worker_memory_by_numa_node() const;
+    size_t              setup_states_memory() const;
+
+    // Per-thread counters of the last search, in thread order
+    std::vector<Search::SearchStats> search_stats() const;
+
+    // Only meaningful when the threads are not searching
+    Tablebases::WDLCache::Stats tb_cache_stats() const;
+    Thread*                get_best_thread();
     void                   start_searching();
     void                   wait_for_search_finished() const;
+    void                   wait_for_all_finished() const;
+    void                   set_spin_time(int microseconds);
+
+    // Latencies in microseconds of the last search: from the "go" until all the
+    // threads are searching, and from the stop until the best move is sent.
+    std::pair<int64_t, int64_t> search_latencies() const;
 
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
 
     void ensure_network_replicated();
 
-    std::atomic_bool stop, abortedSearch, increaseDepth;
+    // Read at every node by all the threads, so kept apart from the members
+    // written during the search, whose writes would evict it from their caches
+    alignas(64) std::atomic_bool stop;
+    alignas(64) std::atomic_bool abortedSearch, increaseDepth;
+
+    // Set by start_thinking() and by the main thread, see search_latencies()
+    std::chrono::steady_clock::time_point goTime, stopTime, bestmoveTime;
+
+    // While countPerfEvents is set, the threads add the hardware events of their
+    // searches to perfEvents (see "bench perf" and "bench prefetch")
+    std::atomic_bool                                           countPerfEvents{false};
+    std::array<std::atomic<uint64_t>, PerfCounters::EVENT_NB> perfEvents{};
+
+    // The other machines searching along, set on the pool of the engine only
+    SearchCluster* cluster = nullptr;
+
+    // The results of earlier searches, set on the pool of the engine only
+    ResultCache* resultCache = nullptr;
+
+    // The pools of a batch search concurrently on the TT of the engine, which
+    // starts one generation for the whole batch instead of each search its own.
+    bool sharesGeneration = false;
+
+    // The moves the threads are searching, sized by set()
+    SearchingTable searching;
+
+    // The lines of a MultiPV search split between groups of threads
+    Search::MultiPVLines multiPVLines;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
     auto begin() noexcept { return threads.begin(); }
@@ -163,6 +230,14 @@ class ThreadPool {
     StateListPtr                         setupStates;
     std::vector<std::unique_ptr<Thread>> threads;
     std::vector<NumaIndex>               boundThreadToNumaNode;
+    std::string                          workerSettings;
+
+    // A few per NUMA node, so that nodes_searched() reads the same number of cache
+    // lines whatever the number of threads, and they are each shared by few threads
+    static constexpr size_t             CountersPerNumaNode = 4;
+    std::vector<Search::SharedCounters> counters;
+
+    static std::string worker_settings(const NumaConfig&, const OptionsMap&);
 
     uint64_t accumulate(std::atomic<uint64_t> Search::Worker::*member) const {
 
@@ -171,6 +246,14 @@ class ThreadPool {
             sum += (th->worker.get()->*member).load(std::memory_order_relaxed);
         return sum;
     }
+
+    uint64_t accumulate(std::atomic<uint64_t> Search::SharedCounters::*member) const {
+
+        uint64_t sum = 0;
+        for (auto& c : counters)
+            sum += (c.*member).load(std::memory_order_relaxed);
+        return sum;
+    }
 };
 
 }  // namespace Stockfish
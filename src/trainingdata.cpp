@@ -0,0 +1,307 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trainingdata.h"
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include "position.h"
+#include "types.h"
+#include "uci.h"
+
+namespace Stockfish::TrainingData {
+
+namespace {
+
+constexpr char    Magic[]  = {'S', 'F', 'T', 'D'};
+constexpr uint8_t Version  = 1;
+constexpr uint8_t Chess960 = 1;  // Flag of a block
+
+void put_varint(std::string& out, uint64_t v) {
+    for (; v >= 0x80; v >>= 7)
+        out += char(v | 0x80);
+    out += char(v);
+}
+
+bool get_varint(const std::string& in, size_t& i, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; i < in.size() && shift < 64; shift += 7)
+    {
+        const uint8_t b = uint8_t(in[i++]);
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+int64_t  unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+// Appends a block with the positions [first, last) of a game, which follow each
+// other by their moves, all legal
+void put_block(std::string&                         out,
+               const std::vector<TrainingPosition>& game,
+               size_t                               first,
+               const std::vector<Move>&             moves,
+               bool                                 chess960) {
+
+    const TrainingPosition& start = game[first];
+    std::string             payload;
+
+    payload += char(chess960 ? Chess960 : 0);
+    payload += char(start.result + 1);
+    put_varint(payload, start.fen.size());
+    payload += start.fen;
+    put_varint(payload, moves.size());
+
+    int previous = 0;
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        const uint16_t m = moves[i].raw();
+        const int      s = game[first + i].score;
+
+        payload += char(m & 0xFF);
+        payload += char(m >> 8);
+        put_varint(payload, zigzag(int64_t(s) + previous));
+        previous = s;
+    }
+
+    put_varint(out, payload.size());
+    out += payload;
+}
+
+// Decodes a block, see put_block()
+bool get_block(const std::string&                                   in,
+               const std::function<void(const TrainingPosition&)>& onPosition) {
+
+    size_t   i = 0;
+    uint64_t fenSize, count;
+
+    if (in.size() < 2)
+        return false;
+
+    const bool chess960 = in[i++] & Chess960;
+    const int  result   = int(uint8_t(in[i++])) - 1;
+
+    if (!get_varint(in, i, fenSize) || in.size() - i < fenSize)
+        return false;
+
+    const std::string fen = in.substr(i, fenSize);
+    i += fenSize;
+
+    if (!get_varint(in, i, count))
+        return false;
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    Position     pos;
+    pos.set(fen, chess960, &states->back());
+
+    TrainingPosition p;
+    int              previous = 0;
+
+    for (uint64_t k = 0; k < count; ++k)
+    {
+        uint64_t s;
+        if (in.size() - i < 2)
+            return false;
+
+        const Move m(uint16_t(uint8_t(in[i]) | uint8_t(in[i + 1]) << 8));
+        i += 2;
+
+        if (!get_varint(in, i, s) || !pos.pseudo_legal(m) || !pos.legal(m))
+            return false;
+
+        p.fen    = pos.fen();
+        p.move   = UCIEngine::move(m, chess960);
+        p.score  = int(unzigzag(s) - previous);
+        p.ply    = pos.game_ply();
+        p.result = k % 2 ? -result : result;
+        previous = p.score;
+        onPosition(p);
+
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+
+    return true;
+}
+
+}
+
+bool is_packed(const std::string& path) {
+    const size_t n = std::strlen(PackedExtension);
+    return path.size() >= n && path.compare(path.size() - n, n, PackedExtension) == 0;
+}
+
+Writer::Writer(const std::string& path, bool isChess960) :
+    file(path, std::ios::binary | std::ios::app | std::ios::ate),
+    packed(is_packed(path)),
+    chess960(isChess960) {
+
+    if (!file)
+        return;
+
+    if (packed && file.tellp() == 0)
+    {
+        file.write(Magic, sizeof(Magic));
+        file.put(char(Version));
+    }
+
+    thread = std::thread(&Writer::run, this);
+}
+
+Writer::~Writer() {
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        exit = true;
+    }
+    cv.notify_one();
+    thread.join();
+}
+
+void Writer::write(std::vector<TrainingPosition>&& game) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        queue.push_back(std::move(game));
+    }
+    cv.notify_one();
+}
+
+void Writer::run() {
+
+    std::deque<std::vector<TrainingPosition>> games;
+    std::string                               out;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return exit || !queue.empty(); });
+
+            if (queue.empty())
+                break;
+
+            std::swap(games, queue);
+        }
+
+        out.clear();
+        for (const auto& game : games)
+            encode(game, out);
+        games.clear();
+
+        file.write(out.data(), std::streamsize(out.size()));
+    }
+
+    file.flush();
+}
+
+void Writer::encode(const std::vector<TrainingPosition>& game, std::string& out) {
+
+    if (!packed)
+    {
+        for (const auto& p : game)
+            out += "fen " + p.fen + "\nmove " + p.move + "\nscore " + std::to_string(p.score)
+                 + "\nply " + std::to_string(p.ply) + "\nresult " + std::to_string(p.result)
+                 + "\ne\n";
+        return;
+    }
+
+    StateListPtr      states(new std::deque<StateInfo>(1));
+    Position          pos;
+    std::vector<Move> moves;
+    size_t            first = 0;
+
+    for (size_t i = 0; i < game.size(); ++i)
+    {
+        // Start a new block unless the position follows from the previous one
+        if (moves.empty() || pos.fen() != game[i].fen)
+        {
+            if (!moves.empty())
+                put_block(out, game, first, moves, chess960);
+
+            moves.clear();
+            first = i;
+            states.reset(new std::deque<StateInfo>(1));
+            pos.set(game[i].fen, chess960, &states->back());
+        }
+
+        const Move m = UCIEngine::to_move(pos, game[i].move);
+
+        // A position without a legal move can't be packed, it ends the block
+        if (m == Move::none())
+        {
+            if (!moves.empty())
+                put_block(out, game, first, moves, chess960);
+
+            moves.clear();
+            continue;
+        }
+
+        moves.push_back(m);
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+
+    if (!moves.empty())
+        put_block(out, game, first, moves, chess960);
+}
+
+bool read(const std::string& path, const std::function<void(const TrainingPosition&)>& onPosition) {
+
+    std::ifstream file(path, std::ios::binary);
+    char          header[sizeof(Magic) + 1];
+
+    if (!file.read(header, sizeof(header)) || std::memcmp(header, Magic, sizeof(Magic))
+        || uint8_t(header[sizeof(Magic)]) != Version)
+        return false;
+
+    std::string block;
+
+    while (file.peek() != std::ifstream::traits_type::eof())
+    {
+        // The size of the block, a varint
+        uint64_t size = 0;
+        int      shift = 0;
+        int      c;
+
+        do
+        {
+            if ((c = file.get()) == std::ifstream::traits_type::eof() || shift >= 64)
+                return false;
+
+            size |= uint64_t(c & 0x7F) << shift;
+            shift += 7;
+        } while (c & 0x80);
+
+        block.resize(size);
+        if (!file.read(block.data(), std::streamsize(size)) || !get_block(block, onPosition))
+            return false;
+    }
+
+    return true;
+}
+
+}  // namespace Stockfish::TrainingData
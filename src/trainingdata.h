@@ -0,0 +1,90 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAININGDATA_H_INCLUDED
+#define TRAININGDATA_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Stockfish {
+
+// A position of a self-play game, with the move played, the score of its search,
+// the ply of the game and its result (1, 0 or -1), from the side to move.
+// Mate and tablebase scores are the internal values, others are centipawns.
+struct TrainingPosition {
+    std::string fen, move;
+    int         score, ply, result;
+};
+
+namespace TrainingData {
+
+// Files whose name ends with this are in the packed format, others are text in
+// the plain format of the NNUE trainers. A packed file is a header followed by
+// blocks, each a chain of consecutive plies of a game: the FEN of the first
+// position, then only the move and the score of each ply, the score as the
+// difference from the negated score of the previous ply. So a position takes
+// about 3 bytes instead of about 100.
+constexpr auto PackedExtension = ".pack";
+
+bool is_packed(const std::string& path);
+
+// Appends the games to a file. The games are encoded and written by a thread of
+// the writer, so that write() never waits for the disk.
+class Writer {
+   public:
+    Writer(const std::string& path, bool isChess960);
+    ~Writer();
+
+    Writer(const Writer&)            = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    bool is_open() const { return file.is_open(); }
+
+    // The positions of a game, in order. A position that doesn't follow from the
+    // one before by its move starts a new block.
+    void write(std::vector<TrainingPosition>&& game);
+
+   private:
+    void run();
+    void encode(const std::vector<TrainingPosition>& game, std::string& out);
+
+    std::ofstream file;
+    bool          packed, chess960;
+
+    std::mutex                                mutex;
+    std::condition_variable                   cv;
+    std::deque<std::vector<TrainingPosition>> queue;
+    bool                                      exit = false;
+    std::thread                               thread;
+};
+
+// Calls onPosition with each position of a packed file, in order. Returns false
+// if the file can't be read or is not in the packed format.
+bool read(const std::string& path, const std::function<void(const TrainingPosition&)>& onPosition);
+
+}  // namespace TrainingData
+}  // namespace Stockfish
+
+#endif  // #ifndef TRAININGDATA_H_INCLUDED
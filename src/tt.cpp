@@ -18,17 +18,39 @@
 
 #include "tt.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "memory.h"
 #include "misc.h"
 #include "syzygy/tbprobe.h"
 #include "thread.h"
 
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #if defined(__linux__) && !defined(__ANDROID__)
+        #include <sys/syscall.h>
+    #endif
+#else
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#endif
+
 namespace Stockfish {
 
 
@@ -136,22 +158,90 @@ void TTWriter::write(
 // A TranspositionTable is an array of Cluster, of size clusterCount. Each cluster consists of ClusterSize number
 // of TTEntry. Each non-empty TTEntry contains information on exactly one position. The size of a Cluster should
 // divide the size of a cache line for best performance, as the cacheline is prefetched when possible.
+//
+// The cluster layout is selected at compile time with TT_CLUSTER_BYTES (ttcluster in the Makefile): the default
+// 32 byte cluster holds 3 entries, a 64 byte cluster fills a whole cache line with 6 entries, trading more memory
+// traffic per probe for fewer misses.
+
+#ifndef TT_CLUSTER_BYTES
+    #define TT_CLUSTER_BYTES 32
+#endif
+
+template<size_t Bytes>
+struct ClusterLayout {
+    static_assert(Bytes == 32 || Bytes == 64, "Unsupported Cluster size");
+
+    static constexpr int Size = Bytes / sizeof(TTEntry);
+
+    TTEntry entry[Size];
+    char    padding[Bytes - Size * sizeof(TTEntry)];  // Pad to Bytes
+};
+
+struct Cluster: ClusterLayout<TT_CLUSTER_BYTES> {};
+
+static constexpr int ClusterSize = Cluster::Size;
+
+static_assert(sizeof(Cluster) == TT_CLUSTER_BYTES, "Suboptimal Cluster size");
 
-static constexpr int ClusterSize = 3;
 
-struct Cluster {
-    TTEntry entry[ClusterSize];
-    char    padding[2];  // Pad to 32 bytes
+// A saved table is this header followed by the raw clusters. The header keeps the
+// clusters aligned to a cache line when the file is mapped, and the entries are
+// stored with their generation so that aging works as before after a reload. The
+// file is in native byte order.
+struct TTFileHeader {
+    char     magic[8];
+    uint64_t clusterSize;
+    uint64_t clusterCount;
+    uint8_t  generation8;
+    char     padding[39];
 };
 
-static_assert(sizeof(Cluster) == 32, "Suboptimal Cluster size");
+static_assert(sizeof(TTFileHeader) == 64, "TTFileHeader must keep clusters cache line aligned");
+
+static constexpr char TTFileMagic[8] = {'S', 'F', 'T', 'T', 'a', 'b', 'l', '1'};
+
+// Identifies the layout of a shared table, along with the cluster size and count.
+// The generation follows the clusters, in a cache line of its own.
+static constexpr uint64_t TTSharedKey       = 0x5346545473686d31ULL;
+static constexpr size_t   TTSharedStateSize = 64;
+
+
+// Frees the table, whether it was allocated, shared or mapped from a file
+void TranspositionTable::release() {
+
+    if (shared)
+    {
+        shared.reset();
+        table            = nullptr;
+        sharedGeneration = nullptr;
+        return;
+    }
+
+    if (!mappedAddress)
+    {
+        aligned_large_pages_free(table);
+        table = nullptr;
+        return;
+    }
+
+#ifndef _WIN32
+    munmap(mappedAddress, mapping);
+#else
+    UnmapViewOfFile(mappedAddress);
+    CloseHandle((HANDLE) mapping);
+#endif
+
+    table         = nullptr;
+    mappedAddress = nullptr;
+    mapping       = 0;
+}
 
 
 // Sets the size of the transposition table,
 // measured in megabytes. Transposition table consists
 // of clusters and each cluster consists of ClusterSize number of TTEntry.
 void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
-    aligned_large_pages_free(table);
+    release();
 
     clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
@@ -167,12 +257,159 @@ void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
 }
 
 
+// Returns floor(a * b / c) and the remainder, where a * b may not fit in 64 bits
+// but the quotient does. Plain long division of the 128-bit product.
+static std::pair<uint64_t, uint64_t> mul_div(uint64_t a, uint64_t b, uint64_t c) {
+
+    uint64_t hi = mul_hi64(a, b), lo = a * b, q = 0, r = hi;
+
+    assert(hi < c);
+
+    for (int i = 63; i >= 0; --i)
+    {
+        const bool carry = r >> 63;
+        r                = r << 1 | (lo >> i & 1);
+        q <<= 1;
+
+        if (carry || r >= c)
+        {
+            r -= c;
+            q |= 1;
+        }
+    }
+
+    return {q, r};
+}
+
+
+// Resizes the table like resize(), but moves the entries into the new table
+// instead of discarding them. Only 16 bits of the key are stored, so the new
+// cluster of an entry is only known to be in the range of new clusters that
+// overlaps its old cluster: one when shrinking by an integer ratio, k when
+// growing k times. An entry is copied to each cluster of its range. In all but
+// the right one it is like an entry of any other position, and it is replaced
+// as usual. When more entries map to a cluster than it holds, the most valuable
+// ones are kept, with the same replace value as in probe().
+void TranspositionTable::rehash(size_t mbSize, ThreadPool& threads) {
+
+    if (!table)
+    {
+        resize(mbSize, threads);
+        return;
+    }
+
+    Cluster* const  oldTable  = table;
+    const size_t    oldCount  = clusterCount;
+    void* const     oldAddr   = mappedAddress;
+    const uint64_t  oldMap    = mapping;
+    const uint8_t   oldGen    = generation8;
+    SharedMemoryPtr oldShared = std::move(shared);
+
+    clusterCount     = mbSize * 1024 * 1024 / sizeof(Cluster);
+    mappedAddress    = nullptr;
+    mapping          = 0;
+    sharedGeneration = nullptr;
+    table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+
+    if (!table)
+    {
+        std::cerr << "Failed to allocate " << mbSize << "MB for transposition table." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Zero the new table as usual first, for the NUMA placement of its pages
+    clear(threads);
+    generation8 = oldGen;
+
+    const size_t threadCount = threads.num_threads();
+
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.run_on_thread(t, [this, t, threadCount, oldTable, oldCount]() {
+            // Each thread fills its part of the new table. The old clusters
+            // overlapping new cluster j are floor(j * oldCount / clusterCount)
+            // up to the last one starting before new cluster j + 1.
+            const size_t stride = clusterCount / threadCount;
+            const size_t start  = stride * t;
+            const size_t end    = t + 1 != threadCount ? start + stride : clusterCount;
+
+            const uint64_t step = oldCount / clusterCount, stepRem = oldCount % clusterCount;
+            auto [next, nextRem] = mul_div(start, oldCount, clusterCount);
+
+            for (size_t j = start; j < end; ++j)
+            {
+                const uint64_t first = next;
+
+                next += step;
+                nextRem += stepRem;
+                if (nextRem >= clusterCount)
+                {
+                    next++;
+                    nextRem -= clusterCount;
+                }
+
+                const uint64_t last = std::min<uint64_t>(next - !nextRem, oldCount - 1);
+
+                TTEntry* const tte = table[j].entry;
+                int            count = 0;
+
+                // Keep the most valuable entries, tte[count - 1] being the least valuable
+                auto value = [this](const TTEntry& e) {
+                    return e.depth8 - e.relative_age(generation8) * 2;
+                };
+
+                for (uint64_t i = first; i <= last; ++i)
+                    for (const TTEntry& e : oldTable[i].entry)
+                    {
+                        if (!e.is_occupied()
+                            || (count == ClusterSize && value(e) <= value(tte[count - 1])))
+                            continue;
+
+                        int k = count < ClusterSize ? count++ : count - 1;
+                        for (; k > 0 && value(tte[k - 1]) < value(e); --k)
+                            tte[k] = tte[k - 1];
+                        tte[k] = e;
+                    }
+            }
+        });
+    }
+
+    for (size_t t = 0; t < threadCount; ++t)
+        threads.wait_on_thread(t);
+
+    // Free the old table, whether it was allocated, shared or mapped
+    Cluster* const newTable = table;
+
+    table         = oldTable;
+    mappedAddress = oldAddr;
+    mapping       = oldMap;
+    shared        = std::move(oldShared);
+    release();
+
+    table = newTable;
+}
+
+
 // Initializes the entire transposition table to zero,
-// in a multi-threaded way.
+// in a multi-threaded way. A shared table is only aged,
+// as zeroing it would also erase the work of the other processes.
 void TranspositionTable::clear(ThreadPool& threads) {
+
+    if (shared)
+    {
+        age();
+        return;
+    }
+
     generation8              = 0;
     const size_t threadCount = threads.num_threads();
 
+    if (numaConfig && numaPolicy != TTNumaPolicy::Auto && numaConfig->num_numa_nodes() > 1)
+    {
+        clear_on_numa_nodes(threadCount);
+        return;
+    }
+
     for (size_t i = 0; i < threadCount; ++i)
     {
         threads.run_on_thread(i, [this, i, threadCount]() {
@@ -190,6 +427,269 @@ void TranspositionTable::clear(ThreadPool& threads) {
 }
 
 
+void TranspositionTable::set_numa_policy(const NumaConfig& config, TTNumaPolicy policy) {
+    numaConfig = &config;
+    numaPolicy = policy;
+}
+
+
+// Zeroes the table from threads bound to the NUMA nodes, so that the pages are placed
+// by first touch as requested by the policy. The table is split in chunks of the size
+// of a huge page, dealt out to the nodes round robin following `pattern`, where each
+// node appears as many times as its share of the table.
+void TranspositionTable::clear_on_numa_nodes(size_t threadCount) {
+
+    const NumaConfig&      cfg   = *numaConfig;
+    const NumaIndex        nodes = cfg.num_numa_nodes();
+    std::vector<NumaIndex> pattern;
+
+    if (numaPolicy == TTNumaPolicy::Interleave)
+        for (NumaIndex n = 0; n < nodes; ++n)
+            pattern.push_back(n);
+    else
+        pattern = cfg.distribute_threads_among_numa_nodes(threadCount);
+
+    constexpr size_t ChunkSize     = 2 * 1024 * 1024;
+    const size_t     chunkClusters = ChunkSize / sizeof(Cluster);
+    const size_t     chunkCount    = (clusterCount + chunkClusters - 1) / chunkClusters;
+
+    std::vector<std::thread> workers;
+
+    for (NumaIndex n = 0; n < nodes; ++n)
+    {
+        // Use as many threads on each node as there are search threads
+        const size_t nodeThreads =
+          numaPolicy == TTNumaPolicy::Interleave
+            ? std::max<size_t>(1, threadCount / nodes)
+            : size_t(std::count(pattern.begin(), pattern.end(), n));
+
+        for (size_t t = 0; t < nodeThreads; ++t)
+            workers.emplace_back([this, &cfg, &pattern, n, t, nodeThreads, chunkClusters,
+                                  chunkCount]() {
+                cfg.bind_current_thread_to_numa_node(n);
+
+                for (size_t c = 0, nodeChunk = 0; c < chunkCount; ++c)
+                    if (pattern[c % pattern.size()] == n && nodeChunk++ % nodeThreads == t)
+                    {
+                        const size_t start = c * chunkClusters;
+                        const size_t len   = std::min(chunkClusters, clusterCount - start);
+
+                        std::memset(&table[start], 0, len * sizeof(Cluster));
+                    }
+            });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+
+// Returns how many of a sample of the table pages are placed on each NUMA node,
+// keyed by the node number of the OS. Returns an empty map when this can't be
+// queried on the platform.
+std::map<int, size_t> TranspositionTable::numa_page_distribution() const {
+
+    std::map<int, size_t> distribution;
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(SYS_move_pages)
+
+    constexpr size_t PageSize = 4096;
+    const size_t     bytes    = clusterCount * sizeof(Cluster);
+    const size_t     samples  = std::min<size_t>(4096, bytes / PageSize);
+
+    std::vector<void*> pages(samples);
+    std::vector<int>   status(samples, -1);
+
+    for (size_t i = 0; i < samples; ++i)
+        pages[i] = reinterpret_cast<char*>(table) + i * (bytes / samples / PageSize) * PageSize;
+
+    // With no target nodes, move_pages() only reports the node of each page
+    if (syscall(SYS_move_pages, 0, samples, pages.data(), nullptr, status.data(), 0) != 0)
+        return distribution;
+
+    for (int node : status)
+        if (node >= 0)
+            distribution[node]++;
+
+#endif
+
+    return distribution;
+}
+
+
+std::string TranspositionTable::pages_information() const {
+    return large_pages_information(table);
+}
+
+size_t TranspositionTable::memory() const { return clusterCount * sizeof(Cluster); }
+
+
+// Writes the table to the given file. The data is first written to a temporary
+// file which then replaces the target, as the table itself may be a mapping
+// of the target file.
+bool TranspositionTable::save(const std::string& file) const {
+
+    TTFileHeader header{};
+    std::memcpy(header.magic, TTFileMagic, sizeof(TTFileMagic));
+    header.clusterSize  = sizeof(Cluster);
+    header.clusterCount = clusterCount;
+    header.generation8  = generation8;
+
+    const std::string tmpFile = file + ".tmp";
+    std::ofstream     stream(tmpFile, std::ios::binary);
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(table), clusterCount * sizeof(Cluster));
+    stream.close();
+
+    if (!stream)
+    {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+
+    std::remove(file.c_str());
+    return std::rename(tmpFile.c_str(), file.c_str()) == 0;
+}
+
+
+// Replaces the table with one saved to the given file. The file is mapped
+// rather than read, so that a large table is paged in lazily while searching
+// instead of with a full read pass. Returns false, leaving the table untouched,
+// if the file can't be mapped or wasn't saved with a table of mbSize megabytes.
+bool TranspositionTable::load(const std::string& file, size_t mbSize) {
+
+    const size_t count    = mbSize * 1024 * 1024 / sizeof(Cluster);
+    const size_t fileSize = sizeof(TTFileHeader) + count * sizeof(Cluster);
+    void*        address  = nullptr;
+    uint64_t     map      = 0;
+
+    if (file.empty())
+        return false;
+
+#ifndef _WIN32
+    struct stat statbuf;
+    int         fd = ::open(file.c_str(), O_RDONLY);
+
+    if (fd == -1)
+        return false;
+
+    if (fstat(fd, &statbuf) || size_t(statbuf.st_size) != fileSize)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    address = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (address == MAP_FAILED)
+        return false;
+
+    #if defined(MADV_RANDOM)
+    madvise(address, fileSize, MADV_RANDOM);
+    #endif
+    map = fileSize;
+#else
+    HANDLE fd = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+    if (fd == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fd, &size) || uint64_t(size.QuadPart) != fileSize)
+    {
+        CloseHandle(fd);
+        return false;
+    }
+
+    HANDLE mmap = CreateFileMapping(fd, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(fd);
+
+    if (!mmap)
+        return false;
+
+    address = MapViewOfFile(mmap, FILE_MAP_COPY, 0, 0, 0);
+
+    if (!address)
+    {
+        CloseHandle(mmap);
+        return false;
+    }
+
+    map = uint64_t(mmap);
+#endif
+
+    const TTFileHeader* header = static_cast<const TTFileHeader*>(address);
+
+    if (std::memcmp(header->magic, TTFileMagic, sizeof(TTFileMagic))
+        || header->clusterSize != sizeof(Cluster) || header->clusterCount != count)
+    {
+#ifndef _WIN32
+        munmap(address, map);
+#else
+        UnmapViewOfFile(address);
+        CloseHandle((HANDLE) map);
+#endif
+        return false;
+    }
+
+    release();
+
+    mappedAddress = address;
+    mapping       = map;
+    clusterCount  = count;
+    generation8   = header->generation8;
+    table         = reinterpret_cast<Cluster*>(static_cast<char*>(address) + sizeof(TTFileHeader));
+
+    return true;
+}
+
+
+// Replaces the table with the one shared by all the processes mapping the file
+// of this size in the given directory, e.g. a tmpfs such as /dev/shm or a
+// hugetlbfs mount. The first process creates it zeroed. Entries are written
+// racily, as between the threads of one process, and the generation is kept
+// after the clusters so that all the processes age the entries alike. Returns
+// false, leaving the table untouched, if the file can't be mapped.
+bool TranspositionTable::share(const std::string& directory, size_t mbSize) {
+
+    const size_t   count  = mbSize * 1024 * 1024 / sizeof(Cluster);
+    const size_t   offset = count * sizeof(Cluster);
+    const uint64_t key    = TTSharedKey ^ (uint64_t(sizeof(Cluster)) << 56) ^ count;
+
+    if (directory.empty())
+        return false;
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/stockfish-tt-%zumb", mbSize);
+
+    auto mem = map_shared_memory(
+      directory + name, offset + TTSharedStateSize, key,
+      [&](void* m) {
+          new (static_cast<char*>(m) + offset) std::atomic<uint8_t>(0);
+          return true;
+      },
+      true);
+
+    if (!mem)
+        return false;
+
+    release();
+
+    char* const base = static_cast<char*>(mem.get());
+
+    shared           = std::move(mem);
+    clusterCount     = count;
+    table            = reinterpret_cast<Cluster*>(base);
+    sharedGeneration = reinterpret_cast<std::atomic<uint8_t>*>(base + offset);
+    generation8      = sharedGeneration->load(std::memory_order_relaxed);
+
+    return true;
+}
+
+
 // Returns an approximation of the hashtable
 // occupation during a search. The hash is x permill full, as per UCI protocol.
 // Only counts entries which match the current generation.
@@ -205,9 +705,29 @@ int TranspositionTable::hashfull(int maxAge) const {
 }
 
 
+// Makes room for a new game in constant time. The generation jumps by half a
+// cycle, 16 searches, so that the entries of the last 16 searches look at least
+// that old and are replaced before the entries of the new game. The age wraps
+// around though: the entries written 16 to 31 searches before the jump look as
+// recent as those of the last 16 searches of the new game, an entry of exactly
+// 16 searches before as recent as a new one. Re-stamping them would take a pass
+// over the table, which is what the jump avoids. Nothing is erased either: until
+// they are replaced, a probe of the same position can still hit old entries.
+void TranspositionTable::age() {
+    constexpr uint8_t delta = (GENERATION_CYCLE / 2) & GENERATION_MASK;
+
+    generation8 =
+      sharedGeneration ? sharedGeneration->fetch_add(delta) + delta : generation8 + delta;
+}
+
+
+// A shared table counts the searches of all the processes, each one searching
+// with the generation it advanced the shared one to.
 void TranspositionTable::new_search() {
     // increment by delta to keep lower bits as is
-    generation8 += GENERATION_DELTA;
+    generation8 = sharedGeneration
+                  ? sharedGeneration->fetch_add(GENERATION_DELTA) + GENERATION_DELTA
+                  : generation8 + GENERATION_DELTA;
 }
 
 
@@ -19,19 +19,36 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
 #include <tuple>
 
 #include "memory.h"
+#include "misc.h"
 #include "types.h"
 
 namespace Stockfish {
 
 class ThreadPool;
+class NumaConfig;
 struct TTEntry;
 struct Cluster;
 
+// Placement of the table pages on the NUMA nodes. The pages land on the node of the
+// thread that first touches them, i.e. the thread zeroing them in `clear`. With `Auto`
+// these are the search threads, wherever they run. `Interleave` spreads the pages evenly
+// over all the nodes, `Bind` over the nodes of the search threads, in proportion to the
+// number of threads bound to each node.
+enum class TTNumaPolicy {
+    Auto,
+    Interleave,
+    Bind
+};
+
 // There is only one global hash table for the engine and all its threads. For chess in particular, we even allow racy
 // updates between threads to and from the TT, as taking the time to synchronize access would cost thinking time and
 // thus elo. As a hash table, collisions are possible and may cause chess playing issues (bizarre blunders, faulty mate
@@ -81,10 +98,20 @@ struct TTWriter {
 class TranspositionTable {
 
    public:
-    ~TranspositionTable() { aligned_large_pages_free(table); }
+    ~TranspositionTable() { release(); }
 
     void resize(size_t mbSize, ThreadPool& threads);  // Set TT size
+    void rehash(size_t mbSize, ThreadPool& threads);  // Set TT size, keeping the entries
     void clear(ThreadPool& threads);                  // Re-initialize memory, multithreaded
+    void age();  // Make the recent entries stale without touching the memory
+    bool save(const std::string& file) const;         // Write the table and its age to disk
+    bool load(const std::string& file, size_t mbSize);  // Map a table saved with the given size
+    bool share(const std::string& directory, size_t mbSize);  // Map a table shared by processes
+    bool is_shared() const { return bool(shared); }
+    void set_numa_policy(const NumaConfig& config, TTNumaPolicy policy);  // Used by `clear`
+    std::map<int, size_t> numa_page_distribution() const;  // Sampled pages per OS NUMA node
+    std::string           pages_information() const;       // Size of the pages backing the table
+    size_t                memory() const;                  // Bytes of the table
     int  hashfull(int maxAge = 0)
       const;  // Approximate what fraction of entries (permille) have been written to during this root search
 
@@ -99,12 +126,64 @@ class TranspositionTable {
    private:
     friend struct TTEntry;
 
+    void release();
+    void clear_on_numa_nodes(size_t threadCount);
+
     size_t   clusterCount;
     Cluster* table = nullptr;
 
+    // When loaded from disk, the table lives in a private (copy-on-write) mapping
+    // of the file, so that entries are only read when first accessed.
+    void*    mappedAddress = nullptr;
+    uint64_t mapping       = 0;
+
+    // When shared, the table lives in a file mapped by every process using the same
+    // directory and size, followed by the generation all of them search with.
+    SharedMemoryPtr       shared;
+    std::atomic<uint8_t>* sharedGeneration = nullptr;
+
+    const NumaConfig* numaConfig = nullptr;
+    TTNumaPolicy      numaPolicy = TTNumaPolicy::Auto;
+
     uint8_t generation8 = 0;  // Size must be not bigger than TTEntry::genBound8
 };
 
+
+// The moves the threads of a pool are searching, for ABDADA style work sharing: a
+// helper thread puts off a move another thread is already searching at the same
+// depth, so that the threads spread over more subtrees. Racy like the TT, as a lost
+// or stale entry only changes the order in which a thread searches its moves.
+class SearchingTable {
+
+   public:
+    // 64 entries per thread, several times the moves each thread searches at once
+    void resize(size_t threadCount) {
+        size_t count = 1024;
+        while (count < 64 * threadCount)
+            count *= 2;
+
+        if (count != size)
+        {
+            table = std::make_unique<std::atomic<Key>[]>(count);
+            size  = count;
+        }
+    }
+
+    static Key key(Key posKey, Move m, Depth d) {
+        return posKey ^ make_key(m.raw() | uint64_t(d) << 16);
+    }
+
+    bool contains(Key k) const { return entry(k).load(std::memory_order_relaxed) == k; }
+    void insert(Key k) { entry(k).store(k, std::memory_order_relaxed); }
+    void erase(Key k) { entry(k).compare_exchange_strong(k, 0, std::memory_order_relaxed); }
+
+   private:
+    std::atomic<Key>& entry(Key k) const { return table[mul_hi64(k, size)]; }
+
+    std::unique_ptr<std::atomic<Key>[]> table;
+    size_t                              size = 0;
+};
+
 }  // namespace Stockfish
 
 #endif  // #ifndef TT_H_INCLUDED
@@ -19,12 +19,14 @@
 #include "tune.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <map>
 #include <optional>
 #include <sstream>
 #include <string>
 
+#include "misc.h"
 #include "ucioption.h"
 
 using std::string;
@@ -106,6 +108,103 @@ void Tune::Entry<Tune::PostUpdate>::read_option() {
     value();
 }
 
+void Tune::for_each_value(const std::function<void(const string&, int&, Range)>& f) {
+    for (auto& e : instance().list)
+        if (auto* entry = dynamic_cast<Entry<int>*>(e.get()))
+            f(entry->name, entry->value, entry->range(entry->value));
+}
+
+void Tune::post_update() {
+    for (auto& e : instance().list)
+        if (auto* entry = dynamic_cast<Entry<PostUpdate>*>(e.get()))
+            entry->value();
+}
+
+
+namespace {
+
+// The constants of the gain schedule of fishtest
+constexpr double SpsaAlpha = 0.602, SpsaGamma = 0.101, SpsaREnd = 0.002;
+
+}
+
+Spsa::Spsa(size_t gamePairs) :
+    totalPairs(std::max<size_t>(gamePairs, 1)),
+    stability(0.1 * totalPairs) {
+
+    const double n = double(totalPairs);
+
+    // Like make_option(), skip the parameters with nothing to tune
+    Tune::for_each_value([&](const string& name, int& value, Range r) {
+        if (r.first == r.second)
+            return;
+
+        const double cEnd = (r.second - r.first) / 20.0;
+
+        params.push_back({name, &value, value, r.first, r.second, double(value),
+                          cEnd * std::pow(n, SpsaGamma),
+                          SpsaREnd * cEnd * cEnd * std::pow(stability + n, SpsaAlpha), 1});
+    });
+}
+
+void Spsa::perturb(PRNG& rng) {
+
+    ck = std::pow(double(pairsPlayed + 1), -SpsaGamma);
+
+    uint64_t bits = 0;
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        if (i % 64 == 0)
+            bits = rng.rand<uint64_t>();
+
+        params[i].sign = (bits >> (i % 64)) & 1 ? 1 : -1;
+    }
+}
+
+void Spsa::apply(int sign) const {
+
+    for (const auto& p : params)
+        *p.value = std::clamp(int(std::lround(p.theta + sign * p.sign * ck * p.c)), p.min, p.max);
+
+    Tune::post_update();
+}
+
+void Spsa::update(int score, size_t pairs) {
+
+    const double ak = std::pow(stability + double(pairsPlayed + 1), -SpsaAlpha);
+
+    for (auto& p : params)
+        p.theta = std::clamp(p.theta + ak * p.a / (ck * p.c) * score * p.sign, double(p.min),
+                             double(p.max));
+
+    pairsPlayed += pairs;
+}
+
+void Spsa::finish() const {
+
+    apply(0);
+
+    // The options are set in the order they were added, so that with
+    // UPDATE_ON_LAST() the values are read once all of them are set.
+    for (const auto& p : params)
+        if (Tune::options && Tune::options->count(p.name))
+        {
+            std::istringstream is("name " + p.name + " value " + std::to_string(*p.value));
+            Tune::options->setoption(is);
+        }
+}
+
+void Spsa::write_results(std::ostream& os) const {
+
+    const double ak = std::pow(stability + double(pairsPlayed + 1), -SpsaAlpha);
+    const double c  = std::pow(double(pairsPlayed + 1), -SpsaGamma);
+
+    for (const auto& p : params)
+        os << "param: " << p.name << ", best: " << p.theta << ", start: " << p.start
+           << ", min: " << p.min << ", max: " << p.max << ", c: " << c * p.c
+           << ", a: " << ak * p.a << "\n";
+}
+
 }  // namespace Stockfish
 
 
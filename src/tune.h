@@ -20,6 +20,8 @@
 #define TUNE_H_INCLUDED
 
 #include <cstddef>
+#include <functional>
+#include <iosfwd>
 #include <memory>
 #include <string>
 #include <type_traits>  // IWYU pragma: keep
@@ -29,6 +31,7 @@
 namespace Stockfish {
 
 class OptionsMap;
+class PRNG;
 
 using Range    = std::pair<int, int>;  // Option's min-max values
 using RangeFun = Range(int);
@@ -166,10 +169,65 @@ class Tune {
             e->read_option();
     }
 
+    // The tuned values with their ranges, and the post-update functions, for the
+    // changes of the values in memory by Spsa
+    static void for_each_value(const std::function<void(const std::string&, int&, Range)>& f);
+    static void post_update();
+
     static bool        update_on_last;
     static OptionsMap* options;
 };
 
+// Tunes the parameters of TUNE() in memory by simultaneous perturbation stochastic
+// approximation (SPSA), as fishtest does with the UCI options: game pairs are
+// played between an engine with the parameters perturbed up, the plus engine,
+// and one with them perturbed down, and the parameters move along the
+// perturbation by the score of the plus engine. The gains follow the schedule
+// of fishtest, so that at the last pair the perturbation of a parameter is
+// c_end = (max - min) / 20 and its step r_end * c_end, with r_end = 0.002.
+//
+// The parameters are globals, so the two engines can't search at the same time.
+// An iteration plays several game pairs with the same perturbation instead, the
+// plus engine searching in all the games, then the minus engine, in turn.
+class Spsa {
+   public:
+    explicit Spsa(size_t gamePairs);
+
+    bool empty() const { return params.empty(); }
+
+    // Draws the signs of the perturbation of the next iteration
+    void perturb(PRNG& rng);
+
+    // Sets the parameters to the values of the plus engine (1), of the minus
+    // engine (-1), or to the tuned values (0)
+    void apply(int sign) const;
+
+    // Ends the iteration, of the given number of game pairs, by the score of the
+    // plus engine: its wins minus its losses
+    void update(int score, size_t pairs);
+
+    // Sets the parameters, and their UCI options, to the tuned values
+    void finish() const;
+
+    // One line per parameter, in the format of the tuning results of fishtest,
+    // see Tune::read_results()
+    void write_results(std::ostream& os) const;
+
+   private:
+    struct Parameter {
+        std::string name;
+        int*        value;
+        int         start, min, max;
+        double      theta, c, a;
+        int         sign;
+    };
+
+    std::vector<Parameter> params;
+    size_t                 pairsPlayed = 0, totalPairs;
+    double                 stability;
+    double                 ck = 0;  // Perturbation gain of the iteration, relative to c
+};
+
 // Some macro magic :-) we define a dummy int variable that the compiler initializes calling Tune::add()
 #define STRINGIFY(x) #x
 #define UNIQUE2(x, y) x##y
@@ -22,6 +22,8 @@
 #include <cctype>
 #include <cmath>
 #include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iterator>
 #include <optional>
 #include <sstream>
@@ -36,6 +38,7 @@
 #include "position.h"
 #include "score.h"
 #include "search.h"
+#include "syzygy/tbprobe.h"
 #include "types.h"
 #include "ucioption.h"
 
@@ -52,6 +55,33 @@ struct overload: Ts... {
 template<typename... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+namespace {
+
+// The hardware events per unit of work, one per line with the values aligned at
+// the given column, followed by the instructions per cycle
+std::string format_perf_counts(const PerfCounters::Values& counts, uint64_t units, int column) {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+
+    auto line = [&](std::string_view name, double value) {
+        ss << "\n    " << std::left << std::setw(column - 4) << name << ": " << value;
+    };
+
+    for (int e = 0; e < PerfCounters::EVENT_NB; ++e)
+        if (counts[e])
+            line(PerfCounters::name(PerfCounters::Event(e)),
+                 double(*counts[e]) / std::max<uint64_t>(units, 1));
+
+    if (counts[PerfCounters::Cycles] && counts[PerfCounters::Instructions])
+        line("ipc", double(*counts[PerfCounters::Instructions])
+                      / std::max<uint64_t>(*counts[PerfCounters::Cycles], 1));
+
+    return ss.str().empty() ? " not available" : ss.str();
+}
+
+}
+
 void UCIEngine::print_info_string(std::string_view str) {
     sync_cout_start();
     for (auto& line : split(str, "\n"))
@@ -61,6 +91,9 @@ void UCIEngine::print_info_string(std::string_view str) {
             std::cout << "info string " << line << '\n';
         }
     }
+    // Also sent from the search threads, e.g. the stats after bestmove, which
+    // would otherwise only reach the GUI with the output of its next command
+    std::cout << std::flush;
     sync_cout_end();
 }
 
@@ -82,6 +115,8 @@ void UCIEngine::init_search_update_listeners() {
     engine.set_on_update_full(
       [this](const auto& i) { on_update_full(i, engine.get_options()["UCI_ShowWDL"]); });
     engine.set_on_bestmove([](const auto& bm, const auto& p) { on_bestmove(bm, p); });
+    engine.set_on_search_stats(
+      [this](const auto& s) { on_search_stats(s, engine.get_options()["SearchStats"] == "json"); });
     engine.set_on_verify_networks([](const auto& s) { print_info_string(s); });
 }
 
@@ -132,7 +167,7 @@ void UCIEngine::loop() {
         else if (token == "position")
             position(is);
         else if (token == "ucinewgame")
-            engine.search_clear();
+            engine.new_game();
         else if (token == "isready")
             sync_cout << "readyok" << sync_endl;
 
@@ -144,8 +179,18 @@ void UCIEngine::loop() {
             bench(is);
         else if (token == BenchmarkCommand)
             benchmark(is);
+        else if (token == "analyse")
+            analyse(is);
+        else if (token == "generate_training_data")
+            generate_training_data(is);
+        else if (token == "spsa")
+            spsa(is);
+        else if (token == "evalbatch")
+            evalbatch(is);
         else if (token == "d")
             sync_cout << engine.visualize() << sync_endl;
+        else if (token == "memory")
+            print_info_string(engine.memory_information_as_string());
         else if (token == "eval")
             engine.trace_eval();
         else if (token == "compiler")
@@ -153,14 +198,55 @@ void UCIEngine::loop() {
         else if (token == "export_net")
         {
             std::pair<std::optional<std::string>, std::string> files[2];
+            bool                                               raw = false;
+
+            if (is >> std::skipws >> files[0].second && files[0].second == "raw")
+            {
+                raw = true;
+                files[0].second.clear();
+                is >> std::skipws >> files[0].second;
+            }
 
-            if (is >> std::skipws >> files[0].second)
+            if (!files[0].second.empty())
                 files[0].first = files[0].second;
 
             if (is >> std::skipws >> files[1].second)
                 files[1].first = files[1].second;
 
-            engine.save_network(files);
+            engine.save_network(files, raw);
+        }
+        else if (token == "tt")
+        {
+            std::string action, file;
+            is >> std::skipws >> action >> file;
+
+            if (action == "save" && !file.empty())
+                print_info_string(engine.save_tt(file) ? "Hash saved to " + file
+                                                       : "Failed to save hash to " + file);
+            else if (action == "load" && !file.empty())
+                print_info_string(engine.load_tt(file)
+                                    ? "Hash loaded from " + file
+                                    : "Failed to load hash from " + file
+                                        + ", missing or not saved with the current Hash size");
+            else
+                sync_cout << "Usage: tt save|load <file>" << sync_endl;
+        }
+        else if (token == "cluster")
+        {
+            std::string host;
+            int         port = 0;
+            is >> std::skipws >> host >> port;
+
+            if (host.empty() || !port)
+                sync_cout << "Usage: cluster <host of the main machine> <ClusterPort>" << sync_endl;
+            else
+            {
+                print_info_string("Cluster searching for " + host + ":" + std::to_string(port));
+                print_info_string(engine.serve_cluster(host, port)
+                                    ? "Cluster main machine disconnected"
+                                    : "Cluster can't connect to " + host + ":"
+                                        + std::to_string(port));
+            }
         }
         else if (token == "--help" || token == "help" || token == "--license" || token == "license")
             sync_cout
@@ -230,9 +316,38 @@ void UCIEngine::go(std::istringstream& is) {
 void UCIEngine::bench(std::istream& args) {
     std::string token;
     uint64_t    num, nodes = 0, cnt = 1;
-    uint64_t    nodesSearched = 0;
+    uint64_t    nodesSearched = 0, ttProbes = 0, ttHits = 0;
     const auto& options       = engine.get_options();
 
+    Tablebases::WDLCache::Stats tbCache{};
+
+    // With "perf" the hardware events of the searches are counted, see PerfCounters
+    bool countEvents = false;
+
+    if (const auto start = args.tellg(); args >> token && token == "perf")
+        countEvents = true;
+    else
+    {
+        args.clear();
+        args.seekg(start);
+    }
+
+    if (const auto start = args.tellg(); args >> token && token == "components")
+    {
+        bench_components(args, countEvents);
+        return;
+    }
+    else if (token == "prefetch")
+    {
+        bench_prefetch(args);
+        return;
+    }
+    else
+    {
+        args.clear();
+        args.seekg(start);
+    }
+
     engine.set_on_update_full([&](const auto& i) {
         nodesSearched = i.nodes;
         on_update_full(i, options["UCI_ShowWDL"]);
@@ -243,6 +358,12 @@ void UCIEngine::bench(std::istream& args) {
     num = count_if(list.begin(), list.end(),
                    [](const std::string& s) { return s.find("go ") == 0 || s.find("eval") == 0; });
 
+    const auto [blockProbesBefore, blockHitsBefore] = engine.get_tb_block_cache_probes_and_hits();
+
+    // Without "perf" the counting is left to the caller, see bench_prefetch()
+    if (countEvents)
+        engine.set_perf_counting(true);
+
     TimePoint elapsed = now();
 
     for (const auto& cmd : list)
@@ -264,6 +385,16 @@ void UCIEngine::bench(std::istream& args) {
                 {
                     engine.go(limits);
                     engine.wait_for_search_finished();
+
+                    auto [probes, hits] = engine.get_tt_probes_and_hits();
+                    ttProbes += probes;
+                    ttHits += hits;
+
+                    auto s = engine.get_tb_cache_stats();
+                    tbCache.probes += s.probes;
+                    tbCache.hits += s.hits;
+                    tbCache.missNanoseconds += s.missNanoseconds;
+                    tbCache.deferred += s.deferred;
                 }
 
                 nodes += nodesSearched;
@@ -290,12 +421,131 @@ void UCIEngine::bench(std::istream& args) {
     std::cerr << "\n==========================="    //
               << "\nTotal time (ms) : " << elapsed  //
               << "\nNodes searched  : " << nodes    //
-              << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
+              << "\nNodes/second    : " << 1000 * nodes / elapsed          //
+              << "\nTT hit rate (%) : " << 100.0 * ttHits / std::max<uint64_t>(ttProbes, 1)
+              << "\nNNUE cache (KB) : " << engine.get_refresh_cache_memory() / 1024 << std::endl;
+
+    if (countEvents)
+    {
+        std::cerr << "Per node        :" << format_perf_counts(engine.get_perf_counts(), nodes, 20)
+                  << std::endl;
+        engine.set_perf_counting(false);
+    }
+
+    // The probes missing the cache give the average cost of a probe
+    if (tbCache.probes)
+    {
+        const uint64_t misses = tbCache.probes - tbCache.hits;
+
+        std::cerr << "TB cache hit (%): " << 100.0 * tbCache.hits / tbCache.probes
+                  << "\nTB saved (ms)   : "
+                  << (misses ? double(tbCache.hits) * tbCache.missNanoseconds / misses / 1e6 : 0.0)
+                  << "\nTB deferred     : " << tbCache.deferred << std::endl;
+    }
+
+    auto [blockProbes, blockHits] = engine.get_tb_block_cache_probes_and_hits();
+    blockProbes -= blockProbesBefore;
+    blockHits -= blockHitsBefore;
+
+    if (blockProbes)
+        std::cerr << "TB block hit (%): " << 100.0 * blockHits / blockProbes << std::endl;
 
     // reset callback, to not capture a dangling reference to nodesSearched
     engine.set_on_update_full([&](const auto& i) { on_update_full(i, options["UCI_ShowWDL"]); });
 }
 
+// Times the engine components in isolation over the positions of the given
+// source (see Benchmark::read_positions), by default the bench positions, and
+// prints the result as a single line of JSON. With "perf", the hardware events
+// per operation are added, for those that can be counted:
+//
+// bench components            : time the components on the bench positions
+// bench components blah       : time the components on the positions in file "blah"
+// bench perf components       : time and count the events of the components
+void UCIEngine::bench_components(std::istream& args, bool countEvents) {
+    std::string fenFile = "default";
+    args >> fenFile;
+
+    std::vector<std::string> fens;
+    for (const auto& fen : Benchmark::read_positions(engine.fen(), fenFile))
+        if (fen.find("setoption") != 0)
+            fens.push_back(fen);
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2) << "{\"positions\":" << fens.size()
+       << ",\"components\":[";
+
+    for (const auto& t : engine.benchmark_components(fens, countEvents))
+    {
+        const double nsPerOp = double(t.nanoseconds) / std::max<uint64_t>(t.ops, 1);
+
+        ss << (ss.str().back() == '[' ? "" : ",") << "{\"name\":\"" << t.name
+           << "\",\"ops\":" << t.ops << ",\"ns\":" << t.nanoseconds
+           << ",\"ns_per_op\":" << nsPerOp
+           << ",\"ops_per_second\":" << (t.ops ? 1e9 / nsPerOp : 0.0);
+
+        for (int e = 0; e < PerfCounters::EVENT_NB; ++e)
+            if (t.events[e])
+                ss << ",\"" << PerfCounters::name(PerfCounters::Event(e))
+                   << "_per_op\":" << double(*t.events[e]) / std::max<uint64_t>(t.ops, 1);
+
+        ss << "}";
+    }
+
+    sync_cout << ss.str() << "]}" << sync_endl;
+}
+
+// Runs the bench twice, first without and then with the prefetching of the
+// history entries read by the child nodes (the "HistoryPrefetch" option), and
+// compares the time and the misses of the last level cache of the searches:
+//
+// bench prefetch [bench arguments]
+void UCIEngine::bench_prefetch(std::istream& args) {
+    const std::string benchArgs((std::istreambuf_iterator<char>(args)), {});
+    const bool        original = bool(engine.get_options()["HistoryPrefetch"]);
+
+    TimePoint               elapsed[2];
+    std::optional<uint64_t> misses[2];
+
+    for (bool enabled : {false, true})
+    {
+        std::istringstream option(std::string("name HistoryPrefetch value ")
+                                  + (enabled ? "true" : "false"));
+        setoption(option);
+
+        engine.set_perf_counting(true);
+        elapsed[enabled] = now();
+
+        std::istringstream is(benchArgs);
+        bench(is);
+
+        elapsed[enabled] = now() - elapsed[enabled];
+        misses[enabled]  = engine.get_perf_counts()[PerfCounters::LLCMisses];
+        engine.set_perf_counting(false);
+    }
+
+    std::istringstream option(std::string("name HistoryPrefetch value ")
+                              + (original ? "true" : "false"));
+    setoption(option);
+
+    std::stringstream ss;
+    ss << "\n==========================="
+       << "\nHistoryPrefetch  : off / on"
+       << "\nTotal time (ms)  : " << elapsed[false] << " / " << elapsed[true]
+       << "\nLLC misses       : ";
+
+    if (misses[false] && misses[true])
+        ss << *misses[false] << " / " << *misses[true] << " (" << std::showpos << std::fixed
+           << std::setprecision(2)
+           << 100.0 * (double(*misses[true]) - double(*misses[false]))
+                / double(std::max<uint64_t>(*misses[false], 1))
+           << "%)";
+    else
+        ss << "not available";
+
+    std::cerr << ss.str() << std::endl;
+}
+
 void UCIEngine::benchmark(std::istream& args) {
     // Probably not very important for a test this long, but include for completeness and sanity.
     static constexpr int NUM_WARMUP_POSITIONS = 3;
@@ -304,11 +554,28 @@ void UCIEngine::benchmark(std::istream& args) {
     uint64_t    nodes = 0, cnt = 1;
     uint64_t    nodesSearched = 0;
 
+    // With "perf" the hardware events of the searches are counted, see PerfCounters
+    bool countEvents = false;
+
+    if (const auto start = args.tellg(); args >> token && token == "sweep")
+    {
+        benchmark_sweep(args);
+        return;
+    }
+    else if (token == "perf")
+        countEvents = true;
+    else
+    {
+        args.clear();
+        args.seekg(start);
+    }
+
     engine.set_on_update_full([&](const Engine::InfoFull& i) { nodesSearched = i.nodes; });
 
     engine.set_on_iter([](const auto&) {});
     engine.set_on_update_no_moves([](const auto&) {});
     engine.set_on_bestmove([](const auto&, const auto&) {});
+    engine.set_on_search_stats([](const auto&) {});
     engine.set_on_verify_networks([](const auto&) {});
 
     Benchmark::BenchmarkSetup setup = Benchmark::setup_benchmark(args);
@@ -366,6 +633,8 @@ void UCIEngine::benchmark(std::istream& args) {
     cnt   = 1;
     nodes = 0;
 
+    int64_t totalStartLatency = 0, totalStopLatency = 0;
+
     int           numHashfullReadings = 0;
     constexpr int hashfullAges[]      = {0, 999};  // Only normal hashfull and touched hash.
     int           totalHashfull[std::size(hashfullAges)] = {0};
@@ -383,6 +652,7 @@ void UCIEngine::benchmark(std::istream& args) {
     };
 
     engine.search_clear();  // search_clear may take a while
+    engine.set_perf_counting(countEvents);
 
     for (const auto& cmd : setup.commands)
     {
@@ -404,6 +674,10 @@ void UCIEngine::benchmark(std::istream& args) {
 
             totalTime += now() - elapsed;
 
+            const auto [startLatency, stopLatency] = engine.get_search_latencies();
+            totalStartLatency += startLatency;
+            totalStopLatency += stopLatency;
+
             updateHashfullReadings();
 
             nodes += nodesSearched;
@@ -453,13 +727,372 @@ void UCIEngine::benchmark(std::istream& args) {
               << totalHashfull[1] / numHashfullReadings
               << "\nTotal nodes searched       : " << nodes
               << "\nTotal search time [s]      : " << totalTime / 1000.0
-              << "\nNodes/second               : " << 1000 * nodes / totalTime << std::endl;
+              << "\nNodes/second               : " << 1000 * nodes / totalTime
+              << "\nLatency avg [us]           : "
+              << "\n    go to all searching    : " << totalStartLatency / numGoCommands
+              << "\n    stop to bestmove       : " << totalStopLatency / numGoCommands << std::endl;
 
     // clang-format on
 
+    if (countEvents)
+    {
+        std::cerr << "Hardware events per node   :"
+                  << format_perf_counts(engine.get_perf_counts(), nodes, 27) << std::endl;
+        engine.set_perf_counting(false);
+    }
+
+    init_search_update_listeners();
+}
+
+// Runs the speedtest workload for each NUMA policy at 1, 2, 4, ... and the given
+// number of threads, and prints the NPS, the average depth, the TT hit rate and
+// the scaling efficiency of each step, as a table and as a line of JSON. The
+// efficiency is the NPS per thread relative to the first step of the policy. A
+// policy giving the same NUMA configuration as a previous one is skipped.
+//
+// speedtest sweep [max threads] [hash MiB] [seconds per step]
+void UCIEngine::benchmark_sweep(std::istream& args) {
+    static constexpr int NUM_WARMUP_POSITIONS = 3;
+
+    struct Step {
+        std::string policy;
+        int         threads;
+        uint64_t    nodes, nps;
+        double      depth, ttHitRate, efficiency;
+    };
+
+    std::string token;
+    uint64_t    nodesSearched = 0;
+    int         depthSearched = 0;
+
+    engine.set_on_update_full([&](const Engine::InfoFull& i) {
+        nodesSearched = i.nodes;
+        depthSearched = i.depth;
+    });
+
+    engine.set_on_iter([](const auto&) {});
+    engine.set_on_update_no_moves([](const auto&) {});
+    engine.set_on_bestmove([](const auto&, const auto&) {});
+    engine.set_on_search_stats([](const auto&) {});
+    engine.set_on_verify_networks([](const auto&) {});
+
+    Benchmark::BenchmarkSetup setup = Benchmark::setup_benchmark(args);
+
+    auto set = [&](const std::string& name, const std::string& value) {
+        std::istringstream is("name " + name + " value " + value);
+        setoption(is);
+    };
+
+    // Runs the go commands of the workload, at most maxSearches of them
+    auto run = [&](Step& step, int maxSearches) {
+        TimePoint totalTime = 0;
+        uint64_t  ttProbes = 0, ttHits = 0, depths = 0;
+        int       searches = 0;
+
+        step.nodes = 0;
+        engine.search_clear();
+
+        for (const auto& cmd : setup.commands)
+        {
+            std::istringstream is(cmd);
+            is >> std::skipws >> token;
+
+            if (token == "go")
+            {
+                Search::LimitsType limits = parse_limits(is);
+
+                TimePoint elapsed = now();
+
+                engine.go(limits);
+                engine.wait_for_search_finished();
+
+                totalTime += now() - elapsed;
+
+                const auto [probes, hits] = engine.get_tt_probes_and_hits();
+                ttProbes += probes;
+                ttHits += hits;
+
+                step.nodes += nodesSearched;
+                depths += depthSearched;
+                nodesSearched = depthSearched = 0;
+
+                if (++searches == maxSearches)
+                    break;
+            }
+            else if (token == "position")
+                position(is);
+            else if (token == "ucinewgame")
+                engine.search_clear();  // search_clear may take a while
+        }
+
+        step.nps       = 1000 * step.nodes / std::max<TimePoint>(totalTime, 1);
+        step.depth     = double(depths) / std::max(searches, 1);
+        step.ttHitRate = 100.0 * ttHits / std::max<uint64_t>(ttProbes, 1);
+    };
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < setup.threads; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(setup.threads);
+
+    const std::string originalPolicy = engine.get_options()["NumaPolicy"];
+
+    set("Hash", std::to_string(setup.ttSize));
+    set("UCI_Chess960", "false");
+
+    std::vector<Step>        steps;
+    std::vector<std::string> configs;
+    uint64_t                 firstNps = 1;
+
+    for (const std::string policy : {"none", "system", "hardware"})
+    {
+        set("NumaPolicy", policy);
+
+        const std::string config = engine.get_numa_config_as_string();
+        if (std::find(configs.begin(), configs.end(), config) != configs.end())
+        {
+            std::cerr << "NumaPolicy " << policy << " skipped, same configuration" << std::endl;
+            continue;
+        }
+        configs.push_back(config);
+
+        for (int threads : threadCounts)
+        {
+            set("Threads", std::to_string(threads));
+
+            Step step{policy, threads, 0, 0, 0, 0, 0};
+
+            if (steps.empty())
+                run(step, NUM_WARMUP_POSITIONS);
+
+            run(step, -1);
+
+            if (threads == threadCounts[0])
+                firstNps = std::max<uint64_t>(step.nps, 1);
+
+            step.efficiency = 100.0 * step.nps / (firstNps * threads);
+
+            std::cerr << "NumaPolicy " << policy << ", " << threads << " threads: " << step.nps
+                      << " nps" << std::endl;
+
+            steps.push_back(step);
+        }
+    }
+
+    set("NumaPolicy", originalPolicy);
+
+    std::stringstream table, json;
+    table << std::fixed << std::setprecision(1);
+    json << std::fixed << std::setprecision(2);
+
+    table << "\n==========================="
+          << "\nFilled invocation : " << BenchmarkCommand << " sweep " << setup.filledInvocation
+          << "\n\n" << std::left << std::setw(10) << "NumaPolicy" << std::right << std::setw(8)
+          << "Threads" << std::setw(14) << "Nodes/second" << std::setw(8) << "Depth"
+          << std::setw(12) << "TT hit (%)" << std::setw(16) << "Efficiency (%)";
+
+    json << "{\"invocation\":\"" << setup.filledInvocation << "\",\"steps\":[";
+
+    for (const auto& s : steps)
+    {
+        table << "\n" << std::left << std::setw(10) << s.policy << std::right << std::setw(8)
+              << s.threads << std::setw(14) << s.nps << std::setw(8) << s.depth << std::setw(12)
+              << s.ttHitRate << std::setw(16) << s.efficiency;
+
+        json << (&s == &steps[0] ? "" : ",") << "{\"numapolicy\":\"" << s.policy
+             << "\",\"threads\":" << s.threads << ",\"nodes\":" << s.nodes
+             << ",\"nps\":" << s.nps << ",\"depth\":" << s.depth
+             << ",\"tthitrate\":" << s.ttHitRate << ",\"efficiency\":" << s.efficiency << "}";
+    }
+
+    std::cerr << table.str() << std::endl;
+    sync_cout << json.str() << "]}" << sync_endl;
+
     init_search_update_listeners();
 }
 
+// Searches the positions of the given source (see Benchmark::setup_analysis) and
+// prints a result line for each, in input order. For a game, the results are
+// printed in the order of the game once all are known, each with the move played
+// from the position, and the score of the position from the side to move.
+void UCIEngine::analyse(std::istream& args) {
+    Benchmark::AnalysisSetup setup = Benchmark::setup_analysis(engine.fen(), args);
+
+    std::istringstream is(setup.limits);
+    Search::LimitsType limits = parse_limits(is);
+    limits.infinite = limits.ponderMode = false;
+
+    const bool game = !setup.threadsPerJob;
+    if (game)
+        setup.threadsPerJob = size_t(engine.get_options()["Threads"]);
+
+    uint64_t                 nodes   = 0;
+    TimePoint                elapsed = now();
+    std::vector<std::string> gameResults(game ? setup.fens.size() : 0);
+
+    engine.analyse(
+      setup.fens, setup.threadsPerJob, limits,
+      [&](size_t idx, std::string_view fen, const Engine::InfoFull& info,
+          std::string_view bestmove) {
+          nodes += info.nodes;
+
+          // The positions of a game are searched from the last one
+          const size_t ply = setup.fens.size() - 1 - idx;
+
+          std::stringstream ss;
+
+          if (game)
+              ss << "result " << ply + 1 << " move "
+                 << (ply < setup.gameMoves.size() ? setup.gameMoves[ply] : "(none)");
+          else
+              ss << "result " << idx + 1 << " fen " << fen;
+
+          ss << " depth " << info.depth << " seldepth " << info.selDepth << " score "
+             << format_score(info.score) << " nodes " << info.nodes << " time " << info.timeMs
+             << " bestmove " << bestmove;
+
+          if (!info.pv.empty())
+              ss << " pv " << info.pv;
+
+          if (game)
+              gameResults[ply] = ss.str();
+          else
+              sync_cout << ss.str() << sync_endl;
+      });
+
+    for (const auto& line : gameResults)
+        sync_cout << line << sync_endl;
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                       //
+              << "\nPositions       : " << setup.fens.size()           //
+              << "\nThreads per job : " << setup.threadsPerJob         //
+              << "\nTotal time (ms) : " << elapsed                     //
+              << "\nNodes searched  : " << nodes                       //
+              << "\nNodes/second    : " << 1000 * nodes / elapsed      //
+              << "\nPositions/second: " << 1000.0 * setup.fens.size() / elapsed << std::endl;
+}
+
+// Plays self-play games and appends their positions to the output file, in the
+// plain text format of the NNUE trainers: a fen, move, score, ply and result
+// line for each position, followed by a line "e". Or in the packed format if
+// the name of the file ends with ".pack", see TrainingData::Writer.
+void UCIEngine::generate_training_data(std::istream& args) {
+    Benchmark::TrainingDataSetup setup = Benchmark::setup_training_data(engine.fen(), args);
+
+    TrainingData::Writer writer(setup.output, engine.get_options()["UCI_Chess960"]);
+    if (!writer.is_open())
+    {
+        print_info_string("Unable to open " + setup.output);
+        return;
+    }
+
+    std::istringstream is(setup.limits);
+    Search::LimitsType limits = parse_limits(is);
+    limits.infinite = limits.ponderMode = false;
+
+    size_t    games = 0, positions = 0;
+    TimePoint elapsed = now();
+
+    engine.generate_training_data(
+      setup, limits, [&](const std::vector<Engine::TrainingPosition>& game) {
+          positions += game.size();
+          writer.write(std::vector<Engine::TrainingPosition>(game));
+
+          if (++games % 1000 == 0)
+              print_info_string("games " + std::to_string(games) + " positions "
+                                + std::to_string(positions));
+      });
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                  //
+              << "\nGames           : " << games                 //
+              << "\nPositions       : " << positions             //
+              << "\nThreads per game: " << setup.threadsPerGame  //
+              << "\nTotal time (ms) : " << elapsed               //
+              << "\nPositions/second: " << 1000.0 * positions / elapsed << std::endl;
+}
+
+// Tunes the parameters of TUNE() by SPSA, see Spsa. The results are written to
+// the output file at each checkpoint, in the format of the tuning results of
+// fishtest, and the parameters keep the tuned values at the end.
+void UCIEngine::spsa(std::istream& args) {
+    Benchmark::SpsaSetup setup = Benchmark::setup_spsa(engine.fen(), args);
+
+    Spsa spsa(setup.gamePairs);
+    if (spsa.empty())
+    {
+        print_info_string("No parameters to tune, see TUNE() in tune.h");
+        return;
+    }
+
+    std::istringstream is(setup.limits);
+    Search::LimitsType limits = parse_limits(is);
+    limits.infinite = limits.ponderMode = false;
+
+    size_t    nextCheckpoint = setup.checkpoint;
+    int64_t   score          = 0;
+    bool      written        = true;
+    TimePoint elapsed        = now();
+
+    auto write_results = [&]() {
+        std::ofstream file(setup.output);
+        spsa.write_results(file);
+        written = bool(file);
+    };
+
+    engine.tune_spsa(setup, limits, spsa, [&](size_t pairs, int iterationScore) {
+        score += iterationScore;
+
+        if (pairs >= nextCheckpoint || pairs == setup.gamePairs)
+        {
+            write_results();
+            print_info_string("pairs " + std::to_string(pairs) + " score " + std::to_string(score)
+                              + (written ? "" : ", unable to write " + setup.output));
+            nextCheckpoint = pairs + setup.checkpoint;
+        }
+    });
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                 //
+              << "\nGame pairs      : " << setup.gamePairs       //
+              << "\nScore of plus   : " << score                 //
+              << "\nThreads per game: " << setup.threadsPerGame  //
+              << "\nTotal time (ms) : " << elapsed               //
+              << "\nPairs/second    : " << 1000.0 * setup.gamePairs / elapsed << "\n\n";
+    spsa.write_results(std::cerr);
+}
+
+// Statically evaluates all positions of the given source (see
+// Benchmark::read_positions), by default the current position. Scores are from
+// the point of view of the side to move.
+void UCIEngine::evalbatch(std::istream& args) {
+    std::string fenFile = "current";
+    args >> fenFile;
+
+    std::vector<std::string> fens;
+    for (const auto& fen : Benchmark::read_positions(engine.fen(), fenFile))
+        if (fen.find("setoption") != 0)
+            fens.push_back(fen);
+
+    TimePoint elapsed = now();
+
+    engine.evaluate_batch(fens, [](size_t idx, std::string_view fen, std::optional<Score> score) {
+        sync_cout << "result " << idx + 1 << " fen " << fen << " score "
+                  << (score ? format_score(*score) : "none") << sync_endl;
+    });
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                    //
+              << "\nPositions       : " << fens.size()              //
+              << "\nTotal time (ms) : " << elapsed                  //
+              << "\nPositions/second: " << 1000 * fens.size() / elapsed << std::endl;
+}
+
 void UCIEngine::setoption(std::istringstream& is) {
     engine.wait_for_search_finished();
     engine.get_options().setoption(is);
@@ -617,11 +1250,11 @@ Move UCIEngine::to_move(const Position& pos, std::string str) {
     return Move::none();
 }
 
-void UCIEngine::on_update_no_moves(const Engine::InfoShort& info) {
-    sync_cout << "info depth " << info.depth << " score " << format_score(info.score) << sync_endl;
+std::string UCIEngine::format_update_no_moves(const Engine::InfoShort& info) {
+    return "info depth " + std::to_string(info.depth) + " score " + format_score(info.score);
 }
 
-void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
+std::string UCIEngine::format_update_full(const Engine::InfoFull& info, bool showWDL) {
     std::stringstream ss;
 
     ss << "info";
@@ -643,10 +1276,10 @@ void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
        << " time " << info.timeMs        //
        << " pv " << info.pv;             //
 
-    sync_cout << ss.str() << sync_endl;
+    return ss.str();
 }
 
-void UCIEngine::on_iter(const Engine::InfoIter& info) {
+std::string UCIEngine::format_iter(const Engine::InfoIter& info) {
     std::stringstream ss;
 
     ss << "info";
@@ -654,14 +1287,90 @@ void UCIEngine::on_iter(const Engine::InfoIter& info) {
        << " currmove " << info.currmove               //
        << " currmovenumber " << info.currmovenumber;  //
 
-    sync_cout << ss.str() << sync_endl;
+    return ss.str();
 }
 
-void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder) {
-    sync_cout << "bestmove " << bestmove;
+std::string UCIEngine::format_bestmove(std::string_view bestmove, std::string_view ponder) {
+    std::string line = "bestmove " + std::string(bestmove);
     if (!ponder.empty())
-        std::cout << " ponder " << ponder;
-    std::cout << sync_endl;
+        line += " ponder " + std::string(ponder);
+    return line;
+}
+
+void UCIEngine::on_update_no_moves(const Engine::InfoShort& info) {
+    sync_cout << format_update_no_moves(info) << sync_endl;
+}
+
+void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
+    sync_cout << format_update_full(info, showWDL) << sync_endl;
+}
+
+void UCIEngine::on_iter(const Engine::InfoIter& info) {
+    sync_cout << format_iter(info) << sync_endl;
+}
+
+void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder) {
+    sync_cout << format_bestmove(bestmove, ponder) << sync_endl;
+}
+
+// Prints the counters of the last search, one line per thread when there are
+// several, followed by their sum. The rates are percentages and the CPU time is
+// in microseconds.
+void UCIEngine::on_search_stats(const std::vector<Engine::Stats>& stats, bool json) {
+
+    auto percent = [](uint64_t part, uint64_t total) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << 100.0 * part / std::max<uint64_t>(total, 1);
+        return ss.str();
+    };
+
+    auto format = [&](const Engine::Stats& s) {
+        std::stringstream ss;
+
+        if (json)
+            ss << "{\"nodes\":" << s.nodes << ",\"qnodes\":" << s.qsearchNodes
+               << ",\"qnodeshare\":" << percent(s.qsearchNodes, s.nodes)
+               << ",\"tthitrate\":" << percent(s.ttHits, s.ttProbes)
+               << ",\"firstmovecutoffs\":" << percent(s.firstMoveCutoffs, s.cutoffs)
+               << ",\"deferredmoves\":" << s.deferredMoves
+               << ",\"nnueupdates\":" << s.nnueUpdates << ",\"nnuerefreshes\":" << s.nnueRefreshes
+               << ",\"evalcachehitrate\":" << percent(s.evalCacheHits, s.evalCacheProbes)
+               << ",\"tbprobes\":" << s.tbProbes << ",\"tbhits\":" << s.tbHits
+               << ",\"tbdeferred\":" << s.tbDeferred << ",\"cputime\":" << s.cpuTime << "}";
+        else
+            ss << "nodes " << s.nodes << " qnodes " << s.qsearchNodes << " qnodeshare "
+               << percent(s.qsearchNodes, s.nodes) << " tthitrate " << percent(s.ttHits, s.ttProbes)
+               << " firstmovecutoffs " << percent(s.firstMoveCutoffs, s.cutoffs)
+               << " deferredmoves " << s.deferredMoves << " nnueupdates " << s.nnueUpdates
+               << " nnuerefreshes " << s.nnueRefreshes << " evalcachehitrate "
+               << percent(s.evalCacheHits, s.evalCacheProbes) << " tbprobes " << s.tbProbes
+               << " tbhits " << s.tbHits << " tbdeferred " << s.tbDeferred << " cputime "
+               << s.cpuTime;
+
+        return ss.str();
+    };
+
+    Engine::Stats total;
+
+    for (const auto& s : stats)
+        total += s;
+
+    if (json)
+    {
+        std::string threads;
+
+        for (const auto& s : stats)
+            threads += (threads.empty() ? "" : ",") + format(s);
+
+        print_info_string("stats {\"threads\":[" + threads + "],\"total\":" + format(total) + "}");
+        return;
+    }
+
+    if (stats.size() > 1)
+        for (size_t i = 0; i < stats.size(); ++i)
+            print_info_string("stats thread " + std::to_string(i) + " " + format(stats[i]));
+
+    print_info_string("stats " + format(total));
 }
 
 }  // namespace Stockfish
@@ -52,6 +52,12 @@ class UCIEngine {
 
     static Search::LimitsType parse_limits(std::istream& is);
 
+    // The lines reporting a search, without the end of line
+    static std::string format_update_no_moves(const Engine::InfoShort& info);
+    static std::string format_update_full(const Engine::InfoFull& info, bool showWDL);
+    static std::string format_iter(const Engine::InfoIter& info);
+    static std::string format_bestmove(std::string_view bestmove, std::string_view ponder);
+
     auto& engine_options() { return engine.get_options(); }
 
    private:
@@ -62,7 +68,14 @@ class UCIEngine {
 
     void          go(std::istringstream& is);
     void          bench(std::istream& args);
+    void          bench_components(std::istream& args, bool countEvents);
+    void          bench_prefetch(std::istream& args);
     void          benchmark(std::istream& args);
+    void          benchmark_sweep(std::istream& args);
+    void          analyse(std::istream& args);
+    void          generate_training_data(std::istream& args);
+    void          spsa(std::istream& args);
+    void          evalbatch(std::istream& args);
     void          position(std::istringstream& is);
     void          setoption(std::istringstream& is);
     std::uint64_t perft(const Search::LimitsType&);
@@ -71,6 +84,7 @@ class UCIEngine {
     static void on_update_full(const Engine::InfoFull& info, bool showWDL);
     static void on_iter(const Engine::InfoIter& info);
     static void on_bestmove(std::string_view bestmove, std::string_view ponder);
+    static void on_search_stats(const std::vector<Engine::Stats>& stats, bool json);
 
     void init_search_update_listeners();
 };
@@ -59,6 +59,7 @@ class Option {
    private:
     friend class OptionsMap;
     friend class Engine;
+    friend class SessionServer;
     friend class Tune;
 
 
@@ -92,6 +93,7 @@ class OptionsMap {
    private:
     friend class Engine;
     friend class Option;
+    friend class SessionServer;
 
     friend std::ostream& operator<<(std::ostream&, const OptionsMap&);
 
@@ -1,9 +1,13 @@
 import argparse
+import json
 import re
 import sys
 import subprocess
 import pathlib
 import os
+import shutil
+import socket
+import tempfile
 
 from testing import (
     EPD,
@@ -38,6 +42,11 @@ def get_path():
     return os.path.abspath(os.path.join(CWD, args.stockfish_path))
 
 
+def get_bench_fens():
+    with open(os.path.join(PATH, "bench_tmp.epd")) as f:
+        return [line.strip() for line in f if line.strip()]
+
+
 def postfix_check(output):
     if args.sanitizer_undefined:
         for idx, line in enumerate(output):
@@ -148,6 +157,119 @@ class TestCLI(metaclass=OrderedClassMembers):
         )
         assert self.stockfish.process.returncode == 0
 
+    def test_analyse_bench_tmp_epd_depth(self):
+        self.stockfish = Stockfish(
+            f"analyse file {os.path.join(PATH,'bench_tmp.epd')} depth 5".split(" "),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+
+        # One result with a score and a best move per position, in the order of the file
+        results = re.findall(
+            r"^result (\d+) fen (.+?) depth 5 .*score (?:cp|mate) -?\d+ .*bestmove \S+",
+            self.stockfish.process.stdout,
+            re.MULTILINE,
+        )
+        fens = get_bench_fens()
+        assert results == [(str(i + 1), fen) for i, fen in enumerate(fens)]
+
+    def test_evalbatch_bench_tmp_epd(self):
+        self.stockfish = Stockfish(
+            f"evalbatch {os.path.join(PATH,'bench_tmp.epd')}".split(" "),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+
+        # One value per position, in the order of the file
+        results = re.findall(
+            r"^result (\d+) fen (.+?) score (cp -?\d+|none)$",
+            self.stockfish.process.stdout,
+            re.MULTILINE,
+        )
+        fens = get_bench_fens()
+        assert [result[:2] for result in results] == [
+            (str(i + 1), fen) for i, fen in enumerate(fens)
+        ]
+
+        # The value of the first position is the one of the eval command, which
+        # is from the side of white
+        stockfish = Stockfish()
+        stockfish.send_command(f"position fen {fens[0]}")
+        stockfish.send_command("eval")
+
+        value = None
+
+        def callback(output):
+            nonlocal value
+            match = re.match(r"Final evaluation +([+-]?\d+\.\d+) \(white side\)", output)
+            if match:
+                value = round(float(match.group(1)) * 100)
+            return match is not None
+
+        stockfish.check_output(callback)
+        stockfish.quit()
+        assert stockfish.close() == 0
+
+        if " b " in fens[0]:
+            value = -value
+        assert results[0][2] == f"cp {value}"
+
+    def test_generate_training_data_bench_tmp_epd(self):
+        output = os.path.join(PATH, "training_tmp.plain")
+        self.stockfish = Stockfish(
+            f"generate_training_data games 4 file {os.path.join(PATH,'bench_tmp.epd')} "
+            f"output {output} nodes 1000".split(" "),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+        assert os.path.getsize(output) > 0
+        os.remove(output)
+
+    def test_generate_packed_training_data_and_evalbatch(self):
+        output = os.path.join(PATH, "training_tmp.pack")
+        self.stockfish = Stockfish(
+            f"generate_training_data games 4 output {output} nodes 1000".split(" "),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+        self.stockfish = Stockfish(f"evalbatch {output}".split(" "), True)
+        assert self.stockfish.process.returncode == 0
+        os.remove(output)
+
+    def test_bench_components_bench_tmp_epd(self):
+        self.stockfish = Stockfish(
+            f"bench components {os.path.join(PATH,'bench_tmp.epd')}".split(" "),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+
+        lines = self.stockfish.process.stdout.splitlines()
+        report = json.loads(next(line for line in lines if line.startswith("{")))
+        assert report["positions"] == len(get_bench_fens())
+
+        names = [component["name"] for component in report["components"]]
+        assert names == [
+            "movegen",
+            "do_move",
+            "nnue_incremental",
+            "nnue_refresh",
+            "tt_probe",
+            "tb_probe",
+        ]
+
+        for component in report["components"]:
+            for key in ["ops", "ns", "ns_per_op", "ops_per_second"]:
+                assert isinstance(component[key], (int, float)) and component[key] >= 0
+
+    def test_bench_prefetch_bench_tmp_epd_depth(self):
+        self.stockfish = Stockfish(
+            f"bench prefetch 16 {get_threads()} 3 {os.path.join(PATH,'bench_tmp.epd')} depth".split(
+                " "
+            ),
+            True,
+        )
+        assert self.stockfish.process.returncode == 0
+
     def test_d(self):
         self.stockfish = Stockfish("d".split(" "), True)
         assert self.stockfish.process.returncode == 0
@@ -156,6 +278,10 @@ class TestCLI(metaclass=OrderedClassMembers):
         self.stockfish = Stockfish("compiler".split(" "), True)
         assert self.stockfish.process.returncode == 0
 
+    def test_memory(self):
+        self.stockfish = Stockfish("memory".split(" "), True)
+        assert self.stockfish.process.returncode == 0
+
     def test_license(self):
         self.stockfish = Stockfish("license".split(" "), True)
         assert self.stockfish.process.returncode == 0
@@ -292,6 +418,33 @@ class TestInteractive(metaclass=OrderedClassMembers):
     def test_clear_hash(self):
         self.stockfish.send_command("setoption name Clear Hash")
 
+    def test_fast_new_game(self):
+        # The hashfull of each iteration of a search of the position after e2e4
+        def search_hashfull(depth):
+            self.stockfish.send_command("position startpos moves e2e4")
+            self.stockfish.send_command(f"go depth {depth}")
+
+            hashfull = []
+
+            def callback(output):
+                if output.startswith("info depth "):
+                    hashfull.append(int(re.search(r" hashfull (\d+) ", output).group(1)))
+                return output.startswith("bestmove")
+
+            self.stockfish.check_output(callback)
+            return hashfull
+
+        self.stockfish.send_command("setoption name FastNewGame value true")
+        assert search_hashfull(12)[-1] > 0
+
+        # The entries of the one search so far are aged by half a cycle, so none of
+        # them counts for the hashfull of the new game. Entries of 16 searches
+        # before the new game would, as the age wraps around.
+        self.stockfish.send_command("ucinewgame")
+        assert search_hashfull(8)[0] == 0
+
+        self.stockfish.send_command("setoption name FastNewGame value false")
+
     def test_fen_position_mate_1(self):
         self.stockfish.send_command("ucinewgame")
         self.stockfish.send_command(
@@ -349,6 +502,19 @@ class TestInteractive(metaclass=OrderedClassMembers):
 
         self.stockfish.starts_with("bestmove")
 
+    def test_fen_position_with_mate_solver(self):
+        self.stockfish.send_command("ucinewgame")
+        self.stockfish.send_command("setoption name MateSolver value true")
+        self.stockfish.send_command(
+            "position fen 8/5R2/2K1P3/4k3/8/b1PPpp1B/5p2/8 w - -"
+        )
+        self.stockfish.send_command("go mate 2")
+        self.stockfish.expect("* score mate 2 * pv c6d7 * f7f5")
+        self.stockfish.expect("info string Mate solver: proof tree of *")
+
+        self.stockfish.starts_with("bestmove c6d7")
+        self.stockfish.send_command("setoption name MateSolver value false")
+
     def test_fen_position_depth_27(self):
         self.stockfish.send_command("ucinewgame")
         self.stockfish.send_command(
@@ -398,12 +564,361 @@ class TestInteractive(metaclass=OrderedClassMembers):
         self.stockfish.send_command("go depth 5")
         self.stockfish.starts_with("bestmove")
 
+    def test_raw_network(self):
+        current_path = os.path.abspath(os.getcwd())
+        Stockfish(
+            f"export_net raw {os.path.join(current_path , 'raw_big.nnue')} {os.path.join(current_path , 'raw_small.nnue')}".split(
+                " "
+            ),
+            True,
+        )
+
+        self.stockfish.send_command("setoption name EvalFile value raw_big.nnue")
+        self.stockfish.send_command("setoption name EvalFileSmall value raw_small.nnue")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 5")
+        self.stockfish.starts_with("bestmove")
+
+        # converting back to the standard format gives the original net
+        self.stockfish.send_command("export_net raw_verify.nnue")
+        self.stockfish.equals("Network saved successfully to raw_verify.nnue")
+        diff = subprocess.run(["diff", "raw_verify.nnue", "verify.nnue"])
+        assert diff.returncode == 0
+
+        self.stockfish.send_command("setoption name EvalFile value verify.nnue")
+
     def test_multipv_setting(self):
         self.stockfish.send_command("setoption name MultiPV value 4")
         self.stockfish.send_command("position startpos")
         self.stockfish.send_command("go depth 5")
         self.stockfish.starts_with("bestmove")
 
+    def test_multipv_info_rate(self):
+        # The number of lines of a search sent as info
+        def search_lines():
+            self.stockfish.send_command("setoption name Clear Hash")
+            self.stockfish.send_command("position startpos")
+            self.stockfish.send_command("go depth 8")
+
+            lines = 0
+
+            def callback(output):
+                nonlocal lines
+                if re.match(r"info depth \d+ .* multipv \d+ ", output):
+                    lines += 1
+                return output.startswith("bestmove")
+
+            self.stockfish.check_output(callback)
+            return lines
+
+        self.stockfish.send_command("setoption name MultiPV value 20")
+        lines = search_lines()
+
+        self.stockfish.send_command("setoption name InfoInterval value 100")
+        self.stockfish.send_command("setoption name InfoChangedOnly value true")
+        limitedLines = search_lines()
+        assert 0 < limitedLines < lines
+
+        self.stockfish.send_command("setoption name InfoChangedOnly value false")
+        self.stockfish.send_command("setoption name InfoInterval value 0")
+        self.stockfish.send_command("setoption name MultiPV value 1")
+
+    def test_multipv_groups(self):
+        self.stockfish.send_command("setoption name MultiPV value 8")
+        self.stockfish.send_command("setoption name MultiPVGroups value 4")
+        self.stockfish.send_command("setoption name Threads value 4")
+        self.stockfish.send_command("position startpos moves e2e4 e7e5")
+        self.stockfish.send_command("go depth 10")
+
+        # The first move of each line of the last iteration
+        lines = {}
+
+        def callback(output):
+            match = re.match(r"info depth 10 .* multipv (\d+) .* pv (\S+)", output)
+            if match:
+                lines[int(match.group(1))] = match.group(2)
+            return output.startswith("bestmove")
+
+        self.stockfish.check_output(callback)
+
+        # The groups together report all the lines, each with another move
+        assert sorted(lines) == list(range(1, 9))
+        assert len(set(lines.values())) == 8
+
+        self.stockfish.send_command("setoption name Threads value 1")
+        self.stockfish.send_command("setoption name MultiPVGroups value 1")
+        self.stockfish.send_command("setoption name MultiPV value 1")
+
+    def test_tt_save_and_load(self):
+        # The nodes of a search of the start position
+        def search_nodes():
+            self.stockfish.send_command("position startpos")
+            self.stockfish.send_command("go depth 8")
+
+            nodes = None
+
+            def callback(output):
+                nonlocal nodes
+                if output.startswith("info depth "):
+                    nodes = int(re.search(r" nodes (\d+) ", output).group(1))
+                return output.startswith("bestmove")
+
+            self.stockfish.check_output(callback)
+            return nodes
+
+        self.stockfish.send_command("setoption name Clear Hash")
+        nodes = search_nodes()
+        self.stockfish.send_command("tt save tt_tmp.bin")
+        self.stockfish.equals("info string Hash saved to tt_tmp.bin")
+
+        self.stockfish.send_command("setoption name Clear Hash")
+        self.stockfish.send_command("tt load tt_tmp.bin")
+        self.stockfish.equals("info string Hash loaded from tt_tmp.bin")
+
+        # The search starts out with the entries of the saved one, the histories
+        # are still clear
+        assert search_nodes() < nodes
+
+        self.stockfish.send_command("setoption name Clear Hash")
+        os.remove("tt_tmp.bin")
+
+    def test_result_cache(self):
+        self.stockfish.send_command("setoption name ResultCache value rc_tmp.bin")
+        self.stockfish.equals("info string Result cache in rc_tmp.bin, 64 MB")
+        self.stockfish.send_command("position startpos moves g1f3 g8f6 f3g1 f6g8")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        # Closing the cache writes the queued results
+        self.stockfish.send_command("setoption name ResultCache value")
+        self.stockfish.equals("info string Result cache is off")
+        self.stockfish.send_command("setoption name ResultCache value rc_tmp.bin")
+        self.stockfish.equals("info string Result cache in rc_tmp.bin, 64 MB")
+        self.stockfish.send_command("go depth 6")
+        self.stockfish.expect("info depth 8 seldepth 8 multipv 1 score * nodes 0 *")
+        self.stockfish.starts_with("bestmove")
+        # The same position after a repetition is searched again
+        self.stockfish.send_command("position startpos moves g1f3 g8f6 f3g1 f6g8")
+        self.stockfish.send_command("go depth 6")
+        self.stockfish.expect("info depth 1 seldepth * multipv 1 score *")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name ResultCache value")
+        self.stockfish.equals("info string Result cache is off")
+        os.remove("rc_tmp.bin")
+
+    def test_hash_rehash(self):
+        # The nodes of a search repeated after growing the TT from 16 to 64 MB
+        def research_nodes(rehash):
+            self.stockfish.send_command("setoption name Hash value 16")
+            self.stockfish.send_command(f"setoption name HashRehash value {rehash}")
+            self.stockfish.send_command("ucinewgame")
+            self.stockfish.send_command("position startpos moves e2e4 e7e5")
+            self.stockfish.send_command("go depth 10")
+            self.stockfish.starts_with("bestmove")
+            self.stockfish.send_command("setoption name Hash value 64")
+            self.stockfish.send_command("go depth 10")
+
+            nodes = None
+
+            def callback(output):
+                nonlocal nodes
+                if output.startswith("info depth 10 "):
+                    nodes = int(re.search(r" nodes (\d+) ", output).group(1))
+                return output.startswith("bestmove")
+
+            self.stockfish.check_output(callback)
+            return nodes
+
+        # The entries kept by the resize save most of the search
+        assert research_nodes("true") < research_nodes("false")
+
+        self.stockfish.send_command("setoption name HashRehash value true")
+        self.stockfish.send_command("setoption name Hash value 3")
+        self.stockfish.send_command("go depth 10")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name Hash value 16")
+        self.stockfish.send_command("setoption name HashRehash value false")
+
+    def test_analyse_threads_per_job(self):
+        self.stockfish.send_command("setoption name Threads value 4")
+        self.stockfish.send_command("analyse file default threads-per-job 2 depth 5")
+        self.stockfish.contains("result 48 fen")
+        self.stockfish.send_command(f"setoption name Threads value {get_threads()}")
+
+    def test_analyse_game(self):
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("analyse game e2e4 e7e5 g1f3 depth 6")
+        self.stockfish.starts_with("result 1 move e2e4")
+        self.stockfish.starts_with("result 2 move e7e5")
+        self.stockfish.starts_with("result 3 move g1f3")
+        self.stockfish.starts_with("result 4 move (none)")
+
+    def test_spsa_without_parameters(self):
+        self.stockfish.send_command("spsa pairs 2 nodes 100")
+        self.stockfish.equals("info string No parameters to tune, see TUNE() in tune.h")
+
+    def test_small_refresh_cache(self):
+        # The memory of the threads, then the nodes and the best move of a search
+        # in which the kings move, so that the accumulators are refreshed
+        def search(size):
+            self.stockfish.send_command(f"setoption name RefreshCacheSize value {size}")
+            self.stockfish.send_command("memory")
+            self.stockfish.send_command("ucinewgame")
+            self.stockfish.send_command("position startpos moves e2e4 e7e5 e1e2 e8e7 e2d3")
+            self.stockfish.send_command("go depth 10")
+
+            result = [0, None, None]
+
+            def callback(output):
+                match = re.match(r"info string Memory of the threads on node \d+: (\d+)", output)
+                if match:
+                    result[0] += int(match.group(1))
+                if output.startswith("info depth 10 "):
+                    result[1] = int(re.search(r" nodes (\d+) ", output).group(1))
+                if output.startswith("bestmove"):
+                    result[2] = output.split()[1]
+                    return True
+                return False
+
+            self.stockfish.check_output(callback)
+            return result
+
+        full = search(64)
+        small = search(2)
+
+        # The cache only saves work, the accumulators and the search are the same
+        assert small[0] < full[0]
+        assert small[1:] == full[1:]
+
+        self.stockfish.send_command("setoption name RefreshCacheSize value 64")
+
+    def test_shared_histories(self):
+        # The memory of the threads, over all the NUMA nodes
+        def threads_memory():
+            self.stockfish.send_command("memory")
+
+            memory = 0
+
+            def callback(output):
+                nonlocal memory
+                match = re.match(r"info string Memory of the threads on node \d+: (\d+)", output)
+                if match:
+                    memory += int(match.group(1))
+                return output.startswith("info string Memory total")
+
+            self.stockfish.check_output(callback)
+            return memory
+
+        self.stockfish.send_command("setoption name Threads value 4")
+        own = threads_memory()
+
+        # The threads no longer have histories of their own
+        self.stockfish.send_command("setoption name SharedHistories value true")
+        assert threads_memory() < own
+
+        self.stockfish.send_command("position startpos moves e2e4 e7e5")
+        self.stockfish.send_command("go depth 10")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name Threads value 1")
+        self.stockfish.send_command("setoption name SharedHistories value false")
+
+    def test_defer_searched_moves(self):
+        self.stockfish.send_command("setoption name DeferSearchedMoves value true")
+        self.stockfish.send_command("setoption name SearchStats value info")
+        self.stockfish.send_command("setoption name Threads value 4")
+        self.stockfish.send_command("position startpos moves e2e4 e7e5")
+        self.stockfish.send_command("go depth 14")
+        self.stockfish.starts_with("bestmove")
+
+        deferred = None
+
+        def callback(output):
+            nonlocal deferred
+            if output.startswith("info string stats nodes "):
+                deferred = int(re.search(r" deferredmoves (\d+) ", output).group(1))
+                return True
+            return False
+
+        # The helper threads put off some of the moves searched by the others
+        self.stockfish.check_output(callback)
+        assert deferred > 0
+
+        self.stockfish.send_command("setoption name Threads value 1")
+        self.stockfish.send_command("setoption name SearchStats value off")
+        self.stockfish.send_command("setoption name DeferSearchedMoves value false")
+
+    def test_search_stats(self):
+        self.stockfish.send_command("setoption name SearchStats value info")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.expect("info string stats nodes * qnodes * tthitrate *")
+        self.stockfish.send_command("setoption name SearchStats value json")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.contains('info string stats {"threads":[{"nodes":')
+        self.stockfish.send_command("setoption name SearchStats value off")
+
+    def test_shared_networks(self):
+        shared_dir = tempfile.mkdtemp()
+        self.stockfish.send_command(f"setoption name EvalSharedPath value {shared_dir}")
+        self.stockfish.equals(f"info string NNUE weights shared from {shared_dir}")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name EvalSharedPath value")
+        self.stockfish.equals("info string NNUE weights are private")
+        shutil.rmtree(shared_dir)
+
+    def test_shared_hash(self):
+        shared_dir = tempfile.mkdtemp()
+        self.stockfish.send_command(f"setoption name HashSharedPath value {shared_dir}")
+        self.stockfish.equals(f"info string Hash shared from {shared_dir}")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name Clear Hash")
+        self.stockfish.send_command("setoption name HashSharedPath value")
+        self.stockfish.equals("info string Hash is private")
+        shutil.rmtree(shared_dir)
+
+    def test_cluster_port(self):
+        self.stockfish.send_command("setoption name ClusterPort value 40123")
+        self.stockfish.equals("info string Cluster listening on port 40123 of 127.0.0.1")
+        self.stockfish.send_command("position startpos")
+        self.stockfish.send_command("go depth 8")
+        self.stockfish.starts_with("bestmove")
+        self.stockfish.send_command("setoption name ClusterPort value 0")
+        self.stockfish.equals("info string Cluster is off")
+
+    def test_server_port(self):
+        self.stockfish.send_command("setoption name ServerPort value 40124")
+        self.stockfish.starts_with("info string Server listening on port 40124 of 127.0.0.1")
+
+        with socket.create_connection(("127.0.0.1", 40124)) as s:
+            s.sendall(b"position startpos moves e2e4\ngo depth 8\n")
+            lines = s.makefile("r")
+            assert any(line.startswith("bestmove") for line in lines)
+
+        self.stockfish.send_command("setoption name ServerAddress value localhost")
+        self.stockfish.equals("info string Server can't listen on port 40124 of localhost")
+        self.stockfish.send_command("setoption name ServerAddress value 127.0.0.1")
+        self.stockfish.starts_with("info string Server listening on port 40124 of 127.0.0.1")
+
+        self.stockfish.send_command("setoption name ServerPort value 0")
+        self.stockfish.equals("info string Server is off")
+
+    def test_perft_hash(self):
+        self.stockfish.send_command("setoption name PerftHash value 16")
+        self.stockfish.send_command(
+            "position fen r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+        )
+        self.stockfish.send_command("go perft 4")
+        self.stockfish.expect("Nodes searched: 4085603")
+        self.stockfish.send_command("setoption name PerftHash value 0")
+
     def test_fen_position_with_skill_level(self):
         self.stockfish.send_command("setoption name Skill Level value 10")
         self.stockfish.send_command("position startpos")
@@ -412,6 +927,39 @@ class TestInteractive(metaclass=OrderedClassMembers):
 
         self.stockfish.send_command("setoption name Skill Level value 20")
 
+    def test_skill_fast(self):
+        # The nodes of a search of the start position to depth 12
+        def search_nodes():
+            self.stockfish.send_command("ucinewgame")
+            self.stockfish.send_command("position startpos")
+            self.stockfish.send_command("go depth 12")
+
+            nodes = None
+
+            def callback(output):
+                nonlocal nodes
+                if output.startswith("info depth "):
+                    nodes = int(re.search(r" nodes (\d+) ", output).group(1))
+                return output.startswith("bestmove")
+
+            self.stockfish.check_output(callback)
+            return nodes
+
+        full = search_nodes()
+
+        self.stockfish.send_command("setoption name UCI_LimitStrength value true")
+        self.stockfish.send_command("setoption name UCI_Elo value 1350")
+        self.stockfish.send_command("setoption name Skill Fast value true")
+
+        # The weak move is picked at a low depth, which ends the search
+        assert search_nodes() < full
+
+        self.stockfish.send_command("go wtime 60000 btime 60000")
+        self.stockfish.starts_with("bestmove")
+
+        self.stockfish.send_command("setoption name Skill Fast value false")
+        self.stockfish.send_command("setoption name UCI_LimitStrength value false")
+
 
 class TestSyzygy(metaclass=OrderedClassMembers):
     def beforeAll(self):
@@ -475,6 +1023,24 @@ class TestSyzygy(metaclass=OrderedClassMembers):
         self.stockfish.check_output(check_output)
         self.stockfish.expect("bestmove *")
 
+    def test_syzygy_numa_replicate(self):
+        self.stockfish.send_command("setoption name NumaPolicy value 0")
+        self.stockfish.send_command("setoption name SyzygyNumaReplicate value true")
+        self.stockfish.send_command("setoption name SyzygyPreload value wdl")
+        self.stockfish.expect("info string Preloaded 35 tablebase files*")
+        self.stockfish.expect("info string Replicated 35 WDL tablebase files*")
+
+        self.stockfish.send_command("ucinewgame")
+        self.stockfish.send_command("position fen 4k3/PP6/8/8/8/8/8/4K3 w - - 0 1")
+        self.stockfish.send_command("go depth 5")
+
+        def check_output(output):
+            if "score cp 20000" in output or "score mate" in output:
+                return True
+
+        self.stockfish.check_output(check_output)
+        self.stockfish.expect("bestmove *")
+
 
 def parse_args():
     parser = argparse.ArgumentParser(description="Run Stockfish with testing options")